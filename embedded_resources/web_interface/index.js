@@ -440,6 +440,43 @@ async function fetchSystemInfo() {
   Dialog.loading.hide();
 }
 
+async function fetchSnifferStats() {
+  Dialog.loading.show('Fetching sniffer statistics...');
+  let kind = $("#sniffer-stats-kind").value;
+  let req = await requestGet("/snifferstats", {
+    kind: kind,
+    sort: $("#sniffer-stats-sort").value,
+    top: 50
+  });
+  let rows = JSON.parse(req);
+  let body = $(".dialog.sniffer-stats tbody");
+  body.innerHTML = "";
+  $(".dialog.sniffer-stats .sniffer-stats-name").textContent = kind === "ap" ? "SSID" : "Network";
+  rows.forEach((r) => {
+    let eapol = [1, 2, 3, 4].map((n) => (r.eapol & (1 << (n - 1))) ? n : "-").join("");
+    let cells = [
+      r.mac, r.frames, `${r.rssiMin}/${r.rssiAvg}/${r.rssiMax}`, eapol, r.sessions, r.channels,
+      kind === "ap" ? r.ssid : r.bssid
+    ];
+    let tr = document.createElement("tr");
+    cells.forEach((value) => {
+      let td = document.createElement("td");
+      td.textContent = value;
+      tr.appendChild(td);
+    });
+    body.appendChild(tr);
+  });
+  if (rows.length === 0) {
+    body.innerHTML = "<tr><td colspan='7'>No statistics yet, run the sniffer first</td></tr>";
+  }
+  Dialog.loading.hide();
+}
+
+function openSnifferStats() {
+  Dialog.show('sniffer-stats');
+  fetchSnifferStats();
+}
+
 async function saveEditorFile(runFile = false) {
   Dialog.loading.show('Saving...');
   let editor = $(".dialog.editor .file-content");
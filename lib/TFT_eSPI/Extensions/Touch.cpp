@@ -24,7 +24,7 @@ inline void TFT_eSPI::begin_touch_read_write(void){
   DMA_BUSY_CHECK;
   CS_H; // Just in case it has been left low
   #if defined (SPI_HAS_TRANSACTION) && defined (SUPPORT_TRANSACTIONS)
-    if (locked) {locked = false; spi.beginTransaction(SPISettings(SPI_TOUCH_FREQUENCY, MSBFIRST, SPI_MODE0));}
+    if (locked) {locked = false; tft_bus_acquire(); spi.beginTransaction(SPISettings(SPI_TOUCH_FREQUENCY, MSBFIRST, SPI_MODE0));}
   #else
     spi.setFrequency(SPI_TOUCH_FREQUENCY);
   #endif
@@ -39,7 +39,7 @@ inline void TFT_eSPI::begin_touch_read_write(void){
 inline void TFT_eSPI::end_touch_read_write(void){
   T_CS_H;
   #if defined (SPI_HAS_TRANSACTION) && defined (SUPPORT_TRANSACTIONS)
-    if(!inTransaction) {if (!locked) {locked = true; spi.endTransaction();}}
+    if(!inTransaction) {if (!locked) {locked = true; spi.endTransaction(); tft_bus_release();}}
   #else
     spi.setFrequency(SPI_FREQUENCY);
   #endif
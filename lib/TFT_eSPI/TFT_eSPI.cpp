@@ -60,6 +60,15 @@
                                                        \
   if (dw < 1 || dh < 1) return;
 
+/***************************************************************************************
+** Function name:           tft_bus_acquire, tft_bus_release
+** Description:             Called when a transaction starts and ends, a sketch that shares
+**                          the display SPI bus with other devices overrides them to keep
+**                          tasks from using the bus at the same time
+***************************************************************************************/
+void __attribute__((weak)) tft_bus_acquire(void) {}
+void __attribute__((weak)) tft_bus_release(void) {}
+
 /***************************************************************************************
 ** Function name:           Legacy - deprecated
 ** Description:             Start/end transaction
@@ -76,6 +85,7 @@
 inline void TFT_eSPI::begin_tft_write(void){
   if (locked) {
     locked = false; // Flag to show SPI access now unlocked
+    tft_bus_acquire();
 #if defined (SPI_HAS_TRANSACTION) && defined (SUPPORT_TRANSACTIONS) && !defined(TFT_PARALLEL_8_BIT) && !defined(RP2040_PIO_INTERFACE)
     spi.beginTransaction(SPISettings(SPI_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
 #endif
@@ -88,6 +98,7 @@ inline void TFT_eSPI::begin_tft_write(void){
 void TFT_eSPI::begin_nin_write(void){
   if (locked) {
     locked = false; // Flag to show SPI access now unlocked
+    tft_bus_acquire();
 #if defined (SPI_HAS_TRANSACTION) && defined (SUPPORT_TRANSACTIONS) && !defined(TFT_PARALLEL_8_BIT) && !defined(RP2040_PIO_INTERFACE)
     spi.beginTransaction(SPISettings(SPI_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
 #endif
@@ -110,6 +121,7 @@ inline void TFT_eSPI::end_tft_write(void){
 #if defined (SPI_HAS_TRANSACTION) && defined (SUPPORT_TRANSACTIONS) && !defined(TFT_PARALLEL_8_BIT) && !defined(RP2040_PIO_INTERFACE)
       spi.endTransaction();
 #endif
+      tft_bus_release();
     }
   }
 }
@@ -125,6 +137,7 @@ inline void TFT_eSPI::end_nin_write(void){
 #if defined (SPI_HAS_TRANSACTION) && defined (SUPPORT_TRANSACTIONS) && !defined(TFT_PARALLEL_8_BIT) && !defined(RP2040_PIO_INTERFACE)
       spi.endTransaction();
 #endif
+      tft_bus_release();
     }
   }
 }
@@ -139,6 +152,7 @@ inline void TFT_eSPI::begin_tft_read(void){
 #if defined (SPI_HAS_TRANSACTION) && defined (SUPPORT_TRANSACTIONS) && !defined(TFT_PARALLEL_8_BIT) && !defined(RP2040_PIO_INTERFACE)
   if (locked) {
     locked = false;
+    tft_bus_acquire();
     spi.beginTransaction(SPISettings(SPI_READ_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
     CS_L;
   }
@@ -162,6 +176,7 @@ inline void TFT_eSPI::end_tft_read(void){
       locked = true;
       CS_H;
       spi.endTransaction();
+      tft_bus_release();
     }
   }
 #else
@@ -426,6 +426,10 @@ typedef struct {
 // Callback prototype for smooth font pixel colour read
 typedef uint16_t (*getColorCallback)(uint16_t x, uint16_t y);
 
+// SPI bus arbitration hooks, weak and empty in the library
+void tft_bus_acquire(void);
+void tft_bus_release(void);
+
 // Class functions and variables
 class TFT_eSPI : public Print {
     friend class TFT_eSprite; // Sprite class has access to protected members
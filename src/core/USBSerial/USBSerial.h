@@ -9,7 +9,24 @@ public:
     size_t println(const String &s) override { return out->println(s); }
     size_t print(const String &s) override { return out->print(s); }
     size_t print(const int n, int format) override { return out->print(n, format); }
-    void vprintf(const char *fmt, va_list args) override { out->printf(fmt, args); }
+    // Formatted here, Stream::printf would take the va_list as a single variadic argument
+    void vprintf(const char *fmt, va_list args) override {
+        char buf[64];
+        va_list copy;
+        va_copy(copy, args);
+        int len = vsnprintf(buf, sizeof(buf), fmt, copy);
+        va_end(copy);
+        if (len < 0) return;
+        if ((size_t)len < sizeof(buf)) {
+            out->write((const uint8_t *)buf, len);
+            return;
+        }
+        char *big = (char *)malloc(len + 1);
+        if (big == nullptr) return;
+        vsnprintf(big, len + 1, fmt, args);
+        out->write((const uint8_t *)big, len);
+        free(big);
+    }
     size_t println() override { return out->println(); }
     size_t println(size_t n) override { return out->println(n); }
     size_t println(const uint32_t n) override { return out->println(n); }
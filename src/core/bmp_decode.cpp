@@ -0,0 +1,87 @@
+#include "bmp_decode.h"
+#include <algorithm>
+#include <cstring>
+
+#define BMP_BI_RGB 0
+#define BMP_BI_BITFIELDS 3
+
+// BMP data is stored little-endian
+static uint16_t bmpRead16(const uint8_t *p) { return p[0] | p[1] << 8; }
+static uint32_t bmpRead32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Byte of a 24 or 32-bit pixel a channel mask selects, -1 if it is not a whole byte
+static int bmpMaskByte(uint32_t mask) {
+    for (int i = 0; i < 4; i++) {
+        if (mask == 0xFFUL << (i * 8)) return i;
+    }
+    return -1;
+}
+
+bool bmpParseHeader(const uint8_t *data, size_t length, BmpInfo &info) {
+    if (length < 54 || bmpRead16(data) != 0x4D42) return false;
+    info.offset = bmpRead32(data + 10);
+    uint32_t headerSize = bmpRead32(data + 14);
+    int32_t w = (int32_t)bmpRead32(data + 18);
+    int32_t h = (int32_t)bmpRead32(data + 22);
+    uint16_t planes = bmpRead16(data + 26);
+    uint16_t bits = bmpRead16(data + 28);
+    uint32_t compression = bmpRead32(data + 30);
+    // The height check also keeps INT32_MIN out, it has no positive counterpart
+    if (headerSize < 40 || planes != 1 || w <= 0 || w > BMP_MAX_WIDTH || h == 0 || h < -BMP_MAX_HEIGHT ||
+        h > BMP_MAX_HEIGHT)
+        return false;
+
+    uint32_t masks[3];
+    if (bits == 16) {
+        masks[0] = 0x7C00;
+        masks[1] = 0x03E0;
+        masks[2] = 0x001F;
+    } else {
+        masks[0] = 0xFF0000;
+        masks[1] = 0x00FF00;
+        masks[2] = 0x0000FF;
+    }
+    if (compression == BMP_BI_BITFIELDS && bits != 24) {
+        // Right after the 40 bytes of the info header, V4 and V5 headers keep them at the same place
+        if (length < BMP_HEADER_BYTES) return false;
+        for (int i = 0; i < 3; i++) masks[i] = bmpRead32(data + 14 + 40 + i * 4);
+    } else if (compression != BMP_BI_RGB) {
+        return false;
+    }
+
+    info.w = w;
+    info.h = h < 0 ? -h : h;
+    info.bottomUp = h > 0;
+    if (bits == 16) {
+        info.format = {2, 0, 0, 0, masks[1] == 0x03E0};
+        info.rowBytes = ((size_t)w * 2 + 3) & ~(size_t)3;
+        if (masks[0] == 0xF800 && masks[1] == 0x07E0 && masks[2] == 0x001F) return true;
+        return masks[0] == 0x7C00 && masks[1] == 0x03E0 && masks[2] == 0x001F;
+    }
+    if (bits != 24 && bits != 32) return false;
+    int r = bmpMaskByte(masks[0]), g = bmpMaskByte(masks[1]), b = bmpMaskByte(masks[2]);
+    if (r < 0 || g < 0 || b < 0 || (bits == 24 && std::max(r, std::max(g, b)) > 2)) return false;
+    info.format = {(uint8_t)(bits / 8), (uint8_t)r, (uint8_t)g, (uint8_t)b, false};
+    info.rowBytes = ((size_t)w * info.format.bytes + 3) & ~(size_t)3;
+    return true;
+}
+
+void bmpConvertRow(const BmpFormat &format, const uint8_t *src, uint16_t *dst, int count) {
+    if (format.bytes == 2) {
+        if (!format.rgb555) {
+            memcpy(dst, src, count * sizeof(uint16_t));
+            return;
+        }
+        const uint16_t *p = (const uint16_t *)src;
+        // The top bit of green is repeated in the new low bit
+        for (int i = 0; i < count; i++) {
+            dst[i] = ((p[i] & 0x7FE0) << 1) | ((p[i] >> 4) & 0x20) | (p[i] & 0x1F);
+        }
+        return;
+    }
+    for (int i = 0; i < count; i++, src += format.bytes) {
+        dst[i] = ((src[format.r] & 0xF8) << 8) | ((src[format.g] & 0xFC) << 3) | (src[format.b] >> 3);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef __BMP_DECODE_H__
+#define __BMP_DECODE_H__
+
+// BMP header parsing and row conversion to RGB565. Plain C++ with no Arduino dependency, the file
+// access stays with the caller, so the decoder can be measured on a host.
+#include <cstddef>
+#include <cstdint>
+
+#define BMP_MAX_WIDTH 8192
+#define BMP_MAX_HEIGHT 65535 // images are captured with 16-bit sizes
+#define BMP_HEADER_BYTES 66  // file and info headers plus the three BITFIELDS masks
+
+struct BmpFormat {
+    uint8_t bytes;   // per pixel
+    uint8_t r, g, b; // byte of each channel in 24 and 32-bit pixels
+    bool rgb555;     // 16-bit pixels with 5 bits of green
+};
+
+struct BmpInfo {
+    int32_t w;
+    int32_t h; // always positive
+    bool bottomUp;
+    uint32_t offset; // of the pixel data
+    size_t rowBytes; // padded to 4 bytes
+    BmpFormat format;
+};
+
+// Uncompressed 16, 24 and 32-bit files, bottom up or top down (negative height), from the first
+// `length` bytes of the file. False for anything else and for sizes over BMP_MAX_WIDTH/HEIGHT.
+bool bmpParseHeader(const uint8_t *data, size_t length, BmpInfo &info);
+
+// Converts count pixels of a row to RGB565
+void bmpConvertRow(const BmpFormat &format, const uint8_t *src, uint16_t *dst, int count);
+
+#endif
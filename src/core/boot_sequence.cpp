@@ -0,0 +1,69 @@
+#include "boot_sequence.h"
+#include <esp_timer.h>
+#include <freertos/event_groups.h>
+
+struct BootStageTask {
+    BootStage *stage;
+    EventGroupHandle_t done;
+    uint32_t bit;
+};
+
+static bool bootInteractiveMarked = false;
+
+static void runStage(BootStage *stage, EventGroupHandle_t done, uint32_t bit) {
+    if (stage->deps) xEventGroupWaitBits(done, stage->deps, pdFALSE, pdTRUE, portMAX_DELAY);
+    stage->startUs = esp_timer_get_time();
+    if (stage->run) stage->run();
+    stage->endUs = esp_timer_get_time();
+    xEventGroupSetBits(done, bit);
+}
+
+static void bootStageTask(void *pvParameters) {
+    BootStageTask *task = (BootStageTask *)pvParameters;
+    runStage(task->stage, task->done, task->bit);
+    delete task;
+    vTaskDelete(NULL);
+}
+
+void runBootStages(BootStage *stages, size_t count) {
+    if (count > BOOT_MAX_STAGES) count = BOOT_MAX_STAGES;
+    EventGroupHandle_t done = xEventGroupCreate();
+    uint32_t all = 0;
+    int64_t begin = esp_timer_get_time();
+
+    // Concurrent stages first, they block on their own dependencies
+    for (size_t i = 0; i < count; i++) {
+        all |= BOOT_STAGE_BIT(i);
+        if (stages[i].core == BOOT_STAGE_INLINE) continue;
+        BootStageTask *task = new BootStageTask{&stages[i], done, BOOT_STAGE_BIT(i)};
+        if (xTaskCreatePinnedToCore(bootStageTask, stages[i].name, 4096, task, 2, NULL, stages[i].core) !=
+            pdPASS) {
+            // No memory for a task, run it in place instead
+            delete task;
+            stages[i].core = BOOT_STAGE_INLINE;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (stages[i].core == BOOT_STAGE_INLINE) runStage(&stages[i], done, BOOT_STAGE_BIT(i));
+    }
+    xEventGroupWaitBits(done, all, pdFALSE, pdTRUE, portMAX_DELAY);
+    vEventGroupDelete(done);
+
+    Serial.printf("[boot] %-12s %10s %10s %5s\n", "stage", "start(us)", "took(us)", "core");
+    for (size_t i = 0; i < count; i++) {
+        Serial.printf(
+            "[boot] %-12s %10lld %10lld %5d\n",
+            stages[i].name,
+            stages[i].startUs,
+            stages[i].endUs - stages[i].startUs,
+            stages[i].core
+        );
+    }
+    Serial.printf("[boot] stages done in %lld us\n", esp_timer_get_time() - begin);
+}
+
+void bootMarkInteractive(const char *what) {
+    if (bootInteractiveMarked) return;
+    bootInteractiveMarked = true;
+    Serial.printf("[boot] %s interactive at %lld us\n", what, esp_timer_get_time());
+}
@@ -0,0 +1,27 @@
+#ifndef __BOOT_SEQUENCE_H__
+#define __BOOT_SEQUENCE_H__
+#include <Arduino.h>
+
+#define BOOT_STAGE_INLINE -1 // run on the caller task (loopTask)
+#define BOOT_STAGE_BIT(i) (1UL << (i))
+#define BOOT_MAX_STAGES 24 // FreeRTOS event groups hold 24 usable bits
+
+struct BootStage {
+    const char *name;
+    void (*run)();
+    uint32_t deps; // BOOT_STAGE_BIT() of the stages that must finish first, always earlier in the table
+    int8_t core;   // core to run on, or BOOT_STAGE_INLINE
+    // filled by runBootStages
+    int64_t startUs;
+    int64_t endUs;
+};
+
+// Runs every stage once its dependencies are done. Inline stages run in table order on the
+// caller task, the others run concurrently in tasks pinned to their core.
+// Prints a per stage timing trace when it finishes.
+void runBootStages(BootStage *stages, size_t count);
+
+// Marks the first interactive frame (menu or startup app) and prints the total boot time once
+void bootMarkInteractive(const char *what);
+
+#endif
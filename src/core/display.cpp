@@ -1,6 +1,8 @@
 #include "display.h"
+#include "bmp_decode.h"
 #include "core/wifi/webInterface.h" // for server
 #include "core/wifi/wg.h"           //for isConnectedWireguard to print wireguard lock
+#include "led_control.h"
 #include "mykeyboard.h"
 #include "settings.h" //for timeStr
 #include "utils.h"
@@ -112,6 +114,7 @@ bool wakeUpScreen() {
         isScreenOff = false;
         dimmer = false;
         getBrightness();
+        ledEffectsScreenWake();
         vTaskDelay(pdMS_TO_TICKS(200));
         return true;
     } else if (dimmer) {
@@ -926,7 +929,7 @@ void drawWireguardStatus(int x, int y) {
 ** Description:   Função para desenhar e mostrar o menu principal
 ***************************************************************************************/
 #define MAX_ITEMS (int)(tftHeight - 20) / (LH * FM)
-Opt_Coord listFiles(int index, std::vector<FileList> fileList) {
+Opt_Coord listFiles(int index, const std::vector<FileList> &fileList) {
     Opt_Coord coord;
     tft.drawPixel(0, 0, bruceConfig.bgColor);
     if (index == 0) {
@@ -1071,6 +1074,39 @@ void drawMfkey64Icon(int x, int y) {
     tft.drawCircle(x + 48, y + 12, 4, getColorVariation(bruceConfig.priColor, 3, -1));
 }
 
+// While decodeImg() runs, the decoders write their pixels here instead of on the screen.
+// Pixels are kept in the native byte order, the one the JPEG and BMP paths push with swapped bytes.
+static struct {
+    bool active = false;
+    uint16_t *pixels = nullptr;
+    uint16_t w = 0;
+    uint16_t h = 0;
+} imgCapture;
+
+static bool captureSize(uint16_t w, uint16_t h) {
+    free(imgCapture.pixels); // a cached PNG BIN that failed half way
+    size_t bytes = (size_t)w * h * sizeof(uint16_t);
+    imgCapture.pixels = (uint16_t *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+    if (!imgCapture.pixels) return false;
+    imgCapture.w = w;
+    imgCapture.h = h;
+    return true;
+}
+
+// Copies a block of decoded pixels cropped to the image, PNGdec gives big endian rows
+static void captureBlock(int x, int y, int w, int h, const uint16_t *src, bool bigEndian) {
+    if (!imgCapture.pixels) return;
+    for (int row = 0; row < h; row++) {
+        if (y + row < 0 || y + row >= imgCapture.h) continue;
+        uint16_t *dst = imgCapture.pixels + (y + row) * imgCapture.w;
+        for (int col = 0; col < w; col++) {
+            if (x + col < 0 || x + col >= imgCapture.w) continue;
+            uint16_t p = src[row * w + col];
+            dst[x + col] = bigEndian ? (p >> 8) | (p << 8) : p;
+        }
+    }
+}
+
 // ####################################################################################################
 //  Draw a JPEG on the TFT, images will be cropped on the right/bottom sides if they do not fit
 // ####################################################################################################
@@ -1107,7 +1143,13 @@ void jpegRender(int xpos, int ypos) {
     max_y += ypos;
 
     // Fetch data from the file, decode and display
-    tft.fillRect(xpos, ypos, JpegDec.width, JpegDec.height, TFT_BLACK);
+    if (!imgCapture.active) {
+        tft.fillRect(xpos, ypos, JpegDec.width, JpegDec.height, TFT_BLACK);
+    } else if (!captureSize(JpegDec.width, JpegDec.height)) {
+        JpegDec.abort();
+        tft.setSwapBytes(swapBytes);
+        return;
+    }
     while (JpegDec.read()) {   // While there is more data in the file
         pImg = JpegDec.pImage; // Decode a MCU (Minimum Coding Unit, typically a 8x8 or 16x16 pixel block)
 
@@ -1141,7 +1183,8 @@ void jpegRender(int xpos, int ypos) {
         uint32_t mcu_pixels = win_w * win_h;
 
         // draw image MCU block only if it will fit on the screen
-        if ((mcu_x + win_w) <= tft.width() && (mcu_y + win_h) <= tft.height())
+        if (imgCapture.active) captureBlock(mcu_x - xpos, mcu_y - ypos, win_w, win_h, pImg, false);
+        else if ((mcu_x + win_w) <= tft.width() && (mcu_y + win_h) <= tft.height())
             tft.pushImage(mcu_x, mcu_y, win_w, win_h, pImg);
         else if ((mcu_y + win_h) > tft.height())
             JpegDec.abort(); // Image has run off bottom of screen so abort decoding
@@ -1329,7 +1372,6 @@ void Gif::GIFDraw(GIFDRAW *pDraw) {
                 }
             } // while looking for opaque pixels
             if (iCount) { // any opaque pixels?
-                tft.drawPixel(0, 0, 0);
                 tft.pushImage(pDraw->iX + x + position->x, y + position->y, iCount, 1, (uint16_t *)usTemp);
                 x += iCount;
                 iCount = 0;
@@ -1350,7 +1392,6 @@ void Gif::GIFDraw(GIFDRAW *pDraw) {
         s = pDraw->pPixels;
         // Translate the 8-bit pixels through the RGB565 palette (already byte reversed)
         for (x = 0; x < iWidth; x++) usTemp[x] = usPalette[*s++];
-        tft.drawPixel(0, 0, 0);
         tft.pushImage(pDraw->iX + position->x, y + position->y, iWidth, 1, (uint16_t *)usTemp);
     }
 } /* GIFDraw() */
@@ -1519,101 +1560,158 @@ uint16_t getColorVariation(uint16_t color, int delta, int direction) {
     return compl_color;
 }
 
-// Draw BITMAP files
-// These read 16- and 32-bit types from the SD card file.
-// BMP data is stored little-endian, Arduino is little-endian too.
-// May need to reverse subscript order if porting elsewhere.
+// ####################################################################################################
+//  Image strips
+// ####################################################################################################
+// The decoders hand their rows to an ImageStrip. It keeps the part of each row that is on screen and
+// pushes a strip of rows with one address window and one bus transaction instead of one per row.
+#define IMG_STRIP_BYTES 8192 // pixels pushed at once
+#define IMG_READ_BYTES 8192  // file data the BMP decoder reads at once
+
+class ImageStrip {
+public:
+    ~ImageStrip() { free(buffer); }
+    // Image of w x h pixels drawn at x, y, its rows arrive bottom up when bottomUp is set.
+    // False when there is no memory for a single row.
+    bool begin(int x, int y, int w, int h, bool bottomUp = false);
+    // Rows only hold the visible columns, from left() on
+    int left() const { return c0; }
+    int width() const { return cw; }
+    int firstRow() const { return r0; }
+    int endRow() const { return r1; }
+    // Where to write row `row` of the image, nullptr when it is off screen
+    uint16_t *row(int row);
+    // Pushes the rows gathered so far, call it before changing the swap bytes setting
+    void flush();
+
+private:
+    int x = 0, y = 0;
+    int c0 = 0, cw = 0; // visible columns
+    int r0 = 0, r1 = 0; // visible rows
+    bool bottomUp = false;
+    uint16_t *buffer = nullptr;
+    int rows = 0;   // strip height
+    int filled = 0; // rows waiting in the strip
+    int last = 0;   // row stored last
+};
+
+bool ImageStrip::begin(int x, int y, int w, int h, bool bottomUp) {
+    this->x = x;
+    this->y = y;
+    this->bottomUp = bottomUp;
+    c0 = max(0, -x);
+    cw = min(w, (int)tft.width() - x) - c0;
+    r0 = max(0, -y);
+    r1 = min(h, (int)tft.height() - y);
+    if (cw <= 0 || r1 <= r0) {
+        cw = 0;
+        r1 = r0;
+        return true; // nothing to draw
+    }
+    rows = constrain(IMG_STRIP_BYTES / (cw * (int)sizeof(uint16_t)), 1, r1 - r0);
+    // Shorter strips when the heap is tight
+    while (!(buffer = (uint16_t *)malloc(rows * cw * sizeof(uint16_t))) && rows > 1) rows /= 2;
+    return buffer != nullptr;
+}
 
-uint16_t read16(fs::File &f) {
-    uint16_t result;
-    ((uint8_t *)&result)[0] = f.read(); // LSB
-    ((uint8_t *)&result)[1] = f.read(); // MSB
-    return result;
+uint16_t *ImageStrip::row(int row) {
+    if (!buffer || row < r0 || row >= r1) return nullptr;
+    if (filled == rows) flush();
+    last = row;
+    // Bottom up rows fill the strip from its end, it is pushed top to bottom either way
+    int slot = bottomUp ? rows - 1 - filled : filled;
+    filled++;
+    return buffer + slot * cw;
 }
 
-uint32_t read32(fs::File &f) {
-    uint32_t result;
-    ((uint8_t *)&result)[0] = f.read(); // LSB
-    ((uint8_t *)&result)[1] = f.read();
-    ((uint8_t *)&result)[2] = f.read();
-    ((uint8_t *)&result)[3] = f.read(); // MSB
-    return result;
+void ImageStrip::flush() {
+    if (filled == 0) return;
+    int top = bottomUp ? last : last - filled + 1;
+    uint16_t *first = bottomUp ? buffer + (rows - filled) * cw : buffer;
+    tft.pushImage(x + c0, y + top, cw, filled, first);
+    filled = 0;
 }
+
+// Draw BITMAP files
+// Uncompressed 16, 24 and 32-bit files, bottom up or top down (negative height), see bmp_decode.h.
+
+// Reads the visible rows several at a time and converts them straight into the strip, or the capture
+static bool bmpDecode(fs::File &f, const BmpInfo &bmp, int x, int y) {
+    const BmpFormat &format = bmp.format;
+    int w = bmp.w, h = bmp.h;
+    bool bottomUp = bmp.bottomUp;
+    size_t rowBytes = bmp.rowBytes;
+    ImageStrip strip;
+    int c0 = 0, cw = w, r0 = 0, r1 = h;
+    if (imgCapture.active) {
+        if (!captureSize(w, h)) return false;
+    } else {
+        if (!strip.begin(x, y, w, h, bottomUp)) return false;
+        c0 = strip.left();
+        cw = strip.width();
+        r0 = strip.firstRow();
+        r1 = strip.endRow();
+        if (cw == 0) return true; // off screen
+    }
+
+    // The visible rows are contiguous in the file too
+    int first = bottomUp ? h - r1 : r0;
+    int count = r1 - r0;
+    int chunkRows = constrain((int)(IMG_READ_BYTES / rowBytes), 1, count);
+    uint8_t *chunk = (uint8_t *)malloc(chunkRows * rowBytes);
+    if (!chunk) return false;
+
+    bool oldSwapBytes = tft.getSwapBytes();
+    tft.setSwapBytes(true);
+    bool ok = f.seek(bmp.offset + (uint32_t)first * rowBytes);
+    for (int done = 0; ok && done < count;) {
+        int n = min(chunkRows, count - done);
+        ok = f.read(chunk, n * rowBytes) == n * rowBytes;
+        for (int i = 0; ok && i < n; i++, done++) {
+            int fileRow = first + done;
+            int row = bottomUp ? h - 1 - fileRow : fileRow;
+            uint16_t *dst = imgCapture.active ? imgCapture.pixels + (size_t)row * w : strip.row(row);
+            bmpConvertRow(format, chunk + i * rowBytes + c0 * format.bytes, dst, cw);
+        }
+    }
+    strip.flush();
+    tft.setSwapBytes(oldSwapBytes);
+    free(chunk);
+    return ok;
+}
+
 bool drawBmp(FS &fs, String filename, int x, int y, bool center) {
     if ((x >= tft.width()) || (y >= tft.height())) return false;
     uint32_t startTime = millis();
 
-    File bmpFS;
-
     // Open requested file on SD card
-    bmpFS = fs.open(filename, "r");
-
+    File bmpFS = fs.open(filename, "r");
     if (!bmpFS) {
-        Serial.print("File not found");
-        goto ERROR;
+        Serial.println("File not found");
+        return false;
     }
 
-    uint32_t seekOffset;
-    uint16_t w, h, row, col;
-    uint8_t r, g, b;
-
-    if (read16(bmpFS) == 0x4D42) {
-        read32(bmpFS);
-        read32(bmpFS);
-        seekOffset = read32(bmpFS);
-        read32(bmpFS);
-        w = read32(bmpFS);
-        h = read32(bmpFS);
-        if (center) {
-            x = x + (tftWidth - w) / 2;
-            y = y + (tftHeight - h) / 2;
-        }
-
-        if ((read16(bmpFS) == 1) && (read16(bmpFS) == 24) && (read32(bmpFS) == 0)) {
-            y += h - 1;
-
-            bool oldSwapBytes = tft.getSwapBytes();
-            tft.setSwapBytes(true);
-            bmpFS.seek(seekOffset);
-
-            uint16_t padding = (4 - ((w * 3) & 3)) & 3;
-            uint8_t lineBuffer[w * 3 + padding];
-
-            for (row = 0; row < h; row++) {
-
-                bmpFS.read(lineBuffer, sizeof(lineBuffer));
-                uint8_t *bptr = lineBuffer;
-                uint16_t *tptr = (uint16_t *)lineBuffer;
-                // Convert 24 to 16-bit colours
-                for (uint16_t col = 0; col < w; col++) {
-                    b = *bptr++;
-                    g = *bptr++;
-                    r = *bptr++;
-                    *tptr++ = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-                }
-
-                // Push the pixel row to screen, pushImage will crop the line if needed
-                // y is decremented as the BMP image is drawn bottom up
-                tft.drawPixel(
-                    0, 0, 0
-                ); // shared TFT_Spi devices struggle to work, need call a line first sometimes
-                tft.pushImage(x, y--, w, 1, (uint16_t *)lineBuffer);
-            }
-            tft.setSwapBytes(oldSwapBytes);
-            Serial.print("BMP Loaded in ");
-            Serial.print(millis() - startTime);
-            Serial.println(" ms");
-        } else {
-            goto ERROR;
-        }
-    } else {
-    ERROR:
+    uint8_t header[BMP_HEADER_BYTES];
+    size_t headerLength = bmpFS.read(header, sizeof(header));
+    BmpInfo bmp;
+    if (!bmpParseHeader(header, headerLength, bmp)) {
         Serial.println("BMP format not recognized.");
         bmpFS.close();
         return false;
     }
+    if (center) {
+        x = x + (tftWidth - bmp.w) / 2;
+        y = y + (tftHeight - bmp.h) / 2;
+    }
+
+    bool ok = bmpDecode(bmpFS, bmp, x, y);
     bmpFS.close();
-    return true;
+    if (ok) {
+        Serial.print("BMP Loaded in ");
+        Serial.print(millis() - startTime);
+        Serial.println(" ms");
+    }
+    return ok;
 }
 
 bool drawImg(FS &fs, String filename, int x, int y, bool center, int playDurationMs) {
@@ -1635,6 +1733,29 @@ bool drawImg(FS &fs, String filename, int x, int y, bool center, int playDuratio
     return false;
 }
 
+uint16_t *decodeImg(FS &fs, String filename, uint16_t &w, uint16_t &h) {
+    String ext = filename.substring(filename.lastIndexOf('.'));
+    ext.toLowerCase();
+    imgCapture.active = true;
+    imgCapture.pixels = nullptr;
+    bool ok = false;
+    if (ext.endsWith("jpg")) ok = showJpeg(fs, filename, 0, 0, false);
+    else if (ext.endsWith("bmp")) ok = drawBmp(fs, filename, 0, 0, false);
+    else if (ext.endsWith("png")) ok = drawPNG(fs, filename, 0, 0, false);
+    imgCapture.active = false;
+
+    if (!ok || !imgCapture.pixels) {
+        free(imgCapture.pixels);
+        imgCapture.pixels = nullptr;
+        return nullptr;
+    }
+    w = imgCapture.w;
+    h = imgCapture.h;
+    uint16_t *pixels = imgCapture.pixels;
+    imgCapture.pixels = nullptr;
+    return pixels;
+}
+
 #if !defined(LITE_VERSION)
 /// Draw PNG files
 
@@ -1648,6 +1769,9 @@ PNG *png = nullptr;
 // Optional pointer to write decoded lines into a cached BIN file
 static File *pngBinOut = nullptr;
 static bool pngCacheOnly = false;
+// Rows on their way to the display while a PNG is decoded
+static ImageStrip *pngStrip = nullptr;
+static bool pngRowByRow = false; // no memory for a strip, every row is pushed on its own
 // Optionally use heap capabilities on ESP32 to pick the best memory region for the decoder
 #if defined(ESP32)
 #include <esp_heap_caps.h>
@@ -1678,17 +1802,18 @@ int16_t xpos = 0;
 int16_t ypos = 0;
 int PNGDraw(PNGDRAW *pDraw) {
     uint16_t usPixels[MAX_IMAGE_WIDTH];
-    // static uint16_t dmaBuffer[MAX_IMAGE_WIDTH]; // static so buffer persists after fn exit
     uint8_t r = ((uint16_t)bruceConfig.bgColor & 0xF800) >> 8;
     uint8_t g = ((uint16_t)bruceConfig.bgColor & 0x07E0) >> 3;
     uint8_t b = ((uint16_t)bruceConfig.bgColor & 0x001F) << 3;
-    png->getLineAsRGB565(pDraw, usPixels, PNG_RGB565_BIG_ENDIAN, b << 16 | g << 8 | r);
-    if (!pngCacheOnly) {
-        tft.drawPixel(0, 0, 0);
-        tft.drawPixel(0, 0, 0);
-        tft.pushImage(xpos, ypos + pDraw->y, pDraw->iWidth, 1, usPixels);
-    }
-    if (pngBinOut) { pngBinOut->write((uint8_t *)usPixels, pDraw->iWidth * sizeof(uint16_t)); }
+    uint16_t *dst = pngStrip ? pngStrip->row(pDraw->y) : nullptr;
+    // Whole rows on screen are decoded straight into the strip
+    bool direct = dst && pngStrip->left() == 0 && pngStrip->width() == pDraw->iWidth;
+    uint16_t *line = direct ? dst : usPixels;
+    png->getLineAsRGB565(pDraw, line, PNG_RGB565_BIG_ENDIAN, b << 16 | g << 8 | r);
+    if (imgCapture.active) captureBlock(0, pDraw->y, pDraw->iWidth, 1, line, true);
+    else if (dst && !direct) memcpy(dst, line + pngStrip->left(), pngStrip->width() * sizeof(uint16_t));
+    else if (pngRowByRow) tft.pushImage(xpos, ypos + pDraw->y, pDraw->iWidth, 1, line);
+    if (pngBinOut) { pngBinOut->write((uint8_t *)line, pDraw->iWidth * sizeof(uint16_t)); }
     return 1;
 }
 
@@ -1737,19 +1862,30 @@ static bool drawPngBin(FS &fs, const String &binPath, int x, int y, bool center)
     }
 
     std::unique_ptr<uint16_t[]> line(new (std::nothrow) uint16_t[w]);
-    if (!line) {
+    ImageStrip strip;
+    bool ready = imgCapture.active ? captureSize(w, h) : strip.begin(x, y, w, h);
+    if (!line || !ready) {
         f.close();
         return false;
     }
 
+    // Only the rows on screen are read when drawing
     size_t rowBytes = w * sizeof(uint16_t);
-    for (uint16_t row = 0; row < h; ++row) {
-        if (f.read((uint8_t *)line.get(), rowBytes) != rowBytes) {
+    uint16_t first = imgCapture.active ? 0 : strip.firstRow();
+    uint16_t end = imgCapture.active ? h : strip.endRow();
+    if (first > 0) f.seek(2 * sizeof(uint16_t) + first * rowBytes);
+    for (uint16_t row = first; row < end; ++row) {
+        uint16_t *dst = imgCapture.active ? nullptr : strip.row(row);
+        bool direct = dst && strip.left() == 0 && strip.width() == w;
+        uint16_t *buf = direct ? dst : line.get();
+        if (f.read((uint8_t *)buf, rowBytes) != rowBytes) {
             f.close();
             return false;
         }
-        tft.pushImage(x, y + row, w, 1, line.get());
+        if (imgCapture.active) captureBlock(0, row, w, 1, buf, true);
+        else if (dst && !direct) memcpy(dst, buf + strip.left(), strip.width() * sizeof(uint16_t));
     }
+    strip.flush();
 
     f.close();
     return true;
@@ -1764,6 +1900,7 @@ bool drawPNG(FS &fs, String filename, int x, int y, bool center) {
     if (fs.exists(binPath)) {
         if (pngCacheOnly) return true; // cache already ready
         if (drawPngBin(fs, binPath, x, y, center)) return true;
+        if (imgCapture.active && !imgCapture.pixels) return false; // no memory to decode into
         fs.remove(binPath); // stale cache, fall back to decode
     }
 
@@ -1810,12 +1947,25 @@ bool drawPNG(FS &fs, String filename, int x, int y, bool center) {
         if (center) {
             xpos = x + (tftWidth - png->getWidth()) / 2;
             ypos = y + (tftHeight - png->getHeight()) / 2;
+        } else {
+            xpos = x;
+            ypos = y;
         }
 
         if (png->getWidth() > MAX_IMAGE_WIDTH) {
             Serial.println("Image too wide for allocated line buffer size!");
+        } else if (imgCapture.active && !captureSize(png->getWidth(), png->getHeight())) {
+            rc = PNG_MEM_ERROR;
+            png->close();
         } else {
+            ImageStrip strip;
+            bool drawing = !imgCapture.active && !pngCacheOnly;
+            if (drawing && strip.begin(xpos, ypos, png->getWidth(), png->getHeight())) pngStrip = &strip;
+            else pngRowByRow = drawing;
             rc = png->decode(NULL, 0);
+            strip.flush();
+            pngStrip = nullptr;
+            pngRowByRow = false;
             png->close();
         }
 
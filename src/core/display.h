@@ -92,6 +92,9 @@ private:
  * @param playDurationMs: time that the GIF will be played
  */
 bool drawImg(FS &fs, String filename, int x = 0, int y = 0, bool center = false, int playDurationMs = 0);
+// Decodes a JPG, BMP or PNG into RGB565 in native byte order instead of drawing it.
+// Returns a malloc'd w * h buffer, in PSRAM when there is some, or nullptr.
+uint16_t *decodeImg(FS &fs, String filename, uint16_t &w, uint16_t &h);
 bool drawPNG(FS &fs, String filename, int x, int y, bool center);
 bool preparePngBin(FS &fs, String filename);
 bool drawBmp(FS &fs, String filename, int x = 0, int y = 0, bool center = false);
@@ -182,7 +185,7 @@ void printSubtitle(String subtitle, bool withLine = true);
 void printFootnote(String text);
 void printCenterFootnote(String text);
 
-Opt_Coord listFiles(int index, std::vector<FileList> fileList);
+Opt_Coord listFiles(int index, const std::vector<FileList> &fileList);
 
 void drawWireguardStatus(int x, int y);
 
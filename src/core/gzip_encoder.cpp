@@ -0,0 +1,187 @@
+#include "gzip_encoder.h"
+#include <esp_rom_crc.h>
+
+#define GZ_WSIZE 4096 // window, matches reach this far back
+#define GZ_HASH_BITS 12
+#define GZ_MIN_MATCH 3
+#define GZ_MAX_MATCH 258
+#define GZ_MAX_CHAIN 24 // candidates tried per position, speed over ratio
+#define GZ_LOOKAHEAD (GZ_MAX_MATCH + GZ_MIN_MATCH)
+
+static const uint16_t lengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                        2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                      33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                      1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                      6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+namespace {
+struct Deflater {
+    Print &out;
+    uint8_t buffer[1024]; // one TLS record per flush when writing to a socket
+    size_t length = 0;
+    size_t written = 0;
+    bool failed = false;
+    uint32_t bits = 0;
+    int bitCount = 0;
+
+    explicit Deflater(Print &out) : out(out) {}
+
+    void flush() {
+        if (length && out.write(buffer, length) != length) failed = true;
+        written += length;
+        length = 0;
+    }
+    void putByte(uint8_t b) {
+        buffer[length++] = b;
+        if (length == sizeof(buffer)) flush();
+    }
+    void put32(uint32_t v) {
+        for (int i = 0; i < 4; i++) putByte(v >> (8 * i));
+    }
+    // Deflate packs values LSB first
+    void putBits(uint32_t value, int count) {
+        bits |= value << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            putByte(bits & 0xFF);
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+    // ...but Huffman codes MSB first
+    void putCode(uint32_t code, int count) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < count; i++) reversed |= ((code >> i) & 1) << (count - 1 - i);
+        putBits(reversed, count);
+    }
+    void putSymbol(int symbol) {
+        if (symbol < 144) putCode(0x30 + symbol, 8);
+        else if (symbol < 256) putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280) putCode(symbol - 256, 7);
+        else putCode(0xC0 + symbol - 280, 8);
+    }
+    void putMatch(int matchLength, int distance) {
+        int i = 28;
+        while (lengthBase[i] > matchLength) i--;
+        putSymbol(257 + i);
+        putBits(matchLength - lengthBase[i], lengthExtra[i]);
+        int j = 29;
+        while (distBase[j] > distance) j--;
+        putCode(j, 5);
+        putBits(distance - distBase[j], distExtra[j]);
+    }
+    void alignByte() {
+        if (bitCount > 0) putByte(bits & 0xFF);
+        bits = 0;
+        bitCount = 0;
+    }
+};
+
+inline uint16_t hash3(const uint8_t *p) {
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & ((1 << GZ_HASH_BITS) - 1);
+}
+} // namespace
+
+size_t GzipEncoder::compress(File &in, Print &out, std::function<void(size_t)> progress) {
+    // Positions are kept +1 so that 0 means none
+    uint8_t *window = (uint8_t *)malloc(2 * GZ_WSIZE);
+    uint16_t *head = (uint16_t *)calloc(1 << GZ_HASH_BITS, sizeof(uint16_t));
+    uint16_t *prev = (uint16_t *)calloc(GZ_WSIZE, sizeof(uint16_t));
+    Deflater d(out);
+    if (!window || !head || !prev) {
+        free(window);
+        free(head);
+        free(prev);
+        return 0;
+    }
+
+    // gzip member header: deflate, no name, unknown mtime and OS
+    static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+    for (uint8_t b : header) d.putByte(b);
+    d.putBits(1, 1); // BFINAL, everything goes in one block
+    d.putBits(1, 2); // BTYPE fixed Huffman
+
+    uint32_t crc = 0;
+    size_t total = 0;
+    size_t fill = 0;
+    size_t pos = 0;
+    bool eof = false;
+    while (!d.failed) {
+        if (!eof && fill - pos < GZ_LOOKAHEAD) {
+            if (fill == 2 * GZ_WSIZE) {
+                // Slide the second half down, older positions fall out of the window
+                memmove(window, window + GZ_WSIZE, GZ_WSIZE);
+                fill -= GZ_WSIZE;
+                pos -= GZ_WSIZE;
+                for (int i = 0; i < (1 << GZ_HASH_BITS); i++) {
+                    head[i] = head[i] > GZ_WSIZE ? head[i] - GZ_WSIZE : 0;
+                }
+                for (int i = 0; i < GZ_WSIZE; i++) prev[i] = prev[i] > GZ_WSIZE ? prev[i] - GZ_WSIZE : 0;
+            }
+            int n = in.read(window + fill, 2 * GZ_WSIZE - fill);
+            if (n <= 0) {
+                eof = true;
+            } else {
+                crc = esp_rom_crc32_le(crc, window + fill, n);
+                fill += n;
+                total += n;
+                if (progress) progress(total);
+            }
+            continue;
+        }
+        if (pos >= fill) break;
+
+        int bestLength = 0;
+        int bestDistance = 0;
+        if (fill - pos >= GZ_MIN_MATCH) {
+            int maxLength = min<size_t>(GZ_MAX_MATCH, fill - pos);
+            uint16_t h = hash3(window + pos);
+            uint16_t candidate = head[h];
+            for (int chain = 0; candidate && chain < GZ_MAX_CHAIN; chain++) {
+                size_t match = candidate - 1;
+                if (match >= pos || pos - match > GZ_WSIZE) break;
+                if (window[match + bestLength] == window[pos + bestLength]) {
+                    int l = 0;
+                    while (l < maxLength && window[match + l] == window[pos + l]) l++;
+                    if (l > bestLength) {
+                        bestLength = l;
+                        bestDistance = pos - match;
+                        if (l == maxLength) break;
+                    }
+                }
+                candidate = prev[match & (GZ_WSIZE - 1)];
+            }
+            prev[pos & (GZ_WSIZE - 1)] = head[h];
+            head[h] = pos + 1;
+        }
+
+        if (bestLength >= GZ_MIN_MATCH) {
+            d.putMatch(bestLength, bestDistance);
+            // The positions inside the match are still candidates for later ones
+            for (size_t p = pos + 1; p < pos + bestLength && p + GZ_MIN_MATCH <= fill; p++) {
+                uint16_t h = hash3(window + p);
+                prev[p & (GZ_WSIZE - 1)] = head[h];
+                head[h] = p + 1;
+            }
+            pos += bestLength;
+        } else {
+            d.putSymbol(window[pos]);
+            pos++;
+        }
+    }
+
+    d.putSymbol(256); // end of block
+    d.alignByte();
+    d.put32(crc);
+    d.put32(total);
+    d.flush();
+
+    free(window);
+    free(head);
+    free(prev);
+    return d.failed ? 0 : d.written;
+}
@@ -0,0 +1,33 @@
+#ifndef __GZIP_ENCODER_H__
+#define __GZIP_ENCODER_H__
+
+#include <Arduino.h>
+#include <FS.h>
+#include <functional>
+
+// Gzip compression of a file into any Print, with fixed size buffers (~25KB).
+// Deflate uses a 4KB window and the fixed Huffman codes: CSV logs shrink 2-4x, no code tables
+// to build or send. The output is deterministic, so a first pass into a GzipCounter gives the exact
+// size of the second one, e.g. for a Content-Length.
+class GzipEncoder {
+public:
+    // Returns the compressed size, 0 on allocation or write failure.
+    // progress is called with the bytes read from in so far.
+    static size_t compress(File &in, Print &out, std::function<void(size_t)> progress = nullptr);
+};
+
+// Print that only counts what is written to it
+class GzipCounter : public Print {
+public:
+    size_t count = 0;
+    size_t write(uint8_t) override {
+        count++;
+        return 1;
+    }
+    size_t write(const uint8_t *, size_t size) override {
+        count += size;
+        return size;
+    }
+};
+
+#endif
@@ -79,118 +79,167 @@ uint32_t alterOneColorChannel(uint32_t color, uint16_t newR, uint16_t newG, uint
 }
 
 TaskHandle_t ledEffectTaskHandle = NULL;
+static SemaphoreHandle_t ledFrameMutex = NULL;
+static volatile int ledPauseCount = 0;
+
+// Lookup tables, built once so frames only use integer math
+static CRGB hueTable[360];           // full saturation and value hue wheel
+static uint8_t sineTable[256];       // (sin(2*PI*i/256) + 1) * 127.5
+static uint8_t gammaTable[256];      // gamma 2.2, perceptually even breathe fades
+static uint8_t tailTable[LED_COUNT]; // 0.6^i in Q8, chase tail fade
+static bool ledTablesReady = false;
+
+static void buildLedTables() {
+    if (ledTablesReady) return;
+    for (int h = 0; h < 360; h++) hueTable[h] = hsvToRgb(h, 255, 255);
+    for (int i = 0; i < 256; i++) {
+        sineTable[i] = (uint8_t)((sinf(i * 2.0f * PI / 256.0f) + 1.0f) * 127.5f);
+        gammaTable[i] = (uint8_t)(powf(i / 255.0f, 2.2f) * 255.0f + 0.5f);
+    }
+    uint16_t fade = 256;
+    for (int i = 0; i < LED_COUNT; i++) {
+        tailTable[i] = fade > 255 ? 255 : fade;
+        fade = fade * 154 / 256; // 0.6 in Q8
+    }
+    ledTablesReady = true;
+}
 
-void ledEffectTask(void *pvParameters) {
-    short hueStep = 360 / LED_COUNT;
-    short offset = 0;
-    int currentLED = 0;
-    int frame = 0;
-    uint64_t start_time = esp_timer_get_time() / 1000;
-    while (1) {
-        CRGB baseColor = isPreviewLed ? previewLedColor : bruceConfig.ledColor;
-        int ledEffect = isPreviewLed ? previewLedEffect : bruceConfig.ledEffect;
-        int ledEffectSpeed = isPreviewLed ? previewLedEffectSpeed : bruceConfig.ledEffectSpeed;
-        int ledEffectDirection = isPreviewLed ? previewLedEffectDirection : bruceConfig.ledEffectDirection;
-
-        if (ledEffect == LED_EFFECT_COLOR_CYCLE || ledEffect == LED_EFFECT_COLOR_WHEEL) {
-            short delayMs = 50;
-
-#ifdef HAS_ENCODER_LED
-            if ((ledEffectSpeed == 11 && EncoderLedChange != 0)) {
-                offset = (offset + (static_cast<short>(20 / 1000.0f * 360.0f)) * EncoderLedChange) % 360;
-                EncoderLedChange = 0;
-            } else if (ledEffectSpeed < 11) {
-                float speed = 0.2f * ledEffectSpeed;
-                offset = (offset + static_cast<short>(speed * delayMs / 1000.0f * 360.0f)) % 360;
-            }
-#else
-            float speed = 0.2f * ledEffectSpeed;
-            offset = (offset + static_cast<short>(speed * delayMs / 1000.0f * 360.0f)) % 360;
-#endif
-            if (ledEffect == LED_EFFECT_COLOR_CYCLE) {
-                short hue = ((offset * -ledEffectDirection) % 360 + 360) % 360;
-                // Serial.printf("LED Effect Cycle: hue=%d, offset=%d", hue, offset);
-                fill_solid(leds, LED_COUNT, hsvToRgb(hue, 255, 255));
-            } else if (ledEffect == LED_EFFECT_COLOR_WHEEL) {
-                for (uint16_t i = 0; i < LED_COUNT; ++i) {
-                    short hue = ((offset + i * -ledEffectDirection * hueStep) % 360 + 360) % 360;
-                    // Serial.printf("LED Effect Wheel: i=%d, hue=%d\n", i, hue);
-                    leds[i] = hsvToRgb(hue, 255, 255);
-                }
-            }
+static inline CRGB scaleColor(const CRGB &c, uint8_t scale) {
+    return CRGB((c.r * scale) >> 8, (c.g * scale) >> 8, (c.b * scale) >> 8);
+}
 
-        } else if (ledEffect == LED_COLOR_BREATHE) {
+static void ledEffectsWake() {
+    if (ledEffectTaskHandle != NULL) xTaskNotifyGive(ledEffectTaskHandle);
+}
 
-            float phase;
+// Effect state, kept between frames
+struct LedEffectState {
+    uint32_t hueQ8 = 0; // hue offset in 1/256 degrees
+    int currentLED = 0;
+    int frame = 0;
+};
+
+// Renders one frame into leds[], returns the time until the next frame is due
+static uint32_t renderLedFrame(LedEffectState &st) {
+    const uint32_t frameMs = 50;
+    CRGB baseColor = isPreviewLed ? previewLedColor : bruceConfig.ledColor;
+    int ledEffect = isPreviewLed ? previewLedEffect : bruceConfig.ledEffect;
+    int ledEffectSpeed = isPreviewLed ? previewLedEffectSpeed : bruceConfig.ledEffectSpeed;
+    int ledEffectDirection = isPreviewLed ? previewLedEffectDirection : bruceConfig.ledEffectDirection;
+    bool encoderSync = false;
+    int encoderSteps = 0;
 #ifdef HAS_ENCODER_LED
-            if ((ledEffectSpeed == 11 && EncoderLedChange != 0) || (ledEffectSpeed < 11)) {
-                if ((ledEffectSpeed == 11 && EncoderLedChange != 0)) {
-                    phase = sinf(frame / 20.0f * PI);
-                    frame += EncoderLedChange;
-                    EncoderLedChange = 0;
-                } else {
-                    float time = millis() / 1000.0f;
-                    float speed = 0.2f * ledEffectSpeed;
-                    phase = sinf(time * speed * PI);
-                }
-#else
-            float time = millis() / 1000.0f;
-            float speed = 0.2f * ledEffectSpeed;
-            phase = sinf(time * speed * PI);
+    encoderSync = ledEffectSpeed == 11;
+    if (encoderSync) {
+        encoderSteps = EncoderLedChange;
+        EncoderLedChange = 0;
+    }
 #endif
-                uint8_t value = (uint8_t)((phase + 1.0f) * 127.5f);
 
-                for (int i = 0; i < LED_COUNT; i++) {
-                    leds[i] = CRGB(
-                        (baseColor.r * value) / 255, (baseColor.g * value) / 255, (baseColor.b * value) / 255
-                    );
-                }
-#ifdef HAS_ENCODER_LED
+    if (ledEffect == LED_EFFECT_COLOR_CYCLE || ledEffect == LED_EFFECT_COLOR_WHEEL) {
+        // 0.2 turns per second per speed step, 72 degrees/s
+        if (encoderSync) st.hueQ8 += 7 * 256 * encoderSteps;
+        else st.hueQ8 += 72 * 256 * ledEffectSpeed * frameMs / 1000;
+        st.hueQ8 %= 360 * 256;
+        int offset = st.hueQ8 >> 8;
+
+        if (ledEffect == LED_EFFECT_COLOR_CYCLE) {
+            fill_solid(leds, LED_COUNT, hueTable[((offset * -ledEffectDirection) % 360 + 360) % 360]);
+        } else {
+            const int hueStep = 360 / LED_COUNT;
+            for (uint16_t i = 0; i < LED_COUNT; ++i) {
+                leds[i] = hueTable[((offset + i * -ledEffectDirection * hueStep) % 360 + 360) % 360];
             }
-#endif
+        }
+        return frameMs;
+    }
+
+    if (ledEffect == LED_COLOR_BREATHE) {
+        uint8_t phase;
+        if (encoderSync) {
+            st.frame += encoderSteps;
+            phase = (uint8_t)(st.frame * 256 / 40); // one breath every 40 encoder steps
+        } else {
+            phase = (uint8_t)((uint64_t)millis() * ledEffectSpeed * 256 / 10000); // period of 10/speed s
+        }
+        fill_solid(leds, LED_COUNT, scaleColor(baseColor, gammaTable[sineTable[phase]]));
+        return frameMs;
+    }
 
 #if LED_COUNT > 1
-        } else if (ledEffect == LED_EFFECT_CHASE || ledEffect == LED_EFFECT_CHASE_TAIL) {
-            uint8_t cycleFrames = 11 - ledEffectSpeed;
+    if (ledEffect == LED_EFFECT_CHASE || ledEffect == LED_EFFECT_CHASE_TAIL) {
+        if (encoderSync) {
+            if (encoderSteps == 0) return frameMs;
+            st.currentLED = ((st.currentLED + encoderSteps) % LED_COUNT + LED_COUNT) % LED_COUNT;
+        } else {
+            st.currentLED = (st.currentLED + ledEffectDirection + LED_COUNT) % LED_COUNT;
+        }
 
-#ifdef HAS_ENCODER_LED
-            if ((ledEffectSpeed == 11 && EncoderLedChange != 0) ||
-                (ledEffectSpeed < 11 && frame % cycleFrames == 0)) {
-                if ((ledEffectSpeed == 11 && EncoderLedChange != 0)) {
-                    currentLED = (currentLED + EncoderLedChange + LED_COUNT) % LED_COUNT;
-                    EncoderLedChange = 0;
-                } else {
-                    currentLED = (currentLED + ledEffectDirection + LED_COUNT) % LED_COUNT;
-                }
-#else
-            if (frame % cycleFrames == 0) {
-                currentLED = (currentLED + ledEffectDirection + LED_COUNT) % LED_COUNT;
+        fill_solid(leds, LED_COUNT, CRGB::Black);
+        if (ledEffect == LED_EFFECT_CHASE) {
+            leds[st.currentLED] = baseColor;
+        } else {
+            for (int i = 1; i < LED_COUNT; ++i) {
+                int index = (st.currentLED - ledEffectDirection * i + LED_COUNT) % LED_COUNT;
+                leds[index] = scaleColor(baseColor, tailTable[i]);
+            }
+        }
+        // Nothing changes between steps, sleep until the next one
+        return encoderSync ? frameMs : (11 - ledEffectSpeed) * frameMs;
+    }
 #endif
+    return frameMs;
+}
 
-                fill_solid(leds, LED_COUNT, CRGB::Black);
+void ledEffectTask(void *pvParameters) {
+    LedEffectState state;
+    CRGB lastShown[LED_COUNT];
+    bool shown = false;
+    TickType_t lastWake = xTaskGetTickCount();
 
-                if (ledEffect == LED_EFFECT_CHASE) {
-                    leds[currentLED] = baseColor;
-                } else {
-                    for (int i = 1; i < LED_COUNT; ++i) {
-                        int index = (currentLED - ledEffectDirection * i + LED_COUNT) % LED_COUNT;
+    buildLedTables();
+    while (1) {
+        // Nothing visible to animate, sleep until someone wakes us up
+        if (ledPauseCount > 0 || isScreenOff || FastLED.getBrightness() == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            lastWake = xTaskGetTickCount();
+            shown = false;
+            continue;
+        }
 
-                        float fade = powf(0.6f, i);
-                        leds[index].r = baseColor.r * fade;
-                        leds[index].g = baseColor.g * fade;
-                        leds[index].b = baseColor.b * fade;
-                    }
-                }
+        xSemaphoreTake(ledFrameMutex, portMAX_DELAY);
+        uint32_t nextMs = 50;
+        if (ledPauseCount == 0) {
+            nextMs = renderLedFrame(state);
+            // Skip the RMT transfer when the frame did not change
+            if (!shown || memcmp(lastShown, leds, sizeof(lastShown)) != 0) {
+                FastLED.show();
+                memcpy(lastShown, leds, sizeof(lastShown));
+                shown = true;
             }
-            frame++;
-#endif
         }
+        xSemaphoreGive(ledFrameMutex);
 
-        FastLED.show();
-        vTaskDelay(pdMS_TO_TICKS(50));
+        xTaskDelayUntil(&lastWake, pdMS_TO_TICKS(nextMs));
     }
 }
 
+void ledEffectsPause() {
+    ledPauseCount = ledPauseCount + 1;
+    // Wait for a frame being sent to finish
+    if (ledFrameMutex != NULL) {
+        xSemaphoreTake(ledFrameMutex, portMAX_DELAY);
+        xSemaphoreGive(ledFrameMutex);
+    }
+}
+
+void ledEffectsResume() {
+    if (ledPauseCount > 0) ledPauseCount = ledPauseCount - 1;
+    if (ledPauseCount == 0) ledEffectsWake();
+}
+
+void ledEffectsScreenWake() { ledEffectsWake(); }
+
 void beginLed() {
 #ifdef RGB_LED_CLK
     FastLED.addLeds<LED_TYPE, RGB_LED, RGB_LED_CLK, LED_ORDER>(leds, LED_COUNT);
@@ -279,6 +328,7 @@ void setLedBrightness(int value) {
     int bright = 255 * value / 100;
     FastLED.setBrightness(bright);
     FastLED.show();
+    ledEffectsWake();
 }
 
 #define BrucePurple 9830500 // Custom purple color for Bruce
@@ -606,14 +656,18 @@ void ledSetup() {
 }
 
 void ledEffects(bool enable) {
+    if (ledFrameMutex == NULL) ledFrameMutex = xSemaphoreCreateMutex();
     if (enable) {
         if (ledEffectTaskHandle == NULL) {
             xTaskCreate(ledEffectTask, "LedEffect", 2048, NULL, 1, &ledEffectTaskHandle);
         }
     } else {
         if (ledEffectTaskHandle != NULL) {
+            // Don't kill the task in the middle of a frame, it would keep the mutex
+            xSemaphoreTake(ledFrameMutex, portMAX_DELAY);
             vTaskDelete(ledEffectTaskHandle);
             ledEffectTaskHandle = NULL;
+            xSemaphoreGive(ledFrameMutex);
         }
     }
 }
@@ -35,8 +35,23 @@ void ledPreviewMode(bool enable);
 void setLedBrightness(int value);
 void setLedBrightnessConfig();
 
+// Stops effect frames while timing critical RF/IR work runs, calls can be nested
+void ledEffectsPause();
+void ledEffectsResume();
+// Effects are suspended while the screen is off, this restarts them
+void ledEffectsScreenWake();
+
 #else
 inline void blinkLed(int blinkTime = 50) {};
+inline void ledEffectsPause() {};
+inline void ledEffectsResume() {};
+inline void ledEffectsScreenWake() {};
 #endif
 
+// Pauses LED effects for the lifetime of the object
+struct LedEffectsPauseScope {
+    LedEffectsPauseScope() { ledEffectsPause(); }
+    ~LedEffectsPauseScope() { ledEffectsResume(); }
+};
+
 #endif
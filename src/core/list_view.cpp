@@ -0,0 +1,302 @@
+#include "list_view.h"
+#include "core/display.h"
+#include "core/mykeyboard.h"
+#include <globals.h>
+
+#define LIST_ROWS (int)(tftHeight / 25) // same as the option menus
+#define LIST_ROW_HEIGHT (FM * 8 + 4)
+#define LIST_SCAN_CHUNK 64    // labels tested against the filter per pass of the loop
+#define LIST_FAST_TURN_MS 80  // encoder detents closer than this speed the list up
+#define LIST_MAX_STEP 32
+
+class ListView {
+public:
+    ListView(ListSource &source, const char *title) : source(source), title(title) {}
+    int run(int index);
+
+private:
+    ListSource &source;
+    const char *title;
+    int rows = 1;
+    int32_t boxY = 0;
+    int cursor = 0; // position in the shown list
+    int top = 0;    // position of the first row on screen
+    Opt_Coord coord;
+    String current; // label under the cursor, scrolled when too long
+
+    // Typed text in lower case, the matches are found a chunk at a time so typing never waits for
+    // the whole list. A longer filter only searches what the shorter one matched.
+    String filter;
+    std::vector<uint32_t> matches;
+    std::vector<uint32_t> candidates; // previous matches while refining
+    bool refining = false;
+    size_t scanned = 0;
+
+    unsigned long lastTurn = 0;
+    int lastDirection = 0;
+    int streak = 0;
+
+    bool filtering() const { return filter.length() > 0; }
+    bool scanning() { return filtering() && scanned < (refining ? candidates.size() : source.size()); }
+    int shown() { return filtering() ? matches.size() : source.size(); }
+    size_t itemAt(int pos) const { return filtering() ? matches[pos] : pos; }
+
+    void drawFrame();
+    void drawRows();
+    void drawLegend(const String &text, int32_t y);
+    void drawFooter();
+    void move(int step);
+    int stepFor(int direction);
+    void setFilter(const String &text);
+    void scan();
+#ifdef HAS_KEYBOARD
+    bool typed(const keyStroke &key);
+#endif
+};
+
+void ListView::drawFrame() {
+    int32_t height = LIST_ROW_HEIGHT * rows + 10;
+    tft.fillRoundRect(tftWidth * 0.10, boxY, tftWidth * 0.8, height, 5, bruceConfig.bgColor);
+    tft.drawRoundRect(tftWidth * 0.10, boxY, tftWidth * 0.8, height, 5, bruceConfig.priColor);
+    if (title && title[0]) drawLegend(title, boxY);
+}
+
+// Short text over the top or bottom edge of the frame
+void ListView::drawLegend(const String &text, int32_t y) {
+    int32_t x = tftWidth * 0.10 + 6;
+    int32_t width = tftWidth * 0.8 - 12;
+    tft.fillRect(x, y - 4 * FP, width, 8 * FP, bruceConfig.bgColor);
+    tft.drawFastHLine(x, y, width, bruceConfig.priColor);
+    if (text.length() == 0) return;
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.drawCentreString(" " + text.substring(0, width / (LW * FP) - 2) + " ", tftWidth / 2, y - 4 * FP, 1);
+}
+
+void ListView::drawFooter() {
+    int total = shown();
+    String text;
+    if (filtering()) text = "/" + filter + " ";
+    text += String(total > 0 ? cursor + 1 : 0) + "/" + String(total);
+    if (scanning()) text += "..";
+    drawLegend(text, boxY + LIST_ROW_HEIGHT * rows + 9);
+}
+
+void ListView::drawRows() {
+    int total = shown();
+    if (cursor < top) top = cursor;
+    if (cursor >= top + rows) top = cursor - rows + 1;
+
+    unsigned int chars = (tftWidth * 0.8 - 10) / (LW * FM) - 1;
+    int32_t x = tftWidth * 0.10 + 5;
+    int32_t y = boxY + 5;
+    tft.setTextSize(FM);
+    for (int r = 0; r < rows; r++) {
+        int pos = top + r;
+        String text = pos == cursor && total > 0 ? ">" : " ";
+        uint16_t color = bruceConfig.priColor;
+        if (pos < total) {
+            size_t item = itemAt(pos);
+            String label = source.label(item);
+            if (source.marked(item)) color = bruceConfig.secColor;
+            if (pos == cursor) {
+                current = label;
+                coord.x = x + FM * LW;
+                coord.y = y + 4;
+                coord.size = chars;
+                coord.fgcolor = color;
+                coord.bgcolor = bruceConfig.bgColor;
+            }
+            text += label;
+        } else if (r == 0 && filtering()) {
+            text += scanning() ? "searching.." : "no match";
+        }
+        // Padding clears what the row showed before
+        while (text.length() < chars) text += ' ';
+        tft.setTextColor(color, bruceConfig.bgColor);
+        tft.setCursor(x, y + 4);
+        tft.print(text.substring(0, chars));
+        y += LIST_ROW_HEIGHT;
+    }
+
+    int32_t barX = tftWidth * 0.9 - 4;
+    int32_t barHeight = LIST_ROW_HEIGHT * rows;
+    tft.fillRect(barX, boxY + 5, 2, barHeight, bruceConfig.bgColor);
+    if (total > rows) {
+        int32_t thumb = max<int32_t>(4, barHeight * rows / total);
+        int32_t thumbY = boxY + 5 + (int64_t)(barHeight - thumb) * top / (total - rows);
+        tft.fillRect(barX, thumbY, 2, thumb, bruceConfig.priColor);
+    }
+#if defined(HAS_TOUCH)
+    TouchFooter();
+#endif
+}
+
+// Single steps wrap around like the option menus, bigger ones stop at the ends
+void ListView::move(int step) {
+    int total = shown();
+    if (total == 0) return;
+    int next = cursor + step;
+    if (next < 0) next = step == -1 && cursor == 0 ? total - 1 : 0;
+    else if (next >= total) next = step == 1 && cursor == total - 1 ? 0 : total - 1;
+    cursor = next;
+}
+
+int ListView::stepFor(int direction) {
+#ifdef HAS_ENCODER
+    unsigned long now = millis();
+    streak = now - lastTurn < LIST_FAST_TURN_MS && direction == lastDirection ? streak + 1 : 0;
+    lastTurn = now;
+    lastDirection = direction;
+    // 1 row for the first detents, then 2, 4, 8.. while the knob keeps turning fast
+    return direction * min(LIST_MAX_STEP, 1 << min(streak / 4, 5));
+#else
+    return direction;
+#endif
+}
+
+void ListView::setFilter(const String &text) {
+    bool hadItem = shown() > 0;
+    size_t item = hadItem ? itemAt(cursor) : 0;
+    bool narrower = filtering() && !scanning() && text.startsWith(filter);
+    filter = text;
+    top = 0;
+    cursor = 0;
+    scanned = 0;
+    if (!filtering()) {
+        // Back on the whole list at the item that was under the cursor
+        matches.clear();
+        matches.shrink_to_fit();
+        candidates.clear();
+        if (hadItem) cursor = item;
+        return;
+    }
+    refining = narrower;
+    if (refining) candidates.swap(matches);
+    else candidates.clear();
+    matches.clear();
+}
+
+void ListView::scan() {
+    size_t total = refining ? candidates.size() : source.size();
+    size_t end = min<size_t>(total, scanned + LIST_SCAN_CHUNK);
+    for (; scanned < end; scanned++) {
+        size_t item = refining ? candidates[scanned] : scanned;
+        String label = source.label(item);
+        label.toLowerCase();
+        if (label.indexOf(filter) >= 0) matches.push_back(item);
+    }
+}
+
+#ifdef HAS_KEYBOARD
+// Printable keys grow the filter and del shortens it, true if it changed
+bool ListView::typed(const keyStroke &key) {
+    String text = filter;
+    for (char c : key.word) {
+        if (c >= 0x20 && c < 0x7F) text += (char)tolower(c);
+    }
+    if (key.del && text.length() > 0) text.remove(text.length() - 1);
+    if (text == filter) return false;
+    check(EscPress); // some keyboards report del as Esc too
+    setFilter(text);
+    return true;
+}
+#endif
+
+int ListView::run(int index) {
+    int count = source.size();
+    rows = constrain(count, 1, LIST_ROWS);
+    boxY = tftHeight / 2 - rows * LIST_ROW_HEIGHT / 2 - 5;
+    cursor = count > 0 ? constrain(index, 0, count - 1) : 0;
+    menuOptionType = MENU_TYPE_REGULAR; // updates menutype to the remote controller
+    menuOptionLabel = title;
+    drawMainBorder();
+    drawFrame();
+
+    bool redraw = true;
+    while (true) {
+        if (redraw) {
+            drawRows();
+            drawFooter();
+            redraw = false;
+        }
+        if (scanning()) {
+            size_t before = matches.size();
+            scan();
+            // New matches on screen, or the search ended without any
+            if ((matches.size() != before && (int)before < top + rows) || (!scanning() && matches.empty()))
+                drawRows();
+            if (matches.size() != before || !scanning()) drawFooter();
+        }
+        if (shown() > 0) displayScrollingText(current, coord);
+
+#ifdef HAS_KEYBOARD
+        if (KeyStroke.pressed) {
+            // The navigation keys type characters as well, those presses only move
+            bool navigation = PrevPress || NextPress || UpPress || DownPress || SelPress;
+            keyStroke key = _getKeyPress();
+            if (!navigation && typed(key)) redraw = true;
+        }
+#endif
+
+        if (PrevPress || check(UpPress)) {
+#if defined(HAS_KEYBOARD) || defined(HAS_ENCODER)
+            check(PrevPress);
+#else
+            // Long press on Prev leaves, there is no Esc button
+            long _tmp = millis();
+            LongPress = true;
+            while (PrevPress) {
+                if (millis() - _tmp > 200)
+                    tft.drawArc(
+                        tftWidth / 2,
+                        tftHeight / 2,
+                        25,
+                        15,
+                        0,
+                        360 * (millis() - (_tmp + 200)) / 500,
+                        getColorVariation(bruceConfig.priColor),
+                        bruceConfig.bgColor
+                    );
+                vTaskDelay(10 / portTICK_RATE_MS);
+            }
+            tft.drawArc(
+                tftWidth / 2, tftHeight / 2, 25, 15, 0, 360, bruceConfig.bgColor, bruceConfig.bgColor
+            );
+            LongPress = false;
+            check(PrevPress);
+            if (millis() - _tmp > 700) return -1;
+#endif
+            move(stepFor(-1));
+            redraw = true;
+        }
+        if (check(NextPress) || check(DownPress)) {
+            move(stepFor(1));
+            redraw = true;
+        }
+
+        // forceMenuOption is set by a SerialCommand to force a selection within the menu
+        if (forceMenuOption >= 0) {
+            int chosen = forceMenuOption;
+            forceMenuOption = -1;
+            if (chosen < (int)source.size()) return chosen;
+        }
+        if (check(SelPress) && shown() > 0) return itemAt(cursor);
+
+#ifdef HAS_KEYBOARD
+        if (check(EscPress)) {
+            if (!filtering()) return -1;
+            setFilter("");
+            redraw = true;
+        }
+#elif defined(T_EMBED) || defined(HAS_TOUCH) || !defined(HAS_SCREEN) || defined(HAS_ENCODER)
+        if (check(EscPress)) return -1;
+#endif
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+}
+
+int loopList(ListSource &source, int index, const char *title) {
+    ListView view(source, title ? title : "");
+    return view.run(index);
+}
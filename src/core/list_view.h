@@ -0,0 +1,22 @@
+#ifndef __LIST_VIEW_H__
+#define __LIST_VIEW_H__
+
+#include <Arduino.h>
+
+// Items of a list shown by loopList(). Labels are asked for only while they are on screen or being
+// searched, so a list of thousands of entries needs no std::vector<Option> with a label and a lambda each.
+class ListSource {
+public:
+    virtual ~ListSource() = default;
+    virtual size_t size() = 0;
+    virtual String label(size_t index) = 0;
+    // Drawn in the secondary color, like Option::selected
+    virtual bool marked(size_t index) { return false; }
+};
+
+// List in the look of a regular loopOptions() menu, returns the chosen index in the source or -1.
+// Keyboard devices narrow the list down to the labels containing what is typed, del and Esc edit the
+// filter. Turning an encoder quickly moves several rows per detent.
+int loopList(ListSource &source, int index = 0, const char *title = "");
+
+#endif
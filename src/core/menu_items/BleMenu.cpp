@@ -1,5 +1,6 @@
 #include "BleMenu.h"
 #include "core/display.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/badusb_ble/ducky_typer.h"
 #include "modules/ble/ble_common.h"
@@ -47,9 +48,7 @@ void BleMenu::optionsMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "Bluetooth");
 }
 void BleMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.ble), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.ble, 0, imgCenterY, true);
 }
 
 void BleMenu::drawIcon(float scale) {
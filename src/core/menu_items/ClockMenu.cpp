@@ -1,16 +1,11 @@
 #include "ClockMenu.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 
 void ClockMenu::optionsMenu() { runClockLoop(); }
 void ClockMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(),
-        bruceConfig.getThemeItemImg(bruceConfig.theme.paths.clock),
-        0,
-        imgCenterY,
-        true
-    );
+    drawThemeImg(bruceConfig.theme.paths.clock, 0, imgCenterY, true);
 }
 void ClockMenu::drawIcon(float scale) {
     clearIconArea();
@@ -3,6 +3,7 @@
 #include "core/i2c_finder.h"
 #include "core/main_menu.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
 #ifdef HAS_RGB_LED
@@ -111,13 +112,7 @@ void ConfigMenu::devMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "Dev Mode");
 }
 void ConfigMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(),
-        bruceConfig.getThemeItemImg(bruceConfig.theme.paths.config),
-        0,
-        imgCenterY,
-        true
-    );
+    drawThemeImg(bruceConfig.theme.paths.config, 0, imgCenterY, true);
 }
 void ConfigMenu::drawIcon(float scale) {
     clearIconArea();
@@ -4,6 +4,7 @@
 #include "core/connect/serial_commands.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
 
@@ -22,13 +23,7 @@ void ConnectMenu::optionsMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, getName().c_str());
 }
 void ConnectMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(),
-        bruceConfig.getThemeItemImg(bruceConfig.theme.paths.connect),
-        0,
-        imgCenterY,
-        true
-    );
+    drawThemeImg(bruceConfig.theme.paths.connect, 0, imgCenterY, true);
 }
 void ConnectMenu::drawIcon(float scale) {
     clearIconArea();
@@ -2,6 +2,7 @@
 #if !defined(LITE_VERSION)
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/ethernet/ARPScanner.h"
 #include "modules/ethernet/DHCPStarvation.h"
@@ -59,13 +60,7 @@ void EthernetMenu::optionsMenu() {
 }
 
 void EthernetMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(),
-        bruceConfig.getThemeItemImg(bruceConfig.theme.paths.ethernet),
-        0,
-        imgCenterY,
-        true
-    );
+    drawThemeImg(bruceConfig.theme.paths.ethernet, 0, imgCenterY, true);
 }
 void EthernetMenu::drawIcon(float scale) {
     clearIconArea();
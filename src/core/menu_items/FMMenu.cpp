@@ -1,5 +1,6 @@
 #include "FMMenu.h"
 #include "core/display.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/fm/fm.h"
 
@@ -19,9 +20,7 @@ void FMMenu::optionsMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "FM");
 }
 void FMMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.fm), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.fm, 0, imgCenterY, true);
 }
 void FMMenu::drawIcon(float scale) {
     clearIconArea();
@@ -2,6 +2,7 @@
 #include "core/display.h"
 #include "core/massStorage.h"
 #include "core/sd_functions.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "core/wifi/webInterface.h"
 
@@ -19,13 +20,7 @@ void FileMenu::optionsMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "Files");
 }
 void FileMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(),
-        bruceConfig.getThemeItemImg(bruceConfig.theme.paths.files),
-        0,
-        imgCenterY,
-        true
-    );
+    drawThemeImg(bruceConfig.theme.paths.files, 0, imgCenterY, true);
 }
 void FileMenu::drawIcon(float scale) {
     clearIconArea();
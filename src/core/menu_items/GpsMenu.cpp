@@ -1,6 +1,7 @@
 #include "GpsMenu.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/gps/gps_tracker.h"
 #include "modules/gps/wardriving.h"
@@ -28,9 +29,7 @@ void GpsMenu::configMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "GPS Config");
 }
 void GpsMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.gps), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.gps, 0, imgCenterY, true);
 }
 void GpsMenu::drawIcon(float scale) {
     clearIconArea();
@@ -1,6 +1,7 @@
 #include "IRMenu.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/ir/TV-B-Gone.h"
 #include "modules/ir/custom_ir.h"
@@ -36,9 +37,7 @@ void IRMenu::configMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "IR Config");
 }
 void IRMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.ir), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.ir, 0, imgCenterY, true);
 }
 void IRMenu::drawIcon(float scale) {
     clearIconArea();
@@ -1,5 +1,6 @@
 #include "NRF24.h"
 #include "core/display.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/NRF24/nrf_common.h"
 #include "modules/NRF24/nrf_jammer.h"
@@ -65,9 +66,7 @@ void NRF24Menu::configMenu() {
 #endif
 }
 void NRF24Menu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.nrf), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.nrf, 0, imgCenterY, true);
 }
 void NRF24Menu::drawIcon(float scale) {
     clearIconArea();
@@ -1,5 +1,6 @@
 #include "OthersMenu.h"
 #include "core/display.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/badusb_ble/ducky_typer.h"
 #include "modules/bjs_interpreter/interpreter.h"
@@ -35,13 +36,7 @@ void OthersMenu::optionsMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "Others");
 }
 void OthersMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(),
-        bruceConfig.getThemeItemImg(bruceConfig.theme.paths.others),
-        0,
-        imgCenterY,
-        true
-    );
+    drawThemeImg(bruceConfig.theme.paths.others, 0, imgCenterY, true);
 }
 void OthersMenu::drawIcon(float scale) {
     clearIconArea();
@@ -1,6 +1,7 @@
 #include "RFIDMenu.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/rfid/PN532KillerTools.h"
 #include "modules/rfid/amiibo.h"
@@ -77,9 +78,7 @@ void RFIDMenu::configMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "RFID Config");
 }
 void RFIDMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.rfid), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.rfid, 0, imgCenterY, true);
 }
 void RFIDMenu::drawIcon(float scale) {
     clearIconArea();
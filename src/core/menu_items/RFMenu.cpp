@@ -1,6 +1,7 @@
 #include "RFMenu.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/rf/record.h"
 #include "modules/rf/rf_bruteforce.h"
@@ -9,6 +10,7 @@
 #include "modules/rf/rf_scan.h"
 #include "modules/rf/rf_send.h"
 #include "modules/rf/rf_spectrum.h"
+#include "modules/rf/rf_survey.h"
 #include "modules/rf/rf_waterfall.h"
 
 void RFMenu::optionsMenu() {
@@ -23,6 +25,7 @@ void RFMenu::optionsMenu() {
         {"RSSI Spectrum",   rf_CC1101_rssi            }, // @Pirata
         {"SquareWave Spec", rf_SquareWave             }, // @Pirata
         {"Spectogram",      rf_waterfall              }, // dev_eclipse
+        {"Survey",          rf_survey                 },
 #if defined(BUZZ_PIN) or defined(HAS_NS4168_SPKR) and defined(RF_LISTEN_H)
         {"Listen",          rf_listen                 }, // dev_eclipse
 #endif
@@ -54,9 +57,7 @@ void RFMenu::configMenu() {
     loopOptions(options, MENU_TYPE_SUBMENU, "RF Config");
 }
 void RFMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.rf), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.rf, 0, imgCenterY, true);
 }
 void RFMenu::drawIcon(float scale) {
     clearIconArea();
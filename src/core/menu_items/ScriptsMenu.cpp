@@ -2,6 +2,7 @@
 #include "ScriptsMenu.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "modules/bjs_interpreter/interpreter.h" // for JavaScript interpreter
 #include <algorithm>                             // for std::sort
@@ -77,13 +78,7 @@ void ScriptsMenu::optionsMenu() {
 #endif
 }
 void ScriptsMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(),
-        bruceConfig.getThemeItemImg(bruceConfig.theme.paths.interpreter),
-        0,
-        imgCenterY,
-        true
-    );
+    drawThemeImg(bruceConfig.theme.paths.interpreter, 0, imgCenterY, true);
 }
 void ScriptsMenu::drawIcon(float scale) {
     clearIconArea();
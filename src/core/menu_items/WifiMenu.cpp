@@ -1,6 +1,7 @@
 #include "WifiMenu.h"
 #include "core/display.h"
 #include "core/settings.h"
+#include "core/theme_cache.h"
 #include "core/utils.h"
 #include "core/wifi/webInterface.h"
 #include "core/wifi/wg.h"
@@ -153,9 +154,7 @@ void WifiMenu::configMenu() {
 }
 
 void WifiMenu::drawIconImg() {
-    drawImg(
-        *bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.wifi), 0, imgCenterY, true
-    );
+    drawThemeImg(bruceConfig.theme.paths.wifi, 0, imgCenterY, true);
 }
 void WifiMenu::drawIcon(float scale) {
     clearIconArea();
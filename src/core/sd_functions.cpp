@@ -1,5 +1,6 @@
 #include "sd_functions.h"
 #include "display.h" // using displayRedStripe as error msg
+#include "list_view.h"
 #include "modules/badusb_ble/ducky_typer.h"
 #include "modules/bjs_interpreter/interpreter.h"
 #include "modules/gps/wigle.h"
@@ -528,6 +529,51 @@ void readFs(FS fs, String folder, String allowed_ext) {
     fileList.push_back(object);
 }
 
+// Rows of fileList as read by readFs(), folders end in "/" and are drawn in the secondary color
+class FileListSource : public ListSource {
+public:
+    size_t size() override { return fileList.size(); }
+    String label(size_t index) override {
+        return fileList[index].folder ? fileList[index].filename + "/" : fileList[index].filename;
+    }
+    bool marked(size_t index) override { return fileList[index].folder; }
+};
+
+/*********************************************************************
+**  Function: pickFile
+**  File picker of loopSD(), one loopList() per folder so a folder of
+**  thousands of files can be filtered by typing a part of the name
+**********************************************************************/
+static String pickFile(FS &fs, String folder, String allowed_ext) {
+    FileListSource files;
+    String result = "";
+    String cameFrom = ""; // folder to put the cursor on after going up
+    while (true) {
+        readFs(fs, folder, allowed_ext);
+        int index = 0;
+        for (size_t i = 0; cameFrom != "" && i < fileList.size(); i++) {
+            if (fileList[i].folder && fileList[i].filename == cameFrom) index = i;
+        }
+        int chosen = loopList(files, index, folder.c_str());
+        cameFrom = "";
+        if (chosen < 0 || fileList[chosen].operation) { // Esc or "> Back" go up like loopSD
+            if (folder == "/") break;
+            cameFrom = folder.substring(folder.lastIndexOf('/') + 1);
+            folder = folder.substring(0, folder.lastIndexOf('/'));
+            if (folder == "") folder = "/";
+            continue;
+        }
+        String path = folder + (folder == "/" ? "" : "/") + fileList[chosen].filename;
+        if (!fileList[chosen].folder) {
+            result = path;
+            break;
+        }
+        folder = path;
+    }
+    fileList.clear();
+    return result;
+}
+
 /*********************************************************************
 **  Function: loopSD
 **  Where you choose what to do with your SD Files
@@ -545,7 +591,6 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
     }
 
     Opt_Coord coord;
-    String result = "";
     const short PAGE_JUMP_SIZE = (tftHeight - 20) / (LH * FM);
     bool reload = false;
     bool redraw = true;
@@ -562,6 +607,7 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
             return "";
         }
     }
+    if (filePicker) return pickFile(fs, rootPath, allowed_ext);
     bool exit = false;
     // returnToMenu=true;  // make sure menu is redrawn when quitting in any point
 
@@ -808,7 +854,7 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
                         options.insert(options.begin(), {"Play Audio", [&]() {
                                                              delay(200);
                                                              check(AnyKeyPress);
-                                                             playAudioFile(&fs, filepath);
+                                                             audioPlayerScreen(&fs, filepath);
                                                          }});
 #endif
                     // generate qr codes from small files (<3K)
@@ -830,11 +876,7 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
                     }
                     options.push_back({"Close Menu", [&]() { yield(); }});
                     options.push_back({"Main Menu", [&]() { exit = true; }});
-                    if (!filePicker) loopOptions(options);
-                    else {
-                        result = filepath;
-                        break;
-                    }
+                    loopOptions(options);
                     tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
                     reload = true;
                     redraw = true;
@@ -854,7 +896,7 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
         }
     }
     fileList.clear();
-    return result;
+    return "";
 }
 
 /*********************************************************************
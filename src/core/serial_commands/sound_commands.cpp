@@ -1,6 +1,7 @@
 #include "sound_commands.h"
 #include "core/sd_functions.h"
 #include "modules/others/audio.h"
+#include "modules/others/audio_player.h"
 #include <globals.h>
 
 uint32_t toneCallback(cmd *c) {
@@ -84,6 +85,58 @@ uint32_t ttsCallback(cmd *c) {
     return r;
 }
 
+#ifdef HAS_NS4168_SPKR
+uint32_t audioPlayCallback(cmd *c) {
+    // audio play music/song.mp3
+    // plays in the background, the CLI stays available
+
+    Command cmd(c);
+
+    Argument arg = cmd.getArgument("filepath");
+    String filepath = arg.getValue();
+    filepath.trim();
+    if (!filepath.startsWith("/")) filepath = "/" + filepath;
+
+    FS *fs;
+    if (!getFsStorage(fs)) return false;
+
+    if (!(*fs).exists(filepath)) {
+        serialDevice->println("Song file does not exist");
+        return false;
+    }
+
+    return audioPlayer.play(fs, filepath);
+}
+
+uint32_t audioControlCallback(cmd *c) {
+    // audio pause|resume|stop|status
+    // audio seek 50
+    // audio volume 80
+
+    Command cmd(c);
+    String name = cmd.getName();
+    Argument arg = cmd.getArgument("value");
+    int value = arg ? arg.getValue().toInt() : 0;
+
+    if (name == "pause") audioPlayer.pause();
+    else if (name == "resume") audioPlayer.resume();
+    else if (name == "stop") audioPlayer.stop();
+    else if (name == "seek") audioPlayer.seek(constrain(value, 0, 100));
+    else if (name == "volume") audioPlayer.setVolume(constrain(value, 0, 100));
+
+    static const char *states[] = {"idle", "playing", "paused"};
+    serialDevice->printf(
+        "state: %s, position: %lu/%lu (%d%%), completed: %lu\n",
+        states[(int)audioPlayer.state()],
+        (unsigned long)audioPlayer.position(),
+        (unsigned long)audioPlayer.size(),
+        audioPlayer.progress(),
+        (unsigned long)audioPlayer.completions()
+    );
+    return true;
+}
+#endif
+
 void createSoundCommands(SimpleCLI *cli) {
     Command toneCmd = cli->addCommand("tone,beep", toneCallback);
     toneCmd.addPosArg("frequency", "500UL");
@@ -94,6 +147,18 @@ void createSoundCommands(SimpleCLI *cli) {
     playCmd.addPosArg("song");
 
     Command ttsCmd = cli->addSingleArgCmd("tts,say", ttsCallback);
+
+    Command audioCmd = cli->addCompositeCmd("audio");
+    Command audioPlayCmd = audioCmd.addCommand("play", audioPlayCallback);
+    audioPlayCmd.addPosArg("filepath");
+    audioCmd.addCommand("pause", audioControlCallback);
+    audioCmd.addCommand("resume", audioControlCallback);
+    audioCmd.addCommand("stop", audioControlCallback);
+    audioCmd.addCommand("status", audioControlCallback);
+    Command audioSeekCmd = audioCmd.addCommand("seek", audioControlCallback);
+    audioSeekCmd.addPosArg("value");
+    Command audioVolumeCmd = audioCmd.addCommand("volume", audioControlCallback);
+    audioVolumeCmd.addPosArg("value");
 #endif
 
     // TODO: webradio
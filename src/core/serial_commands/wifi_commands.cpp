@@ -1,4 +1,5 @@
 #include "wifi_commands.h"
+#include "core/net_utils.h"
 #include "core/wifi/webInterface.h"
 #include "core/wifi/wifi_common.h" //to return MAC addr
 #include <globals.h>
@@ -7,6 +8,7 @@
 #include "esp_netif_net_stack.h"
 #include "modules/wifi/tcp_utils.h"
 #include "modules/wifi/sniffer.h"
+#include "modules/wifi/sniffer_stats.h"
 //#include "modules/wifi/responder.h"
 
 uint32_t wifiCallback(cmd *c) {
@@ -83,6 +85,80 @@ uint32_t snifferCallback(cmd *c) {
     return true;
 }
 
+uint32_t snifferStatsCallback(cmd *c) {
+    Command cmd(c);
+    String kind = cmd.getArgument("kind").getValue();
+    kind.trim();
+    int top = cmd.getArgument("top").getValue().toInt();
+    String sort = cmd.getArgument("sort").getValue();
+    sort.trim();
+
+    FS *fs = sniffer_stats_fs();
+    if (kind == "clear") {
+        bool ok = snifferStats.clear(*fs);
+        serialDevice->println(ok ? "Sniffer statistics cleared" : "Could not clear the sniffer statistics");
+        return ok;
+    }
+    if (kind != "ap" && kind != "client") {
+        serialDevice->println(
+            "Usage: sniffstats [ap|client|clear] [top N] [frames|rssi|seen]\n"
+            "-> sniffstats ap 10 frames (10 networks with the most frames)\n"
+            "-> sniffstats client 20 seen (20 clients seen last)"
+        );
+        return false;
+    }
+    SnifferStatsKind k = kind == "ap" ? SnifferStatsKind::AP : SnifferStatsKind::Client;
+    SnifferStatsSort s = sort == "rssi"   ? SnifferStatsSort::Rssi
+                         : sort == "seen" ? SnifferStatsSort::LastSeen
+                                          : SnifferStatsSort::Frames;
+    std::vector<SnifferStatsRecord> rows = snifferStats.top(*fs, k, s, top > 0 ? top : 10);
+    if (rows.empty()) {
+        serialDevice->println("No sniffer statistics yet, run the sniffer first");
+        return true;
+    }
+
+    bool ap = k == SnifferStatsKind::AP;
+    serialDevice->printf(
+        "%-17s %8s  %-16s  %-5s  %4s  %-16s  %-8s  %s\n",
+        ap ? "BSSID" : "MAC",
+        "Frames",
+        "RSSI min/avg/max",
+        "EAPOL",
+        "Sess",
+        "Last seen",
+        "Channels",
+        ap ? "SSID" : "Network"
+    );
+    for (const SnifferStatsRecord &r : rows) {
+        char eapol[5] = "----";
+        for (int i = 0; i < 4; i++) {
+            if (r.eapol & (1 << i)) eapol[i] = '1' + i;
+        }
+        char seen[20] = "-";
+        if (r.lastSeen) {
+            time_t t = r.lastSeen;
+            struct tm tm;
+            localtime_r(&t, &tm);
+            strftime(seen, sizeof(seen), "%Y-%m-%d %H:%M", &tm);
+        }
+        String network = ap ? String(r.ssid) : macToString(r.bssid);
+        serialDevice->printf(
+            "%s %8lu  %4d/%4d/%4d    %s   %4u  %-16s  %-8s  %s\n",
+            macToString(r.mac).c_str(),
+            (unsigned long)r.frames,
+            r.frames ? r.rssiMin : 0,
+            r.rssiAvg(),
+            r.frames ? r.rssiMax : 0,
+            eapol,
+            r.sessions,
+            seen,
+            sniffer_stats_channels(r.channels).c_str(),
+            network.c_str()
+        );
+    }
+    return true;
+}
+
 uint32_t listenTCPCallback(cmd *c) {
     if (!wifiConnected) Serial.println("Connect to a WiFi first."); return false;
 
@@ -117,6 +193,11 @@ void createWifiCommands(SimpleCLI *cli) {
     Command listenTCPCmd = cli->addCommand("listen", listenTCPCallback); //TODO: make possible to select port to open via Serial
     
     Command snifferCmd = cli->addCommand("sniffer", snifferCallback); //TODO: be able to exit from it from Serial
+
+    Command snifferStatsCmd = cli->addCommand("sniffstats", snifferStatsCallback);
+    snifferStatsCmd.addPosArg("kind", "ap");
+    snifferStatsCmd.addPosArg("top", "10");
+    snifferStatsCmd.addPosArg("sort", "frames");
     
     #endif
     //Command responderCmd = cli->addCommand("responder", responderCallback); TODO
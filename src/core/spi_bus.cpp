@@ -0,0 +1,185 @@
+#include "spi_bus.h"
+#include <globals.h>
+
+SpiArbiter spiArbiter;
+
+struct SpiDeviceInfo {
+    const char *name;
+    uint32_t clock;
+    uint8_t mode;
+    UBaseType_t priority; // the holder of the bus runs at least at this priority
+};
+
+// Indexed by SpiDevice. Radios come first, their FIFOs and timing do not wait for a redraw.
+static const SpiDeviceInfo deviceInfo[] = {
+#ifdef SPI_FREQUENCY
+    {"Display",  SPI_FREQUENCY, SPI_MODE0, 1},
+#else
+    {"Display",  40000000,      SPI_MODE0, 1},
+#endif
+    {"SD",       4000000,       SPI_MODE0, 2},
+    {"CC1101",   4000000,       SPI_MODE0, 3},
+    {"NRF24",    10000000,      SPI_MODE0, 3},
+    {"LoRa",     2000000,       SPI_MODE0, 3},
+    {"Ethernet", 14000000,      SPI_MODE0, 2},
+};
+
+static const BruceConfigPins::SPIPins *pinsOf(SpiDevice device) {
+    switch (device) {
+        case SpiDevice::SDCard: return &bruceConfigPins.SDCARD_bus;
+        case SpiDevice::CC1101: return &bruceConfigPins.CC1101_bus;
+        case SpiDevice::NRF24: return &bruceConfigPins.NRF24_bus;
+        case SpiDevice::LoRa: return &bruceConfigPins.LoRa_bus;
+        case SpiDevice::Ethernet: return &bruceConfigPins.W5500_bus;
+        default: return nullptr;
+    }
+}
+
+static int mosiOf(SpiDevice device) {
+    if (device == SpiDevice::Display) {
+#if defined(HAS_SCREEN) && TFT_MOSI > 0
+        return TFT_MOSI;
+#else
+        return -1; // headless or parallel display
+#endif
+    }
+    const BruceConfigPins::SPIPins *pins = pinsOf(device);
+    return pins && pins->mosi != GPIO_NUM_NC ? (int)pins->mosi : -1;
+}
+
+void SpiArbiter::begin() {
+    for (Bus &bus : buses) {
+        if (!bus.lock) bus.lock = xSemaphoreCreateRecursiveMutex();
+        if (!bus.lock) return;
+    }
+    ready = true;
+}
+
+bool SpiArbiter::shared(SpiDevice device) {
+    int mosi = mosiOf(device);
+    if (mosi < 0) return false;
+    for (int d = 0; d < (int)SpiDevice::Count; d++) {
+        if ((SpiDevice)d != device && mosiOf((SpiDevice)d) == mosi) return true;
+    }
+    return false;
+}
+
+SPIClass *SpiArbiter::instanceFor(SpiDevice device) {
+    int mosi = mosiOf(device);
+    if (mosi < 0) return nullptr;
+#if defined(HAS_SCREEN) && TFT_MOSI > 0
+    if (mosi == TFT_MOSI) return &tft.getSPIinstance();
+#endif
+    if (mosi == mosiOf(SpiDevice::SDCard)) return &sdcardSPI;
+    // The radios and the W5500 share CC_NRF_SPI when they are wired together
+    for (int d = (int)SpiDevice::CC1101; d < (int)SpiDevice::Count; d++) {
+        if ((SpiDevice)d != device && mosiOf((SpiDevice)d) == mosi) return &CC_NRF_SPI;
+    }
+    return nullptr;
+}
+
+SPIClass *SpiArbiter::bus(SpiDevice device) {
+    SPIClass *spi = shared(device) ? instanceFor(device) : nullptr;
+    if (!spi) return nullptr;
+    const BruceConfigPins::SPIPins *pins = pinsOf(device);
+    // Does nothing when the bus already runs, the display bus is begun by the display
+    if (pins && spi != &tft.getSPIinstance()) spi->begin(pins->sck, pins->miso, pins->mosi);
+    Serial.printf("%s on a shared SPI bus\n", deviceInfo[(int)device].name);
+    return spi;
+}
+
+// Buses get a lock slot the first time a shared device uses them, a slot is reused once no device is
+// wired to its pins any more
+SpiArbiter::Bus *SpiArbiter::busOf(SpiDevice device) {
+    if (!ready || !shared(device)) return nullptr;
+    int mosi = mosiOf(device);
+    int wired[(int)SpiDevice::Count];
+    for (int d = 0; d < (int)SpiDevice::Count; d++) wired[d] = mosiOf((SpiDevice)d);
+
+    Bus *found = nullptr;
+    portENTER_CRITICAL(&mux);
+    for (Bus &bus : buses) {
+        if (bus.mosi == mosi) {
+            found = &bus;
+            break;
+        }
+    }
+    for (int i = 0; !found && i < (int)SpiDevice::Count; i++) {
+        Bus &bus = buses[i];
+        bool used = false;
+        for (int d = 0; d < (int)SpiDevice::Count; d++) used |= bus.mosi >= 0 && wired[d] == bus.mosi;
+        if (bus.depth == 0 && !used) {
+            bus.mosi = mosi;
+            bus.owner = SpiDevice::Count;
+            found = &bus;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+    return found;
+}
+
+void SpiArbiter::acquire(SpiDevice device) {
+    Bus *bus = busOf(device);
+    if (!bus) return;
+    xSemaphoreTakeRecursive(bus->lock, portMAX_DELAY);
+    const SpiDeviceInfo &info = deviceInfo[(int)device];
+    if (bus->depth++ == 0) raisePriority(info.priority);
+    if (bus->owner == device) return;
+    bus->owner = device;
+    // Drivers that do not use transactions find the bus set up for them, the display sets its own
+    SPIClass *spi = device == SpiDevice::Display ? nullptr : instanceFor(device);
+    if (spi && spi->bus()) {
+        spi->beginTransaction(SPISettings(info.clock, MSBFIRST, info.mode));
+        spi->endTransaction();
+    }
+}
+
+void SpiArbiter::release(SpiDevice device) {
+    Bus *bus = busOf(device);
+    if (!bus || bus->depth == 0 || xSemaphoreGetMutexHolder(bus->lock) != xTaskGetCurrentTaskHandle()) return;
+    if (--bus->depth == 0) restorePriority();
+    xSemaphoreGiveRecursive(bus->lock);
+}
+
+// The base priority is read while the task holds no bus, so it is never one inherited through a bus
+// lock, and it is only set back once the last bus is released. Buses released out of order keep the
+// highest boost until then.
+void SpiArbiter::raisePriority(UBaseType_t priority) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    UBaseType_t current = uxTaskPriorityGet(NULL);
+    Holder *holder = nullptr;
+    portENTER_CRITICAL(&mux);
+    for (Holder &h : holders) {
+        if (h.task == self) holder = &h;
+    }
+    for (int i = 0; !holder && i < (int)SpiDevice::Count; i++) {
+        if (holders[i].task == NULL) {
+            holder = &holders[i];
+            *holder = {self, 0, current, current};
+        }
+    }
+    bool raise = holder && priority > holder->priority;
+    if (holder) holder->buses++;
+    if (raise) holder->priority = priority;
+    portEXIT_CRITICAL(&mux);
+    if (raise) vTaskPrioritySet(NULL, priority);
+}
+
+void SpiArbiter::restorePriority() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    bool restore = false;
+    UBaseType_t base = 0;
+    portENTER_CRITICAL(&mux);
+    for (Holder &h : holders) {
+        if (h.task != self || --h.buses > 0) continue;
+        restore = h.priority != h.basePriority;
+        base = h.basePriority;
+        h = Holder();
+    }
+    portEXIT_CRITICAL(&mux);
+    if (restore) vTaskPrioritySet(NULL, base);
+}
+
+// Every display transaction goes through the arbiter, TFT_eSPI calls these around them
+void tft_bus_acquire(void) { spiArbiter.acquire(SpiDevice::Display); }
+void tft_bus_release(void) { spiArbiter.release(SpiDevice::Display); }
@@ -0,0 +1,68 @@
+#ifndef __SPI_BUS_H__
+#define __SPI_BUS_H__
+
+#include <Arduino.h>
+#include <SPI.h>
+
+// Devices on the SPI buses. Buses are told apart by their MOSI pin, as the module setup always did,
+// devices wired to the same pins share one SPIClass and one lock.
+enum class SpiDevice : uint8_t { Display, SDCard, CC1101, NRF24, LoRa, Ethernet, Count };
+
+class SpiArbiter {
+public:
+    // Creates the bus locks, until then nothing is serialized
+    void begin();
+
+    // SPIClass already driving the pins of the device, begun on them. nullptr when no other device is
+    // wired to these pins, the driver can then have a bus of its own.
+    SPIClass *bus(SpiDevice device);
+    bool shared(SpiDevice device);
+
+    // Keeps the other tasks off the device's bus while it transfers, the same task may nest them.
+    // Taking the bus from another device sets this device's clock and mode first, and the holder runs
+    // at least at the device's priority so a radio read is not stretched out by the UI. The priority
+    // the task had before its first bus comes back once it released its last one.
+    // Devices on other buses never wait, the display keeps drawing while a radio on its own bus works.
+    void acquire(SpiDevice device);
+    void release(SpiDevice device);
+
+private:
+    struct Bus {
+        int mosi = -1;
+        SemaphoreHandle_t lock = NULL;
+        SpiDevice owner = SpiDevice::Count; // last device that used the bus
+        UBaseType_t depth = 0;
+    };
+    // A task holding buses, at most one per bus
+    struct Holder {
+        TaskHandle_t task = NULL;
+        uint8_t buses = 0;
+        UBaseType_t basePriority = 0; // before it took its first bus
+        UBaseType_t priority = 0;     // what it runs at now
+    };
+    Bus buses[(int)SpiDevice::Count];
+    Holder holders[(int)SpiDevice::Count];
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    bool ready = false;
+
+    Bus *busOf(SpiDevice device);
+    SPIClass *instanceFor(SpiDevice device);
+    void raisePriority(UBaseType_t priority);
+    void restorePriority();
+};
+
+extern SpiArbiter spiArbiter;
+
+// Holds the device's bus for the scope
+class SpiGuard {
+public:
+    explicit SpiGuard(SpiDevice device) : device(device) { spiArbiter.acquire(device); }
+    ~SpiGuard() { spiArbiter.release(device); }
+    SpiGuard(const SpiGuard &) = delete;
+    SpiGuard &operator=(const SpiGuard &) = delete;
+
+private:
+    SpiDevice device;
+};
+
+#endif
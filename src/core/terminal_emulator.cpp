@@ -0,0 +1,504 @@
+#include "terminal_emulator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// DEC special graphics for 0x60..0x7E, the line drawing set of curses applications
+static const uint16_t decGraphics[31] = {
+    0x25C6, 0x2592, 0x2409, 0x240C, 0x240D, 0x240A, 0x00B0, 0x00B1, 0x2424, 0x240B, 0x2518,
+    0x2510, 0x250C, 0x2514, 0x253C, 0x23BA, 0x23BB, 0x2500, 0x23BC, 0x23BD, 0x251C, 0x2524,
+    0x2534, 0x252C, 0x2502, 0x2264, 0x2265, 0x03C0, 0x2260, 0x00A3, 0x00B7,
+};
+
+TerminalEmulator::TerminalEmulator(uint16_t cols, uint16_t rows, uint16_t scrollback)
+    : width(std::max<uint16_t>(cols, 1)), height(std::max<uint16_t>(rows, 1)), historySize(scrollback) {
+    screen.assign(width * height, Cell());
+    dirty.assign(height, true);
+    history.assign(historySize * width, Cell());
+    reset();
+}
+
+void TerminalEmulator::reset() {
+    altScreen = false;
+    mainScreen.clear();
+    pen = Cell();
+    std::fill(screen.begin(), screen.end(), Cell());
+    curX = curY = 0;
+    wrapPending = false;
+    showCursor = true;
+    autoWrap = true;
+    originMode = false;
+    top = 0;
+    bottom = height - 1;
+    lineDrawing[0] = lineDrawing[1] = false;
+    charset = 0;
+    saved = Saved();
+    state = State::Ground;
+    utf8Remaining = 0;
+    markAllDirty();
+}
+
+void TerminalEmulator::write(const char *text) { write((const uint8_t *)text, strlen(text)); }
+
+void TerminalEmulator::write(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = data[i];
+
+        // C0 controls act in the middle of sequences too, except inside strings
+        if (c < 0x20 && state != State::Osc && state != State::OscEscape) {
+            if (c == 0x18 || c == 0x1A) state = State::Ground; // CAN, SUB
+            else control(c);
+            continue;
+        }
+
+        switch (state) {
+            case State::Ground:
+                if (utf8Remaining > 0) {
+                    if ((c & 0xC0) == 0x80) {
+                        utf8 = (utf8 << 6) | (c & 0x3F);
+                        if (--utf8Remaining == 0) print(utf8 <= 0xFFFF ? utf8 : '?');
+                        break;
+                    }
+                    utf8Remaining = 0;
+                    print('?'); // truncated sequence, this byte starts over
+                }
+                if (c < 0x7F) print(c);
+                else if (c == 0x7F) break; // DEL
+                else if (c >= 0xC0 && c < 0xF8) {
+                    utf8Remaining = c < 0xE0 ? 1 : c < 0xF0 ? 2 : 3;
+                    utf8 = c & (0x3F >> utf8Remaining);
+                } else print('?');
+                break;
+            case State::Escape: escape(c); break;
+            case State::Charset:
+                if (charsetSlot < 2) lineDrawing[charsetSlot] = c == '0';
+                state = State::Ground;
+                break;
+            case State::Csi:
+                if (c >= '0' && c <= '9') {
+                    int &p = params[paramCount - 1];
+                    p = std::min(p * 10 + (c - '0'), 9999);
+                } else if (c == ';' || c == ':') {
+                    if (paramCount < MAX_PARAMS) params[paramCount++] = 0;
+                } else if (c >= '<' && c <= '?') {
+                    privateMarker = c;
+                } else if (c >= 0x20 && c <= 0x2F) {
+                    privateMarker = privateMarker ? privateMarker : c; // intermediates: not supported
+                } else {
+                    state = State::Ground;
+                    if (c >= 0x40 && c <= 0x7E) csi(c);
+                }
+                break;
+            case State::Osc:
+                if (c == 0x07) state = State::Ground;
+                else if (c == 0x1B) state = State::OscEscape;
+                break;
+            case State::OscEscape: state = c == '\\' ? State::Ground : State::Osc; break;
+        }
+    }
+}
+
+void TerminalEmulator::control(uint8_t c) {
+    switch (c) {
+        case 0x08: // BS
+            if (curX > 0) curX--;
+            wrapPending = false;
+            break;
+        case 0x09: // HT, stops every 8 columns
+            curX = std::min<int>((curX / 8 + 1) * 8, width - 1);
+            wrapPending = false;
+            break;
+        case 0x0A:
+        case 0x0B:
+        case 0x0C: lineFeed(); break;
+        case 0x0D:
+            curX = 0;
+            wrapPending = false;
+            break;
+        case 0x0E: charset = 1; break; // SO
+        case 0x0F: charset = 0; break; // SI
+        case 0x1B: state = State::Escape; break;
+        default: break; // BEL and the rest
+    }
+}
+
+void TerminalEmulator::escape(uint8_t c) {
+    state = State::Ground;
+    switch (c) {
+        case '[':
+            state = State::Csi;
+            memset(params, 0, sizeof(params));
+            paramCount = 1;
+            privateMarker = 0;
+            break;
+        case ']':
+        case 'P': // DCS
+        case 'X':
+        case '^':
+        case '_': state = State::Osc; break;
+        case '(':
+        case ')':
+            state = State::Charset;
+            charsetSlot = c - '(';
+            break;
+        case '#':
+        case '*':
+        case '+':
+            state = State::Charset; // the next byte has nothing for us
+            charsetSlot = 2;
+            break;
+        case '7':
+            saved = {curX, curY, pen, originMode};
+            break;
+        case '8':
+            pen = saved.pen;
+            originMode = saved.originMode;
+            curX = std::min<uint16_t>(saved.x, width - 1);
+            curY = std::min<uint16_t>(saved.y, height - 1);
+            wrapPending = false;
+            break;
+        case 'D': lineFeed(); break;
+        case 'E':
+            curX = 0;
+            lineFeed();
+            break;
+        case 'M': reverseLineFeed(); break;
+        case 'c': reset(); break;
+        default: break; // keypad modes, tab stops
+    }
+}
+
+int TerminalEmulator::param(int index, int fallback) const {
+    return index < paramCount && params[index] > 0 ? params[index] : fallback;
+}
+
+void TerminalEmulator::csi(uint8_t final) {
+    int n = param(0, 1);
+    if (privateMarker && privateMarker != '?' && final != 'c') return;
+    if (privateMarker == '?' && final != 'h' && final != 'l' && final != 'J' && final != 'K') return;
+
+    Cell *row = &screen[curY * width];
+    switch (final) {
+        case '@': { // ICH
+            n = std::min<int>(n, width - curX);
+            std::move_backward(row + curX, row + width - n, row + width);
+            std::fill(row + curX, row + curX + n, blank());
+            touch(curY, curY);
+            break;
+        }
+        case 'P': { // DCH
+            n = std::min<int>(n, width - curX);
+            std::move(row + curX + n, row + width, row + curX);
+            std::fill(row + width - n, row + width, blank());
+            touch(curY, curY);
+            break;
+        }
+        case 'X': clear(curX, curY, std::min<int>(curX + n - 1, width - 1), curY); break;
+        case 'A': {
+            int limit = curY >= top ? top : 0;
+            curY = std::max<int>(curY - n, limit);
+            wrapPending = false;
+            break;
+        }
+        case 'B': {
+            int limit = curY <= bottom ? bottom : height - 1;
+            curY = std::min<int>(curY + n, limit);
+            wrapPending = false;
+            break;
+        }
+        case 'C': moveTo(curX + n, curY - (originMode ? top : 0)); break;
+        case 'D': moveTo(curX - n, curY - (originMode ? top : 0)); break;
+        case 'E':
+            curY = std::min<int>(curY + n, curY <= bottom ? bottom : height - 1);
+            curX = 0;
+            wrapPending = false;
+            break;
+        case 'F':
+            curY = std::max<int>(curY - n, curY >= top ? top : 0);
+            curX = 0;
+            wrapPending = false;
+            break;
+        case 'G':
+        case '`': moveTo(n - 1, curY - (originMode ? top : 0)); break;
+        case 'H':
+        case 'f': moveTo(param(1, 1) - 1, param(0, 1) - 1); break;
+        case 'd': moveTo(curX, n - 1); break;
+        case 'I':
+            for (int i = 0; i < n; i++) control(0x09);
+            break;
+        case 'Z':
+            curX = std::max<int>(((curX + 7) / 8 - n) * 8, 0);
+            wrapPending = false;
+            break;
+        case 'J': {
+            int mode = param(0, 0);
+            if (mode == 0) clear(curX, curY, width - 1, height - 1);
+            else if (mode == 1) clear(0, 0, curX, curY);
+            else clear(0, 0, width - 1, height - 1);
+            if (mode == 3) historyCount = 0;
+            break;
+        }
+        case 'K': {
+            int mode = param(0, 0);
+            if (mode == 0) clear(curX, curY, width - 1, curY);
+            else if (mode == 1) clear(0, curY, curX, curY);
+            else clear(0, curY, width - 1, curY);
+            break;
+        }
+        case 'L':
+            if (curY >= top && curY <= bottom) scrollDown(curY, bottom, n);
+            curX = 0;
+            wrapPending = false;
+            break;
+        case 'M':
+            if (curY >= top && curY <= bottom) scrollUp(curY, bottom, n);
+            curX = 0;
+            wrapPending = false;
+            break;
+        case 'S': scrollUp(top, bottom, n); break;
+        case 'T':
+            if (paramCount <= 1) scrollDown(top, bottom, n);
+            break;
+        case 'b':
+            n = std::min<int>(n, width * height);
+            for (int i = 0; i < n; i++) print(lastChar);
+            break;
+        case 'c':
+            if (privateMarker == 0) response += "\x1b[?1;2c"; // VT100 with advanced video
+            else if (privateMarker == '>') response += "\x1b[>0;0;0c";
+            break;
+        case 'h': setMode(true); break;
+        case 'l': setMode(false); break;
+        case 'm': sgr(); break;
+        case 'n': {
+            char reply[24];
+            if (param(0, 0) == 5) response += "\x1b[0n";
+            if (param(0, 0) == 6) {
+                snprintf(reply, sizeof(reply), "\x1b[%d;%dR", curY + 1 - (originMode ? top : 0), curX + 1);
+                response += reply;
+            }
+            break;
+        }
+        case 'r': {
+            int t = param(0, 1) - 1;
+            int b = param(1, height) - 1;
+            if (t < b && b < height) {
+                top = t;
+                bottom = b;
+                moveTo(0, 0);
+            }
+            break;
+        }
+        case 's': saved = {curX, curY, pen, originMode}; break;
+        case 'u': escape('8'); break;
+        default: break;
+    }
+}
+
+void TerminalEmulator::setMode(bool enable) {
+    for (int i = 0; i < paramCount; i++) {
+        if (privateMarker != '?') continue; // insert and newline modes are not supported
+        switch (params[i]) {
+            case 6:
+                originMode = enable;
+                moveTo(0, 0);
+                break;
+            case 7: autoWrap = enable; break;
+            case 25:
+                showCursor = enable;
+                touch(curY, curY);
+                break;
+            case 47:
+            case 1047: enterAltScreen(enable); break;
+            case 1048: escape(enable ? '7' : '8'); break;
+            case 1049:
+                if (enable) escape('7');
+                enterAltScreen(enable);
+                if (!enable) escape('8');
+                break;
+            default: break;
+        }
+    }
+}
+
+void TerminalEmulator::sgr() {
+    for (int i = 0; i < paramCount; i++) {
+        int p = params[i];
+        switch (p) {
+            case 0: pen = Cell(); break;
+            case 1: pen.attr |= Bold; break;
+            case 22: pen.attr &= ~Bold; break;
+            case 4: pen.attr |= Underline; break;
+            case 24: pen.attr &= ~Underline; break;
+            case 7: pen.attr |= Reverse; break;
+            case 27: pen.attr &= ~Reverse; break;
+            case 39:
+                pen.fg = 7;
+                pen.attr |= DefaultFg;
+                break;
+            case 49:
+                pen.bg = 0;
+                pen.attr |= DefaultBg;
+                break;
+            case 38:
+            case 48: {
+                int color = -1;
+                if (i + 2 < paramCount && params[i + 1] == 5) {
+                    color = std::min(params[i + 2], 255);
+                    i += 2;
+                } else if (i + 4 < paramCount && params[i + 1] == 2) {
+                    // True color to the nearest entry of the 6x6x6 cube
+                    int r = std::min(params[i + 2], 255), g = std::min(params[i + 3], 255),
+                        b = std::min(params[i + 4], 255);
+                    color = 16 + 36 * ((r * 5 + 127) / 255) + 6 * ((g * 5 + 127) / 255) + (b * 5 + 127) / 255;
+                    i += 4;
+                }
+                if (color < 0) return;
+                if (p == 38) pen.fg = color;
+                else pen.bg = color;
+                pen.attr &= p == 38 ? ~DefaultFg : ~DefaultBg;
+                break;
+            }
+            default:
+                // Faint, italic, blink... are not rendered
+                if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+                    pen.fg = p < 90 ? p - 30 : p - 90 + 8;
+                    pen.attr &= ~DefaultFg;
+                } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+                    pen.bg = p < 100 ? p - 40 : p - 100 + 8;
+                    pen.attr &= ~DefaultBg;
+                }
+                break;
+        }
+    }
+}
+
+void TerminalEmulator::print(uint16_t ch) {
+    if (lineDrawing[charset] && ch >= 0x60 && ch <= 0x7E) ch = decGraphics[ch - 0x60];
+    if (wrapPending && autoWrap) {
+        curX = 0;
+        lineFeed();
+    }
+    wrapPending = false;
+    Cell &c = screen[curY * width + curX];
+    c = pen;
+    c.ch = ch;
+    dirty[curY] = true;
+    lastChar = ch;
+    if (curX + 1 < width) curX++;
+    else wrapPending = true;
+}
+
+void TerminalEmulator::moveTo(int x, int y) {
+    int minY = originMode ? top : 0;
+    int maxY = originMode ? bottom : height - 1;
+    curX = std::max(0, std::min<int>(x, width - 1));
+    curY = std::max(minY, std::min(y + minY, maxY));
+    wrapPending = false;
+}
+
+void TerminalEmulator::lineFeed() {
+    wrapPending = false;
+    if (curY == bottom) {
+        // Only what leaves the whole primary screen is worth keeping
+        if (top == 0 && !altScreen && historySize > 0) {
+            std::copy(screen.begin(), screen.begin() + width, history.begin() + historyHead * width);
+            historyHead = (historyHead + 1) % historySize;
+            historyCount = std::min(historyCount + 1, historySize);
+        }
+        scrollUp(top, bottom, 1);
+    } else if (curY + 1 < height) {
+        curY++;
+    }
+}
+
+void TerminalEmulator::reverseLineFeed() {
+    wrapPending = false;
+    if (curY == top) scrollDown(top, bottom, 1);
+    else if (curY > 0) curY--;
+}
+
+void TerminalEmulator::scrollUp(uint16_t from, uint16_t to, int count) {
+    count = std::min(count, to - from + 1);
+    Cell *first = &screen[from * width];
+    std::move(first + count * width, &screen[(to + 1) * width], first);
+    std::fill(&screen[(to + 1 - count) * width], &screen[(to + 1) * width], blank());
+    touch(from, to);
+}
+
+void TerminalEmulator::scrollDown(uint16_t from, uint16_t to, int count) {
+    count = std::min(count, to - from + 1);
+    Cell *first = &screen[from * width];
+    std::move_backward(first, &screen[(to + 1 - count) * width], &screen[(to + 1) * width]);
+    std::fill(first, first + count * width, blank());
+    touch(from, to);
+}
+
+void TerminalEmulator::clear(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    std::fill(&screen[y0 * width + x0], &screen[y1 * width + x1] + 1, blank());
+    touch(y0, y1);
+}
+
+void TerminalEmulator::touch(uint16_t from, uint16_t to) {
+    for (uint16_t y = from; y <= to; y++) dirty[y] = true;
+}
+
+void TerminalEmulator::enterAltScreen(bool enable) {
+    if (enable == altScreen) return;
+    if (enable) {
+        mainScreen = screen;
+        std::fill(screen.begin(), screen.end(), blank());
+    } else {
+        screen = mainScreen;
+        mainScreen.clear();
+    }
+    altScreen = enable;
+    markAllDirty();
+}
+
+TerminalEmulator::Cell TerminalEmulator::blank() const {
+    // Erased cells take the current background, as on xterm
+    Cell c;
+    c.bg = pen.bg;
+    c.attr = (pen.attr & DefaultBg) | DefaultFg;
+    return c;
+}
+
+const TerminalEmulator::Cell *TerminalEmulator::scrollbackLine(size_t age) const {
+    if (age >= historyCount) return nullptr;
+    return &history[((historyHead + historySize - 1 - age) % historySize) * width];
+}
+
+void TerminalEmulator::clearDirty() { std::fill(dirty.begin(), dirty.end(), false); }
+
+void TerminalEmulator::markAllDirty() { std::fill(dirty.begin(), dirty.end(), true); }
+
+std::string TerminalEmulator::takeResponse() {
+    std::string out;
+    out.swap(response);
+    return out;
+}
+
+std::string TerminalEmulator::snapshot() const {
+    std::string out;
+    for (uint16_t y = 0; y < height; y++) {
+        std::string line;
+        for (uint16_t x = 0; x < width; x++) {
+            uint16_t ch = cell(x, y).ch;
+            if (ch < 0x80) {
+                line += (char)ch;
+            } else if (ch < 0x800) {
+                line += (char)(0xC0 | (ch >> 6));
+                line += (char)(0x80 | (ch & 0x3F));
+            } else {
+                line += (char)(0xE0 | (ch >> 12));
+                line += (char)(0x80 | ((ch >> 6) & 0x3F));
+                line += (char)(0x80 | (ch & 0x3F));
+            }
+        }
+        line.erase(line.find_last_not_of(' ') + 1);
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
@@ -0,0 +1,129 @@
+#ifndef __TERMINAL_EMULATOR_H__
+#define __TERMINAL_EMULATOR_H__
+
+// VT100/ANSI terminal state: escape sequence parser, character grid and scrollback. Plain C++ with
+// no Arduino dependency, so recorded sessions can be replayed on a host and compared by snapshot().
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TerminalEmulator {
+public:
+    enum Attr : uint8_t {
+        Bold = 1,
+        Underline = 2,
+        Reverse = 4,
+        DefaultFg = 8, // fg/bg hold no color, the view uses its own defaults
+        DefaultBg = 16,
+    };
+    struct Cell {
+        uint16_t ch = ' '; // code point, BMP only
+        uint8_t fg = 7;    // xterm 256 color palette
+        uint8_t bg = 0;
+        uint8_t attr = DefaultFg | DefaultBg;
+        bool operator==(const Cell &o) const {
+            return ch == o.ch && fg == o.fg && bg == o.bg && attr == o.attr;
+        }
+        bool operator!=(const Cell &o) const { return !(*this == o); }
+    };
+
+    TerminalEmulator(uint16_t cols, uint16_t rows, uint16_t scrollback = 200);
+
+    void write(const uint8_t *data, size_t length);
+    void write(const char *text);
+    void reset();
+
+    uint16_t cols() const { return width; }
+    uint16_t rows() const { return height; }
+    uint16_t cursorX() const { return curX; }
+    uint16_t cursorY() const { return curY; }
+    bool cursorVisible() const { return showCursor; }
+    const Cell &cell(uint16_t x, uint16_t y) const { return screen[y * width + x]; }
+
+    // Lines that scrolled off the top, age 0 is the most recent one
+    size_t scrollbackLines() const { return historyCount; }
+    const Cell *scrollbackLine(size_t age) const;
+
+    // Rows changed since clearDirty(), so a view only compares what may differ
+    bool rowDirty(uint16_t y) const { return dirty[y]; }
+    void clearDirty();
+    void markAllDirty();
+
+    // Replies the host asked for (cursor position, device attributes), to be sent back to it
+    std::string takeResponse();
+
+    // Screen rows as UTF-8, trailing blanks trimmed, one line each
+    std::string snapshot() const;
+
+private:
+    enum class State : uint8_t {
+        Ground,
+        Escape,
+        Charset, // ESC ( or ESC ), next byte picks the set
+        Csi,
+        Osc,     // ignored up to BEL or ESC backslash
+        OscEscape,
+    };
+
+    uint16_t width;
+    uint16_t height;
+    std::vector<Cell> screen;
+    std::vector<Cell> mainScreen; // kept while the alternate screen is shown
+    std::vector<bool> dirty;
+
+    std::vector<Cell> history; // ring of scrollback rows
+    size_t historySize;
+    size_t historyHead = 0; // next row to overwrite
+    size_t historyCount = 0;
+
+    uint16_t curX = 0;
+    uint16_t curY = 0;
+    bool wrapPending = false; // last column was written, wrap on the next character
+    bool showCursor = true;
+    bool autoWrap = true;
+    bool originMode = false;
+    bool altScreen = false;
+    uint16_t top = 0; // scrolling region, inclusive
+    uint16_t bottom;
+    Cell pen;                     // attributes for new characters
+    bool lineDrawing[2] = {false}; // G0/G1 use the DEC special graphics set
+    uint8_t charset = 0;           // shifted in set
+
+    struct Saved {
+        uint16_t x = 0, y = 0;
+        Cell pen;
+        bool originMode = false;
+    } saved;
+
+    State state = State::Ground;
+    uint8_t charsetSlot = 0;
+    static const int MAX_PARAMS = 16;
+    int params[MAX_PARAMS];
+    int paramCount = 0;
+    char privateMarker = 0;
+    uint32_t utf8 = 0;
+    int utf8Remaining = 0;
+    uint16_t lastChar = ' ';
+    std::string response;
+
+    void print(uint16_t ch);
+    void control(uint8_t c);
+    void escape(uint8_t c);
+    void csi(uint8_t final);
+    void sgr();
+    void setMode(bool enable);
+
+    int param(int index, int fallback) const;
+    void moveTo(int x, int y);
+    void lineFeed();
+    void reverseLineFeed();
+    void scrollUp(uint16_t from, uint16_t to, int count);
+    void scrollDown(uint16_t from, uint16_t to, int count);
+    void clear(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1); // inclusive, row major
+    void touch(uint16_t from, uint16_t to);
+    void enterAltScreen(bool enable);
+    Cell blank() const;
+};
+
+#endif
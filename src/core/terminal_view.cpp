@@ -0,0 +1,241 @@
+#include "terminal_view.h"
+#include "core/display.h"
+#include "core/mykeyboard.h"
+#include <globals.h>
+
+#define TERMINAL_SCROLLBACK 200
+#define TERMINAL_KEY_DEBOUNCE 200
+
+// xterm colors 0..15
+static const uint8_t basePalette[16][3] = {
+    {0,   0,   0  },
+    {205, 0,   0  },
+    {0,   205, 0  },
+    {205, 205, 0  },
+    {0,   0,   238},
+    {205, 0,   205},
+    {0,   205, 205},
+    {229, 229, 229},
+    {127, 127, 127},
+    {255, 0,   0  },
+    {0,   255, 0  },
+    {255, 255, 0  },
+    {92,  92,  255},
+    {255, 0,   255},
+    {0,   255, 255},
+    {255, 255, 255},
+};
+
+TerminalView::TerminalView(TerminalEmulator &term) : term(term) {}
+
+uint16_t TerminalView::fitColumns() { return tftWidth / LW; }
+
+uint16_t TerminalView::fitRows() { return tftHeight / LH; }
+
+uint16_t TerminalView::color(uint8_t index, bool bold) const {
+    uint8_t r, g, b;
+    if (bold && index < 8) index += 8;
+    if (index < 16) {
+        r = basePalette[index][0];
+        g = basePalette[index][1];
+        b = basePalette[index][2];
+    } else if (index < 232) {
+        // 6x6x6 cube
+        static const uint8_t levels[6] = {0, 95, 135, 175, 215, 255};
+        index -= 16;
+        r = levels[index / 36];
+        g = levels[(index / 6) % 6];
+        b = levels[index % 6];
+    } else {
+        r = g = b = 8 + (index - 232) * 10;
+    }
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// The built in font is ASCII, line drawing falls back to the usual characters
+char TerminalView::glyph(uint16_t ch) {
+    if (ch >= 0x20 && ch < 0x7F) return ch;
+    if (ch == 0x2500 || ch == 0x2501 || ch == 0x2550 || (ch >= 0x23BA && ch <= 0x23BD)) return '-';
+    if (ch == 0x2502 || ch == 0x2503 || ch == 0x2551) return '|';
+    if (ch >= 0x250C && ch <= 0x256C) return '+';
+    if (ch >= 0x2580 && ch <= 0x259F) return '#';
+    if (ch == 0x25C6) return '*';
+    if (ch == 0x00B7) return '.';
+    if (ch == 0x00B0) return 'o';
+    return ch < 0x20 ? ' ' : '?';
+}
+
+void TerminalView::scroll(int lines) {
+    int next = constrain(offset + lines, 0, (int)term.scrollbackLines());
+    if (next == offset) return;
+    offset = next;
+    term.markAllDirty(); // the shown rows all moved
+    draw();
+}
+
+void TerminalView::draw(bool force) {
+    uint16_t cols = term.cols();
+    uint16_t rows = term.rows();
+    if (shown.size() != (size_t)cols * rows) {
+        shown.assign(cols * rows, TerminalEmulator::Cell());
+        force = true;
+    }
+    offset = min<int>(offset, term.scrollbackLines());
+
+    tft.setTextSize(FP);
+    String run;
+    for (uint16_t y = 0; y < rows; y++) {
+        // Following the output only dirty rows can differ, scrolled back everything moves
+        bool cursorRow = offset == 0 && term.cursorVisible() && term.cursorY() == y;
+        if (!force && offset == 0 && !term.rowDirty(y) && !cursorRow && y != cursorShownY) continue;
+        const TerminalEmulator::Cell *line =
+            y < offset ? term.scrollbackLine(offset - 1 - y) : &term.cell(0, y - offset);
+
+        uint16_t x = 0;
+        while (x < cols) {
+            TerminalEmulator::Cell c = line[x];
+            if (cursorRow && x == term.cursorX()) c.attr ^= TerminalEmulator::Reverse;
+            if (!force && c == shown[y * cols + x]) {
+                x++;
+                continue;
+            }
+
+            // Changed cells with the same look go out in one string
+            uint16_t start = x;
+            run = "";
+            TerminalEmulator::Cell first = c;
+            while (x < cols) {
+                TerminalEmulator::Cell n = line[x];
+                if (cursorRow && x == term.cursorX()) n.attr ^= TerminalEmulator::Reverse;
+                if ((!force && n == shown[y * cols + x]) || n.fg != first.fg || n.bg != first.bg ||
+                    n.attr != first.attr)
+                    break;
+                run += glyph(n.ch);
+                shown[y * cols + x] = n;
+                x++;
+            }
+
+            bool bold = first.attr & TerminalEmulator::Bold;
+            uint16_t fg = first.attr & TerminalEmulator::DefaultFg ? TFT_WHITE : color(first.fg, bold);
+            uint16_t bg =
+                first.attr & TerminalEmulator::DefaultBg ? bruceConfig.bgColor : color(first.bg, false);
+            if (first.attr & TerminalEmulator::Reverse) std::swap(fg, bg);
+            tft.setTextColor(fg, bg);
+            tft.drawString(run, start * LW, y * LH, 1);
+            if (first.attr & TerminalEmulator::Underline) {
+                tft.drawFastHLine(start * LW, y * LH + LH - 1, (x - start) * LW, fg);
+            }
+        }
+    }
+    term.clearDirty();
+    // Where the cursor was drawn, to be cleared wherever it goes
+    cursorShownY = offset == 0 && term.cursorVisible() ? term.cursorY() : -1;
+}
+
+TerminalSession::TerminalSession()
+    : term(TerminalView::fitColumns(), TerminalView::fitRows(), TERMINAL_SCROLLBACK), view(term) {}
+
+void TerminalSession::sendText(const char *text, size_t length) {
+    if (length == 0) return;
+    send((const uint8_t *)text, length);
+    if (localEcho) {
+        for (size_t i = 0; i < length; i++) {
+            // Echo the line ending as a new line
+            if (text[i] == '\r' || text[i] == '\n') term.write("\r\n");
+            else if (text[i] == 0x7F) term.write("\b \b");
+            else term.write((const uint8_t *)&text[i], 1);
+        }
+    }
+}
+
+// Returns false when the user wants to leave
+bool TerminalSession::handleKeys() {
+#ifdef HAS_KEYBOARD
+    keyStroke key = _getKeyPress();
+    if (!key.pressed || millis() - lastKeyMillis < TERMINAL_KEY_DEBOUNCE) return true;
+    lastKeyMillis = millis();
+
+    if (scrolling) {
+        // Arrows move through the scrollback, any other key goes back to the output
+        for (uint8_t k : key.word) {
+            if (k == 0xDA) view.scroll(1);
+            else if (k == 0xD9) view.scroll(-1);
+            else scrolling = false;
+        }
+        if (key.enter || key.del) scrolling = false;
+        if (!scrolling) view.scroll(-view.scrolledBack());
+        return true;
+    }
+
+    // A modifier on its own opens the local menu, there is no spare key for it
+    if ((key.ctrl || key.alt || key.gui) && key.word.empty() && !key.enter && !key.del) {
+        bool leave = false;
+        std::vector<Option> options = {
+            {"Resume",      [&]() {}                 },
+            {"Scroll back", [&]() { scrolling = true; }},
+            {"Leave",       [&]() { leave = true; }   },
+        };
+        loopOptions(options);
+        view.draw(true);
+        if (scrolling) view.scroll(term.rows() / 2);
+        return !leave;
+    }
+
+    String out;
+    for (uint8_t k : key.word) {
+        // HID codes of the special keys to VT100 sequences
+        if (k == 0xDA) out += "\x1b[A";
+        else if (k == 0xD9) out += "\x1b[B";
+        else if (k == 0xD7) out += "\x1b[C";
+        else if (k == 0xD8) out += "\x1b[D";
+        else if (k == 0xB1) out += "\x1b";
+        else if (k == 0xB3) out += "\t";
+        else if (k == 0xD4) out += "\x1b[3~";
+        else if (key.ctrl && isalpha(k)) out += (char)(toupper(k) & 0x1F);
+        else if (k < 0x80) out += (char)k;
+    }
+    if (key.del) out += (char)0x7F;
+    if (key.enter) out += enter;
+    sendText(out.c_str(), out.length());
+    view.scroll(-view.scrolledBack());
+#else
+    if (check(EscPress)) return false;
+    if (check(PrevPress)) view.scroll(term.rows() / 2);
+    if (check(NextPress)) view.scroll(-(int)term.rows() / 2);
+    if (check(SelPress)) {
+        String line = keyboard("", 76, "Send:");
+        if (line != "\x1B") {
+            line += enter;
+            sendText(line.c_str(), line.length());
+        }
+        view.scroll(-view.scrolledBack());
+        view.draw(true);
+    }
+#endif
+    return true;
+}
+
+bool TerminalSession::run() {
+    uint8_t buffer[512];
+    tft.fillScreen(bruceConfig.bgColor);
+#ifdef HAS_KEYBOARD
+    term.write("\x1b[90m[Ctrl or Alt alone: menu]\x1b[0m\r\n");
+#else
+    term.write("\x1b[90m[Sel: type, Prev/Next: scroll, Esc: leave]\x1b[0m\r\n");
+#endif
+    view.draw(true);
+
+    while (true) {
+        int n = receive(buffer, sizeof(buffer));
+        if (n < 0) return false;
+        if (n > 0) {
+            term.write(buffer, n);
+            std::string reply = term.takeResponse();
+            if (!reply.empty()) send((const uint8_t *)reply.data(), reply.size());
+        }
+        if (!handleKeys()) return true;
+        // Scrolled back the picture stays put until the user returns
+        if (view.scrolledBack() == 0) view.draw();
+        if (n <= 0) vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef __TERMINAL_VIEW_H__
+#define __TERMINAL_VIEW_H__
+
+#include "terminal_emulator.h"
+#include <Arduino.h>
+#include <functional>
+
+// Draws a TerminalEmulator on the TFT with the small font. A copy of what is on the glass is kept,
+// so only cells that changed are drawn, in runs of the same colors.
+class TerminalView {
+public:
+    explicit TerminalView(TerminalEmulator &term);
+
+    // Grid that fits the whole screen
+    static uint16_t fitColumns();
+    static uint16_t fitRows();
+
+    // force redraws everything, e.g. after a dialog was drawn over the terminal
+    void draw(bool force = false);
+    // Lines of scrollback shown above the screen, 0 follows the output
+    void scroll(int lines);
+    int scrolledBack() const { return offset; }
+
+private:
+    TerminalEmulator &term;
+    std::vector<TerminalEmulator::Cell> shown;
+    int offset = 0;
+    int cursorShownY = -1;
+
+    uint16_t color(uint8_t index, bool bold) const;
+    static char glyph(uint16_t ch);
+};
+
+// Interactive session over any byte stream, used by the SSH, Telnet and TCP clients.
+// Keyboard devices send every key as typed, the others type a line at a time with Sel,
+// scroll back with Prev/Next and leave with Esc.
+class TerminalSession {
+public:
+    // Bytes from the remote side without blocking: 0 when there is nothing, < 0 once closed
+    std::function<int(uint8_t *buffer, size_t size)> receive;
+    std::function<void(const uint8_t *data, size_t length)> send;
+    bool localEcho = false;    // the remote side does not echo what is typed
+    const char *enter = "\r"; // what the enter key sends
+
+    TerminalSession();
+    // Runs until the connection closes or the user leaves, true if the user left
+    bool run();
+
+    TerminalEmulator term;
+    TerminalView view;
+
+private:
+    bool scrolling = false; // keys move through the scrollback
+    unsigned long lastKeyMillis = 0;
+
+    void sendText(const char *text, size_t length);
+    bool handleKeys();
+};
+
+#endif
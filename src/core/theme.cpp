@@ -1,6 +1,7 @@
 #include "theme.h"
 #include "core/led_control.h"
 #include "display.h"
+#include "theme_cache.h"
 
 struct ThemeEntry {
     const char *key;
@@ -11,13 +12,14 @@ struct ThemeEntry {
 void BruceTheme::removeTheme(void) {
     themeInfo t;
     theme = t;
+    themeAssets.clear();
 }
 FS *BruceTheme::themeFS(void) {
     if (theme.fs == 1) return &LittleFS;
     else if (theme.fs == 2) return &SD;
     return &LittleFS; // always get back to safety
 }
-bool BruceTheme::openThemeFile(FS *fs, String filepath, bool overwriteConfigSettings) {
+bool BruceTheme::openThemeFile(FS *fs, String filepath, bool overwriteConfigSettings, bool prepareAssets) {
 
     if (fs == nullptr) return true;
     if (!fs->exists(filepath)) return false;
@@ -38,6 +40,7 @@ bool BruceTheme::openThemeFile(FS *fs, String filepath, bool overwriteConfigSett
         return false;
     }
     themePath = filepath;
+    themeAssets.clear(); // images of the previous theme
     String baseThemePath = themePath.substring(0, themePath.lastIndexOf('/')) + "/";
 
     ThemeEntry entries[] = {
@@ -69,7 +72,9 @@ bool BruceTheme::openThemeFile(FS *fs, String filepath, bool overwriteConfigSett
                 *entry.flag = true;
                 entry.path = _th[entry.key].as<String>();
                 // Pre-cache PNGs into BIN files to avoid runtime decoding and allocations
-                if (path.endsWith(".png") || path.endsWith(".PNG")) { preparePngBin(*fs, path); }
+                if (prepareAssets && (path.endsWith(".png") || path.endsWith(".PNG"))) {
+                    preparePngBin(*fs, path);
+                }
             } else {
                 log_w("THEME: file not found: %s", entry.key);
             }
@@ -68,7 +68,8 @@ public:
     // UI Color
     void _setUiColor(uint16_t primary, uint16_t *secondary = nullptr, uint16_t *background = nullptr);
 
-    bool openThemeFile(FS *fs, String filepath, bool overwriteConfigSettings);
+    // prepareAssets pre-decodes PNG images, when false they are decoded on first draw
+    bool openThemeFile(FS *fs, String filepath, bool overwriteConfigSettings, bool prepareAssets = true);
     bool validateImgFile(FS *fs, String filepath);
     String getThemeItemImg(String item) {
         return themePath.substring(0, themePath.lastIndexOf('/')) + "/" + item;
@@ -0,0 +1,82 @@
+#include "theme_cache.h"
+#include "display.h"
+#include <globals.h>
+
+ThemeAssetCache themeAssets;
+
+static size_t cacheBudget() { return psramFound() ? THEME_CACHE_BUDGET : 0; }
+
+bool ThemeAssetCache::draw(FS &fs, const String &path, int x, int y, bool center) {
+    if (cacheBudget() == 0) return drawImg(fs, path, x, y, center);
+
+    Entry *e = nullptr;
+    for (Entry &entry : entries) {
+        if (entry.path == path) e = &entry;
+    }
+    if (e && e->pixels && e->bgColor != bruceConfig.bgColor) {
+        // Decoded over another background
+        used -= size(*e);
+        free(e->pixels);
+        e->pixels = nullptr;
+        entries.erase(entries.begin() + (e - entries.data()));
+        e = nullptr;
+    }
+    if (!e) e = load(fs, path);
+    if (!e || !e->pixels) return drawImg(fs, path, x, y, center);
+    e->lastUse = ++useCounter;
+
+    // Same placement as the decoders, and logged so the remote screen shows it too
+    tft.imageToBin(&fs == &SD ? 0 : 2, path, x, y, center, 0);
+    if (center) {
+        x = x + (tftWidth - e->w) / 2;
+        y = y + (tftHeight - e->h) / 2;
+    }
+    bool swapBytes = tft.getSwapBytes();
+    tft.setSwapBytes(true);
+    tft.pushImage(x, y, e->w, e->h, e->pixels);
+    tft.setSwapBytes(swapBytes);
+    return true;
+}
+
+ThemeAssetCache::Entry *ThemeAssetCache::load(FS &fs, const String &path) {
+    Entry e = {path, nullptr, 0, 0, bruceConfig.bgColor, 0};
+    uint32_t start = millis();
+    e.pixels = decodeImg(fs, path, e.w, e.h);
+    if (e.pixels && size(e) > cacheBudget() / 2) {
+        // Would push everything else out
+        free(e.pixels);
+        e.pixels = nullptr;
+    }
+    if (e.pixels) {
+        makeRoom(size(e));
+        used += size(e);
+        log_i("THEME: cached %s (%dx%d) in %lu ms", path.c_str(), e.w, e.h, millis() - start);
+    }
+    // Images that are not kept are remembered too, so they are not decoded again on every draw
+    entries.push_back(e);
+    return &entries.back();
+}
+
+void ThemeAssetCache::makeRoom(size_t bytes) {
+    while (used + bytes > cacheBudget()) {
+        Entry *oldest = nullptr;
+        for (Entry &entry : entries) {
+            if (entry.pixels && (!oldest || entry.lastUse < oldest->lastUse)) oldest = &entry;
+        }
+        if (!oldest) return;
+        used -= size(*oldest);
+        free(oldest->pixels);
+        entries.erase(entries.begin() + (oldest - entries.data()));
+    }
+}
+
+void ThemeAssetCache::clear() {
+    for (Entry &entry : entries) free(entry.pixels);
+    entries.clear();
+    entries.shrink_to_fit();
+    used = 0;
+}
+
+bool drawThemeImg(const String &item, int x, int y, bool center) {
+    return themeAssets.draw(*bruceConfig.themeFS(), bruceConfig.getThemeItemImg(item), x, y, center);
+}
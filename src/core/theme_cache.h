@@ -0,0 +1,42 @@
+#ifndef __THEME_CACHE_H__
+#define __THEME_CACHE_H__
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+
+// Theme images decoded once into RGB565, so drawing a menu icon is a single pushImage instead of
+// reading and decoding a file. Entries are dropped least recently used first when over the budget.
+// Only boards with PSRAM keep pixels, the others still draw from the file (PNGs from their BIN).
+#define THEME_CACHE_BUDGET (1024 * 1024)
+
+class ThemeAssetCache {
+public:
+    bool draw(FS &fs, const String &path, int x, int y, bool center);
+    // Frees every image, for when the theme changes
+    void clear();
+    size_t bytes() const { return used; }
+
+private:
+    struct Entry {
+        String path;
+        uint16_t *pixels; // nullptr when it can't be cached (GIF, too big), drawn from the file
+        uint16_t w;
+        uint16_t h;
+        uint16_t bgColor; // transparent PNG pixels were blended with it
+        uint32_t lastUse;
+    };
+    std::vector<Entry> entries;
+    size_t used = 0;
+    uint32_t useCounter = 0;
+
+    Entry *load(FS &fs, const String &path);
+    void makeRoom(size_t bytes);
+    static size_t size(const Entry &e) { return (size_t)e.w * e.h * sizeof(uint16_t); }
+};
+
+extern ThemeAssetCache themeAssets;
+
+// Draws an image of the active theme, item is one of bruceConfig.theme.paths
+bool drawThemeImg(const String &item, int x, int y, bool center);
+
+#endif
@@ -1,6 +1,7 @@
 #include "webInterface.h"
 #include "core/display.h"    // using displayRedStripe as error msg
 #include "core/mykeyboard.h" // using keyboard when calling rename
+#include "core/net_utils.h"
 #include "core/passwords.h"
 #include "core/sd_functions.h" // using sd functions called to rename and manage sd files
 #include "core/serialcmds.h"
@@ -8,6 +9,7 @@
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h" // using common wifisetup
 #include "esp_task_wdt.h"
+#include "modules/wifi/sniffer_stats.h"
 #include "webFiles.h"
 #include <MD5Builder.h>
 #include <esp_heap_caps.h>
@@ -472,6 +474,44 @@ void configureWebServer() {
         }
     });
 
+    // Sniffer statistics, top N networks or clients of every session
+    server->on("/snifferstats", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (checkUserWebAuth(request)) {
+            SnifferStatsKind kind = request->arg("kind") == "client" ? SnifferStatsKind::Client
+                                                                     : SnifferStatsKind::AP;
+            String sort = request->arg("sort");
+            SnifferStatsSort order = sort == "rssi"   ? SnifferStatsSort::Rssi
+                                     : sort == "seen" ? SnifferStatsSort::LastSeen
+                                                      : SnifferStatsSort::Frames;
+            int top = request->hasArg("top") ? constrain(request->arg("top").toInt(), 1, 200) : 20;
+            MOUNT_SD_CARD;
+            std::vector<SnifferStatsRecord> rows = snifferStats.top(*sniffer_stats_fs(), kind, order, top);
+            UNMOUNT_SD_CARD;
+
+            JsonDocument doc;
+            JsonArray list = doc.to<JsonArray>();
+            for (const SnifferStatsRecord &r : rows) {
+                JsonObject row = list.add<JsonObject>();
+                row["mac"] = macToString(r.mac);
+                row["bssid"] = macToString(r.bssid);
+                row["ssid"] = r.ssid;
+                row["frames"] = r.frames;
+                row["rssiMin"] = r.frames ? r.rssiMin : 0;
+                row["rssiAvg"] = r.rssiAvg();
+                row["rssiMax"] = r.frames ? r.rssiMax : 0;
+                row["eapol"] = r.eapol;
+                row["eapolFrames"] = r.eapolFrames;
+                row["channels"] = sniffer_stats_channels(r.channels);
+                row["sessions"] = r.sessions;
+                row["firstSeen"] = r.firstSeen;
+                row["lastSeen"] = r.lastSeen;
+            }
+            String body;
+            serializeJson(doc, body);
+            request->send(200, "application/json", body);
+        }
+    });
+
     // Get Screen
     server->on("/getscreen", HTTP_GET, [](AsyncWebServerRequest *request) {
         if (checkUserWebAuth(request)) {
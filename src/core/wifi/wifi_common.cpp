@@ -1,5 +1,6 @@
 #include "core/wifi/wifi_common.h"
 #include "core/display.h"    // using displayRedStripe  and loop options
+#include "core/list_view.h"
 #include "core/mykeyboard.h" // usinf keyboard when calling rename
 #include "core/powerSave.h"
 #include "core/settings.h"
@@ -121,6 +122,34 @@ void wifiDisconnect() {
     returnToMenu = true;
 }
 
+// Networks of the last scan followed by "Hidden SSID" and "Main Menu"
+class WifiScanSource : public ListSource {
+public:
+    explicit WifiScanSource(int nets) : nets(nets) {}
+    size_t size() override { return nets + 2; }
+    String label(size_t index) override {
+        if (index == nets) return "Hidden SSID";
+        if (index > nets) return "Main Menu";
+        const char *encryption;
+        switch (WiFi.encryptionType(index)) {
+            case WIFI_AUTH_OPEN: encryption = "Open"; break;
+            case WIFI_AUTH_WEP: encryption = "WEP"; break;
+            case WIFI_AUTH_WPA_PSK: encryption = "WPA/PSK"; break;
+            case WIFI_AUTH_WPA2_PSK: encryption = "WPA2/PSK"; break;
+            case WIFI_AUTH_WPA_WPA2_PSK: encryption = "WPA/WPA2/PSK"; break;
+            case WIFI_AUTH_WPA2_ENTERPRISE: encryption = "WPA2/Enterprise"; break;
+            default: encryption = "Unknown"; break;
+        }
+        // Secured networks start with #
+        String prefix = WiFi.encryptionType(index) == WIFI_AUTH_OPEN ? "" : "#";
+        return prefix + WiFi.SSID(index) + "(" + String(WiFi.RSSI(index)) + "|" + encryption + "|ch." +
+               String(WiFi.channel(index)) + ")";
+    }
+
+private:
+    size_t nets;
+};
+
 bool wifiConnectMenu(wifi_mode_t mode) {
     if (WiFi.isConnected()) return false; // safeguard
 
@@ -141,42 +170,19 @@ bool wifiConnectMenu(wifi_mode_t mode) {
             do {
                 displayTextLine("Scanning..");
                 nets = WiFi.scanNetworks();
-                options = {};
-                for (int i = 0; i < nets; i++) {
-                    if (options.size() < 250) {
-                        String ssid = WiFi.SSID(i);
-                        int encryptionType = WiFi.encryptionType(i);
-                        int32_t rssi = WiFi.RSSI(i);
-                        int32_t ch = WiFi.channel(i);
-                        // Check if the network is secured
-                        String encryptionPrefix = (encryptionType == WIFI_AUTH_OPEN) ? "" : "#";
-                        String encryptionTypeStr;
-                        switch (encryptionType) {
-                            case WIFI_AUTH_OPEN: encryptionTypeStr = "Open"; break;
-                            case WIFI_AUTH_WEP: encryptionTypeStr = "WEP"; break;
-                            case WIFI_AUTH_WPA_PSK: encryptionTypeStr = "WPA/PSK"; break;
-                            case WIFI_AUTH_WPA2_PSK: encryptionTypeStr = "WPA2/PSK"; break;
-                            case WIFI_AUTH_WPA_WPA2_PSK: encryptionTypeStr = "WPA/WPA2/PSK"; break;
-                            case WIFI_AUTH_WPA2_ENTERPRISE: encryptionTypeStr = "WPA2/Enterprise"; break;
-                            default: encryptionTypeStr = "Unknown"; break;
-                        }
-
-                        String optionText = encryptionPrefix + ssid + "(" + String(rssi) + "|" +
-                                            encryptionTypeStr + "|ch." + String(ch) + ")";
-
-                        options.push_back({optionText.c_str(), [=]() {
-                                               _wifiConnect(ssid, encryptionType);
-                                           }});
-                    }
+                if (nets < 0) nets = 0; // the scan failed
+                returnToMenu = false;
+                // Labels come from the scan results as they are drawn, so every network is listed
+                WifiScanSource networks(nets);
+                int chosen = loopList(networks);
+                if (chosen >= 0 && chosen < nets) {
+                    _wifiConnect(WiFi.SSID(chosen), WiFi.encryptionType(chosen));
+                } else if (chosen == nets) {
+                    String __ssid = keyboard("", 32, "Your SSID");
+                    _wifiConnect(__ssid.c_str(), 8);
+                } else if (chosen == nets + 1) {
+                    backToMenu();
                 }
-                options.push_back({"Hidden SSID", [=]() {
-                                       String __ssid = keyboard("", 32, "Your SSID");
-                                       _wifiConnect(__ssid.c_str(), 8);
-                                   }});
-                addOptionToMainMenu();
-
-                loopOptions(options);
-                options.clear();
 
                 if (check(EscPress)) {
                     refresh_scan = true;
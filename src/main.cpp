@@ -133,12 +133,14 @@ volatile int tftWidth = VECTOR_DISPLAY_DEFAULT_HEIGHT;
 volatile int tftHeight = VECTOR_DISPLAY_DEFAULT_WIDTH;
 #endif
 
+#include "core/boot_sequence.h"
 #include "core/display.h"
 #include "core/led_control.h"
 #include "core/mykeyboard.h"
 #include "core/sd_functions.h"
 #include "core/serialcmds.h"
 #include "core/settings.h"
+#include "core/spi_bus.h"
 #include "core/wifi/webInterface.h"
 #include "core/wifi/wifi_common.h"
 #include "modules/bjs_interpreter/interpreter.h" // for JavaScript interpreter
@@ -372,47 +374,10 @@ void startup_sound() {
 }
 
 /*********************************************************************
- **  Function: setup
- **  Where the devices are started and variables set
+ **  Function: init_wifi_country
+ **  Set WiFi country to avoid warnings and ensure max power
  *********************************************************************/
-void setup() {
-    Serial.setRxBufferSize(
-        SAFE_STACK_BUFFER_SIZE / 4
-    ); // Must be invoked before Serial.begin(). Default is 256 chars
-    Serial.begin(115200);
-
-    log_d("Total heap: %d", ESP.getHeapSize());
-    log_d("Free heap: %d", ESP.getFreeHeap());
-    if (psramInit()) log_d("PSRAM Started");
-    if (psramFound()) log_d("PSRAM Found");
-    else log_d("PSRAM Not Found");
-    log_d("Total PSRAM: %d", ESP.getPsramSize());
-    log_d("Free PSRAM: %d", ESP.getFreePsram());
-
-    // declare variables
-    prog_handler = 0;
-    sdcardMounted = false;
-    wifiConnected = false;
-    BLEConnected = false;
-    bruceConfig.bright = 100; // theres is no value yet
-    bruceConfigPins.rotation = ROTATION;
-    setup_gpio();
-#if defined(HAS_SCREEN)
-    tft.init();
-    tft.setRotation(bruceConfigPins.rotation);
-    tft.fillScreen(TFT_BLACK);
-    // bruceConfig is not read yet.. just to show something on screen due to long boot time
-    tft.setTextColor(TFT_PURPLE, TFT_BLACK);
-    tft.drawCentreString("Booting", tft.width() / 2, tft.height() / 2, 1);
-#else
-    tft.begin();
-#endif
-    begin_storage();
-    begin_tft();
-    init_clock();
-    init_led();
-
-    // Set WiFi country to avoid warnings and ensure max power
+void init_wifi_country() {
     wifi_country_t country = {
         .cc = "US",
         .schan = 1,
@@ -423,13 +388,13 @@ void setup() {
 
     esp_wifi_set_max_tx_power(80); // 80 translates to 20dBm
     esp_wifi_set_country(&country);
+}
 
-    // Some GPIO Settings (such as CYD's brightness control must be set after tft and sdcard)
-    _post_setup_gpio();
-    // end of post gpio begin
-
-    // #ifndef USE_TFT_eSPI_TOUCH
-    // This task keeps running all the time, will never stop
+/*********************************************************************
+ **  Function: start_input_handler
+ **  This task keeps running all the time, will never stop
+ *********************************************************************/
+void start_input_handler() {
     xTaskCreate(
         taskInputHandler,              // Task function
         "InputHandler",                // Task Name
@@ -438,13 +403,36 @@ void setup() {
         2,                             // Task priority (0 to 3), loopTask has priority 2.
         &xHandle                       // Task handle (not used)
     );
-    // #endif
+}
+
+/*********************************************************************
+ **  Function: load_theme
+ **  Theme images are decoded on first use, not at boot
+ *********************************************************************/
+void load_theme() {
+#if defined(HAS_SCREEN)
+    bruceConfig.openThemeFile(bruceConfig.themeFS(), bruceConfig.themePath, false, false);
+#endif
+}
+
+/*********************************************************************
+ **  Function: boot_splash
+ **  Boot animation and sound, skipped with instantBoot
+ *********************************************************************/
+void boot_splash() {
 #if defined(HAS_SCREEN)
-    bruceConfig.openThemeFile(bruceConfig.themeFS(), bruceConfig.themePath, false);
     if (!bruceConfig.instantBoot) {
         boot_screen_anim();
         startup_sound();
     }
+#endif
+}
+
+/*********************************************************************
+ **  Function: start_wifi_at_startup
+ *********************************************************************/
+void start_wifi_at_startup() {
+#if defined(HAS_SCREEN)
     if (bruceConfig.wifiAtStartup) {
         log_i("Loading Wifi at Startup");
         xTaskCreate(
@@ -457,10 +445,85 @@ void setup() {
         );
     }
 #endif
+}
+
+// Boot stages, dependencies must point to earlier entries.
+// Storage, TFT and SD usually share the SPI bus, so everything touching them stays inline.
+// RTC (I2C), WiFi country and LEDs (RMT) have their own peripherals and run on core 0. The RTC waits
+// for the TFT and storage, on M5 boards they drive the PMU on the same I2C bus.
+enum BootStageId {
+    BOOT_STORAGE,
+    BOOT_WIFI_COUNTRY,
+    BOOT_TFT,
+    BOOT_CLOCK,
+    BOOT_LED,
+    BOOT_POST_GPIO,
+    BOOT_INPUT,
+    BOOT_THEME,
+    BOOT_SPLASH,
+    BOOT_WIFI,
+};
+static const uint32_t afterStorage = BOOT_STAGE_BIT(BOOT_STORAGE);
+static const uint32_t afterStorageTft = BOOT_STAGE_BIT(BOOT_STORAGE) | BOOT_STAGE_BIT(BOOT_TFT);
+static const uint32_t afterTftClock = BOOT_STAGE_BIT(BOOT_TFT) | BOOT_STAGE_BIT(BOOT_CLOCK);
+static const uint32_t afterThemeInput = BOOT_STAGE_BIT(BOOT_THEME) | BOOT_STAGE_BIT(BOOT_INPUT);
+BootStage bootStages[] = {
+    {"storage",      begin_storage,         0,                                  BOOT_STAGE_INLINE},
+    {"wifi_country", init_wifi_country,     0,                                  0                },
+    {"tft",          begin_tft,             afterStorage,                       BOOT_STAGE_INLINE},
+    {"clock",        init_clock,            afterStorageTft,                    0                },
+    {"led",          init_led,              afterStorage,                       0                },
+    // Some GPIO Settings (such as CYD's brightness control must be set after tft and sdcard)
+    {"post_gpio",    _post_setup_gpio,      afterTftClock,                      BOOT_STAGE_INLINE},
+    {"input",        start_input_handler,   BOOT_STAGE_BIT(BOOT_POST_GPIO),     BOOT_STAGE_INLINE},
+    {"theme",        load_theme,            BOOT_STAGE_BIT(BOOT_TFT),           BOOT_STAGE_INLINE},
+    {"splash",       boot_splash,           afterThemeInput,                    BOOT_STAGE_INLINE},
+    {"wifi",         start_wifi_at_startup, BOOT_STAGE_BIT(BOOT_WIFI_COUNTRY),  BOOT_STAGE_INLINE},
+};
+
+/*********************************************************************
+ **  Function: setup
+ **  Where the devices are started and variables set
+ *********************************************************************/
+void setup() {
+    Serial.setRxBufferSize(
+        SAFE_STACK_BUFFER_SIZE / 4
+    ); // Must be invoked before Serial.begin(). Default is 256 chars
+    Serial.begin(115200);
+
+    log_d("Total heap: %d", ESP.getHeapSize());
+    log_d("Free heap: %d", ESP.getFreeHeap());
+    if (psramInit()) log_d("PSRAM Started");
+    if (psramFound()) log_d("PSRAM Found");
+    else log_d("PSRAM Not Found");
+    log_d("Total PSRAM: %d", ESP.getPsramSize());
+    log_d("Free PSRAM: %d", ESP.getFreePsram());
+
+    // declare variables
+    prog_handler = 0;
+    sdcardMounted = false;
+    wifiConnected = false;
+    BLEConnected = false;
+    bruceConfig.bright = 100; // theres is no value yet
+    bruceConfigPins.rotation = ROTATION;
+    spiArbiter.begin(); // before anything talks on a bus
+    setup_gpio();
+#if defined(HAS_SCREEN)
+    tft.init();
+    tft.setRotation(bruceConfigPins.rotation);
+    tft.fillScreen(TFT_BLACK);
+    // bruceConfig is not read yet.. just to show something on screen due to long boot time
+    tft.setTextColor(TFT_PURPLE, TFT_BLACK);
+    tft.drawCentreString("Booting", tft.width() / 2, tft.height() / 2, 1);
+#else
+    tft.begin();
+#endif
+    runBootStages(bootStages, sizeof(bootStages) / sizeof(bootStages[0]));
     //  start a task to handle serial commands while the webui is running
     startSerialCommandsHandlerTask();
 
     wakeUpScreen();
+    if (bruceConfig.startupApp != "") bootMarkInteractive(bruceConfig.startupApp.c_str());
     if (bruceConfig.startupApp != "" && !startupApp.startApp(bruceConfig.startupApp)) {
         bruceConfig.setStartupApp("");
     }
@@ -496,6 +559,7 @@ void loop() {
 #endif
     tft.fillScreen(bruceConfig.bgColor);
 
+    bootMarkInteractive("menu");
     mainMenu.begin();
     delay(1);
 }
@@ -519,6 +583,7 @@ void loop() {
 
     // Enable navigation through webUI
     tft.fillScreen(bruceConfig.bgColor);
+    bootMarkInteractive("menu");
     mainMenu.begin();
     vTaskDelay(10 / portTICK_PERIOD_MS);
 }
@@ -1,5 +1,6 @@
 #include "nrf_common.h"
 #include "../../core/mykeyboard.h"
+#include "../../core/spi_bus.h"
 
 RF24 NRFradio(bruceConfigPins.NRF24_bus.io0, bruceConfigPins.NRF24_bus.cs);
 HardwareSerial NRFSerial = HardwareSerial(2); // Uses UART2 for External NRF's
@@ -46,27 +47,9 @@ bool nrf_start(NRF24_MODE mode) {
     pinMode(bruceConfigPins.NRF24_bus.io0, OUTPUT);
     digitalWrite(bruceConfigPins.NRF24_bus.io0, LOW);
 
-    if (bruceConfigPins.NRF24_bus.mosi == (gpio_num_t)TFT_MOSI &&
-        bruceConfigPins.NRF24_bus.mosi != GPIO_NUM_NC) { // (T_EMBED), CORE2 and others
-#if TFT_MOSI > 0 // condition for Headless and 8bit displays (no SPI bus)
-        NRFSPI = &tft.getSPIinstance();
-#else
-        NRFSPI = &SPI;
-#endif
-
-    } else if (bruceConfigPins.NRF24_bus.mosi == bruceConfigPins.SDCARD_bus.mosi) {
-        // CC1101 shares SPI with SDCard (Cardputer and CYDs)
-
-        NRFSPI = &sdcardSPI;
-    } else if (bruceConfigPins.NRF24_bus.mosi == bruceConfigPins.CC1101_bus.mosi &&
-               bruceConfigPins.NRF24_bus.mosi != bruceConfigPins.SDCARD_bus.mosi) {
-        // Smoochie board shares CC1101 and NRF24 SPI bus with different CS pins at
-        // the same time, different from StickCs that uses the same Bus, but one at a
-        // time (same CS Pin)
-        NRFSPI = &CC_NRF_SPI;
-    } else {
-        NRFSPI = &SPI;
-    }
+    // Shares the TFT, SD or CC1101 bus when wired to it
+    NRFSPI = spiArbiter.bus(SpiDevice::NRF24);
+    if (!NRFSPI) NRFSPI = &SPI;
     NRFSPI->begin(
         (int8_t)bruceConfigPins.NRF24_bus.sck,
         (int8_t)bruceConfigPins.NRF24_bus.miso,
@@ -74,6 +57,7 @@ bool nrf_start(NRF24_MODE mode) {
     );
     delay(10);
 
+    SpiGuard bus(SpiDevice::NRF24);
     if (NRFradio.begin(
             NRFSPI,
             rf24_gpio_pin_t(bruceConfigPins.NRF24_bus.io0),
@@ -1,6 +1,7 @@
 #include "nrf_jammer.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/spi_bus.h"
 #include "nrf_common.h"
 #include <globals.h>
 
@@ -61,6 +62,7 @@ void nrf_jammer() {
         int hopIndex = 0;
         bool redraw = true;
         if (CHECK_NRF_SPI(mode)) {
+            SpiGuard bus(SpiDevice::NRF24);
             NRFradio.setPALevel(RF24_PA_MAX);
             NRFradio.startConstCarrier(RF24_PA_MAX, 50);
             NRFradio.setAddressWidth(5);
@@ -117,7 +119,10 @@ void nrf_jammer() {
 
             hopIndex++;
             if (hopIndex >= modes[modeIndex].count) hopIndex = 0;
-            if (CHECK_NRF_SPI(mode)) { NRFradio.setChannel(modes[modeIndex].channels[hopIndex]); }
+            if (CHECK_NRF_SPI(mode)) {
+                SpiGuard bus(SpiDevice::NRF24);
+                NRFradio.setChannel(modes[modeIndex].channels[hopIndex]);
+            }
 
             if (check(NextPress)) {
                 modeIndex++;
@@ -133,7 +138,10 @@ void nrf_jammer() {
             }
         }
 
-        if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
+        if (CHECK_NRF_SPI(mode)) {
+            SpiGuard bus(SpiDevice::NRF24);
+            NRFradio.stopConstCarrier();
+        }
         if ((CHECK_NRF_UART(mode)) || (CHECK_NRF_BOTH(mode))) {
              NRFSerial.println("OFF");
         }
@@ -154,6 +162,7 @@ void nrf_channel_jammer() {
         int channel = 50;
         bool redraw = true;
         if (CHECK_NRF_SPI(mode)) {
+            SpiGuard bus(SpiDevice::NRF24);
             NRFradio.setPALevel(RF24_PA_MAX);
             NRFradio.startConstCarrier(RF24_PA_MAX, channel);
             NRFradio.setAddressWidth(3);
@@ -214,6 +223,7 @@ void nrf_channel_jammer() {
                 channel++;
                 if (channel > 125) channel = 1;
                 if (CHECK_NRF_SPI(mode)) {
+                    SpiGuard bus(SpiDevice::NRF24);
                     NRFradio.setChannel(channel);
                     NRFradio.startConstCarrier(RF24_PA_MAX, channel);
                 }
@@ -225,6 +235,7 @@ void nrf_channel_jammer() {
                 channel--;
                 if (channel < 1) channel = 125;
                 if (CHECK_NRF_SPI(mode)) {
+                    SpiGuard bus(SpiDevice::NRF24);
                     NRFradio.setChannel(channel);
                     NRFradio.startConstCarrier(RF24_PA_MAX, channel);
                 }
@@ -232,7 +243,10 @@ void nrf_channel_jammer() {
             }
         }
 
-        if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
+        if (CHECK_NRF_SPI(mode)) {
+            SpiGuard bus(SpiDevice::NRF24);
+            NRFradio.stopConstCarrier();
+        }
         if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) {
             NRFSerial.println("OFF");
         }
@@ -255,6 +269,7 @@ void nrf_channel_hopper() {
     }
 
     if (CHECK_NRF_SPI(mode)) {
+        SpiGuard bus(SpiDevice::NRF24);
         NRFradio.setPALevel(RF24_PA_MAX);
         NRFradio.startConstCarrier(RF24_PA_MAX, 50);
         if (!NRFradio.setDataRate(RF24_2MBPS)) ;
@@ -381,10 +396,16 @@ void nrf_channel_hopper() {
         while (!check(EscPress)) {
             channel += stepSize;
             if (channel > stopChannel) channel = startChannel;
-            if (CHECK_NRF_SPI(mode)) NRFradio.setChannel(channel);
+            if (CHECK_NRF_SPI(mode)) {
+                SpiGuard bus(SpiDevice::NRF24);
+                NRFradio.setChannel(channel);
+            }
         }
 
-        if (CHECK_NRF_SPI(mode)) NRFradio.stopConstCarrier();
+        if (CHECK_NRF_SPI(mode)) {
+            SpiGuard bus(SpiDevice::NRF24);
+            NRFradio.stopConstCarrier();
+        }
         if (CHECK_NRF_UART(mode) || CHECK_NRF_BOTH(mode)) NRFSerial.println("OFF");
     }
 }
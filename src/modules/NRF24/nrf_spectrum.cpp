@@ -1,6 +1,7 @@
 #include "nrf_spectrum.h"
 #include "../../core/display.h"
 #include "../../core/mykeyboard.h"
+#include "../../core/spi_bus.h"
 
 #define CHANNELS 80
 #define RGB565(r, g, b) ((((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)))
@@ -36,6 +37,7 @@ String scanChannels(SPIClass *SSPI, bool web) {
     digitalWrite(bruceConfigPins.NRF24_bus.io0, LOW);
 
     for (int i = 0; i < CHANNELS; i++) {
+        SpiGuard bus(SpiDevice::NRF24); // per channel, the display may draw in between
         NRFradio.setChannel(i);
         NRFradio.startListening();
         delayMicroseconds(128);
@@ -83,6 +85,7 @@ void nrf_spectrum(SPIClass *SSPI) {
     tft.drawRightString("2.48Ghz", tftWidth, tftHeight - LH, 1);
 
     if (nrf_start(NRF_MODE_SPI)) { // This function only works on SPI
+        spiArbiter.acquire(SpiDevice::NRF24);
         NRFradio.setAutoAck(false);
         NRFradio.disableCRC();       // accept any signal we find
         NRFradio.setAddressWidth(2); // a reverse engineering tactic (not typically recommended)
@@ -96,10 +99,13 @@ void nrf_spectrum(SPIClass *SSPI) {
         };
         for (uint8_t i = 0; i < 6; ++i) { NRFradio.openReadingPipe(i, noiseAddress[i]); }
         NRFradio.setDataRate(RF24_1MBPS);
+        spiArbiter.release(SpiDevice::NRF24);
 
         while (!check(EscPress)) { scanChannels(SSPI); }
+        spiArbiter.acquire(SpiDevice::NRF24);
         NRFradio.stopListening();
         powerDown(*SSPI);
+        spiArbiter.release(SpiDevice::NRF24);
         delay(250);
         return;
 
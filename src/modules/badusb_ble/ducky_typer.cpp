@@ -244,9 +244,15 @@ NewScript:
                 }
             }
         }
+        DuckyProgram program;
+        if (!ducky_compile(*fs, bad_script, program)) {
+            displayError("Could not read script", true);
+            goto NewScript;
+        }
+        ducky_show_warnings(program);
         displayWarning(String(BTN_ALIAS) + " to deploy", true);
         delay(200);
-        key_input(*fs, bad_script, hid);
+        ducky_run(program, hid);
 
         displayTextLine("Payload Sent", true);
 
@@ -265,147 +271,227 @@ EXIT:
     }
     returnToMenu = true;
 }
-// Parses a file to run in the badUSBBLE
-void key_input(FS fs, String bad_script, HIDInterface *_hid) {
-    if (!fs.exists(bad_script) || bad_script == "") return;
+static const DuckyCommand *ducky_find_command(const char *name) {
+    for (auto &cmds : duckyCmds) {
+        if (strcmp(name, cmds.command) == 0) return &cmds;
+    }
+    return nullptr;
+}
+
+static uint32_t ducky_add_text(DuckyProgram &program, const String &text) {
+    uint32_t offset = program.text.length();
+    program.text += text;
+    return offset;
+}
+
+// Compiles a ducky script into an opcode stream, all parsing happens here so playback is a tight loop
+bool ducky_compile(FS &fs, const String &bad_script, DuckyProgram &program) {
+    program.ops.clear();
+    program.text = "";
+    program.warnings.clear();
+    program.lines = 0;
+
+    if (bad_script == "" || !fs.exists(bad_script)) return false;
     File payloadFile = fs.open(bad_script, "r");
-    if (!payloadFile) return;
-    tft.setCursor(0, 40);
-    tft.println("from file!");
-    String lineContent = "";
-    String Command = "";
-    char Cmd[15];
-    String Argument = "";
-    String RepeatTmp = "";
-    char ArgChar = '\0';
-    bool ArgIsCmd; // Verifies if the Argument is DELETE, TAB or F1-F12
+    if (!payloadFile) return false;
+    program.text.reserve(payloadFile.size());
+
+    // Ops generated by the last command line, replayed by REPEAT. A REPEAT is not a command itself,
+    // consecutive ones all replay the same line.
+    size_t prevStart = 0;
+    size_t prevCount = 0;
+
+    while (payloadFile.available()) {
+        // CRLF is a combination of two control characters: the "Carriage Return" represented by
+        // the character "\r" and the "Line Feed" represented by the character "\n".
+        String lineContent = payloadFile.readStringUntil('\n');
+        if (lineContent.endsWith("\r")) lineContent.remove(lineContent.length() - 1);
+        uint16_t line = ++program.lines;
+        if (lineContent.length() == 0) continue;
+
+        int space = lineContent.indexOf(' ');
+        String Command = space > 0 ? lineContent.substring(0, space) : lineContent;
+        String Argument = space > 0 ? lineContent.substring(space + 1) : "";
+
+        if (Command == "REPEAT") {
+            long count = Argument.toInt();
+            if (count <= 0) {
+                count = 1;
+                String reason = Argument == "" ? "without argument" : "argument NaN";
+                program.warnings.push_back("L" + String(line) + ": REPEAT " + reason + ", repeating once");
+            }
+            if (prevCount == 0) {
+                program.warnings.push_back("L" + String(line) + ": REPEAT with nothing to repeat");
+                continue;
+            }
+            DuckyOp op = {};
+            op.code = DuckyOp_Repeat;
+            op.line = line;
+            op.len = prevCount;
+            op.arg = count;
+            op.from = prevStart;
+            program.ops.push_back(op);
+            continue;
+        }
+
+        prevStart = program.ops.size();
+        const DuckyCommand *PriCmd = ducky_find_command(Command.c_str());
+        DuckyOp op = {};
+        op.line = line;
+
+        if (PriCmd == nullptr) {
+            program.warnings.push_back(
+                "L" + String(line) + ": " + Command + " -> Not Supported, running as STRINGLN"
+            );
+            op.code = DuckyOp_String;
+            op.arg = ducky_add_text(program, lineContent);
+            op.len = lineContent.length();
+            op.newline = true;
+            program.ops.push_back(op);
+        } else if (PriCmd->type == DuckyCommandType_Print) {
+            op.code = DuckyOp_String;
+            op.arg = ducky_add_text(program, Argument);
+            op.len = Argument.length();
+            op.newline = strcmp(PriCmd->command, "STRINGLN") == 0;
+            if (op.len > 0 || op.newline) program.ops.push_back(op);
+        } else if (PriCmd->type == DuckyCommandType_Delay) {
+            op.code = DuckyOp_Delay;
+            if ((int)PriCmd->key > 0) op.arg = DEF_DELAY; // Default delay is 100ms
+            else if (Argument.toInt() > 0) op.arg = Argument.toInt();
+            else {
+                op.arg = DEF_DELAY;
+                program.warnings.push_back(
+                    "L" + String(line) + ": invalid DELAY, using " + String(DEF_DELAY)
+                );
+            }
+            program.ops.push_back(op);
+        } else if (PriCmd->type == DuckyCommandType_Cmd || PriCmd->type == DuckyCommandType_Combination) {
+            op.code = DuckyOp_Chord;
+            if (PriCmd->type == DuckyCommandType_Cmd) {
+                op.keys[op.keyCount++] = PriCmd->key;
+            } else {
+                for (auto comb : duckyComb) {
+                    if (strcmp(PriCmd->command, comb.command) == 0) {
+                        op.keys[op.keyCount++] = comb.key1;
+                        op.keys[op.keyCount++] = comb.key2;
+                        if (comb.key3 != 0) op.keys[op.keyCount++] = comb.key3;
+                        break;
+                    }
+                }
+            }
+            // Argument can be another key (GUI TAB) or a single character (GUI r)
+            const DuckyCommand *ArgCmd = ducky_find_command(Argument.c_str());
+            if (ArgCmd != nullptr && ArgCmd->type == DuckyCommandType_Cmd)
+                op.keys[op.keyCount++] = ArgCmd->key;
+            else if (Argument.length() > 0) op.keys[op.keyCount++] = Argument.charAt(0);
+            program.ops.push_back(op);
+        }
+        // REM and DuckyCommandType_Loop generate nothing
+        prevCount = program.ops.size() - prevStart;
+    }
+    payloadFile.close();
+    return true;
+}
+
+// Runs one opcode, returns how many keystrokes were sent
+static uint32_t ducky_exec(const DuckyProgram &program, const DuckyOp &op, HIDInterface *_hid) {
+    switch (op.code) {
+        case DuckyOp_Chord:
+            for (uint8_t k = 0; k < op.keyCount; k++) _hid->press(op.keys[k]);
+            _hid->releaseAll();
+            return 1;
+        case DuckyOp_String:
+            _hid->write((const uint8_t *)program.text.c_str() + op.arg, op.len);
+            if (op.newline) _hid->println();
+            return op.len + (op.newline ? 1 : 0);
+        case DuckyOp_Delay: delay(op.arg); return 0;
+        default: return 0;
+    }
+}
+
+// Plays a compiled script, reports the achieved typing rate at the end
+void ducky_run(const DuckyProgram &program, HIDInterface *_hid) {
+    uint32_t keys = 0;
+    uint32_t delayed = 0;
+    unsigned long lastDraw = 0;
+    unsigned long start = millis();
 
     _hid->releaseAll();
-    tft.setTextSize(1);
-    tft.setCursor(0, 0);
     tft.fillScreen(bruceConfig.bgColor);
+    progressHandler(0, program.lines, "Sending payload");
 
-    while (payloadFile.available()) {
-        previousMillis = millis(); // resets DimScreen
+    for (size_t i = 0; i < program.ops.size(); i++) {
         if (check(SelPress)) {
             while (check(SelPress)); // hold the code in this position until release the btn
+            unsigned long paused = millis();
             options = {
                 {"Continue", yield},
             };
             addOptionToMainMenu();
             loopOptions(options);
-
             if (returnToMenu) break;
-            tft.setTextSize(FP);
+            delayed += millis() - paused;
+            tft.fillScreen(bruceConfig.bgColor);
+            progressHandler(0, program.lines, "Sending payload");
         }
-        // CRLF is a combination of two control characters: the "Carriage Return" represented by
-        // the character "\r" and the "Line Feed" represented by the character "\n".
-        lineContent = payloadFile.readStringUntil('\n');
-        if (lineContent.endsWith("\r")) lineContent.remove(lineContent.length() - 1);
 
-        RepeatTmp = lineContent.substring(0, lineContent.indexOf(' '));
-        RepeatTmp = RepeatTmp.c_str();
-        if (RepeatTmp == "REPEAT") {
-            if (lineContent.indexOf(' ') > 0) {
-                // how many times it will repeat, using .toInt() conversion;
-                RepeatTmp = lineContent.substring(lineContent.indexOf(' ') + 1);
-                if (RepeatTmp.toInt() == 0) {
-                    RepeatTmp = "1";
-                    tft.setTextColor(ALCOLOR);
-                    tft.println("REPEAT argument NaN, repeating once");
+        const DuckyOp &op = program.ops[i];
+        if (op.code == DuckyOp_Repeat) {
+            for (uint32_t r = 0; r < op.arg; r++) {
+                for (size_t j = op.from; j < op.from + op.len; j++) {
+                    if (program.ops[j].code == DuckyOp_Delay) delayed += program.ops[j].arg;
+                    keys += ducky_exec(program, program.ops[j], _hid);
                 }
-            } else {
-                RepeatTmp = "1";
-                tft.setTextColor(ALCOLOR);
-                tft.println("REPEAT without argument, repeating once");
             }
         } else {
-            Command = lineContent.substring(0, lineContent.indexOf(' ')); // get the Command
-            strcpy(Cmd, Command.c_str());                                 // get the cmd
-            if (lineContent.indexOf(' ') > 0)
-                Argument = lineContent.substring(lineContent.indexOf(' ') + 1); // get the argument
-            else Argument = "";
-            RepeatTmp = "1";
+            if (op.code == DuckyOp_Delay) delayed += op.arg;
+            keys += ducky_exec(program, op, _hid);
         }
-        uint16_t i;
-        ArgIsCmd = false;
-        Argument = Argument.c_str();
-        ArgChar = Argument.charAt(0);
-        for (i = 0; i < RepeatTmp.toInt(); i++) {
-            DuckyCommand *ArgCmd = nullptr;
-            DuckyCommand *PriCmd = nullptr;
-            ArgIsCmd = false;
-            for (auto cmds : duckyCmds) {
-                if (strcmp(Cmd, cmds.command) == 0) {
-                    PriCmd = &cmds;
-                    // STRING and STRINGLN are processed here
-                    if (cmds.type == DuckyCommandType_Print) {
-                        _hid->print(Argument);
-                        if (strcmp(cmds.command, "STRINGLN") == 0) _hid->println();
-                        break;
-                    }
-                    // DELAY and DEFAULTDELAY are processed here
-                    else if (cmds.type == DuckyCommandType_Delay) {
-                        if ((int)cmds.key > 0) delay(DEF_DELAY); // Default delay is 100ms
-                        else if (Argument.toInt() > 0) delay(Argument.toInt());
-                        else delay(DEF_DELAY);
-                        break;
-                    }
-                    // Comment line is porocessed Here
-                    else if (cmds.type == DuckyCommandType_Comment) {
-                        yield(); // do nothing, just wait for the next line
-                        break;
-                    }
-                    // Normal commands are processed here
-                    else if (cmds.type == DuckyCommandType_Cmd) {
-                        _hid->press(cmds.key);
-                        ArgIsCmd = true;
-                    }
-                    // Combinations are processed here
-                    else if (cmds.type == DuckyCommandType_Combination) {
-                        for (auto comb : duckyComb) {
-                            if (strcmp(Cmd, comb.command) == 0) {
-                                _hid->press(comb.key1);
-                                _hid->press(comb.key2);
-                                if (comb.key3 != 0) _hid->press(comb.key3);
-                                ArgIsCmd = true;
-                            }
-                        }
-                    }
-                }
-                // check if the Argument contains a command
-                if (strcmp(Argument.c_str(), cmds.command) == 0) { ArgCmd = &cmds; }
-            }
 
-            if (ArgCmd != nullptr && PriCmd != nullptr) {
-                if (ArgCmd->type == DuckyCommandType_Cmd) { _hid->press(ArgCmd->key); }
-            } else if (ArgIsCmd && PriCmd != nullptr) {
-                if (ArgChar != '\0') _hid->press(ArgChar);
-            }
-            _hid->releaseAll();
-
-            if (PriCmd == nullptr) {
-                tft.setTextColor(ALCOLOR);
-                tft.print(Command);
-                tft.println(" -> Not Supported, running as STRINGLN");
-                if (Argument != "") {
-                    _hid->println(Command + " " + Argument);
-                } else {
-                    _hid->println(Command);
-                }
-            } else {
-                tft.setTextColor(bruceConfig.priColor);
-                tft.print(Command);
-            }
-            if (Argument.length() > 0) {
-                tft.setTextColor(TFT_WHITE);
-                tft.println(Argument);
-            } else tft.println();
+        // Redrawing on every line adds jitter to the HID stream, keep it at a few fps
+        if (millis() - lastDraw > 250) {
+            previousMillis = millis(); // resets DimScreen
+            progressHandler(op.line, program.lines, "Sending payload");
+            lastDraw = millis();
         }
     }
-    tft.setTextSize(FM);
-    payloadFile.close();
     _hid->releaseAll();
+
+    unsigned long typing = millis() - start;
+    typing = typing > delayed ? typing - delayed : 0;
+    float rate = typing > 0 ? keys * 1000.0f / typing : 0;
+    const char *transport = _hid == hid_ble ? "BLE" : "USB";
+    Serial.printf("Ducky %s: %lu keys in %lu ms, %.1f keys/s\n", transport, (unsigned long)keys, typing, rate);
+    progressHandler(program.lines, program.lines, "Sending payload");
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.drawCentreString(
+        String(transport) + ": " + String(rate, 1) + " keys/s", tftWidth / 2, tftHeight - 25, 1
+    );
+    tft.setTextSize(FM);
+}
+
+// Shows compile warnings before the payload is deployed
+void ducky_show_warnings(const DuckyProgram &program) {
+    if (program.warnings.empty()) return;
+    tft.fillScreen(bruceConfig.bgColor);
+    tft.setCursor(0, 0);
+    tft.setTextSize(FP);
+    tft.setTextColor(ALCOLOR, bruceConfig.bgColor);
+    for (auto &warning : program.warnings) {
+        Serial.println(warning);
+        if (tft.getCursorY() < tftHeight - 8) tft.println(warning);
+    }
+    tft.setTextSize(FM);
+    displayWarning(String(program.warnings.size()) + " warnings", true);
+}
+
+// Parses a file to run in the badUSBBLE
+void key_input(FS fs, String bad_script, HIDInterface *_hid) {
+    DuckyProgram program;
+    if (!ducky_compile(fs, bad_script, program)) return;
+    ducky_show_warnings(program);
+    ducky_run(program, _hid);
 }
 
 // Sends a simple command
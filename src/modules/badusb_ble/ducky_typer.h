@@ -11,6 +11,7 @@
 #include <CH9329_Keyboard.h>
 #endif
 #include <BleKeyboard.h>
+#include <vector>
 
 extern HIDInterface *hid_usb;
 extern HIDInterface *hid_ble;
@@ -21,6 +22,35 @@ void ducky_setup(HIDInterface *&hid, bool ble = false);
 // Setup the keyboard for badUSB or badBLE
 void ducky_startKb(HIDInterface *&hid, bool ble);
 
+enum DuckyOpcode : uint8_t { DuckyOp_Chord, DuckyOp_String, DuckyOp_Delay, DuckyOp_Repeat };
+
+struct DuckyOp {
+    DuckyOpcode code;
+    uint8_t keyCount; // Chord: keys used
+    uint8_t keys[4];  // Chord: pressed in order, released together
+    bool newline;     // String: STRINGLN
+    uint16_t line;    // Source line, for progress
+    uint16_t len;     // String: text length, Repeat: number of ops to replay
+    uint32_t arg;     // String: offset in text pool, Delay: ms, Repeat: count
+    uint32_t from;    // Repeat: first op of the repeated command
+};
+
+struct DuckyProgram {
+    std::vector<DuckyOp> ops;
+    String text; // STRING arguments, referenced by offset
+    std::vector<String> warnings;
+    uint16_t lines = 0;
+};
+
+// Compiles a script file into a DuckyProgram, returns false if the file can't be read
+bool ducky_compile(FS &fs, const String &bad_script, DuckyProgram &program);
+
+// Shows and logs the warnings found while compiling
+void ducky_show_warnings(const DuckyProgram &program);
+
+// Plays a compiled script through the HID interface
+void ducky_run(const DuckyProgram &program, HIDInterface *hid);
+
 // Parses a file to run in the badUSB
 void key_input(FS fs, String bad_script, HIDInterface *hid);
 
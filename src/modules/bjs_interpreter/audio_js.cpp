@@ -2,28 +2,73 @@
 #include "audio_js.h"
 
 #include "helpers_js.h"
+#include "modules/others/audio_player.h"
 
 duk_ret_t putPropAudioFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic) {
-    bduk_put_prop_c_lightfunc(ctx, obj_idx, "playFile", native_playAudioFile, 1, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "playFile", native_playAudioFile, 2, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "tone", native_tone, 3, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "pause", native_audioControl, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "resume", native_audioControl, 0, magic + 1);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "stop", native_audioControl, 0, magic + 2);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "seek", native_audioControl, 1, magic + 3);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "setVolume", native_audioControl, 1, magic + 4);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "status", native_audioStatus, 0, magic);
     return 0;
 }
 
 duk_ret_t registerAudio(duk_context *ctx) {
-    bduk_register_c_lightfunc(ctx, "playAudioFile", native_playAudioFile, 1);
+    bduk_register_c_lightfunc(ctx, "playAudioFile", native_playAudioFile, 2);
     bduk_register_c_lightfunc(ctx, "tone", native_tone, 3);
     return 0;
 }
 
 duk_ret_t native_playAudioFile(duk_context *ctx) {
     // usage: playAudioFile(filename : string);
+    // usage: playAudioFile(filename : string, async : boolean);
     // returns: bool==true on success, false on any error
+    // async returns once playback started, follow it with audio.status()
     // MEMO: no need to check for board support (done in serialCli.parse)
-    bool r = serialCli.parse("music_player " + String(duk_to_string(ctx, 0)));
+    String command = duk_get_boolean_default(ctx, 1, false) ? "audio play " : "music_player ";
+    bool r = serialCli.parse(command + String(duk_to_string(ctx, 0)));
     duk_push_boolean(ctx, r);
     return 1;
 }
 
+duk_ret_t native_audioControl(duk_context *ctx) {
+    // usage: pause(); resume(); stop();
+    // usage: seek(percent : number); setVolume(volume : number);
+#if defined(HAS_NS4168_SPKR)
+    uint8_t value = constrain(duk_get_int_default(ctx, 0, 0), 0, 100);
+    switch (duk_get_current_magic(ctx)) {
+        case 0: audioPlayer.pause(); break;
+        case 1: audioPlayer.resume(); break;
+        case 2: audioPlayer.stop(); break;
+        case 3: audioPlayer.seek(value); break;
+        case 4: audioPlayer.setVolume(value); break;
+    }
+#endif
+    return 0;
+}
+
+duk_ret_t native_audioStatus(duk_context *ctx) {
+    // usage: status();
+    // returns: { playing, paused, position, size, progress, completed }
+    // completed counts the files that played to their end
+    duk_idx_t obj_idx = duk_push_object(ctx);
+#if defined(HAS_NS4168_SPKR)
+    bool paused = audioPlayer.state() == AudioPlayer::State::Paused;
+    bduk_put_prop(ctx, obj_idx, "playing", duk_push_boolean, audioPlayer.busy());
+    bduk_put_prop(ctx, obj_idx, "paused", duk_push_boolean, paused);
+    bduk_put_prop(ctx, obj_idx, "position", duk_push_uint, audioPlayer.position());
+    bduk_put_prop(ctx, obj_idx, "size", duk_push_uint, audioPlayer.size());
+    bduk_put_prop(ctx, obj_idx, "progress", duk_push_uint, audioPlayer.progress());
+    bduk_put_prop(ctx, obj_idx, "completed", duk_push_uint, audioPlayer.completions());
+#else
+    bduk_put_prop(ctx, obj_idx, "playing", duk_push_boolean, false);
+#endif
+    return 1;
+}
+
 duk_ret_t native_tone(duk_context *ctx) {
     // usage: tone(frequency: number);
     // usage: tone(frequency: number, duration: number, nonBlocking: boolean);
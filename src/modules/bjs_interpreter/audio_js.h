@@ -9,6 +9,8 @@ duk_ret_t registerAudio(duk_context *ctx);
 
 duk_ret_t native_playAudioFile(duk_context *ctx);
 duk_ret_t native_tone(duk_context *ctx);
+duk_ret_t native_audioControl(duk_context *ctx);
+duk_ret_t native_audioStatus(duk_context *ctx);
 
 #endif
 #endif
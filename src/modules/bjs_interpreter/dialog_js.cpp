@@ -1,5 +1,6 @@
 #if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
 #include "dialog_js.h"
+#include "core/list_view.h"
 #include "core/scrollableTextArea.h"
 
 #include "helpers_js.h"
@@ -99,6 +100,13 @@ duk_ret_t native_dialogPickFile(duk_context *ctx) {
     return 1;
 }
 
+// Label and return value of each choice
+struct ChoiceSource : public ListSource {
+    std::vector<std::pair<const char *, const char *>> items;
+    size_t size() override { return items.size(); }
+    String label(size_t index) override { return items[index].first; }
+};
+
 duk_ret_t native_dialogChoice(duk_context *ctx) {
     // usage: dialogChoice(choices : string[] | {[key: string]: string})
     // legacy version dialogChoice takes ["choice1", "return_val1", "choice2",
@@ -113,7 +121,8 @@ duk_ret_t native_dialogChoice(duk_context *ctx) {
         duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: Choice argument must be object or array.", "dialogChoice");
         return 1;
     }
-    options = {};
+    // The strings stay on the duktape heap with the argument, only the pointers are kept
+    ChoiceSource choices;
     bool arg0IsArray = duk_is_array(ctx, 0);
 
     duk_enum(ctx, 0, 0);
@@ -149,15 +158,13 @@ duk_ret_t native_dialogChoice(duk_context *ctx) {
             }
         }
         duk_pop_2(ctx);
-        options.push_back({choiceKey, [choiceValue, &result]() { result = choiceValue; }});
+        choices.items.push_back({choiceKey, choiceValue});
     }
 
-    if (legacy) {
-        options.push_back({"Cancel", [&]() { result = ""; }});
-    }
+    if (legacy) choices.items.push_back({"Cancel", ""});
 
-    loopOptions(options, MENU_TYPE_REGULAR, "", 0, true);
-    options.clear();
+    int chosen = loopList(choices);
+    if (chosen >= 0 && choices.items[chosen].second) result = choices.items[chosen].second;
 
     duk_push_string(ctx, result);
     return 1;
@@ -0,0 +1,286 @@
+#if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
+#include "eventloop_js.h"
+
+#include "helpers_js.h"
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#define JS_LOOP_CALLBACKS_KEY "jsLoopCallbacks"
+#define JS_LOOP_QUEUE_LENGTH 16
+
+struct JsTimer {
+    uint32_t id;
+    uint32_t when;
+    uint32_t interval;
+    bool repeat;
+};
+
+struct JsSpawnArgs {
+    TaskFunction_t fn;
+    void *arg;
+};
+
+// Min-heap ordered by expiration, millis() wrap around safe
+static bool timerLater(const JsTimer &a, const JsTimer &b) { return (int32_t)(a.when - b.when) > 0; }
+
+static std::vector<JsTimer> timers;
+static std::deque<uint32_t> microtasks;
+static QueueHandle_t jobQueue = NULL;
+static uint32_t nextCallbackId = 1;
+static int pendingOps = 0; // only touched by the interpreter task
+
+/*********************************************************************
+**  Callback storage
+**  Functions (and their bound arguments) live in the heap stash so the
+**  garbage collector keeps them alive while a timer or job is pending.
+**  Each entry is an array: [fn, arg0, arg1, ...]
+*********************************************************************/
+static void pushCallbacksObject(duk_context *ctx) {
+    duk_push_heap_stash(ctx);
+    if (!duk_get_prop_string(ctx, -1, JS_LOOP_CALLBACKS_KEY)) {
+        duk_pop(ctx);
+        duk_push_object(ctx);
+        duk_dup_top(ctx);
+        duk_put_prop_string(ctx, -3, JS_LOOP_CALLBACKS_KEY);
+    }
+    duk_remove(ctx, -2); // remove stash
+}
+
+static uint32_t storeCallback(duk_context *ctx, duk_idx_t fnIdx, duk_idx_t firstArg, duk_idx_t lastArg) {
+    fnIdx = duk_normalize_index(ctx, fnIdx);
+    uint32_t id = nextCallbackId++;
+
+    pushCallbacksObject(ctx);
+    duk_idx_t arr_idx = duk_push_array(ctx);
+    duk_dup(ctx, fnIdx);
+    duk_put_prop_index(ctx, arr_idx, 0);
+    duk_uarridx_t pos = 1;
+    for (duk_idx_t i = firstArg; i <= lastArg; i++) {
+        duk_dup(ctx, i);
+        duk_put_prop_index(ctx, arr_idx, pos++);
+    }
+    duk_put_prop_index(ctx, -2, id);
+    duk_pop(ctx);
+    return id;
+}
+
+static void releaseCallback(duk_context *ctx, uint32_t id) {
+    pushCallbacksObject(ctx);
+    duk_del_prop_index(ctx, -1, id);
+    duk_pop(ctx);
+}
+
+static void invokeCallback(
+    duk_context *ctx, uint32_t id, duk_idx_t (*push)(duk_context *, void *), void *data, bool keep
+) {
+    pushCallbacksObject(ctx);
+    if (!duk_get_prop_index(ctx, -1, id) || !duk_is_array(ctx, -1)) {
+        // cleared before it fired
+        duk_pop_2(ctx);
+        return;
+    }
+    duk_idx_t arr_idx = duk_get_top_index(ctx);
+    duk_size_t len = duk_get_length(ctx, arr_idx);
+
+    duk_get_prop_index(ctx, arr_idx, 0);
+    duk_idx_t nargs = 0;
+    for (duk_uarridx_t i = 1; i < len; i++, nargs++) duk_get_prop_index(ctx, arr_idx, i);
+    if (push != NULL) nargs += push(ctx, data);
+
+    if (duk_pcall(ctx, nargs) != DUK_EXEC_SUCCESS) {
+        Serial.printf(
+            "callback failed: %s\n",
+            duk_is_error(ctx, -1) ? duk_safe_to_stacktrace(ctx, -1) : duk_safe_to_string(ctx, -1)
+        );
+    }
+    duk_pop_2(ctx); // result and entry
+
+    if (!keep) duk_del_prop_index(ctx, -1, id);
+    duk_pop(ctx);
+}
+
+static void runMicrotasks(duk_context *ctx) {
+    while (!microtasks.empty()) {
+        uint32_t id = microtasks.front();
+        microtasks.pop_front();
+        invokeCallback(ctx, id, NULL, NULL, false);
+    }
+}
+
+static void runDueTimers(duk_context *ctx) {
+    while (!timers.empty() && (int32_t)(millis() - timers.front().when) >= 0) {
+        std::pop_heap(timers.begin(), timers.end(), timerLater);
+        JsTimer timer = timers.back();
+        timers.pop_back();
+
+        // Reschedule before calling, so the callback can clear its own interval
+        if (timer.repeat) {
+            timer.when += timer.interval;
+            if ((int32_t)(millis() - timer.when) > 0) timer.when = millis() + timer.interval;
+            timers.push_back(timer);
+            std::push_heap(timers.begin(), timers.end(), timerLater);
+        }
+        invokeCallback(ctx, timer.id, NULL, NULL, timer.repeat);
+        runMicrotasks(ctx);
+    }
+}
+
+static duk_ret_t addTimer(duk_context *ctx, bool repeat) {
+    // usage: setTimeout(callback : function, delay_in_ms : number, ...args)
+    // usage: setInterval(callback : function, interval_in_ms : number, ...args)
+    // returns: timer id, to be used with clearTimeout/clearInterval
+    if (!duk_is_function(ctx, 0)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function", "setTimeout");
+    }
+    int32_t delayMs = duk_get_int_default(ctx, 1, 0);
+    if (delayMs < 0) delayMs = 0;
+    if (repeat && delayMs == 0) delayMs = 1; // avoid starving the loop
+
+    JsTimer timer;
+    timer.id = storeCallback(ctx, 0, 2, duk_get_top(ctx) - 1);
+    timer.when = millis() + delayMs;
+    timer.interval = delayMs;
+    timer.repeat = repeat;
+    timers.push_back(timer);
+    std::push_heap(timers.begin(), timers.end(), timerLater);
+
+    duk_push_uint(ctx, timer.id);
+    return 1;
+}
+
+duk_ret_t registerEventLoop(duk_context *ctx) {
+    bduk_register_c_lightfunc(ctx, "setTimeout", native_setTimeout, DUK_VARARGS);
+    bduk_register_c_lightfunc(ctx, "setInterval", native_setInterval, DUK_VARARGS);
+    bduk_register_c_lightfunc(ctx, "clearTimeout", native_clearTimer, 1);
+    bduk_register_c_lightfunc(ctx, "clearInterval", native_clearTimer, 1);
+    bduk_register_c_lightfunc(ctx, "queueMicrotask", native_queueMicrotask, 1);
+    return 0;
+}
+
+duk_ret_t native_setTimeout(duk_context *ctx) { return addTimer(ctx, false); }
+
+duk_ret_t native_setInterval(duk_context *ctx) { return addTimer(ctx, true); }
+
+duk_ret_t native_clearTimer(duk_context *ctx) {
+    // usage: clearTimeout(id : number);
+    if (!duk_is_number(ctx, 0)) return 0;
+    uint32_t id = duk_to_uint32(ctx, 0);
+
+    auto it = std::remove_if(timers.begin(), timers.end(), [id](const JsTimer &t) { return t.id == id; });
+    if (it == timers.end()) return 0;
+    timers.erase(it, timers.end());
+    std::make_heap(timers.begin(), timers.end(), timerLater);
+    releaseCallback(ctx, id);
+    return 0;
+}
+
+duk_ret_t native_queueMicrotask(duk_context *ctx) {
+    // usage: queueMicrotask(callback : function);
+    if (!duk_is_function(ctx, 0)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function", "queueMicrotask");
+    }
+    microtasks.push_back(storeCallback(ctx, 0, 1, 0));
+    return 0;
+}
+
+/*********************************************************************
+**  Background jobs
+*********************************************************************/
+uint32_t jsEventLoopRetainCallback(duk_context *ctx, duk_idx_t idx) { return storeCallback(ctx, idx, 1, 0); }
+
+static void spawnTrampoline(void *pvParameters) {
+    JsSpawnArgs *args = (JsSpawnArgs *)pvParameters;
+    args->fn(args->arg);
+    delete args;
+    vTaskDelete(NULL);
+}
+
+bool jsEventLoopSpawn(const char *name, TaskFunction_t fn, void *arg, uint32_t stackSize) {
+    if (jobQueue == NULL) return false;
+    JsSpawnArgs *args = new JsSpawnArgs{fn, arg};
+    // Same priority as the interpreter, the loop sleeps while workers run
+    if (xTaskCreate(spawnTrampoline, name, stackSize, args, 2, NULL) != pdPASS) {
+        delete args;
+        return false;
+    }
+    pendingOps++;
+    return true;
+}
+
+bool jsEventLoopPost(const JsLoopJob &job) {
+    if (jobQueue == NULL) return false;
+    return xQueueSend(jobQueue, &job, portMAX_DELAY) == pdTRUE;
+}
+
+static duk_idx_t pushStringResult(duk_context *ctx, void *data) {
+    duk_push_null(ctx);
+    duk_push_string(ctx, ((String *)data)->c_str());
+    return 2;
+}
+
+static duk_idx_t pushErrorResult(duk_context *ctx, void *data) {
+    duk_push_error_object(ctx, DUK_ERR_ERROR, "%s", ((String *)data)->c_str());
+    return 1;
+}
+
+static void releaseString(void *data) { delete (String *)data; }
+
+void jsEventLoopPostString(uint32_t callbackId, const String &result) {
+    jsEventLoopPost({callbackId, pushStringResult, releaseString, new String(result)});
+}
+
+void jsEventLoopPostError(uint32_t callbackId, const String &error) {
+    jsEventLoopPost({callbackId, pushErrorResult, releaseString, new String(error)});
+}
+
+/*********************************************************************
+**  Loop
+*********************************************************************/
+void jsEventLoopBegin(duk_context *ctx) {
+    timers.clear();
+    microtasks.clear();
+    nextCallbackId = 1;
+    pendingOps = 0;
+    if (jobQueue == NULL) jobQueue = xQueueCreate(JS_LOOP_QUEUE_LENGTH, sizeof(JsLoopJob));
+}
+
+// Runs until there are no timers and no background jobs left.
+// While waiting, the interpreter task blocks on the job queue so idle scripts cost no CPU.
+void jsEventLoopRun(duk_context *ctx) {
+    runMicrotasks(ctx);
+    while (!timers.empty() || pendingOps > 0) {
+        TickType_t wait = portMAX_DELAY;
+        if (!timers.empty()) {
+            int32_t remaining = (int32_t)(timers.front().when - millis());
+            wait = remaining > 0 ? pdMS_TO_TICKS(remaining) : 0;
+        }
+
+        JsLoopJob job;
+        if (xQueueReceive(jobQueue, &job, wait) == pdTRUE) {
+            pendingOps--;
+            invokeCallback(ctx, job.callbackId, job.push, job.data, false);
+            if (job.release != NULL) job.release(job.data);
+            runMicrotasks(ctx);
+        }
+        runDueTimers(ctx);
+    }
+}
+
+void jsEventLoopEnd(duk_context *ctx) {
+    // Workers still running would post into a deleted queue, wait for them
+    JsLoopJob job;
+    while (pendingOps > 0 && xQueueReceive(jobQueue, &job, portMAX_DELAY) == pdTRUE) {
+        pendingOps--;
+        if (job.release != NULL) job.release(job.data);
+    }
+    timers.clear();
+    timers.shrink_to_fit();
+    microtasks.clear();
+    if (jobQueue != NULL) {
+        vQueueDelete(jobQueue);
+        jobQueue = NULL;
+    }
+}
+
+#endif
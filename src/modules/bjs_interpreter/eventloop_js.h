@@ -0,0 +1,41 @@
+#if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
+#ifndef __EVENTLOOP_JS_H__
+#define __EVENTLOOP_JS_H__
+
+#include <Arduino.h>
+#include <duktape.h>
+
+// Result of a background operation, posted by a worker task back to the interpreter task.
+// `push` runs on the interpreter task and pushes the callback arguments, returning how many.
+// `release` frees `data`, it is also called when the loop is torn down before dispatching.
+struct JsLoopJob {
+    uint32_t callbackId;
+    duk_idx_t (*push)(duk_context *ctx, void *data);
+    void (*release)(void *data);
+    void *data;
+};
+
+duk_ret_t registerEventLoop(duk_context *ctx);
+
+void jsEventLoopBegin(duk_context *ctx);
+void jsEventLoopRun(duk_context *ctx);
+void jsEventLoopEnd(duk_context *ctx);
+
+// Stores the function at `idx` so it survives until the job completes, returns its id.
+uint32_t jsEventLoopRetainCallback(duk_context *ctx, duk_idx_t idx);
+// Runs `fn(arg)` in a new task, the task must call jsEventLoopPost() exactly once before returning.
+bool jsEventLoopSpawn(const char *name, TaskFunction_t fn, void *arg, uint32_t stackSize = 4096);
+// Thread safe, may be called from any task.
+bool jsEventLoopPost(const JsLoopJob &job);
+
+// Helpers for workers that only produce a string or an error message
+void jsEventLoopPostString(uint32_t callbackId, const String &result);
+void jsEventLoopPostError(uint32_t callbackId, const String &error);
+
+duk_ret_t native_setTimeout(duk_context *ctx);
+duk_ret_t native_setInterval(duk_context *ctx);
+duk_ret_t native_clearTimer(duk_context *ctx);
+duk_ret_t native_queueMicrotask(duk_context *ctx);
+
+#endif
+#endif
@@ -44,6 +44,7 @@ void interpreterHandler(void *pvParameters) {
 
     // Init containers
     clearDisplayModuleData();
+    jsEventLoopBegin(ctx);
 
     registerConsole(ctx);
 
@@ -59,6 +60,7 @@ void interpreterHandler(void *pvParameters) {
     bduk_register_c_lightfunc(ctx, "load", native_load, 1);
     registerGlobals(ctx);
     registerMath(ctx);
+    registerEventLoop(ctx);
 
     // registerAudio(ctx);
     // registerBadUSB(ctx);
@@ -145,6 +147,8 @@ void interpreterHandler(void *pvParameters) {
         } else {
             printf("Script ran succesfully");
         }
+        // Keep running while there are pending timers or background jobs
+        jsEventLoopRun(ctx);
     }
     free((char *)script);
     script = NULL;
@@ -155,9 +159,11 @@ void interpreterHandler(void *pvParameters) {
     duk_pop(ctx);
 
     // Clean up.
+    jsEventLoopEnd(ctx);
     duk_destroy_heap(ctx);
 
     clearDisplayModuleData();
+    clearLoraModuleData();
 
     // delay(1000);
     interpreter_start = false;
@@ -302,6 +308,8 @@ duk_ret_t native_require(duk_context *ctx) {
         putPropIRFunctions(ctx, obj_idx, 0);
     } else if (filepath == "keyboard" || filepath == "input") {
         putPropKeyboardFunctions(ctx, obj_idx, 0);
+    } else if (filepath == "lora") {
+        putPropLoraFunctions(ctx, obj_idx, 0);
     } else if (filepath == "math") {
         putPropMathFunctions(ctx, obj_idx, 0);
     } else if (filepath == "notification") {
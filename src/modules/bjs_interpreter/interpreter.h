@@ -16,12 +16,14 @@ extern char *scriptName;
 #include "device_js.h"
 #include "dialog_js.h"
 #include "display_js.h"
+#include "eventloop_js.h"
 #include "globals_js.h"
 #include "gpio_js.h"
 #include "helpers_js.h"
 #include "i2c_js.h"
 #include "ir_js.h"
 #include "keyboard_js.h"
+#include "lora_js.h"
 #include "math_js.h"
 #include "notification_js.h"
 #include "serial_js.h"
@@ -0,0 +1,159 @@
+#if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
+#include "lora_js.h"
+
+#include "modules/lora/lora_service.h"
+
+#include "eventloop_js.h"
+#include "helpers_js.h"
+
+// Messages for the script from begin() until it stops, read() and readAsync() take them in order
+static QueueHandle_t scriptQueue = NULL;
+static bool scriptStartedRadio = false;
+
+struct LoraReadJob {
+    uint32_t callbackId;
+    uint32_t timeout;
+};
+
+void clearLoraModuleData() {
+    if (scriptStartedRadio) loraService.end();
+    scriptStartedRadio = false;
+    loraService.unsubscribe(scriptQueue);
+    scriptQueue = NULL;
+}
+
+duk_ret_t putPropLoraFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "begin", native_loraBegin, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "end", native_loraEnd, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "send", native_loraSend, 1, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_loraRead, 1, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readAsync", native_loraReadAsync, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "history", native_loraHistory, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "historySize", native_loraHistorySize, 0, magic);
+    return 0;
+}
+
+duk_ret_t registerLora(duk_context *ctx) {
+    bduk_register_c_lightfunc(ctx, "loraBegin", native_loraBegin, 0);
+    bduk_register_c_lightfunc(ctx, "loraSend", native_loraSend, 1);
+    bduk_register_c_lightfunc(ctx, "loraRead", native_loraRead, 1);
+    return 0;
+}
+
+static void pushMessage(duk_context *ctx, const LoraMessage &message) {
+    duk_idx_t obj_idx = duk_push_object(ctx);
+    bduk_put_prop(ctx, obj_idx, "text", duk_push_string, message.text);
+    bduk_put_prop(ctx, obj_idx, "rssi", duk_push_number, message.rssi);
+    bduk_put_prop(ctx, obj_idx, "snr", duk_push_number, message.snr);
+    bduk_put_prop(ctx, obj_idx, "time", duk_push_uint, message.time);
+    bduk_put_prop(ctx, obj_idx, "outgoing", duk_push_boolean, message.outgoing != 0);
+}
+
+duk_ret_t native_loraBegin(duk_context *ctx) {
+    // usage: begin();
+    // returns: bool==true once the radio listens, with the settings of the LoRa menu
+    if (!loraService.running()) {
+        if (!loraService.begin()) {
+            duk_push_boolean(ctx, false);
+            return 1;
+        }
+        scriptStartedRadio = true;
+    }
+    if (scriptQueue == NULL) scriptQueue = loraService.subscribe(8);
+    duk_push_boolean(ctx, scriptQueue != NULL);
+    return 1;
+}
+
+duk_ret_t native_loraEnd(duk_context *ctx) {
+    // usage: end();
+    // messages already received can still be read
+    if (scriptStartedRadio) loraService.end();
+    scriptStartedRadio = false;
+    return 0;
+}
+
+duk_ret_t native_loraSend(duk_context *ctx) {
+    // usage: send(text : string);
+    // returns: bool==true when it was transmitted, blocks while transmitting
+    duk_push_boolean(ctx, loraService.send(String(duk_to_string(ctx, 0))));
+    return 1;
+}
+
+duk_ret_t native_loraRead(duk_context *ctx) {
+    // usage: read();
+    // usage: read(timeout_in_ms : number);
+    // returns: { text, rssi, snr, time, outgoing } or null when nothing came in time
+    // sent messages are delivered too, with outgoing==true
+    LoraMessage message;
+    TickType_t wait = pdMS_TO_TICKS(duk_get_uint_default(ctx, 0, 0));
+    if (scriptQueue == NULL || xQueueReceive(scriptQueue, &message, wait) != pdTRUE) {
+        duk_push_null(ctx);
+        return 1;
+    }
+    pushMessage(ctx, message);
+    return 1;
+}
+
+static duk_idx_t pushMessageResult(duk_context *ctx, void *data) {
+    duk_push_null(ctx);
+    if (data) pushMessage(ctx, *(LoraMessage *)data);
+    else duk_push_null(ctx);
+    return 2;
+}
+
+static void releaseMessage(void *data) { delete (LoraMessage *)data; }
+
+static void loraReadWorker(void *pvParameters) {
+    LoraReadJob *job = (LoraReadJob *)pvParameters;
+    LoraMessage *message = new LoraMessage;
+    if (xQueueReceive(scriptQueue, message, pdMS_TO_TICKS(job->timeout)) != pdTRUE) {
+        delete message;
+        message = nullptr;
+    }
+    jsEventLoopPost({job->callbackId, pushMessageResult, releaseMessage, message});
+    delete job;
+}
+
+duk_ret_t native_loraReadAsync(duk_context *ctx) {
+    // usage: readAsync(callback : function(err, message));
+    // usage: readAsync(timeout_in_ms : number, callback : function(err, message));
+    // message is what read() returns, null on timeout
+    duk_idx_t cb_idx = duk_get_top(ctx) - 1;
+    if (cb_idx < 0 || !duk_is_function(ctx, cb_idx)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function", "readAsync");
+    }
+    if (scriptQueue == NULL) {
+        return duk_error(ctx, DUK_ERR_ERROR, "%s: call begin() first", "readAsync");
+    }
+    LoraReadJob *job = new LoraReadJob;
+    job->timeout = (cb_idx > 0 && duk_is_number(ctx, 0)) ? duk_to_uint32(ctx, 0) : 10000;
+    job->callbackId = jsEventLoopRetainCallback(ctx, cb_idx);
+    if (!jsEventLoopSpawn("jsLoraRead", loraReadWorker, job)) {
+        delete job;
+        return duk_error(ctx, DUK_ERR_ERROR, "%s: could not start task", "readAsync");
+    }
+    return 0;
+}
+
+duk_ret_t native_loraHistory(duk_context *ctx) {
+    // usage: history(first : number, count : number);
+    // returns: array of messages, index 0 is the oldest kept
+    uint32_t first = duk_get_uint_default(ctx, 0, 0);
+    uint32_t count = min<uint32_t>(duk_get_uint_default(ctx, 1, 10), LORA_HISTORY_SIZE);
+    duk_idx_t arr_idx = duk_push_array(ctx);
+    LoraMessage message;
+    for (uint32_t i = 0; i < count; i++) {
+        if (loraService.readHistory(first + i, &message, 1) == 0) break;
+        pushMessage(ctx, message);
+        duk_put_prop_index(ctx, arr_idx, i);
+    }
+    return 1;
+}
+
+duk_ret_t native_loraHistorySize(duk_context *ctx) {
+    // usage: historySize();
+    duk_push_uint(ctx, loraService.historySize());
+    return 1;
+}
+
+#endif
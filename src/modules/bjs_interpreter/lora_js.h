@@ -0,0 +1,21 @@
+#if !defined(LITE_VERSION) && !defined(DISABLE_INTERPRETER)
+#ifndef __LORA_JS_H__
+#define __LORA_JS_H__
+
+#include <duktape.h>
+
+void clearLoraModuleData();
+
+duk_ret_t putPropLoraFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic);
+duk_ret_t registerLora(duk_context *ctx);
+
+duk_ret_t native_loraBegin(duk_context *ctx);
+duk_ret_t native_loraEnd(duk_context *ctx);
+duk_ret_t native_loraSend(duk_context *ctx);
+duk_ret_t native_loraRead(duk_context *ctx);
+duk_ret_t native_loraReadAsync(duk_context *ctx);
+duk_ret_t native_loraHistory(duk_context *ctx);
+duk_ret_t native_loraHistorySize(duk_context *ctx);
+
+#endif
+#endif
@@ -2,6 +2,7 @@
 #include "serial_js.h"
 
 #include "display_js.h"
+#include "eventloop_js.h"
 
 #include "helpers_js.h"
 
@@ -9,6 +10,7 @@ duk_ret_t putPropSerialFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t ma
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "print", native_serialPrint, DUK_VARARGS, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "println", native_serialPrintln, DUK_VARARGS, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "readln", native_serialReadln, 1, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readlnAsync", native_serialReadlnAsync, 2, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "cmd", native_serialCmd, 1, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_serialPrint, DUK_VARARGS, magic);
     return 0;
@@ -61,6 +63,44 @@ duk_ret_t native_serialReadln(duk_context *ctx) {
     return 1;
 }
 
+struct SerialReadlnJob {
+    uint32_t callbackId;
+    uint32_t timeoutMs;
+};
+
+static void serialReadlnWorker(void *pvParameters) {
+    SerialReadlnJob *job = (SerialReadlnJob *)pvParameters;
+    String line = "";
+    uint32_t start = millis();
+    while (millis() - start < job->timeoutMs) {
+        if (Serial.available()) {
+            line = Serial.readStringUntil('\n');
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    jsEventLoopPostString(job->callbackId, line);
+    delete job;
+}
+
+duk_ret_t native_serialReadlnAsync(duk_context *ctx) {
+    // usage: serial.readlnAsync(callback : function(err, line));  // default to 10s timeout
+    // usage: serial.readlnAsync(timeout_in_ms : number, callback : function(err, line));
+    // the callback receives an empty string on timeout
+    duk_idx_t cb_idx = duk_get_top(ctx) - 1;
+    if (cb_idx < 0 || !duk_is_function(ctx, cb_idx)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function", "readlnAsync");
+    }
+    SerialReadlnJob *job = new SerialReadlnJob;
+    job->timeoutMs = (cb_idx > 0 && duk_is_number(ctx, 0)) ? duk_to_uint32(ctx, 0) : 1000 * 10;
+    job->callbackId = jsEventLoopRetainCallback(ctx, cb_idx);
+    if (!jsEventLoopSpawn("jsSerialReadln", serialReadlnWorker, job)) {
+        delete job;
+        return duk_error(ctx, DUK_ERR_ERROR, "%s: could not start task", "readlnAsync");
+    }
+    return 0;
+}
+
 duk_ret_t native_serialCmd(duk_context *ctx) {
     bool r = serialCli.parse(String(duk_to_string(ctx, 0)));
     duk_push_boolean(ctx, r);
@@ -11,6 +11,7 @@ void registerConsole(duk_context *ctx);
 duk_ret_t native_serialPrint(duk_context *ctx);
 duk_ret_t native_serialPrintln(duk_context *ctx);
 duk_ret_t native_serialReadln(duk_context *ctx);
+duk_ret_t native_serialReadlnAsync(duk_context *ctx);
 duk_ret_t native_serialCmd(duk_context *ctx);
 
 #endif
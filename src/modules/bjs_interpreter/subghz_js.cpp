@@ -3,6 +3,7 @@
 
 #include "modules/rf/rf_scan.h"
 
+#include "eventloop_js.h"
 #include "helpers_js.h"
 
 duk_ret_t putPropSubGHzFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magic) {
@@ -10,6 +11,8 @@ duk_ret_t putPropSubGHzFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t ma
     // TODO: getFrequency
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_subghzRead, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRaw", native_subghzReadRaw, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readAsync", native_subghzReadAsync, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRawAsync", native_subghzReadAsync, 2, 1);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmitFile", native_subghzTransmitFile, 1, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmit", native_subghzTransmit, 4, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "setup", native_noop, 0, magic);
@@ -79,6 +82,41 @@ duk_ret_t native_subghzReadRaw(duk_context *ctx) {
     return 1;
 }
 
+struct SubGHzReadJob {
+    uint32_t callbackId;
+    float frequency;
+    int timeout;
+    bool raw;
+};
+
+static void subghzReadWorker(void *pvParameters) {
+    SubGHzReadJob *job = (SubGHzReadJob *)pvParameters;
+    String r = RCSwitch_Read(job->frequency, job->timeout, job->raw);
+    jsEventLoopPostString(job->callbackId, r);
+    delete job;
+}
+
+duk_ret_t native_subghzReadAsync(duk_context *ctx) {
+    // usage: subghz.readAsync(callback : function(err, result));
+    // usage: subghz.readAsync(timeout_in_seconds : number, callback : function(err, result));
+    // usage: subghz.readRawAsync(...) same as above
+    // the callback receives the same string subghzRead() would return
+    duk_idx_t cb_idx = duk_get_top(ctx) - 1;
+    if (cb_idx < 0 || !duk_is_function(ctx, cb_idx)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function", "readAsync");
+    }
+    SubGHzReadJob *job = new SubGHzReadJob;
+    job->frequency = bruceConfigPins.rfFreq;
+    job->timeout = (cb_idx > 0 && duk_is_number(ctx, 0)) ? duk_to_int(ctx, 0) : 10;
+    job->raw = duk_get_current_magic(ctx) == 1;
+    job->callbackId = jsEventLoopRetainCallback(ctx, cb_idx);
+    if (!jsEventLoopSpawn("jsSubghzRead", subghzReadWorker, job, 8192)) {
+        delete job;
+        return duk_error(ctx, DUK_ERR_ERROR, "%s: could not start task", "readAsync");
+    }
+    return 0;
+}
+
 duk_ret_t native_subghzSetFrequency(duk_context *ctx) {
     // usage: subghzSetFrequency(freq_as_float);
     if (duk_is_number(ctx, 0)) bruceConfigPins.rfFreq = duk_to_number(ctx, 0); // float global var
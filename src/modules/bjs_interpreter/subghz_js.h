@@ -11,6 +11,7 @@ duk_ret_t native_subghzTransmitFile(duk_context *ctx);
 duk_ret_t native_subghzTransmit(duk_context *ctx);
 duk_ret_t native_subghzRead(duk_context *ctx);
 duk_ret_t native_subghzReadRaw(duk_context *ctx);
+duk_ret_t native_subghzReadAsync(duk_context *ctx);
 duk_ret_t native_subghzSetFrequency(duk_context *ctx);
 
 #endif
@@ -2,6 +2,7 @@
 #include "wifi_js.h"
 
 #include "core/wifi/wifi_common.h"
+#include "eventloop_js.h"
 #include "helpers_js.h"
 #include <HTTPClient.h>
 #include <WiFi.h>
@@ -12,7 +13,9 @@ duk_ret_t putPropWiFiFunctions(duk_context *ctx, duk_idx_t obj_idx, uint8_t magi
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "connectDialog", native_wifiConnectDialog, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "disconnect", native_wifiDisconnect, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "scan", native_wifiScan, 0, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "scanAsync", native_wifiScanAsync, 1, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "httpFetch", native_httpFetch, 2, magic);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "httpFetchAsync", native_httpFetchAsync, 3, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "getMACAddress", native_wifiMACAddress, 0, magic);
     bduk_put_prop_c_lightfunc(ctx, obj_idx, "getIPAddress", native_ipAddress, 0, magic);
     return 0;
@@ -117,6 +120,62 @@ duk_ret_t native_wifiScan(duk_context *ctx) {
     return 1;
 }
 
+struct WiFiScanEntry {
+    String ssid;
+    String mac;
+    const char *encryptionType;
+};
+
+struct WiFiScanJob {
+    uint32_t callbackId;
+    std::vector<WiFiScanEntry> entries;
+};
+
+static duk_idx_t pushWiFiScanResult(duk_context *ctx, void *data) {
+    WiFiScanJob *job = (WiFiScanJob *)data;
+    duk_push_null(ctx);
+    duk_idx_t arr_idx = duk_push_array(ctx);
+    for (size_t i = 0; i < job->entries.size(); i++) {
+        duk_idx_t obj_idx = duk_push_object(ctx);
+        bduk_put_prop(ctx, obj_idx, "encryptionType", duk_push_string, job->entries[i].encryptionType);
+        bduk_put_prop(ctx, obj_idx, "SSID", duk_push_string, job->entries[i].ssid.c_str());
+        bduk_put_prop(ctx, obj_idx, "MAC", duk_push_string, job->entries[i].mac.c_str());
+        duk_put_prop_index(ctx, arr_idx, i);
+    }
+    return 2;
+}
+
+static void releaseWiFiScanJob(void *data) { delete (WiFiScanJob *)data; }
+
+static void wifiScanWorker(void *pvParameters) {
+    WiFiScanJob *job = (WiFiScanJob *)pvParameters;
+    WiFi.mode(WIFI_MODE_STA);
+    int nets = WiFi.scanNetworks();
+    for (int i = 0; i < nets; i++) {
+        int enctypeInt = int(WiFi.encryptionType(i));
+        job->entries.push_back(
+            {WiFi.SSID(i), WiFi.BSSIDstr(i), enctypeInt < 12 ? wifi_enc_types[enctypeInt] : "UNKNOWN"}
+        );
+    }
+    WiFi.scanDelete();
+    jsEventLoopPost({job->callbackId, pushWiFiScanResult, releaseWiFiScanJob, job});
+}
+
+duk_ret_t native_wifiScanAsync(duk_context *ctx) {
+    // usage: wifi.scanAsync(callback : function(err, networks));
+    // networks has the same format as wifi.scan()
+    if (!duk_is_function(ctx, 0)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function", "scanAsync");
+    }
+    WiFiScanJob *job = new WiFiScanJob;
+    job->callbackId = jsEventLoopRetainCallback(ctx, 0);
+    if (!jsEventLoopSpawn("jsWifiScan", wifiScanWorker, job)) {
+        delete job;
+        return duk_error(ctx, DUK_ERR_ERROR, "%s: could not start task", "scanAsync");
+    }
+    return 0;
+}
+
 duk_ret_t native_wifiDisconnect(duk_context *ctx) {
     wifiDisconnect();
     return 0;
@@ -363,6 +422,125 @@ duk_ret_t native_httpFetch(duk_context *ctx) {
     return 1;
 }
 
+struct HttpFetchJob {
+    uint32_t callbackId;
+    String url;
+    String method;
+    String body;
+    std::vector<std::pair<String, String>> requestHeaders;
+    std::vector<std::pair<String, String>> responseHeaders;
+    int status;
+    String response;
+};
+
+static duk_idx_t pushHttpFetchResult(duk_context *ctx, void *data) {
+    HttpFetchJob *job = (HttpFetchJob *)data;
+    if (job->status <= 0) {
+        duk_push_error_object(ctx, DUK_ERR_ERROR, "%s", job->response.c_str());
+        return 1;
+    }
+    duk_push_null(ctx);
+    duk_idx_t obj_idx = duk_push_object(ctx);
+    bduk_put_prop(ctx, obj_idx, "body", duk_push_string, job->response.c_str());
+    bduk_put_prop(ctx, obj_idx, "response", duk_push_int, job->status);
+    bduk_put_prop(ctx, obj_idx, "status", duk_push_int, job->status);
+    bduk_put_prop(ctx, obj_idx, "ok", duk_push_boolean, job->status >= 200 && job->status < 300);
+    duk_idx_t headers_idx = duk_push_object(ctx);
+    for (auto &header : job->responseHeaders) {
+        bduk_put_prop(ctx, headers_idx, header.first.c_str(), duk_push_string, header.second.c_str());
+    }
+    duk_put_prop_string(ctx, obj_idx, "headers");
+    return 2;
+}
+
+static void releaseHttpFetchJob(void *data) { delete (HttpFetchJob *)data; }
+
+static void httpFetchWorker(void *pvParameters) {
+    HttpFetchJob *job = (HttpFetchJob *)pvParameters;
+    job->status = 0;
+
+    if (WiFi.status() != WL_CONNECTED) {
+        job->response = "WIFI Not Connected";
+    } else {
+        HTTPClient http;
+        http.setReuse(false);
+        http.begin(job->url);
+        for (auto &header : job->requestHeaders) http.addHeader(header.first, header.second);
+
+        const char *headersKeys[] = {
+            "Content-Type", "Content-Length", "Transfer-Encoding", "Connection", "Cache-Control", "Date", "Server"
+        };
+        http.collectHeaders(headersKeys, 7);
+
+        job->status = http.sendRequest(job->method.c_str(), (uint8_t *)job->body.c_str(), job->body.length());
+        if (job->status <= 0) {
+            job->response = http.errorToString(job->status);
+        } else {
+            job->response = http.getString(); // handles chunked transfer encoding
+            for (size_t i = 0; i < http.headers(); i++) {
+                job->responseHeaders.push_back({http.headerName(i), http.header(i)});
+            }
+        }
+        http.end();
+    }
+    jsEventLoopPost({job->callbackId, pushHttpFetchResult, releaseHttpFetchJob, job});
+}
+
+duk_ret_t native_httpFetchAsync(duk_context *ctx) {
+    // usage: wifi.httpFetchAsync(url : string, callback : function(err, response));
+    // usage: wifi.httpFetchAsync(url : string, options : {method, body, headers}, callback);
+    // response has the same format as httpFetch(), body is always a string
+    duk_idx_t cb_idx = duk_get_top(ctx) - 1;
+    if (cb_idx < 1 || !duk_is_function(ctx, cb_idx)) {
+        return duk_error(ctx, DUK_ERR_TYPE_ERROR, "%s: callback must be a function", "httpFetchAsync");
+    }
+
+    HttpFetchJob *job = new HttpFetchJob;
+    job->url = duk_to_string(ctx, 0);
+    job->method = "GET";
+
+    if (cb_idx > 1 && duk_is_object(ctx, 1)) {
+        if (duk_get_prop_string(ctx, 1, "method")) job->method = duk_get_string_default(ctx, -1, "GET");
+        duk_pop(ctx);
+
+        if (duk_get_prop_string(ctx, 1, "body")) {
+            if (duk_is_object(ctx, -1)) duk_json_encode(ctx, -1);
+            job->body = duk_to_string(ctx, -1);
+        }
+        duk_pop(ctx);
+
+        if (duk_get_prop_string(ctx, 1, "headers") && duk_is_object(ctx, -1)) {
+            bool headersIsArray = duk_is_array(ctx, -1);
+            duk_enum(ctx, -1, headersIsArray ? DUK_ENUM_ARRAY_INDICES_ONLY : 0);
+            while (duk_next(ctx, -1, 1)) {
+                if (!headersIsArray) {
+                    job->requestHeaders.push_back({duk_to_string(ctx, -2), duk_to_string(ctx, -1)});
+                } else if (duk_is_array(ctx, -1)) { // [[key, value], ...]
+                    duk_get_prop_index(ctx, -1, 0);
+                    duk_get_prop_index(ctx, -2, 1);
+                    job->requestHeaders.push_back({duk_to_string(ctx, -2), duk_to_string(ctx, -1)});
+                    duk_pop_2(ctx);
+                } else { // [key, value, key, value, ...]
+                    String key = duk_to_string(ctx, -1);
+                    duk_pop_2(ctx);
+                    if (!duk_next(ctx, -1, 1)) break;
+                    job->requestHeaders.push_back({key, duk_to_string(ctx, -1)});
+                }
+                duk_pop_2(ctx);
+            }
+            duk_pop(ctx); // enum
+        }
+        duk_pop(ctx);
+    }
+
+    job->callbackId = jsEventLoopRetainCallback(ctx, cb_idx);
+    if (!jsEventLoopSpawn("jsHttpFetch", httpFetchWorker, job, 8192)) {
+        delete job;
+        return duk_error(ctx, DUK_ERR_ERROR, "%s: could not start task", "httpFetchAsync");
+    }
+    return 0;
+}
+
 duk_ret_t native_wifiMACAddress(duk_context *ctx) {
     String macAddress = WiFi.macAddress();
     duk_push_string(ctx, macAddress.c_str());
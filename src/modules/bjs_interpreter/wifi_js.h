@@ -13,6 +13,8 @@ duk_ret_t native_wifiConnect(duk_context *ctx);
 duk_ret_t native_wifiScan(duk_context *ctx);
 duk_ret_t native_wifiDisconnect(duk_context *ctx);
 duk_ret_t native_httpFetch(duk_context *ctx);
+duk_ret_t native_httpFetchAsync(duk_context *ctx);
+duk_ret_t native_wifiScanAsync(duk_context *ctx);
 duk_ret_t native_wifiMACAddress(duk_context *ctx);
 duk_ret_t native_ipAddress(duk_context *ctx);
 
@@ -29,7 +29,11 @@ void BLE_API::setup() {
 
     battery_service.setup(pServer);
     serial_service.setup(pServer);
-    serialDevice = &serial_service;
+    // The command reader and the screen mirror go through USBserial, it talks to the BLE stream
+    // until end()
+    usbOutput = USBserial.getSerialOutput();
+    USBserial.setSerialOutput(serial_service.getStream());
+    serialDevice = &USBserial;
 
     BLEAdvertising *pAdvertising = pServer->getAdvertising();
     pAdvertising->enableScanResponse(false); // Save some battery
@@ -43,6 +47,10 @@ void BLE_API::update_mtu(uint16_t mtu) {
 }
 
 void BLE_API::end() {
+    // Before the BLE stream buffers are freed
+    USBserial.setSerialOutput(usbOutput ? usbOutput : &Serial);
+    usbOutput = nullptr;
+    serialDevice = &USBserial;
     battery_service.end();
     serial_service.end();
 #if defined(CONFIG_IDF_TARGET_ESP32C5)
@@ -50,6 +58,5 @@ void BLE_API::end() {
 #else
     BLEDevice::deinit();
 #endif
-    serialDevice = &USBserial;
 }
 #endif
@@ -15,6 +15,7 @@ private:
     NimBLEServer *pServer;
     BatteryService battery_service;
     BLESerialService serial_service;
+    Stream *usbOutput = nullptr; // USBserial output to restore on end
 };
 #endif
 #endif // BLE_API_HPP
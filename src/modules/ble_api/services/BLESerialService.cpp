@@ -2,103 +2,246 @@
 #include "BLESerialService.h"
 #include <NimBLEDevice.h>
 
+#define BLE_SERIAL_ATT_HEADER 3         // opcode + handle, the rest of the MTU is payload
+#define BLE_SERIAL_MAX_PAYLOAD 512      // largest ATT value
+#define BLE_SERIAL_STATUS_TIMEOUT_MS 50 // fallback if the stack never reports the notification
+#define BLE_SERIAL_WRITE_TIMEOUT_MS 500 // how long a writer waits for room in the TX ring
+
 BLESerialService::BLESerialService() : BruceBLEService() {}
 
 BLESerialService::~BLESerialService() {}
 
-static bool newValue = false;
-
 class BLESerialCallbacks : public NimBLECharacteristicCallbacks {
+    BLESerialStream *stream;
+
+public:
+    BLESerialCallbacks(BLESerialStream *s) : stream(s) {}
+
     void onWrite(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo) override {
-        newValue = true;
+        NimBLEAttValue value = pCharacteristic->getValue();
+        stream->onReceive(value.data(), value.size());
+    }
+    void onStatus(NimBLECharacteristic *pCharacteristic, int code) override { stream->onNotifyStatus(code); }
+    void onSubscribe(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo, uint16_t subValue)
+        override {
+        stream->setSubscribed(subValue != 0);
     }
 };
 
-void BLESerialService::setup(NimBLEServer *pServer) {
-    pService = pServer->createService("4371ec0b-3d43-49f9-b731-7c72a4a7bb91");
-
-    serial_char = pService->createCharacteristic(
-        "d555ed97-bf2a-4f46-b3eb-d1fcdd7325e9", // Battery Level
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::WRITE
-    );
-
-    callbacks = new BLESerialCallbacks();
-    serial_char->setCallbacks(callbacks);
+/*********************************************************************
+**  BLESerialStream
+*********************************************************************/
+bool BLESerialStream::begin(NimBLECharacteristic *characteristic) {
+    serial_char = characteristic;
+    stopping = false;
+    subscribed = false;
+    peeked = -1;
+    txBuffer = xStreamBufferCreate(BLE_SERIAL_TX_BUFFER_SIZE, 1);
+    rxBuffer = xStreamBufferCreate(BLE_SERIAL_RX_BUFFER_SIZE, 1);
+    txLock = xSemaphoreCreateMutex();
+    txDone = xSemaphoreCreateBinary();
+    if (!txBuffer || !rxBuffer || !txLock || !txDone ||
+        xTaskCreate(txTaskFn, "ble_serial_tx", 3072, this, 2, &txTask) != pdPASS) {
+        txTask = NULL;
+        end();
+        return false;
+    }
+    return true;
+}
 
-    pService->start();
-    pServer->getAdvertising()->addServiceUUID(pService->getUUID());
+void BLESerialStream::end() {
+    if (txTask != NULL) {
+        // Let the sender finish the notification in flight, then stop it
+        stopping = true;
+        xTaskNotifyGive(txTask);
+        while (stopping) vTaskDelay(pdMS_TO_TICKS(5));
+        txTask = NULL;
+    }
+    if (txBuffer) vStreamBufferDelete(txBuffer);
+    if (rxBuffer) vStreamBufferDelete(rxBuffer);
+    if (txLock) vSemaphoreDelete(txLock);
+    if (txDone) vSemaphoreDelete(txDone);
+    txBuffer = rxBuffer = NULL;
+    txLock = txDone = NULL;
+    serial_char = nullptr;
+    subscribed = false;
 }
 
-void BLESerialService::end() { delete callbacks; }
+void BLESerialStream::setSubscribed(bool value) {
+    // Called from the NimBLE host task, the sender does the cleanup
+    subscribed = value;
+    if (txTask) xTaskNotifyGive(txTask);
+}
 
-int BLESerialService::available() {
-    if (!newValue) return 0;
-    newValue = false;
+void BLESerialStream::onNotifyStatus(int code) {
+    // Any status means the stack is done with the previous notification (sent or failed)
+    if (txDone) xSemaphoreGive(txDone);
+}
 
-    return serial_char->getValue().size();
+void BLESerialStream::onReceive(const uint8_t *data, size_t len) {
+    // Runs on the NimBLE host task, never block it
+    if (!rxBuffer || len == 0) return;
+    size_t sent = xStreamBufferSend(rxBuffer, data, len, 0);
+    if (sent < len) log_w("BLE serial RX overflow, dropped %u bytes", (unsigned)(len - sent));
 }
 
-size_t BLESerialService::println(const String &s) {
-    String toSend = s + "\r\n";
-    serial_char->notify(toSend);
-    vTaskDelay(pdMS_TO_TICKS(10)); // Add some delay to ensure data is read by the client
-    return toSend.length();
+void BLESerialStream::txTaskFn(void *pvParameters) {
+    BLESerialStream *self = (BLESerialStream *)pvParameters;
+    uint8_t chunk[BLE_SERIAL_MAX_PAYLOAD];
+
+    while (!self->stopping) {
+        if (!self->subscribed) {
+            // Nobody is listening, drop what was queued so writers don't block on a full ring
+            xStreamBufferReset(self->txBuffer);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (xStreamBufferIsEmpty(self->txBuffer)) {
+            // Woken by write(), a subscription change or end()
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        size_t payload = self->mtu > BLE_SERIAL_ATT_HEADER ? self->mtu - BLE_SERIAL_ATT_HEADER : 20;
+        if (payload > sizeof(chunk)) payload = sizeof(chunk);
+        size_t len = xStreamBufferReceive(self->txBuffer, chunk, payload, 0);
+        if (len == 0) continue;
+
+        xSemaphoreTake(self->txDone, 0); // discard a stale status
+        int retries = 0;
+        while (!self->serial_char->notify(chunk, len) && !self->stopping && self->subscribed) {
+            // Controller buffers are full (congestion), back off until one is released
+            if (++retries > 20) break;
+            xSemaphoreTake(self->txDone, pdMS_TO_TICKS(BLE_SERIAL_STATUS_TIMEOUT_MS));
+        }
+        xSemaphoreTake(self->txDone, pdMS_TO_TICKS(BLE_SERIAL_STATUS_TIMEOUT_MS));
+    }
+    self->stopping = false;
+    vTaskDelete(NULL);
 }
 
-size_t BLESerialService::print(const String &s) {
-    serial_char->notify(s);
-    vTaskDelay(pdMS_TO_TICKS(10));
-    return s.length();
+size_t BLESerialStream::write(const uint8_t *buffer, size_t size) {
+    if (!txBuffer || !subscribed || size == 0) return 0;
+    size_t written = 0;
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    while (written < size && subscribed) {
+        size_t n = xStreamBufferSend(
+            txBuffer, buffer + written, size - written, pdMS_TO_TICKS(BLE_SERIAL_WRITE_TIMEOUT_MS)
+        );
+        xTaskNotifyGive(txTask);
+        if (n == 0) break; // client stopped reading, drop the rest
+        written += n;
+    }
+    xSemaphoreGive(txLock);
+    return written;
 }
 
-size_t BLESerialService::println(size_t n) {
-    String s = String(n);
-    return println(s);
+int BLESerialStream::availableForWrite() {
+    return txBuffer ? xStreamBufferSpacesAvailable(txBuffer) : 0;
 }
 
-void BLESerialService::vprintf(const char *fmt, va_list args) {
-    int size = sprintf(nullptr, fmt, args);
-    char str[BUFFER_SIZE];
-    sprintf(str, fmt, args);
+void BLESerialStream::flush() {
+    // Wait until the sender emptied the TX ring
+    uint32_t start = millis();
+    while (txBuffer && subscribed && !xStreamBufferIsEmpty(txBuffer) &&
+           millis() - start < BLE_SERIAL_WRITE_TIMEOUT_MS * 4) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
 
-    serial_char->notify(reinterpret_cast<const uint8_t *>(str), size);
-    vTaskDelay(pdMS_TO_TICKS(10));
+int BLESerialStream::available() {
+    if (!rxBuffer) return 0;
+    return xStreamBufferBytesAvailable(rxBuffer) + (peeked >= 0 ? 1 : 0);
 }
 
-String BLESerialService::readStringUntil(char terminator) {
-    Serial.println("readStringUntil");
-    String result = "";
-    std::string value = serial_char->getValue();
-    for (char c : value) {
-        result += c;
-        if (c == terminator) break;
+int BLESerialStream::read() {
+    if (peeked >= 0) {
+        int c = peeked;
+        peeked = -1;
+        return c;
     }
-    return result;
+    uint8_t c;
+    if (!rxBuffer || xStreamBufferReceive(rxBuffer, &c, 1, 0) != 1) return -1;
+    return c;
 }
 
-size_t BLESerialService::println(const uint32_t n) {
-    String s = String(n);
-    return println(s);
+int BLESerialStream::peek() {
+    if (peeked < 0) peeked = read();
+    return peeked;
 }
 
-size_t BLESerialService::print(const int n, int format) {
-    String s = String(n, format);
-    return print(s);
+/*********************************************************************
+**  BLESerialService
+*********************************************************************/
+void BLESerialService::setup(NimBLEServer *pServer) {
+    pService = pServer->createService("4371ec0b-3d43-49f9-b731-7c72a4a7bb91");
+
+    serial_char = pService->createCharacteristic(
+        "d555ed97-bf2a-4f46-b3eb-d1fcdd7325e9",
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::WRITE |
+            NIMBLE_PROPERTY::WRITE_NR
+    );
+
+    callbacks = new BLESerialCallbacks(&stream);
+    serial_char->setCallbacks(callbacks);
+    stream.setMTU(mtu);
+    if (!stream.begin(serial_char)) log_e("BLE serial: could not allocate buffers");
+
+    pService->start();
+    pServer->getAdvertising()->addServiceUUID(pService->getUUID());
 }
 
-size_t BLESerialService::println(const int n, int format) {
-    String s = String(n, format);
-    return println(s);
+void BLESerialService::end() {
+    stream.end();
+    if (serial_char) serial_char->setCallbacks(nullptr);
+    delete callbacks;
+    callbacks = nullptr;
 }
 
-size_t BLESerialService::println() { return println(""); }
+int BLESerialService::available() { return stream.available(); }
+
+// Reads across packets until the terminator, using the Stream timeout
+String BLESerialService::readStringUntil(char terminator) { return stream.readStringUntil(terminator); }
+
+size_t BLESerialService::println(const String &s) { return stream.println(s); }
 
-size_t BLESerialService::write(uint8_t *str, size_t size) {
-    serial_char->notify(str, size);
-    vTaskDelay(pdMS_TO_TICKS(10));
-    return size;
+size_t BLESerialService::print(const String &s) { return stream.print(s); }
+
+size_t BLESerialService::println(size_t n) { return stream.println((unsigned long)n); }
+
+void BLESerialService::vprintf(const char *fmt, va_list args) {
+    char str[BUFFER_SIZE];
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(str, sizeof(str), fmt, copy);
+    va_end(copy);
+    if (len < 0) return;
+
+    if ((size_t)len < sizeof(str)) {
+        stream.write(reinterpret_cast<const uint8_t *>(str), len);
+        return;
+    }
+    char *big = (char *)malloc(len + 1);
+    if (big == nullptr) return;
+    vsnprintf(big, len + 1, fmt, args);
+    stream.write(reinterpret_cast<const uint8_t *>(big), len);
+    free(big);
 }
 
-void BLESerialService::setMTU(uint16_t mtu) { this->mtu = mtu; }
+size_t BLESerialService::println(const uint32_t n) { return stream.println((unsigned long)n); }
+
+size_t BLESerialService::print(const int n, int format) { return stream.print(n, format); }
+
+size_t BLESerialService::println(const int n, int format) { return stream.println(n, format); }
+
+size_t BLESerialService::println() { return stream.println(); }
+
+size_t BLESerialService::write(uint8_t *str, size_t size) { return stream.write(str, size); }
+
+void BLESerialService::flush() { stream.flush(); }
+
+void BLESerialService::setMTU(uint16_t mtu) {
+    this->mtu = mtu;
+    stream.setMTU(mtu);
+}
 
 #endif
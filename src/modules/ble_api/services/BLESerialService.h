@@ -3,14 +3,57 @@
 #include "BruceBLEService.hpp"
 
 #include <SerialDevice.h>
+#include <freertos/semphr.h>
+#include <freertos/stream_buffer.h>
 
 #define BUFFER_SIZE 128
+#define BLE_SERIAL_TX_BUFFER_SIZE 4096
+#define BLE_SERIAL_RX_BUFFER_SIZE 1024
 
 class BLESerialCallbacks;
 
+// Arduino Stream over the serial characteristic.
+// Writes go into a TX ring drained by a sender task, which splits it into MTU sized
+// notifications and waits for each one to be handed to the controller before sending the next.
+// Received packets are appended to a RX ring, so reads see one continuous byte stream.
+class BLESerialStream : public Stream {
+    friend class BLESerialCallbacks;
+
+    NimBLECharacteristic *serial_char = nullptr;
+    StreamBufferHandle_t txBuffer = NULL;
+    StreamBufferHandle_t rxBuffer = NULL;
+    SemaphoreHandle_t txLock = NULL;    // many tasks print, stream buffers allow one writer
+    SemaphoreHandle_t txDone = NULL;    // given by onStatus after each notification
+    TaskHandle_t txTask = NULL;
+    volatile uint16_t mtu = 23;
+    volatile bool subscribed = false;
+    volatile bool stopping = false;
+    int peeked = -1;
+
+    static void txTaskFn(void *pvParameters);
+    void onNotifyStatus(int code);
+    void onReceive(const uint8_t *data, size_t len);
+
+public:
+    bool begin(NimBLECharacteristic *characteristic);
+    void end();
+    void setMTU(uint16_t new_mtu) { mtu = new_mtu; }
+    void setSubscribed(bool value);
+    bool connected() { return subscribed; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int availableForWrite() override;
+};
+
 class BLESerialService : public BruceBLEService, public SerialDevice {
     NimBLECharacteristic *serial_char = nullptr;
     BLESerialCallbacks *callbacks = nullptr;
+    BLESerialStream stream;
 
 public:
     BLESerialService();
@@ -26,9 +69,11 @@ public:
     void vprintf(const char *str, va_list args) override;
     size_t println(uint32_t n) override;
     size_t write(uint8_t *str, size_t size) override;
-    void flush() override {}
+    void flush() override;
     String readStringUntil(char terminator) override;
     int available() override;
     void setMTU(uint16_t mtu);
+    // Usable wherever a Stream is expected, BLE_API hands it to USBSerial::setSerialOutput
+    Stream *getStream() { return &stream; }
 };
 #endif
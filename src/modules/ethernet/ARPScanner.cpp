@@ -7,10 +7,12 @@
 
 #include "ARPScanner.h"
 #include "ARPSpoofer.h"
+#include "ARPSweeper.h"
 #include "ARPoisoner.h"
 #include "HostInfo.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/scrollableTextArea.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
 #include "esp_netif.h"
@@ -24,6 +26,7 @@
 #include "modules/ethernet/MACFlooding.h"
 #include <ETH.h>
 #endif
+#include <algorithm>
 #include <globals.h>
 #include <sstream>
 void run_arp_scanner() {
@@ -70,64 +73,7 @@ void toBytes(IPAddress ip, uint8_t *bytes) {
     bytes[3] = ip[3];
 }
 
-void ARPScanner::readArpTableETH(netif *iface) {
-    for (uint32_t i = 0; i < ARP_TABLE_SIZE; ++i) {
-        ip4_addr_t *ip_ret;
-        eth_addr *eth_ret;
-        if (etharp_get_entry(i, &ip_ret, &iface, &eth_ret)) { hostslist_eth.emplace_back(ip_ret, eth_ret); }
-    }
-    etharp_cleanup_netif(iface);
-}
-
-#include "ARPSpoofer.h"
-#include "esp_err.h"
-#include "esp_netif.h"
-#include "esp_ping.h"
-#include "lwip/inet.h"
-#include "lwip/ip_addr.h"
-#include "lwip/tcpip.h"
-#include "ping/ping_sock.h"
-
-bool wait_ping = true;
-
-static void ping_cb(esp_ping_handle_t hdl, void *args) {
-    // Turn on just for debug
-    //Serial.println("Ping done");
-    wait_ping = false;
-    esp_ping_stop(hdl);
-    esp_ping_delete_session(hdl);
-}
-
-static void ping_cb_fail(esp_ping_handle_t hdl, void *args) {
-    //Serial.println("Ping Fail");
-    wait_ping = false;
-    esp_ping_stop(hdl);
-    esp_ping_delete_session(hdl);
-}
-
-void ping_target(ip_addr_t target) {
-    esp_ping_config_t ping_config = ESP_PING_DEFAULT_CONFIG();
-    ping_config.target_addr = target;
-    ping_config.count = 4; // Number of pings
-    /* set callback functions */
-    esp_ping_callbacks_t cbs = {
-        .cb_args = NULL,
-        .on_ping_success = ping_cb,
-        .on_ping_timeout = ping_cb_fail,
-        .on_ping_end = ping_cb_fail,
-    };
-    esp_ping_handle_t ping_handle;
-    esp_err_t err = esp_ping_new_session(&ping_config, &cbs, &ping_handle);
-    if (err == ESP_OK) {
-        esp_ping_start(ping_handle); // Non-blocking; replies handled in callback
-    } else {
-        wait_ping = false;
-        Serial.printf("\nesp_ping_new_session with error: %s\n\n", esp_err_to_name(err));
-    }
-}
-
 void ARPScanner::setup() {
-    LOCK_TCPIP_CORE();
     hostslist_eth.clear();
 
     options.clear();
@@ -147,11 +93,10 @@ void ARPScanner::setup() {
         return;
     }
 
-    ip_info.ip.addr = ntohl(ip_info.ip.addr);
     ip_info.netmask.addr = ntohl(ip_info.netmask.addr);
     gateway = ip_info.gw.addr;
 
-    const uint32_t networkAddress = ntohl(gateway) & ip_info.netmask.addr;
+    const uint32_t networkAddress = ntohl(ip_info.ip.addr) & ip_info.netmask.addr;
     const uint32_t broadcast = networkAddress | ~ip_info.netmask.addr;
 
     // get iface
@@ -162,73 +107,52 @@ void ARPScanner::setup() {
         return;
     }
 
-    etharp_cleanup_netif(net_iface); // to avoid gateway duplication
-
-    // send arp requests, read table each ARP_TABLE_SIZE requests
-    uint16_t tableReadCounter = 0;
-    uint32_t hostsScanned = 0;
-    const uint32_t totalHosts = broadcast - networkAddress - 1;
-    static uint32_t lastUpdate = 0;
-
-    for (uint32_t ip_le = networkAddress + 1; ip_le < broadcast; ip_le++) {
-        if (ip_le == ip_info.ip.addr || ip_le == gateway) continue;
+    // Frames are sent and replies collected by the sweeper, the lwIP ARP table is not involved
+    ARPSweeper sweeper(net_iface);
+    if (broadcast - networkAddress < 2 || !sweeper.begin(networkAddress + 1, broadcast - 1)) {
+        displayError("ARP scan unavailable", true);
+        return;
+    }
 
-        ip4_addr_t ip_be{htonl(ip_le)}; // big endian
+    drawMainBorder();
+    tft.setTextSize(FP);
+    ScrollableTextArea area = ScrollableTextArea("ARP SCAN");
+    area.addLine("");
+    area.draw();
+
+    sweeper.onHost([&](const ARPSweepResult &result) {
+        ip4_addr_t ip{result.ip};
+        eth_addr eth;
+        memcpy(eth.addr, result.mac, MAC_ADDRESS_LENGTH);
+        hostslist_eth.emplace_back(&ip, &eth);
+
+        const Host &host = hostslist_eth.back();
+        String line = host.ip.toString() + " " + host.mac + " " + String(result.rttUs / 1000.0, 1) + "ms";
+        Serial.println(line);
+        area.addLine(line);
+        area.scrollToLine(area.linesBuffer.size());
+        area.draw(true);
+    });
 
-        hostsScanned++;
-        if (millis() - lastUpdate > 500) { // Update display every 500ms
-            displayRedStripe(
-                "Probing " + String(hostsScanned) + " of " + String(totalHosts) + " hosts",
-                getComplementaryColor2(bruceConfig.priColor),
-                bruceConfig.priColor
-            );
+    uint32_t lastUpdate = 0;
+    while (sweeper.poll()) {
+        if (millis() - lastUpdate > 500) { // Update progress every 500ms
+            area.linesBuffer[0] = "Pass " + String(sweeper.pass() + 1) + ": " + String(sweeper.progress()) +
+                                  "/" + String(sweeper.total()) + ", " + String(sweeper.found()) + " hosts";
+            area.draw(true);
             lastUpdate = millis();
         }
-
-        err_t res = etharp_request(net_iface, &ip_be);
-
-        if (res != ERR_OK) {
-            Serial.println("Arp req for: " + IPAddress(ip_be.addr).toString() + "failed with ec: " + res);
-        } else {
-            ++tableReadCounter;
-        }
-
-        vTaskDelay(arpRequestDelay);
-
-        // read table if we sent ARP_TABLE_SIZE requests
-        if (tableReadCounter == ARP_TABLE_SIZE) {
-            readArpTableETH(net_iface);
-            tableReadCounter = 0;
-        }
         // Stops search on EscPress
-        if (check(EscPress)) break;
+        if (check(EscPress)) {
+            sweeper.cancel();
+            break;
+        }
     }
-    UNLOCK_TCPIP_CORE();
-    auto it = std::find_if(hostslist_eth.begin(), hostslist_eth.end(), [this](const Host &host) {
-        return host.ip == gateway;
-    });
-
-    // Sometimes happens that gateway is not scanned, so force ping and then read again ARP table
-    if (it == hostslist_eth.end()) {
-        ip_addr_t target;
-        target.type = IPADDR_TYPE_V4;
-        target.u_addr.ip4.addr = gateway;
-        ping_target(target); // Ping target to force ARP request
-
-        while (wait_ping) { delay(1); }
-
-        struct eth_addr *eth_ret = NULL;
-        const ip4_addr_t *ipaddr_ret = NULL;
-        ip4_addr_t gateway_ip;
-        gateway_ip.addr = gateway;
 
-        // Search gateway in the ARP table
-        s8_t arp_find_result = etharp_find_addr(net_iface, &gateway_ip, &eth_ret, &ipaddr_ret);
-
-        if (arp_find_result < 0) { Serial.println("Gateway MAC not found."); }
-
-        readArpTableETH(net_iface); // Update hostlists
-    }
+    // Replies stream in arrival order, the menu lists them by address
+    std::sort(hostslist_eth.begin(), hostslist_eth.end(), [](const Host &a, const Host &b) {
+        return ntohl((uint32_t)a.ip) < ntohl((uint32_t)b.ip);
+    });
 
 ScanHostMenu:
     if (hostslist_eth.empty()) {
@@ -243,6 +167,7 @@ ScanHostMenu:
         if (host.ip == gateway) result += "(GTW)";
         options.push_back({result.c_str(), [this, host]() { afterScanOptions(host); }});
     }
+    if (hostslist_eth.size() > 1) options.push_back({"Port scan all", [this]() { HostInfo{hostslist_eth}; }});
     addOptionToMainMenu();
 
     loopOptions(options);
@@ -0,0 +1,268 @@
+/**
+ * @file ARPSweeper.cpp
+ * @brief ARP sweep with raw frames, replies are collected outside of the lwIP ARP table
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include "ARPSweeper.h"
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "lwip/def.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include <string.h>
+
+// Offsets in an Ethernet II frame carrying an ARP packet
+#define ARP_FRAME_LEN 42
+#define ARP_OFF_ETHERTYPE 12
+#define ARP_OFF_OPCODE 20
+#define ARP_OFF_SENDER_MAC 22
+#define ARP_OFF_SENDER_IP 28
+#define ARP_OFF_TARGET_MAC 32
+#define ARP_OFF_TARGET_IP 38
+#define ARP_OPCODE_REQUEST 1
+#define ARP_OPCODE_REPLY 2
+
+#define ARP_SWEEP_QUEUE_LEN 64 // replies waiting for poll(), drained at every burst
+#define ARP_SWEEP_TABLE_MIN 64
+#define ARP_SWEEP_MAX_STALLS 100 // bursts refused by the driver before an address is skipped
+
+QueueHandle_t ARPSweeper::replies = NULL;
+struct netif *ARPSweeper::hooked = nullptr;
+uint32_t ARPSweeper::hookedIp = 0;
+netif_input_fn ARPSweeper::originalInput = nullptr;
+
+ARPSweeper::ARPSweeper(struct netif *iface, const ARPSweepConfig &config) : iface(iface), config(config) {
+    if (this->config.burstSize == 0) this->config.burstSize = 1;
+}
+
+ARPSweeper::~ARPSweeper() { cancel(); }
+
+/*********************************************************************
+**  Input hook, runs in the driver RX task for every received frame
+*********************************************************************/
+err_t ARPSweeper::inputHook(struct pbuf *p, struct netif *inp) {
+    if (inp == hooked && p->len >= ARP_FRAME_LEN) {
+        const uint8_t *frame = (const uint8_t *)p->payload;
+        if (frame[ARP_OFF_ETHERTYPE] == 0x08 && frame[ARP_OFF_ETHERTYPE + 1] == 0x06 &&
+            frame[ARP_OFF_OPCODE] == 0 && frame[ARP_OFF_OPCODE + 1] == ARP_OPCODE_REPLY &&
+            memcmp(frame + ARP_OFF_TARGET_IP, &hookedIp, 4) == 0) {
+            Reply reply;
+            memcpy(&reply.ip, frame + ARP_OFF_SENDER_IP, 4);
+            memcpy(reply.mac, frame + ARP_OFF_SENDER_MAC, 6);
+            reply.us = esp_timer_get_time();
+            xQueueSend(replies, &reply, 0); // never block the driver, a lost reply is retried
+        }
+    }
+    // lwIP still sees every frame, the sweep only listens
+    return originalInput(p, inp);
+}
+
+bool ARPSweeper::begin(uint32_t first, uint32_t last) {
+    if (hooked != nullptr || iface == nullptr || iface->linkoutput == nullptr || iface->input == nullptr ||
+        iface->hwaddr_len != 6 || last < first) {
+        return false;
+    }
+    // The queue outlives the sweep, a hook call still in flight may use it after cancel()
+    if (replies == NULL) replies = xQueueCreate(ARP_SWEEP_QUEUE_LEN, sizeof(Reply));
+    if (replies == NULL) return false;
+    xQueueReset(replies);
+
+    firstIp = first;
+    count = last - first + 1;
+    cursor = 0;
+    passIndex = 0;
+    settling = false;
+    burstHead = burstCount = 0;
+    stalledBursts = 0;
+    table.assign(ARP_SWEEP_TABLE_MIN, Entry());
+    used = 0;
+
+    LOCK_TCPIP_CORE();
+    hookedIp = netif_ip4_addr(iface)->addr;
+    originalInput = iface->input;
+    hooked = iface;
+    iface->input = inputHook;
+    UNLOCK_TCPIP_CORE();
+
+    lastBurstMs = millis() - config.burstIntervalMs;
+    running = true;
+    return true;
+}
+
+void ARPSweeper::restoreInput() {
+    if (hooked != iface || iface == nullptr) return;
+    LOCK_TCPIP_CORE();
+    iface->input = originalInput;
+    hooked = nullptr;
+    UNLOCK_TCPIP_CORE();
+}
+
+void ARPSweeper::cancel() {
+    restoreInput();
+    running = false;
+}
+
+/*********************************************************************
+**  Replies table
+*********************************************************************/
+// Hashes the host order address, its low bits are the ones that change within a subnet
+size_t ARPSweeper::slot(uint32_t ip) const { return (ntohl(ip) * 2654435761u) & (table.size() - 1); }
+
+ARPSweeper::Entry *ARPSweeper::find(uint32_t ip) {
+    size_t mask = table.size() - 1;
+    for (size_t i = slot(ip);; i = (i + 1) & mask) {
+        if (table[i].ip == ip) return &table[i];
+        if (table[i].ip == 0) return nullptr;
+    }
+}
+
+void ARPSweeper::grow() {
+    std::vector<Entry> old;
+    old.swap(table);
+    table.assign(old.size() * 2, Entry());
+    size_t mask = table.size() - 1;
+    for (const Entry &entry : old) {
+        if (entry.ip == 0) continue;
+        size_t i = slot(entry.ip);
+        while (table[i].ip != 0) i = (i + 1) & mask;
+        table[i] = entry;
+    }
+}
+
+// Returns false if the host was already known
+bool ARPSweeper::insert(const Reply &reply) {
+    if (find(reply.ip) != nullptr) return false;
+    if ((used + 1) * 2 > table.size()) grow();
+
+    size_t mask = table.size() - 1;
+    size_t i = slot(reply.ip);
+    while (table[i].ip != 0) i = (i + 1) & mask;
+    Entry &entry = table[i];
+    entry.ip = reply.ip;
+    memcpy(entry.mac, reply.mac, 6);
+    entry.rttUs = rttFor(ntohl(reply.ip) - firstIp, reply.us);
+    used++;
+    return true;
+}
+
+// The newest burst that covered the address sent the request being answered
+uint32_t ARPSweeper::rttFor(uint32_t index, int64_t replyUs) const {
+    for (uint8_t n = 0; n < burstCount; n++) {
+        const Burst &burst = bursts[(burstHead + ARP_SWEEP_BURSTS - 1 - n) % ARP_SWEEP_BURSTS];
+        if (index >= burst.first && index <= burst.last) {
+            return replyUs > burst.sentUs ? (uint32_t)(replyUs - burst.sentUs) : 0;
+        }
+    }
+    return 0;
+}
+
+void ARPSweeper::handleReply(const Reply &reply) {
+    uint32_t ip = ntohl(reply.ip);
+    if (reply.ip == 0 || ip < firstIp || ip - firstIp >= count) return;
+    if (!insert(reply)) return;
+    if (!hostCallback) return;
+
+    const Entry *entry = find(reply.ip);
+    ARPSweepResult result;
+    result.ip = entry->ip;
+    memcpy(result.mac, entry->mac, 6);
+    result.rttUs = entry->rttUs;
+    hostCallback(result);
+}
+
+/*********************************************************************
+**  Requests
+*********************************************************************/
+bool ARPSweeper::sendRequest(uint32_t ip) {
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, ARP_FRAME_LEN, PBUF_RAM);
+    if (p == nullptr) return false;
+
+    uint8_t *frame = (uint8_t *)p->payload;
+    memset(frame, 0xFF, 6); // broadcast
+    memcpy(frame + 6, iface->hwaddr, 6);
+    frame[ARP_OFF_ETHERTYPE] = 0x08;
+    frame[ARP_OFF_ETHERTYPE + 1] = 0x06;
+    const uint8_t header[] = {0x00, 0x01, 0x08, 0x00, 6, 4, 0x00, ARP_OPCODE_REQUEST}; // Ethernet/IPv4
+    memcpy(frame + 14, header, sizeof(header));
+    memcpy(frame + ARP_OFF_SENDER_MAC, iface->hwaddr, 6);
+    memcpy(frame + ARP_OFF_SENDER_IP, &hookedIp, 4);
+    memset(frame + ARP_OFF_TARGET_MAC, 0, 6);
+    memcpy(frame + ARP_OFF_TARGET_IP, &ip, 4);
+
+    err_t err = iface->linkoutput(iface, p);
+    pbuf_free(p);
+    return err == ERR_OK;
+}
+
+void ARPSweeper::sendBurst() {
+    uint32_t start = cursor;
+    int64_t sentUs = esp_timer_get_time();
+    uint8_t sent = 0;
+
+    // The core lock is only held while frames are handed to the driver, never across the pacing delay
+    LOCK_TCPIP_CORE();
+    while (cursor < count && sent < config.burstSize) {
+        uint32_t ip = htonl(firstIp + cursor);
+        if (ip == hookedIp || find(ip) != nullptr) { // ourselves, or answered in an earlier pass
+            cursor++;
+            continue;
+        }
+        if (!sendRequest(ip)) {
+            // Driver TX queue full, retry this address in the next burst unless the link is gone
+            if (++stalledBursts > ARP_SWEEP_MAX_STALLS) {
+                stalledBursts = 0;
+                cursor++;
+            }
+            break;
+        }
+        stalledBursts = 0;
+        cursor++;
+        sent++;
+    }
+    UNLOCK_TCPIP_CORE();
+
+    if (sent == 0) return;
+    bursts[burstHead] = {start, cursor - 1, sentUs};
+    burstHead = (burstHead + 1) % ARP_SWEEP_BURSTS;
+    if (burstCount < ARP_SWEEP_BURSTS) burstCount++;
+}
+
+bool ARPSweeper::poll() {
+    if (!running) return false;
+
+    uint32_t now = millis();
+    if (settling) {
+        if (now - settleStartMs >= config.settleMs) {
+            settling = false;
+            if (passIndex >= config.retries || used >= count) {
+                cancel();
+                // Replies that arrived while unhooking
+                Reply reply;
+                while (xQueueReceive(replies, &reply, 0) == pdTRUE) handleReply(reply);
+                return false;
+            }
+            passIndex++;
+            cursor = 0;
+        }
+    } else if (now - lastBurstMs >= config.burstIntervalMs) {
+        lastBurstMs = now;
+        sendBurst();
+        if (cursor >= count) {
+            settling = true;
+            settleStartMs = now;
+        }
+    }
+
+    // Sleep on the replies until the next burst is due
+    uint32_t due = settling ? settleStartMs + config.settleMs : lastBurstMs + config.burstIntervalMs;
+    int32_t wait = (int32_t)(due - millis());
+    TickType_t ticks = wait > 0 ? pdMS_TO_TICKS(wait) : 0;
+    Reply reply;
+    while (xQueueReceive(replies, &reply, ticks) == pdTRUE) {
+        handleReply(reply);
+        ticks = 0;
+    }
+    return true;
+}
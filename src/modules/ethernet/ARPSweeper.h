@@ -0,0 +1,112 @@
+/**
+ * @file ARPSweeper.h
+ * @brief ARP sweep with raw frames, replies are collected outside of the lwIP ARP table
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * Requests are built here and pushed through netif->linkoutput in paced bursts. Replies are
+ * picked up by a hook on netif->input, so the TCP/IP core is never held while waiting and the
+ * ARP_TABLE_SIZE entries of lwIP don't limit how many hosts can be found.
+ */
+#ifndef ARP_SWEEPER_H
+#define ARP_SWEEPER_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "lwip/netif.h"
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+#define ARP_SWEEP_BURSTS 32 // bursts remembered to match replies, ~300 ms at the default pace
+
+struct ARPSweepResult {
+    uint32_t ip; // network byte order, as in IPAddress
+    uint8_t mac[6];
+    uint32_t rttUs; // from the request that got the first reply, 0 if it can't be matched
+};
+
+struct ARPSweepConfig {
+    uint8_t burstSize = 16;        // frames handed to the driver at once
+    uint16_t burstIntervalMs = 10; // ~1600 requests/s, enough for a /16 in under a minute
+    uint8_t retries = 2;           // extra passes over the addresses that didn't answer
+    uint16_t settleMs = 400;       // wait for late replies before a retry pass and at the end
+};
+
+class ARPSweeper {
+public:
+    using Callback = std::function<void(const ARPSweepResult &)>;
+
+    explicit ARPSweeper(struct netif *iface, const ARPSweepConfig &config = ARPSweepConfig());
+    ~ARPSweeper();
+
+    // Sweeps [first, last], host byte order. Fails if another sweep is running on any netif.
+    bool begin(uint32_t first, uint32_t last);
+    // Called from poll() once per host, as soon as its first reply is seen
+    void onHost(Callback callback) { hostCallback = callback; }
+    // Sends the next burst when it is due and waits for replies until then.
+    // Returns false once every pass is done or the sweep was cancelled.
+    bool poll();
+    void cancel();
+
+    uint32_t total() const { return count; }
+    uint32_t progress() const { return cursor; } // position in the current pass
+    uint8_t pass() const { return passIndex; }
+    size_t found() const { return used; }
+
+private:
+    struct Entry {
+        uint32_t ip = 0; // 0 = empty slot
+        uint8_t mac[6];
+        uint32_t rttUs;
+    };
+    struct Burst {
+        uint32_t first; // index range covered by the burst, responders included
+        uint32_t last;
+        int64_t sentUs;
+    };
+    struct Reply {
+        uint32_t ip;
+        uint8_t mac[6];
+        int64_t us;
+    };
+
+    struct netif *iface;
+    ARPSweepConfig config;
+    uint32_t firstIp = 0; // host byte order
+    uint32_t count = 0;
+    uint32_t cursor = 0;
+    uint8_t passIndex = 0;
+    bool running = false;
+    bool settling = false; // waiting for late replies at the end of a pass
+    uint32_t lastBurstMs = 0;
+    uint32_t settleStartMs = 0;
+    Callback hostCallback;
+
+    // Open addressing on the IP, so lookups during retry passes stay cheap on /16 networks
+    std::vector<Entry> table;
+    size_t used = 0;
+    // Recent bursts, enough to match replies to the request that triggered them
+    Burst bursts[ARP_SWEEP_BURSTS];
+    uint8_t burstHead = 0;
+    uint8_t burstCount = 0;
+    uint16_t stalledBursts = 0;
+
+    size_t slot(uint32_t ip) const;
+    Entry *find(uint32_t ip);
+    bool insert(const Reply &reply);
+    void grow();
+    uint32_t rttFor(uint32_t index, int64_t replyUs) const;
+    void sendBurst();
+    bool sendRequest(uint32_t ip);
+    void handleReply(const Reply &reply);
+    void restoreInput();
+
+    static QueueHandle_t replies;
+    static struct netif *hooked;
+    static uint32_t hookedIp;
+    static netif_input_fn originalInput;
+    static err_t inputHook(struct pbuf *p, struct netif *inp);
+};
+
+#endif
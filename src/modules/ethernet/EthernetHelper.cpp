@@ -8,6 +8,7 @@
 #if !defined(LITE_VERSION)
 #include "EthernetHelper.h"
 #include "core/display.h"
+#include "core/spi_bus.h"
 #include <ETH.h>
 #include <Network.h>
 #include <SPI.h>
@@ -22,46 +23,16 @@ static bool connected = false;
 
 /** Select the proper SPI bus for the W5500, reusing existing shared buses when possible. */
 static SPIClass *selectEthernetSPIBus() {
-    SPIClass *selectedSPI = &SPI;
-    if (bruceConfigPins.W5500_bus.mosi == (gpio_num_t)TFT_MOSI &&
-        bruceConfigPins.W5500_bus.mosi != GPIO_NUM_NC) {
-#if TFT_MOSI > 0
-        selectedSPI = &tft.getSPIinstance();
-        Serial.println("Using TFT SPI for Ethernet");
-#else
-        Serial.println("TFT SPI unavailable, falling back to default SPI for Ethernet");
-#endif
-    } else if (bruceConfigPins.W5500_bus.mosi == bruceConfigPins.SDCARD_bus.mosi &&
-               bruceConfigPins.W5500_bus.mosi != GPIO_NUM_NC) {
-        selectedSPI = &sdcardSPI;
-        sdcardSPI.begin(
-            (int8_t)bruceConfigPins.W5500_bus.sck,
-            (int8_t)bruceConfigPins.W5500_bus.miso,
-            (int8_t)bruceConfigPins.W5500_bus.mosi,
-            (int8_t)bruceConfigPins.W5500_bus.cs
-        );
-        Serial.println("Using SDCard SPI for Ethernet");
-    } else if ((bruceConfigPins.W5500_bus.mosi == bruceConfigPins.NRF24_bus.mosi ||
-                bruceConfigPins.W5500_bus.mosi == bruceConfigPins.CC1101_bus.mosi) &&
-               bruceConfigPins.W5500_bus.mosi != GPIO_NUM_NC) {
-        selectedSPI = &CC_NRF_SPI;
-        CC_NRF_SPI.begin(
-            (int8_t)bruceConfigPins.W5500_bus.sck,
-            (int8_t)bruceConfigPins.W5500_bus.miso,
-            (int8_t)bruceConfigPins.W5500_bus.mosi,
-            (int8_t)bruceConfigPins.W5500_bus.cs
-        );
-        Serial.println("Using CC/NRF SPI for Ethernet");
-    } else {
-        SPI.begin(
-            (int8_t)bruceConfigPins.W5500_bus.sck,
-            (int8_t)bruceConfigPins.W5500_bus.miso,
-            (int8_t)bruceConfigPins.W5500_bus.mosi,
-            (int8_t)bruceConfigPins.W5500_bus.cs
-        );
-        Serial.println("Using dedicated SPI for Ethernet");
-    }
-    return selectedSPI;
+    SPIClass *shared = spiArbiter.bus(SpiDevice::Ethernet);
+    if (shared) return shared;
+    SPI.begin(
+        (int8_t)bruceConfigPins.W5500_bus.sck,
+        (int8_t)bruceConfigPins.W5500_bus.miso,
+        (int8_t)bruceConfigPins.W5500_bus.mosi,
+        (int8_t)bruceConfigPins.W5500_bus.cs
+    );
+    Serial.println("Using dedicated SPI for Ethernet");
+    return &SPI;
 }
 
 /** Event handler for Ethernet events */
@@ -151,7 +122,11 @@ bool EthernetHelper::setup() {
     const int rstPin =
         (bruceConfigPins.W5500_bus.io2 == GPIO_NUM_NC) ? -1 : static_cast<int>(bruceConfigPins.W5500_bus.io2);
 
-    if (!ETH.begin(ETH_PHY_W5500, 1, csPin, irqPin, rstPin, *ethSpi)) {
+    // Reset and setup of the chip, later frames go through SPIClass transactions from the driver task
+    spiArbiter.acquire(SpiDevice::Ethernet);
+    bool started = ETH.begin(ETH_PHY_W5500, 1, csPin, irqPin, rstPin, *ethSpi);
+    spiArbiter.release(SpiDevice::Ethernet);
+    if (!started) {
         displayError("Ethernet start failed", true);
         Serial.println("ETH.begin failed");
         return false;
@@ -170,6 +145,7 @@ void EthernetHelper::stop() {
         Network.removeEvent(ethEventId);
         ethEventId = 0;
     }
+    SpiGuard bus(SpiDevice::Ethernet);
     ETH.end();
     ethSpi = nullptr;
 }
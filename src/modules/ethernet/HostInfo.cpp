@@ -1,83 +1,25 @@
 /**
  * @file HostInfo.cpp
  * @brief HostInfo module for every esp-netif
- * @version 0.2
- * @date 2025-11-26
+ * @version 0.3
+ * @date 2026-10-19
  */
 
 #include "HostInfo.h"
-#include "ESPNetifEthernetClient.h"
+#include "PortScanner.h"
 #include "core/display.h"
 #include "core/net_utils.h"
 #include "core/scrollableTextArea.h"
 
-HostInfo::HostInfo(const Host &host, bool wifi) {
-#if !defined(LITE_VERSION)
-    if (!wifi) {
-        eth_client = new ESPNetifEthernetClient();
-    } else {
-        wifi_client = new WiFiClient();
-    }
-#else
-    wifi_client = new WiFiClient();
-#endif
+HostInfo::HostInfo(const Host &host, bool wifi) { setup({host}); }
 
-    setup(host);
-}
-
-HostInfo::~HostInfo() {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        delete eth_client;
-    } else {
-        delete wifi_client;
-    }
-#else
-    delete wifi_client;
-#endif
-}
-
-void HostInfo::client_stop() {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        eth_client->client_close(sockfd);
-    } else {
-        wifi_client->stop();
-    }
-#else
-    wifi_client->stop();
-#endif
-}
-
-void HostInfo::client_connect(IPAddress ip, int port) {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        sockfd = eth_client->connect(ip, port, 3000);
-    } else {
-        wifi_client->connect(ip, port);
-    }
-#else
-    wifi_client->connect(ip, port);
-#endif
-}
-
-bool HostInfo::client_connected() {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        return eth_client->connected(sockfd);
-    } else {
-        return wifi_client->connected();
-    }
-#else
-    return wifi_client->connected();
-#endif
-}
+HostInfo::HostInfo(const std::vector<Host> &hosts) { setup(hosts); }
 
-void HostInfo::setup(const Host &host) {
-    const int TIMEOUT_MS = 150; // Timeout for connection attempt
+HostInfo::~HostInfo() {}
 
+void HostInfo::setup(const std::vector<Host> &hosts) {
     // Array of TCP ports to scan
-    const int portNumbers[] = {
+    const uint16_t portNumbers[] = {
         19, 20, 21, 22, 23, 25, 42, 53, 67, 68, 69, 80, 88,
         110, 111, 113, 119, 123, 135, 137, 139, 143, 161, 162,
         179, 194, 389, 427, 443, 445, 464, 465, 500, 514, 515,
@@ -93,6 +35,22 @@ void HostInfo::setup(const Host &host) {
         32768, 49152, 49153, 49154, 49155, 49156, 49157
     };
     const int portCount = sizeof(portNumbers) / sizeof(portNumbers[0]);
+    if (hosts.empty()) return;
+
+    bool allPorts = false;
+    bool chosen = false;
+    options = {
+        {"Common ports",      [&]() { chosen = true; }           },
+        {"All ports 1-65535", [&]() { chosen = allPorts = true; }},
+    };
+    loopOptions(options);
+    options.clear();
+    if (!chosen) return;
+
+    PortScanner scanner;
+    for (const Host &host : hosts) scanner.addHost(host.ip);
+    if (allPorts) scanner.addPortRange(1, 65535);
+    else scanner.addPorts(portNumbers, portCount);
 
     // Initialize display
     drawMainBorder();
@@ -100,52 +58,47 @@ void HostInfo::setup(const Host &host) {
 
     ScrollableTextArea area = ScrollableTextArea("HOST INFO");
 
-    area.addLine("Host: " + host.ip.toString());
-    area.addLine("Mac: " + host.mac);
-    area.addLine("Manufacturer: " + getManufacturer(host.mac));
-    area.addLine("Scanning Ports... Wait");
+    if (hosts.size() == 1) {
+        area.addLine("Host: " + hosts[0].ip.toString());
+        area.addLine("Mac: " + hosts[0].mac);
+        area.addLine("Manufacturer: " + getManufacturer(hosts[0].mac));
+    } else {
+        area.addLine("Hosts: " + String(hosts.size()));
+    }
+    area.addLine("Scanning " + String(scanner.total()) + " ports... [ESC] to stop");
     area.addLine("Open TCP Ports: ");
 
     area.draw();
 
-    //bool scanCanceled = false;
-
-    for (int i = 0; i < portCount; i++) {
-        int port = portNumbers[i];
-
+    // Results are shown as soon as each port answers
+    bool multiHost = hosts.size() > 1;
+    scanner.onOpen([&](const PortScanResult &result) {
+        String line = multiHost ? IPAddress(result.ip).toString() + ":" + String(result.port)
+                                : String(result.port);
+        area.addLine(line + " (" + String(result.rttMs) + " ms)");
+        Serial.println(line);
+        area.draw();
+    });
+
+    unsigned long startTime = millis();
+    unsigned long lastProgress = startTime;
+    while (scanner.poll(20)) {
         if (check(EscPress)) {
+            scanner.cancel();
             returnToMenu = true;
             break;
         }
-
-        client_connect(host.ip, port);
-        unsigned long startTime = millis();
-
-        bool connected = false;
-        while (millis() - startTime < TIMEOUT_MS) {
-            if (client_connected()) {
-                connected = true;
-                break;
-            }
-            continue;
-        }
-
-        if (connected) {
-            area.addLine(String(port));
-            Serial.println(port, DEC);
-            area.draw();
+        if (millis() - lastProgress > 1000) {
+            Serial.printf(
+                "Port scan: %lu/%lu\n", (unsigned long)scanner.done(), (unsigned long)scanner.total()
+            );
+            lastProgress = millis();
         }
-
-        client_stop();
-    }
-
-    /*
-    if (scanCanceled) {
-        tft.print("Scan Canceled!");
-    } else {
-        tft.print("Done!");
     }
-    */
 
+    area.addLine(
+        String(returnToMenu ? "Stopped: " : "Done: ") + String(scanner.openCount()) + " open, " +
+        String(scanner.done()) + " ports in " + String((millis() - startTime) / 1000.0, 1) + "s"
+    );
     area.show();
 }
@@ -1,16 +1,12 @@
 #ifndef HOST_INFO_H
 #define HOST_INFO_H
 
-#include "ESPNetifEthernetClient.h"
 #include "modules/wifi/scan_hosts.h"
 #include <map>
+#include <vector>
 class HostInfo {
 private:
-    WiFiClient *wifi_client = nullptr;
-#if !defined(LITE_VERSION)
-    ESPNetifEthernetClient *eth_client = nullptr;
-#endif
-    void setup(const Host &host);
+    void setup(const std::vector<Host> &hosts);
     /*
     std::map<int, const char *> portServices = {
         //  hmm
@@ -140,14 +136,12 @@ private:
         {49156, "Windows RPC"                                                      },
         {49157, "Windows RPC"                                                      }
     }; */
-    void client_stop();
-    void client_connect(IPAddress ip, int port);
-    bool client_connected();
-    int sockfd = -1;
 
 public:
     HostInfo();
+    // WiFi and Ethernet both go through lwIP sockets, `wifi` is kept for the callers
     HostInfo(const Host &host, bool wifi);
+    HostInfo(const std::vector<Host> &hosts);
     ~HostInfo();
 };
 
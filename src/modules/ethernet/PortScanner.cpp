@@ -0,0 +1,189 @@
+/**
+ * @file PortScanner.cpp
+ * @brief Non-blocking TCP connect scanner, keeps many probes in flight
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include "PortScanner.h"
+#include <errno.h>
+#include <string.h>
+#ifdef ARDUINO
+#include "Arduino.h"
+#include "lwip/sockets.h"
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static uint32_t nowMs() {
+#ifdef ARDUINO
+    return millis();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#endif
+}
+
+// Resets the connection on close so no TIME_WAIT state is kept for every open port
+static void closeProbe(int fd) {
+    struct linger lin = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+    close(fd);
+}
+
+PortScanner::PortScanner(const PortScanConfig &config) : config(config) {
+    if (this->config.maxInFlight == 0) this->config.maxInFlight = 1;
+}
+
+PortScanner::~PortScanner() { cancel(); }
+
+void PortScanner::addHost(uint32_t ip) {
+    HostState host;
+    host.ip = ip;
+    hosts.push_back(host);
+}
+
+void PortScanner::addPorts(const uint16_t *list, size_t count) { ports.insert(ports.end(), list, list + count); }
+
+void PortScanner::addPortRange(uint16_t first, uint16_t last) {
+    ports.reserve(ports.size() + (last - first) + 1);
+    for (uint32_t port = first; port <= last; port++) ports.push_back(port);
+}
+
+void PortScanner::cancel() {
+    for (const Probe &probe : inFlight) closeProbe(probe.fd);
+    inFlight.clear();
+    cancelled = true;
+}
+
+/*********************************************************************
+**  Adaptive timeout, RFC 6298 style estimate from SYN -> SYN/ACK or RST
+*********************************************************************/
+void PortScanner::sampleRtt(HostState &host, uint32_t rtt) {
+    if (!host.sampled) {
+        host.srtt = rtt;
+        host.rttvar = rtt / 2.0f;
+        host.sampled = true;
+        return;
+    }
+    float err = host.srtt > rtt ? host.srtt - rtt : rtt - host.srtt;
+    host.rttvar = 0.75f * host.rttvar + 0.25f * err;
+    host.srtt = 0.875f * host.srtt + 0.125f * rtt;
+}
+
+uint32_t PortScanner::hostTimeout(const HostState &host) const {
+    if (!host.sampled) return config.initialTimeoutMs;
+    uint32_t timeout = (uint32_t)(host.srtt + 4 * host.rttvar);
+    if (timeout < config.minTimeoutMs) timeout = config.minTimeoutMs;
+    if (timeout > config.maxTimeoutMs) timeout = config.maxTimeoutMs;
+    return timeout;
+}
+
+uint32_t PortScanner::timeoutFor(uint32_t ip) const {
+    for (const HostState &host : hosts) {
+        if (host.ip == ip) return hostTimeout(host);
+    }
+    return config.initialTimeoutMs;
+}
+
+/*********************************************************************
+**  Probes
+*********************************************************************/
+// Returns false when no socket is available right now
+bool PortScanner::startProbe(uint32_t index) {
+    // Ports interleave across hosts, so every host gets an RTT sample early
+    uint32_t hostIndex = index % hosts.size();
+    uint16_t port = ports[index / hosts.size()];
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = hosts[hostIndex].ip;
+    addr.sin_port = htons(port);
+
+    uint32_t now = nowMs();
+    inFlight.push_back({fd, hostIndex, port, now});
+    int res = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (res == 0) finishProbe(inFlight.size() - 1, true, true, now);
+    else if (errno != EINPROGRESS) finishProbe(inFlight.size() - 1, false, errno == ECONNREFUSED, now);
+    return true;
+}
+
+void PortScanner::finishProbe(size_t slot, bool open, bool sample, uint32_t now) {
+    Probe probe = inFlight[slot];
+    inFlight[slot] = inFlight.back();
+    inFlight.pop_back();
+    closeProbe(probe.fd);
+    completed++;
+
+    HostState &host = hosts[probe.host];
+    uint32_t rtt = now - probe.startMs;
+    if (sample) sampleRtt(host, rtt);
+    if (!open) return;
+    found++;
+    if (openCallback) openCallback({host.ip, probe.port, (uint16_t)(rtt > 0xFFFF ? 0xFFFF : rtt)});
+}
+
+bool PortScanner::poll(uint32_t waitMs) {
+    if (cancelled || hosts.empty() || ports.empty()) return false;
+
+    while (inFlight.size() < config.maxInFlight && next < total()) {
+        if (!startProbe(next)) {
+            // Out of sockets with nothing to wait for, it won't get better
+            if (inFlight.empty()) {
+                cancel();
+                return false;
+            }
+            break;
+        }
+        next++;
+    }
+    if (inFlight.empty()) return next < total();
+
+    // Wait until a probe completes or the earliest one times out
+    uint32_t now = nowMs();
+    uint32_t wait = waitMs;
+    fd_set writeSet, errorSet;
+    FD_ZERO(&writeSet);
+    FD_ZERO(&errorSet);
+    int maxFd = -1;
+    for (const Probe &probe : inFlight) {
+        FD_SET(probe.fd, &writeSet);
+        FD_SET(probe.fd, &errorSet);
+        if (probe.fd > maxFd) maxFd = probe.fd;
+        uint32_t elapsed = now - probe.startMs;
+        uint32_t timeout = hostTimeout(hosts[probe.host]);
+        uint32_t left = elapsed >= timeout ? 0 : timeout - elapsed;
+        if (left < wait) wait = left;
+    }
+    struct timeval tv;
+    tv.tv_sec = wait / 1000;
+    tv.tv_usec = (wait % 1000) * 1000;
+    int ready = select(maxFd + 1, nullptr, &writeSet, &errorSet, &tv);
+    now = nowMs();
+
+    for (size_t i = inFlight.size(); i-- > 0;) {
+        const Probe &probe = inFlight[i];
+        if (ready > 0 && (FD_ISSET(probe.fd, &writeSet) || FD_ISSET(probe.fd, &errorSet))) {
+            int sockErr = 0;
+            socklen_t len = sizeof(sockErr);
+            if (getsockopt(probe.fd, SOL_SOCKET, SO_ERROR, &sockErr, &len) < 0) sockErr = errno;
+            // A refused connection is an answer too, it measures the RTT as well as an open port
+            finishProbe(i, sockErr == 0, sockErr == 0 || sockErr == ECONNREFUSED, now);
+        } else if (now - probe.startMs >= hostTimeout(hosts[probe.host])) {
+            finishProbe(i, false, false, now); // filtered or host down
+        }
+    }
+    return !inFlight.empty() || next < total();
+}
@@ -0,0 +1,83 @@
+/**
+ * @file PortScanner.h
+ * @brief Non-blocking TCP connect scanner, keeps many probes in flight
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * Only depends on BSD sockets (lwIP on the device), so it also builds on a POSIX host.
+ */
+#ifndef PORT_SCANNER_H
+#define PORT_SCANNER_H
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+struct PortScanResult {
+    uint32_t ip; // network byte order, as in IPAddress
+    uint16_t port;
+    uint16_t rttMs;
+};
+
+struct PortScanConfig {
+    uint8_t maxInFlight = 8;         // lwIP has few sockets, leave some for the rest of the firmware
+    uint16_t initialTimeoutMs = 500; // until the host answered once
+    uint16_t minTimeoutMs = 60;
+    uint16_t maxTimeoutMs = 2000;
+};
+
+class PortScanner {
+public:
+    using Callback = std::function<void(const PortScanResult &)>;
+
+    explicit PortScanner(const PortScanConfig &config = PortScanConfig());
+    ~PortScanner();
+
+    void addHost(uint32_t ip);
+    void addPorts(const uint16_t *ports, size_t count);
+    void addPortRange(uint16_t first, uint16_t last);
+    // Called from poll() for every open port, as soon as it is found
+    void onOpen(Callback callback) { openCallback = callback; }
+
+    // Opens new probes and waits up to `waitMs` for the ones in flight.
+    // Returns false once every probe is done or the scan was cancelled.
+    bool poll(uint32_t waitMs);
+    void cancel();
+
+    uint32_t total() const { return hosts.size() * ports.size(); }
+    uint32_t done() const { return completed; }
+    uint32_t openCount() const { return found; }
+    // Current connect timeout for a host, derived from its measured RTT
+    uint32_t timeoutFor(uint32_t ip) const;
+
+private:
+    struct Probe {
+        int fd;
+        uint32_t host; // index in hosts
+        uint16_t port;
+        uint32_t startMs;
+    };
+    struct HostState {
+        uint32_t ip;
+        float srtt = 0;   // smoothed RTT (ms)
+        float rttvar = 0; // RTT variation (ms)
+        bool sampled = false;
+    };
+
+    PortScanConfig config;
+    std::vector<HostState> hosts;
+    std::vector<uint16_t> ports;
+    std::vector<Probe> inFlight;
+    uint32_t next = 0; // next host/port pair to probe
+    uint32_t completed = 0;
+    uint32_t found = 0;
+    bool cancelled = false;
+    Callback openCallback;
+
+    bool startProbe(uint32_t index);
+    void finishProbe(size_t slot, bool open, bool sample, uint32_t now);
+    void sampleRtt(HostState &host, uint32_t rtt);
+    uint32_t hostTimeout(const HostState &host) const;
+};
+
+#endif
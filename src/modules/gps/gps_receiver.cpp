@@ -0,0 +1,235 @@
+/**
+ * @file gps_receiver.cpp
+ * @brief NMEA ingestion task, publishes timestamped fixes to the rest of the firmware
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include "gps_receiver.h"
+#include <TimeLib.h>
+
+#if SOC_UART_NUM > 2
+#define GPS_UART UART_NUM_2
+#else
+#define GPS_UART UART_NUM_1
+#endif
+#define GPS_RX_BUFFER 1024
+#define GPS_RX_TIMEOUT 2 // symbols of silence before the driver posts what it has
+
+GpsReceiver gpsReceiver;
+
+uint32_t GpsFix::unixTime() const {
+    if (!dateTime) return 0;
+    tmElements_t tm;
+    tm.Year = CalendarYrToTm(year);
+    tm.Month = month;
+    tm.Day = day;
+    tm.Hour = hour;
+    tm.Minute = minute;
+    tm.Second = second;
+    return makeTime(tm);
+}
+
+/*********************************************************************
+**  Life cycle
+*********************************************************************/
+bool GpsReceiver::begin() {
+    if (task != NULL) {
+        users++;
+        return true;
+    }
+
+    releasePins();
+    port = GPS_UART;
+    uart_config_t config = {};
+    config.baud_rate = bruceConfigPins.gpsBaudrate;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    config.source_clk = UART_SCLK_DEFAULT;
+    if (uart_driver_install(port, GPS_RX_BUFFER, 0, 16, &events, 0) != ESP_OK) {
+        restorePins();
+        return false;
+    }
+    uart_param_config(port, &config);
+    uart_set_pin(
+        port, bruceConfigPins.gps_bus.tx, bruceConfigPins.gps_bus.rx, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE
+    );
+    uart_set_rx_timeout(port, GPS_RX_TIMEOUT);
+
+    gps = TinyGPSPlus();
+    positions = 0;
+    byteUs = 10000000UL / max<uint32_t>(bruceConfigPins.gpsBaudrate, 1200); // 8N1, 10 bits a byte
+    rxBytes = passed = failed = rxOverflows = 0;
+    lastDataUs = esp_timer_get_time();
+    published.store(0, std::memory_order_relaxed);
+    writing.store(0, std::memory_order_relaxed);
+    stopping = false;
+    exited = xSemaphoreCreateBinary();
+    // Above the UI so fixes are stamped when they arrive, it sleeps between sentences
+    if (!exited || xTaskCreate(rxTask, "GpsReceiver", 4096, this, 5, &task) != pdPASS) {
+        if (exited) vSemaphoreDelete(exited);
+        exited = NULL;
+        task = NULL;
+        uart_driver_delete(port);
+        restorePins();
+        return false;
+    }
+    users = 1;
+    return true;
+}
+
+void GpsReceiver::end() {
+    if (task == NULL || --users > 0) return;
+    stopping = true;
+    xSemaphoreTake(exited, portMAX_DELAY);
+    vSemaphoreDelete(exited);
+    exited = NULL;
+    task = NULL;
+    uart_driver_delete(port);
+    events = NULL;
+    restorePins();
+}
+
+/*********************************************************************
+**  Ingestion
+*********************************************************************/
+void GpsReceiver::rxTask(void *pvParameters) {
+    GpsReceiver *rx = (GpsReceiver *)pvParameters;
+    uint8_t buffer[128];
+    uart_event_t event;
+    while (!rx->stopping) {
+        if (xQueueReceive(rx->events, &event, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+        int64_t now = esp_timer_get_time();
+        switch (event.type) {
+            case UART_DATA: {
+                // The event comes GPS_RX_TIMEOUT symbols after the last byte, or as the FIFO fills up
+                size_t pending = event.size;
+                while (pending > 0) {
+                    int n = uart_read_bytes(rx->port, buffer, min(pending, sizeof(buffer)), 0);
+                    if (n <= 0) break;
+                    pending -= n;
+                    rx->parse(buffer, n, now - (int64_t)(pending + GPS_RX_TIMEOUT) * rx->byteUs);
+                }
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // Sentences are lost anyway, start again on a clean line
+                uart_flush_input(rx->port);
+                xQueueReset(rx->events);
+                rx->rxOverflows++;
+                break;
+            default: break;
+        }
+    }
+    xSemaphoreGive(rx->exited);
+    vTaskDelete(NULL);
+}
+
+// receivedUs is when the last byte of data arrived
+void GpsReceiver::parse(const uint8_t *data, size_t length, int64_t receivedUs) {
+    rxBytes += length;
+    lastDataUs = receivedUs;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == '$') sentenceUs = receivedUs - (int64_t)(length - 1 - i) * byteUs;
+        if (!gps.encode(data[i])) continue;
+        passed = gps.passedChecksum();
+        failed = gps.failedChecksum();
+        if (gps.location.isUpdated()) positions++;
+        if (gps.location.isUpdated() || gps.date.isUpdated() || gps.time.isUpdated()) publish();
+    }
+}
+
+void GpsReceiver::publish() {
+    uint32_t seq = published.load(std::memory_order_relaxed) + 1;
+    writing.store(seq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Readers copy the other slot, or retry if they raced this write
+    GpsFix &fix = slots[seq & 1];
+    fix.seq = seq;
+    fix.timeUs = sentenceUs;
+    fix.positions = positions;
+    fix.location = gps.location.isValid();
+    fix.dateTime = gps.date.isValid() && gps.time.isValid();
+    // Reading the values clears the updated flags for the next sentence
+    fix.lat = gps.location.lat();
+    fix.lng = gps.location.lng();
+    fix.altitude = gps.altitude.meters();
+    fix.hdop = gps.hdop.hdop();
+    fix.speed = gps.speed.kmph();
+    fix.course = gps.course.deg();
+    fix.satellites = gps.satellites.value();
+    fix.year = gps.date.year();
+    fix.month = gps.date.month();
+    fix.day = gps.date.day();
+    fix.hour = gps.time.hour();
+    fix.minute = gps.time.minute();
+    fix.second = gps.time.second();
+    fix.centisecond = gps.time.centisecond();
+
+    published.store(seq, std::memory_order_release);
+}
+
+bool GpsReceiver::latest(GpsFix &fix) const {
+    for (;;) {
+        uint32_t seq = published.load(std::memory_order_acquire);
+        if (seq == 0) return false;
+        fix = slots[seq & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // The slot is only written again for seq + 2
+        if (writing.load(std::memory_order_relaxed) - seq < 2) return true;
+    }
+}
+
+/*********************************************************************
+**  Pins
+*********************************************************************/
+void GpsReceiver::releasePins() {
+    rxPinReleased = false;
+    if (bruceConfigPins.CC1101_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+        bruceConfigPins.NRF24_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+#if !defined(LITE_VERSION)
+        bruceConfigPins.W5500_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+        bruceConfigPins.LoRa_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+#endif
+        bruceConfigPins.SDCARD_bus.checkConflict(bruceConfigPins.gps_bus.rx)) {
+        // T-Embed CC1101 and T-Display S3 Touch ties this pin to the NRF24 CS; switch it to input so the GPS
+        // UART can drive it.
+        pinMode(bruceConfigPins.gps_bus.rx, INPUT);
+        rxPinReleased = true;
+    }
+}
+
+void GpsReceiver::restorePins() {
+    if (rxPinReleased) {
+        if (bruceConfigPins.CC1101_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+            bruceConfigPins.NRF24_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+#if !defined(LITE_VERSION)
+            bruceConfigPins.W5500_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+            bruceConfigPins.LoRa_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
+#endif
+            bruceConfigPins.SDCARD_bus.checkConflict(bruceConfigPins.gps_bus.rx)) {
+            // Restore the original board state after leaving the GPS app s
+            // o the radio/other peripherals behave as expected
+            pinMode(bruceConfigPins.gps_bus.rx, OUTPUT);
+            if (bruceConfigPins.gps_bus.rx == bruceConfigPins.CC1101_bus.cs ||
+                bruceConfigPins.gps_bus.rx == bruceConfigPins.NRF24_bus.cs ||
+#if !defined(LITE_VERSION)
+                bruceConfigPins.gps_bus.rx == bruceConfigPins.W5500_bus.cs ||
+                bruceConfigPins.gps_bus.rx == bruceConfigPins.W5500_bus.cs ||
+#endif
+                bruceConfigPins.gps_bus.rx == bruceConfigPins.SDCARD_bus.cs) {
+                // If it is conflicting to an SPI CS pin, keep it HIGH
+                digitalWrite(bruceConfigPins.gps_bus.rx, HIGH);
+            } else {
+                // If it is conflicting with any other SPI pin, keep it LOW
+                // Avoids CC1101 Jamming and nRF24 radio to keep enabled
+                digitalWrite(bruceConfigPins.gps_bus.rx, LOW);
+            }
+        }
+        rxPinReleased = false;
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * @file gps_receiver.h
+ * @brief NMEA ingestion task, publishes timestamped fixes to the rest of the firmware
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#ifndef __GPS_RECEIVER_H__
+#define __GPS_RECEIVER_H__
+
+#include <TinyGPS++.h>
+#include <atomic>
+#include <driver/uart.h>
+#include <esp_timer.h>
+#include <globals.h>
+
+// Snapshot of the receiver state after a sentence that updated the position, date or time
+struct GpsFix {
+    uint32_t seq;       // increases with every published fix, 0 = none yet
+    int64_t timeUs;     // esp_timer_get_time() when the first byte of the sentence arrived
+    uint32_t positions; // sentences that carried a position so far
+    bool location;      // lat/lng are valid
+    bool dateTime;      // date and time are valid
+    double lat;
+    double lng;
+    float altitude; // meters
+    float hdop;
+    float speed;  // km/h
+    float course; // degrees
+    uint32_t satellites;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t centisecond;
+
+    uint32_t ageMs() const { return (esp_timer_get_time() - timeUs) / 1000; }
+    // Unix time of the fix, 0 without a date
+    uint32_t unixTime() const;
+};
+
+// Owns the GPS UART while at least one user has it open. A task blocks on the UART event queue,
+// feeds TinyGPS++ and publishes a fix per sentence into two slots guarded by a sequence number,
+// so readers never wait for the parser and the parser never waits for them.
+class GpsReceiver {
+public:
+    // Opens the UART on the configured pins, counted, every begin() needs an end()
+    bool begin();
+    void end();
+    bool running() const { return task != NULL; }
+
+    // Latest fix, false if none was published yet
+    bool latest(GpsFix &fix) const;
+    uint32_t sequence() const { return published.load(std::memory_order_acquire); }
+
+    uint32_t bytes() const { return rxBytes; }
+    // Milliseconds since the last byte, or since begin() if nothing was received
+    uint32_t idleMs() const { return (esp_timer_get_time() - lastDataUs) / 1000; }
+    uint32_t sentences() const { return passed; }
+    uint32_t failedChecksums() const { return failed; }
+    uint32_t overflows() const { return rxOverflows; }
+
+private:
+    uart_port_t port = UART_NUM_MAX;
+    QueueHandle_t events = NULL;
+    TaskHandle_t task = NULL;
+    SemaphoreHandle_t exited = NULL;
+    volatile bool stopping = false;
+    uint8_t users = 0;
+    bool rxPinReleased = false;
+
+    TinyGPSPlus gps;
+    int64_t sentenceUs = 0;
+    uint32_t positions = 0;
+    uint32_t byteUs = 0; // time on the wire of one byte
+
+    GpsFix slots[2];
+    std::atomic<uint32_t> published{0}; // seq of the last complete slot
+    std::atomic<uint32_t> writing{0};   // seq of the slot being written
+
+    volatile uint32_t rxBytes = 0;
+    volatile int64_t lastDataUs = 0;
+    volatile uint32_t passed = 0;
+    volatile uint32_t failed = 0;
+    volatile uint32_t rxOverflows = 0;
+
+    void parse(const uint8_t *data, size_t length, int64_t receivedUs);
+    void publish();
+    void releasePins();
+    void restorePins();
+    static void rxTask(void *pvParameters);
+};
+
+extern GpsReceiver gpsReceiver;
+
+#endif // GPS_RECEIVER_H
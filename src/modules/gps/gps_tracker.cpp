@@ -12,7 +12,7 @@
 #include "core/sd_functions.h"
 #include "current_year.h"
 
-#define MAX_WAIT 5000
+#define GPS_TIMEOUT_MS 30000
 
 GPSTracker::GPSTracker() { setup(); }
 
@@ -39,14 +39,15 @@ void GPSTracker::setup() {
 }
 
 bool GPSTracker::begin_gps() {
-    releasePins();
-    GPSserial.begin(
-        bruceConfigPins.gpsBaudrate, SERIAL_8N1, bruceConfigPins.gps_bus.rx, bruceConfigPins.gps_bus.tx
-    );
+    if (!gpsReceiver.begin()) {
+        displayError("GPS UART error", true);
+        returnToMenu = true;
+        return false;
+    }
 
     int count = 0;
     padprintln("Waiting for GPS data");
-    while (GPSserial.available() <= 0) {
+    while (gpsReceiver.bytes() == 0) {
         if (check(EscPress)) {
             end();
             return false;
@@ -61,57 +62,55 @@ bool GPSTracker::begin_gps() {
 }
 
 void GPSTracker::end() {
-    GPSserial.end();
-    restorePins();
+    gpsReceiver.end();
 
     returnToMenu = true;
     gpsConnected = false;
 }
 
 void GPSTracker::loop() {
-    int count = 0;
+    uint32_t lastDraw = 0;
     returnToMenu = false;
     while (1) {
-        display_banner();
-
         if (check(EscPress) || returnToMenu) return end();
 
-        if (GPSserial.available() > 0) {
-            count = 0;
-            while (GPSserial.available() > 0) gps.encode(GPSserial.read());
+        if (gpsReceiver.idleMs() > GPS_TIMEOUT_MS) {
+            displayError("GPS not Found!");
+            return end();
+        }
 
-            if (gps.location.isUpdated()) {
-                padprintln("GPS location updated");
+        // The receiver task parses in the background, only new fixes are handled here
+        GpsFix latest;
+        if (gpsReceiver.latest(latest) && latest.seq != fix.seq) {
+            // GGA and RMC both carry the position of an epoch, keep one point per epoch
+            bool point = latest.location && latest.positions != fix.positions &&
+                         (latest.second != fix.second || latest.centisecond != fix.centisecond ||
+                          latest.minute != fix.minute || gpsCoordCount == 0);
+            fix = latest;
+            if (filename == "" && fix.dateTime && fix.year >= CURRENT_YEAR && fix.year < CURRENT_YEAR + 5)
+                create_filename();
+            if (point) {
                 set_position();
                 add_coord();
-            } else {
-                padprintln("GPS location not updated");
-                dump_gps_data();
-
-                if (filename == "" && gps.date.year() >= CURRENT_YEAR && gps.date.year() < CURRENT_YEAR + 5)
-                    create_filename();
-            }
-        } else {
-            if (count > 5) {
-                displayError("GPS not Found!");
-                return end();
+                lastDraw = 0;
             }
-            padprintln("No GPS data available");
-            count++;
         }
 
-        int tmp = millis();
-        while (millis() - tmp < MAX_WAIT && !gps.location.isUpdated()) {
-            if (check(EscPress) || returnToMenu) return end();
+        if (millis() - lastDraw > 1000) {
+            display_banner();
+            dump_gps_data();
+            if (fix.location) padprintf(2, "Coord: %.6f, %.6f\n", fix.lat, fix.lng);
+            lastDraw = millis();
         }
+        vTaskDelay(20 / portTICK_PERIOD_MS);
     }
 }
 
 void GPSTracker::set_position() {
-    double lat = gps.location.lat();
-    double lng = gps.location.lng();
+    double lat = fix.lat;
+    double lng = fix.lng;
 
-    if (initial_position_set) distance += gps.distanceBetween(cur_lat, cur_lng, lat, lng);
+    if (initial_position_set) distance += TinyGPSPlus::distanceBetween(cur_lat, cur_lng, lat, lng);
     else initial_position_set = true;
 
     cur_lat = lat;
@@ -132,15 +131,15 @@ void GPSTracker::display_banner() {
 }
 
 void GPSTracker::dump_gps_data() {
-    if (!date_time_updated && (!gps.date.isUpdated() || !gps.time.isUpdated())) {
+    if (!date_time_updated && !fix.dateTime) {
         padprintln("Waiting for valid GPS data");
         return;
     }
     date_time_updated = true;
-    padprintf(2, "Date: %02d-%02d-%02d\n", gps.date.year(), gps.date.month(), gps.date.day());
-    padprintf(2, "Time: %02d:%02d:%02d\n", gps.time.hour(), gps.time.minute(), gps.time.second());
-    padprintf(2, "Sat:  %d\n", gps.satellites.value());
-    padprintf(2, "HDOP: %.2f\n", gps.hdop.hdop());
+    padprintf(2, "Date: %02d-%02d-%02d\n", fix.year, fix.month, fix.day);
+    padprintf(2, "Time: %02d:%02d:%02d\n", fix.hour, fix.minute, fix.second);
+    padprintf(2, "Sat:  %lu\n", (unsigned long)fix.satellites);
+    padprintf(2, "HDOP: %.2f\n", fix.hdop);
 }
 
 void GPSTracker::create_filename() {
@@ -148,12 +147,12 @@ void GPSTracker::create_filename() {
     sprintf(
         timestamp,
         "%02d%02d%02d_%02d%02d%02d",
-        gps.date.year() % 100,
-        gps.date.month() % 100,
-        gps.date.day() % 100,
-        gps.time.hour() % 100,
-        gps.time.minute() % 100,
-        gps.time.second() % 100
+        fix.year % 100,
+        fix.month % 100,
+        fix.day % 100,
+        fix.hour % 100,
+        fix.minute % 100,
+        fix.second % 100
     );
     filename = String(timestamp) + "_gps_tracker.gpx";
 }
@@ -222,63 +221,26 @@ void GPSTracker::add_coord() {
 
     if (is_new_file) add_initial_file_data(file);
 
-    file.printf("      <trkpt lat=\"%f\" lon=\"%f\">\n", gps.location.lat(), gps.location.lng());
+    file.printf("      <trkpt lat=\"%f\" lon=\"%f\">\n", fix.lat, fix.lng);
     file.println("        <sym>Waypoint</sym>");
-    file.printf("        <ele>%f</ele>\n", gps.altitude.meters());
-    file.printf("        <hdop>%f</hdop>\n", gps.hdop.hdop());
-    file.printf("        <sat>%ld</sat>\n", gps.satellites.value());
+    file.printf("        <ele>%f</ele>\n", fix.altitude);
+    if (fix.dateTime) {
+        file.printf(
+            "        <time>%04d-%02d-%02dT%02d:%02d:%02d.%02dZ</time>\n",
+            fix.year,
+            fix.month,
+            fix.day,
+            fix.hour,
+            fix.minute,
+            fix.second,
+            fix.centisecond
+        );
+    }
+    file.printf("        <hdop>%f</hdop>\n", fix.hdop);
+    file.printf("        <sat>%lu</sat>\n", (unsigned long)fix.satellites);
     file.println("      </trkpt>");
 
     gpsCoordCount++;
 
     file.close();
-
-    padprintf(2, "Coord: %.6f, %.6f\n", gps.location.lat(), gps.location.lng());
-}
-
-void GPSTracker::releasePins() {
-    rxPinReleased = false;
-    if (bruceConfigPins.CC1101_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-        bruceConfigPins.NRF24_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#if !defined(LITE_VERSION)
-        bruceConfigPins.W5500_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-        bruceConfigPins.LoRa_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#endif
-        bruceConfigPins.SDCARD_bus.checkConflict(bruceConfigPins.gps_bus.rx)) {
-        // T-Embed CC1101 and T-Display S3 Touch ties this pin to the NRF24 CS; switch it to input so the GPS
-        // UART can drive it.
-        pinMode(bruceConfigPins.gps_bus.rx, INPUT);
-        rxPinReleased = true;
-    }
-}
-
-void GPSTracker::restorePins() {
-    if (rxPinReleased) {
-        if (bruceConfigPins.CC1101_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-            bruceConfigPins.NRF24_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#if !defined(LITE_VERSION)
-            bruceConfigPins.W5500_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-            bruceConfigPins.LoRa_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#endif
-            bruceConfigPins.SDCARD_bus.checkConflict(bruceConfigPins.gps_bus.rx)) {
-            // Restore the original board state after leaving the GPS app s
-            // o the radio/other peripherals behave as expected
-            pinMode(bruceConfigPins.gps_bus.rx, OUTPUT);
-            if (bruceConfigPins.gps_bus.rx == bruceConfigPins.CC1101_bus.cs ||
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.NRF24_bus.cs ||
-#if !defined(LITE_VERSION)
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.W5500_bus.cs ||
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.W5500_bus.cs ||
-#endif
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.SDCARD_bus.cs) {
-                // If it is conflicting to an SPI CS pin, keep it HIGH
-                digitalWrite(bruceConfigPins.gps_bus.rx, HIGH);
-            } else {
-                // If it is conflicting with any other SPI pin, keep it LOW
-                // Avoids CC1101 Jamming and nRF24 radio to keep enabled
-                digitalWrite(bruceConfigPins.gps_bus.rx, LOW);
-            }
-        }
-        rxPinReleased = false;
-    }
 }
@@ -9,7 +9,7 @@
 #ifndef __GPS_TRACKER_H__
 #define __GPS_TRACKER_H__
 
-#include <TinyGPS++.h>
+#include "gps_receiver.h"
 #include <globals.h>
 
 class GPSTracker {
@@ -33,18 +33,14 @@ private:
     double cur_lng;
     double distance = 0;
     String filename = "";
-    TinyGPSPlus gps;
-    HardwareSerial GPSserial = HardwareSerial(2);
+    GpsFix fix = {}; // last fix taken from the receiver
     int gpsCoordCount = 0;
-    bool rxPinReleased = false;
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Setup
     /////////////////////////////////////////////////////////////////////////////////////
     bool begin_gps(void);
     void end(void);
-    void releasePins(void);
-    void restorePins(void);
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Display functions
@@ -12,8 +12,29 @@
 #include "core/sd_functions.h"
 #include "core/wifi/wifi_common.h"
 #include "current_year.h"
-
-#define MAX_WAIT 5000
+#include "modules/wifi/sniffer.h" // channel lists
+#include <TimeLib.h>
+#include <algorithm>
+#include <esp_heap_caps.h>
+#include <esp_wifi.h>
+#include <vector>
+
+#define GPS_TIMEOUT_MS 30000
+#define WARDRIVING_DIR "/BruceWardriving"
+#define WARDRIVING_QUEUE_LEN 64
+#define WARDRIVING_DWELL_MS 120      // a bit more than one beacon interval
+#define WARDRIVING_FIX_MAX_AGE 2000  // ms, older fixes are not attached to observations
+#define WARDRIVING_SETTLE_MS 15000   // a network is written once its best position stopped improving
+#define WARDRIVING_FLUSH_MS 5000
+#define WARDRIVING_STALE_MS 120000   // networks not heard for this long leave the table when it fills up
+#define WARDRIVING_NETWORKS 512      // slots, 3/4 usable
+#define WARDRIVING_NETWORKS_PSRAM 8192
+#define WARDRIVING_SEEN_BITS 65536   // 8kB, under 1% of a 5000 network drive goes uncounted
+#define WARDRIVING_SEEN_BITS_PSRAM 1048576
+#define WARDRIVING_BUFFER 4096
+
+QueueHandle_t Wardriving::observations = NULL;
+volatile uint32_t Wardriving::droppedObservations = 0;
 
 Wardriving::Wardriving() { setup(); }
 
@@ -33,27 +54,72 @@ void Wardriving::setup() {
     display_banner();
     padprintln("Initializing...");
 
-    begin_wifi();
+    if (!begin_wifi()) {
+        displayError("Not enough memory", true);
+        return;
+    }
     if (!begin_gps()) return;
 
     vTaskDelay(500 / portTICK_PERIOD_MS);
     return loop();
 }
 
-void Wardriving::begin_wifi() {
+bool Wardriving::begin_wifi() {
+    networkCapacity = psramFound() ? WARDRIVING_NETWORKS_PSRAM : WARDRIVING_NETWORKS;
+    networks = (WardrivingNetwork *)heap_caps_calloc(
+        networkCapacity, sizeof(WardrivingNetwork), MALLOC_CAP_SPIRAM
+    );
+    if (!networks) {
+        networkCapacity = WARDRIVING_NETWORKS;
+        networks = (WardrivingNetwork *)calloc(networkCapacity, sizeof(WardrivingNetwork));
+    }
+    seenBitCount = psramFound() ? WARDRIVING_SEEN_BITS_PSRAM : WARDRIVING_SEEN_BITS;
+    seenBits = (uint32_t *)heap_caps_calloc(seenBitCount / 32, sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    if (!seenBits) {
+        seenBitCount = WARDRIVING_SEEN_BITS;
+        seenBits = (uint32_t *)calloc(seenBitCount / 32, sizeof(uint32_t));
+    }
+    writeBuffer = (char *)malloc(WARDRIVING_BUFFER);
+    // The queue outlives the session, the callback may still run while the radio stops
+    if (observations == NULL) {
+        observations = xQueueCreate(WARDRIVING_QUEUE_LEN, sizeof(WardrivingObservation));
+    }
+    if (!networks || !seenBits || !writeBuffer || !observations) {
+        free(networks);
+        free(seenBits);
+        free(writeBuffer);
+        networks = nullptr;
+        seenBits = nullptr;
+        writeBuffer = nullptr;
+        return false;
+    }
+    xQueueReset(observations);
+    droppedObservations = 0;
+
     WiFi.mode(WIFI_STA);
     WiFi.disconnect();
+
+    // Listen to beacons and probe responses on every channel instead of scanning
+    wifi_promiscuous_filter_t filter = {.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT};
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(promiscuous_rx);
+    esp_wifi_set_promiscuous(true);
+    hopIndex = 0;
+    hopMs = millis();
+    esp_wifi_set_channel(all_wifi_channels[hopIndex], WIFI_SECOND_CHAN_NONE);
+    return true;
 }
 
 bool Wardriving::begin_gps() {
-    releasePins();
-    GPSserial.begin(
-        bruceConfigPins.gpsBaudrate, SERIAL_8N1, bruceConfigPins.gps_bus.rx, bruceConfigPins.gps_bus.tx
-    );
+    if (!gpsReceiver.begin()) {
+        displayError("GPS UART error", true);
+        end();
+        return false;
+    }
 
     int count = 0;
     padprintln("Waiting for GPS data");
-    while (GPSserial.available() <= 0) {
+    while (gpsReceiver.bytes() == 0) {
         if (check(EscPress)) {
             end();
             return false;
@@ -68,58 +134,74 @@ bool Wardriving::begin_gps() {
 }
 
 void Wardriving::end() {
+    esp_wifi_set_promiscuous(false);
+    esp_wifi_set_promiscuous_rx_cb(nullptr);
+    drain_observations();
+    write_networks(true);
+    flush_file();
+    if (file) file.close();
+    free(networks);
+    free(seenBits);
+    free(writeBuffer);
+    networks = nullptr;
+    seenBits = nullptr;
+    writeBuffer = nullptr;
+    networkCapacity = networkCount = 0;
+
     wifiDisconnect();
 
-    GPSserial.end();
-    restorePins();
+    gpsReceiver.end();
     returnToMenu = true;
     gpsConnected = false;
 }
 
 void Wardriving::loop() {
-    int count = 0;
+    uint32_t lastFlush = millis();
+    uint32_t lastDraw = 0;
     returnToMenu = false;
     while (1) {
-        display_banner();
-
         if (check(EscPress) || returnToMenu) return end();
 
-        if (GPSserial.available() > 0) {
-            count = 0;
-            while (GPSserial.available() > 0) gps.encode(GPSserial.read());
-
-            if (gps.location.isUpdated()) {
-                padprintln("GPS location updated");
+        // GPS, radio and storage are serviced without ever waiting on one another
+        if (gpsReceiver.idleMs() > GPS_TIMEOUT_MS) {
+            displayError("GPS not Found!");
+            return end();
+        }
+        GpsFix latest;
+        if (gpsReceiver.latest(latest) && latest.seq != fix.seq) {
+            bool moved = latest.location && latest.positions != fix.positions;
+            fix = latest;
+            if (moved) {
+                position[1] = position[0];
+                position[0] = fix;
                 set_position();
-                scan_networks();
-            } else {
-                padprintln("GPS location not updated");
-                dump_gps_data();
-
-                if (filename == "" && gps.date.year() >= CURRENT_YEAR && gps.date.year() < CURRENT_YEAR + 5)
-                    create_filename();
-            }
-        } else {
-            if (count > 5) {
-                displayError("GPS not Found!");
-                return end();
             }
-            padprintln("No GPS data available");
-            count++;
+            if (filename == "" && fix.dateTime && fix.year >= CURRENT_YEAR && fix.year < CURRENT_YEAR + 5)
+                create_filename();
         }
 
-        int tmp = millis();
-        while (millis() - tmp < MAX_WAIT && !gps.location.isUpdated()) {
-            if (check(EscPress) || returnToMenu) return end();
+        drain_observations();
+        hop_channel();
+
+        if (millis() - lastFlush > WARDRIVING_FLUSH_MS) {
+            write_networks(false);
+            flush_file();
+            lastFlush = millis();
+        }
+        if (millis() - lastDraw > 1000) {
+            display_banner();
+            dump_gps_data();
+            lastDraw = millis();
         }
+        vTaskDelay(5 / portTICK_PERIOD_MS);
     }
 }
 
 void Wardriving::set_position() {
-    double lat = gps.location.lat();
-    double lng = gps.location.lng();
+    double lat = fix.lat;
+    double lng = fix.lng;
 
-    if (initial_position_set) distance += gps.distanceBetween(cur_lat, cur_lng, lat, lng);
+    if (initial_position_set) distance += TinyGPSPlus::distanceBetween(cur_lat, cur_lng, lat, lng);
     else initial_position_set = true;
 
     cur_lat = lat;
@@ -134,21 +216,31 @@ void Wardriving::display_banner() {
         padprintln("File: " + filename.substring(0, filename.length() - 4), 2);
         padprintln("Unique Networks Found: " + String(wifiNetworkCount), 2);
         padprintf(2, "Distance: %.2fkm\n", distance / 1000);
+        if (distance >= 1000) padprintf(2, "Networks/km: %.1f\n", wifiNetworkCount / (distance / 1000));
     }
+    padprintf(
+        2,
+        "Ch %d, %lu beacons, %lu lines\n",
+        all_wifi_channels[hopIndex],
+        (unsigned long)observationCount,
+        (unsigned long)linesWritten
+    );
+    if (droppedObservations > 0) padprintf(2, "Dropped: %lu\n", (unsigned long)droppedObservations);
 
     padprintln("");
 }
 
 void Wardriving::dump_gps_data() {
-    if (!date_time_updated && (!gps.date.isUpdated() || !gps.time.isUpdated())) {
+    if (!date_time_updated && !fix.dateTime) {
         padprintln("Waiting for valid GPS data");
         return;
     }
     date_time_updated = true;
-    padprintf(2, "Date: %02d-%02d-%02d\n", gps.date.year(), gps.date.month(), gps.date.day());
-    padprintf(2, "Time: %02d:%02d:%02d\n", gps.time.hour(), gps.time.minute(), gps.time.second());
-    padprintf(2, "Sat:  %d\n", gps.satellites.value());
-    padprintf(2, "HDOP: %.2f\n", gps.hdop.hdop());
+    padprintf(2, "Date: %02d-%02d-%02d\n", fix.year, fix.month, fix.day);
+    padprintf(2, "Time: %02d:%02d:%02d\n", fix.hour, fix.minute, fix.second);
+    padprintf(2, "Sat:  %lu\n", (unsigned long)fix.satellites);
+    padprintf(2, "HDOP: %.2f\n", fix.hdop);
+    if (fix.location) padprintf(2, "Coord: %.6f, %.6f\n", fix.lat, fix.lng);
 }
 
 String Wardriving::auth_mode_to_string(wifi_auth_mode_t authMode) {
@@ -166,56 +258,278 @@ String Wardriving::auth_mode_to_string(wifi_auth_mode_t authMode) {
     }
 }
 
-void Wardriving::scan_networks() {
-    wifiConnected = true;
+/////////////////////////////////////////////////////////////////////////////////////
+// Radio
+/////////////////////////////////////////////////////////////////////////////////////
+
+// Security of a network from its beacon, as WiFi.encryptionType() reports it after a scan
+static wifi_auth_mode_t beacon_auth_mode(const uint8_t *ies, int len, bool privacy) {
+    bool wpa = false, rsn = false, psk = false, sae = false, eap = false;
+    for (int offset = 0; offset + 2 <= len;) {
+        uint8_t tag = ies[offset];
+        uint8_t tagLength = ies[offset + 1];
+        const uint8_t *body = ies + offset + 2;
+        if (offset + 2 + tagLength > len) break;
+        if (tag == 221 && tagLength >= 4 && body[0] == 0x00 && body[1] == 0x50 && body[2] == 0xF2 &&
+            body[3] == 0x01) {
+            wpa = true;
+        } else if (tag == 48 && tagLength >= 8) {
+            rsn = true;
+            // version, group cipher, pairwise ciphers, then the AKM suites
+            int pos = 6;
+            int pairwise = body[pos] | (body[pos + 1] << 8);
+            pos += 2 + 4 * pairwise;
+            if (pos + 2 <= tagLength) {
+                int akms = body[pos] | (body[pos + 1] << 8);
+                pos += 2;
+                for (int i = 0; i < akms && pos + 4 <= tagLength; i++, pos += 4) {
+                    switch (body[pos + 3]) {
+                        case 1:
+                        case 5: eap = true; break;
+                        case 2:
+                        case 6: psk = true; break;
+                        case 8: sae = true; break;
+                    }
+                }
+            }
+        }
+        offset += 2 + tagLength;
+    }
+    if (rsn) {
+        if (eap) return WIFI_AUTH_WPA2_ENTERPRISE;
+        if (sae) return psk ? WIFI_AUTH_WPA2_WPA3_PSK : WIFI_AUTH_WPA3_PSK;
+        return wpa ? WIFI_AUTH_WPA_WPA2_PSK : WIFI_AUTH_WPA2_PSK;
+    }
+    if (wpa) return WIFI_AUTH_WPA_PSK;
+    return privacy ? WIFI_AUTH_WEP : WIFI_AUTH_OPEN;
+}
 
-    int network_amount = WiFi.scanNetworks();
-    if (network_amount == 0) {
-        padprintln("No Wi-Fi networks found", 2);
-        return;
+// Runs in the WiFi task, only parses the frame and queues it
+void Wardriving::promiscuous_rx(void *buf, wifi_promiscuous_pkt_type_t type) {
+    if (type != WIFI_PKT_MGMT) return;
+    const wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
+    const uint8_t *frame = pkt->payload;
+    int len = pkt->rx_ctrl.sig_len - 4; // FCS
+    if (len < 36) return;
+    uint8_t subtype = frame[0] >> 4;
+    if (subtype != 8 && subtype != 5) return; // beacon, probe response
+
+    WardrivingObservation obs = {};
+    obs.timeUs = esp_timer_get_time();
+    memcpy(obs.bssid, frame + 16, 6);
+    obs.rssi = pkt->rx_ctrl.rssi;
+    obs.channel = pkt->rx_ctrl.channel;
+    const uint8_t *ies = frame + 36;
+    int iesLength = len - 36;
+    for (int offset = 0; offset + 2 <= iesLength;) {
+        uint8_t tag = ies[offset];
+        uint8_t tagLength = ies[offset + 1];
+        if (offset + 2 + tagLength > iesLength) break;
+        if (tag == 0 && tagLength <= 32) {
+            memcpy(obs.ssid, ies + offset + 2, tagLength);
+        } else if (tag == 3 && tagLength == 1) {
+            obs.channel = ies[offset + 2]; // the frame may leak from a neighbour channel
+        }
+        offset += 2 + tagLength;
     }
+    bool privacy = frame[34] & 0x10;
+    obs.authMode = beacon_auth_mode(ies, iesLength, privacy);
 
-    padprintf(2, "Coord: %.6f, %.6f\n", gps.location.lat(), gps.location.lng());
-    padprintln("Networks Found: " + String(network_amount), 2);
+    if (xQueueSend(observations, &obs, 0) != pdTRUE) droppedObservations++;
+}
 
-    return append_to_file(network_amount);
+void Wardriving::hop_channel() {
+    // Busy channels are listened to twice as long
+    uint8_t channel = all_wifi_channels[hopIndex];
+    uint32_t dwell = WARDRIVING_DWELL_MS;
+    for (uint8_t c : pri_wifi_channels) {
+        if (c == channel) dwell *= 2;
+    }
+    if (millis() - hopMs < dwell) return;
+    hopIndex = (hopIndex + 1) % sizeof(all_wifi_channels);
+    hopMs = millis();
+    esp_wifi_set_channel(all_wifi_channels[hopIndex], WIFI_SECOND_CHAN_NONE);
 }
 
+void Wardriving::drain_observations() {
+    if (!networks) return;
+    WardrivingObservation obs;
+    while (xQueueReceive(observations, &obs, 0) == pdTRUE) add_observation(obs);
+}
+
+void Wardriving::add_observation(const WardrivingObservation &obs) {
+    observationCount++;
+    WardrivingNetwork *net = find_network(obs.bssid, true);
+    if (!net) {
+        evict_networks();
+        net = find_network(obs.bssid, true);
+        if (!net) return;
+    }
+    uint32_t now = millis();
+    net->lastSeenMs = now;
+    if (obs.ssid[0] != '\0') memcpy(net->ssid, obs.ssid, sizeof(net->ssid));
+    net->authMode = obs.authMode;
+
+    // Position of the sentence closest in time to the frame. A frame queued before the newest
+    // sentence arrived is often nearer the one before it.
+    const GpsFix *at = nullptr;
+    int64_t best = WARDRIVING_FIX_MAX_AGE * 1000LL;
+    for (const GpsFix &candidate : position) {
+        int64_t gap = llabs(obs.timeUs - candidate.timeUs);
+        if (candidate.location && gap < best) {
+            best = gap;
+            at = &candidate;
+        }
+    }
+    if (!at || (net->located && obs.rssi <= net->rssi)) return;
+
+    // Closest to the AP so far, keep this position. A network evicted from the table comes back
+    // unlocated, the seen filter keeps it from being counted twice.
+    if (!net->located) {
+        if (first_sighting(obs.bssid)) wifiNetworkCount++;
+        net->firstSeen = at->unixTime();
+    }
+    net->located = true;
+    net->dirty = true;
+    net->improvedMs = now;
+    net->rssi = obs.rssi;
+    net->channel = obs.channel;
+    net->lat = lround(at->lat * 1e7);
+    net->lng = lround(at->lng * 1e7);
+    net->altitude = constrain(at->altitude, INT16_MIN, INT16_MAX);
+    net->hdop = min<uint32_t>(lround(at->hdop * 100), UINT16_MAX);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Networks table
+/////////////////////////////////////////////////////////////////////////////////////
+
+static size_t bssid_home(const uint8_t *bssid, size_t capacity) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (int i = 0; i < 6; i++) h = (h ^ bssid[i]) * 16777619u;
+    return h & (capacity - 1);
+}
+
+// Bloom filter over every BSSID located this session, true the first time
+bool Wardriving::first_sighting(const uint8_t *bssid) {
+    uint32_t h1 = 2166136261u, h2 = 0;
+    for (int i = 0; i < 6; i++) {
+        h1 = (h1 ^ bssid[i]) * 16777619u;
+        h2 = h2 * 31 + bssid[i];
+    }
+    h2 = h2 * 2654435761u | 1;
+    bool seen = true;
+    for (uint32_t k = 0; k < 3; k++) {
+        uint32_t bit = (h1 + k * h2) & (seenBitCount - 1);
+        if (!(seenBits[bit / 32] & (1u << (bit % 32)))) seen = false;
+        seenBits[bit / 32] |= 1u << (bit % 32);
+    }
+    return !seen;
+}
+
+WardrivingNetwork *Wardriving::find_network(const uint8_t *bssid, bool create) {
+    size_t mask = networkCapacity - 1;
+    for (size_t i = bssid_home(bssid, networkCapacity);; i = (i + 1) & mask) {
+        WardrivingNetwork &net = networks[i];
+        if (!net.used) {
+            if (!create || (networkCount + 1) * 4 > networkCapacity * 3) return nullptr;
+            memset(&net, 0, sizeof(net));
+            memcpy(net.bssid, bssid, 6);
+            net.used = true;
+            networkCount++;
+            return &net;
+        }
+        if (memcmp(net.bssid, bssid, 6) == 0) return &net;
+    }
+}
+
+// Linear probing deletion: entries after the hole that can reach it move back
+void Wardriving::erase_network(size_t index) {
+    size_t mask = networkCapacity - 1;
+    networks[index].used = false;
+    networkCount--;
+    for (size_t j = (index + 1) & mask; networks[j].used; j = (j + 1) & mask) {
+        size_t home = bssid_home(networks[j].bssid, networkCapacity);
+        // move j into the hole unless its home lies cyclically in (index, j]
+        bool reachable = index <= j ? (home > index && home <= j) : (home > index || home <= j);
+        if (reachable) continue;
+        networks[index] = networks[j];
+        networks[j].used = false;
+        index = j;
+    }
+}
+
+// The table is full: write what is pending and forget the networks left behind
+void Wardriving::evict_networks() {
+    write_networks(true);
+    flush_file();
+    uint32_t now = millis();
+    size_t before = networkCount;
+    for (size_t i = 0; i < networkCapacity;) {
+        const WardrivingNetwork &net = networks[i];
+        if (net.used && !net.dirty && now - net.lastSeenMs > WARDRIVING_STALE_MS) erase_network(i);
+        else i++; // an erase moves another entry into i
+    }
+    if (networkCount * 8 > networkCapacity * 5) {
+        // Everything was heard recently, drop the quietest quarter of the table
+        std::vector<uint32_t> seen;
+        seen.reserve(networkCount);
+        for (size_t i = 0; i < networkCapacity; i++) {
+            if (networks[i].used) seen.push_back(networks[i].lastSeenMs);
+        }
+        auto oldest = seen.begin() + seen.size() / 4;
+        std::nth_element(seen.begin(), oldest, seen.end(), [&](uint32_t a, uint32_t b) {
+            return now - a > now - b;
+        });
+        uint32_t cutoff = now - *oldest;
+        for (size_t i = 0; i < networkCapacity;) {
+            const WardrivingNetwork &net = networks[i];
+            if (net.used && !net.dirty && now - net.lastSeenMs >= cutoff) erase_network(i);
+            else i++;
+        }
+    }
+    Serial.printf("Wardriving: table full, %u networks forgotten\n", (unsigned)(before - networkCount));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Storage
+/////////////////////////////////////////////////////////////////////////////////////
+
 void Wardriving::create_filename() {
     char timestamp[20];
     sprintf(
         timestamp,
         "%02d%02d%02d_%02d%02d%02d",
-        gps.date.year() % 100,
-        gps.date.month() % 100,
-        gps.date.day() % 100,
-        gps.time.hour() % 100,
-        gps.time.minute() % 100,
-        gps.time.second() % 100
+        fix.year % 100,
+        fix.month % 100,
+        fix.day % 100,
+        fix.hour % 100,
+        fix.minute % 100,
+        fix.second % 100
     );
     filename = String(timestamp) + "_wardriving.csv";
 }
 
-void Wardriving::append_to_file(int network_amount) {
+bool Wardriving::open_file() {
+    if (file) return true;
+    if (filename == "") return false; // named after the first GPS date
+
     FS *fs;
     if (!getFsStorage(fs)) {
         padprintln("Storage setup error");
         returnToMenu = true;
-        return;
+        return false;
     }
 
-    if (filename == "") create_filename();
-
-    if (!(*fs).exists("/BruceWardriving")) (*fs).mkdir("/BruceWardriving");
+    if (!(*fs).exists(WARDRIVING_DIR)) (*fs).mkdir(WARDRIVING_DIR);
 
-    bool is_new_file = false;
-    if (!(*fs).exists("/BruceWardriving/" + filename)) is_new_file = true;
-    File file = (*fs).open("/BruceWardriving/" + filename, is_new_file ? FILE_WRITE : FILE_APPEND);
+    bool is_new_file = !(*fs).exists(WARDRIVING_DIR "/" + filename);
+    file = (*fs).open(WARDRIVING_DIR "/" + filename, is_new_file ? FILE_WRITE : FILE_APPEND);
 
     if (!file) {
         padprintln("Failed to open file for writing");
         returnToMenu = true;
-        return;
+        return false;
     }
 
     if (is_new_file) {
@@ -229,89 +543,74 @@ void Wardriving::append_to_file(int network_amount) {
             "AltitudeMeters,AccuracyMeters,RCOIs,MfgrId,Type"
         );
     }
+    return true;
+}
 
-    for (int i = 0; i < network_amount; i++) {
-        String macAddress = WiFi.BSSIDstr(i);
-
-        // Check if MAC was already found in this session
-        if (registeredMACs.find(macAddress) == registeredMACs.end()) {
-            registeredMACs.insert(macAddress); // Adds MAC to file
-            int32_t channel = WiFi.channel(i);
-
-            char buffer[512];
-            snprintf(
-                buffer,
-                sizeof(buffer),
-                "%s,\"%s\",[%s],%04d-%02d-%02d %02d:%02d:%02d,%ld,%ld,%ld,%f,%f,%f,%f,,,WIFI\n",
-                macAddress.c_str(),
-                WiFi.SSID(i).c_str(),
-                auth_mode_to_string(WiFi.encryptionType(i)).c_str(),
-                gps.date.year(),
-                gps.date.month(),
-                gps.date.day(),
-                gps.time.hour(),
-                gps.time.minute(),
-                gps.time.second(),
-                channel,
-                channel != 14 ? 2407 + (channel * 5) : 2484,
-                WiFi.RSSI(i),
-                gps.location.lat(),
-                gps.location.lng(),
-                gps.altitude.meters(),
-                gps.hdop.hdop() * 1.0
-            );
-            file.print(buffer);
-
-            wifiNetworkCount++;
-        }
-    }
-
-    file.close();
+void Wardriving::write_line(const char *line, size_t length) {
+    if (writeLength + length > WARDRIVING_BUFFER) flush_file();
+    memcpy(writeBuffer + writeLength, line, length);
+    writeLength += length;
 }
 
-void Wardriving::releasePins() {
-    rxPinReleased = false;
-    if (bruceConfigPins.CC1101_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-        bruceConfigPins.NRF24_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#if !defined(LITE_VERSION)
-        bruceConfigPins.W5500_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-        bruceConfigPins.LoRa_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#endif
-        bruceConfigPins.SDCARD_bus.checkConflict(bruceConfigPins.gps_bus.rx)) {
-        // T-Embed CC1101 and T-Display S3 Touch ties this pin to the NRF24 CS;
-        // switch it to input so the GPS UART can drive it.
-        pinMode(bruceConfigPins.gps_bus.rx, INPUT);
-        rxPinReleased = true;
-    }
+void Wardriving::flush_file() {
+    if (writeLength == 0 || !file) return;
+    file.write((const uint8_t *)writeBuffer, writeLength);
+    file.flush();
+    writeLength = 0;
 }
 
-void Wardriving::restorePins() {
-    if (rxPinReleased) {
-        if (bruceConfigPins.CC1101_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-            bruceConfigPins.NRF24_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#if !defined(LITE_VERSION)
-            bruceConfigPins.W5500_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-            bruceConfigPins.LoRa_bus.checkConflict(bruceConfigPins.gps_bus.rx) ||
-#endif
-            bruceConfigPins.SDCARD_bus.checkConflict(bruceConfigPins.gps_bus.rx)) {
-            // Restore the original board state after leaving the GPS app s
-            // o the radio/other peripherals behave as expected
-            pinMode(bruceConfigPins.gps_bus.rx, OUTPUT);
-            if (bruceConfigPins.gps_bus.rx == bruceConfigPins.CC1101_bus.cs ||
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.NRF24_bus.cs ||
-#if !defined(LITE_VERSION)
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.W5500_bus.cs ||
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.W5500_bus.cs ||
-#endif
-                bruceConfigPins.gps_bus.rx == bruceConfigPins.SDCARD_bus.cs) {
-                // If it is conflicting to an SPI CS pin, keep it HIGH
-                digitalWrite(bruceConfigPins.gps_bus.rx, HIGH);
-            } else {
-                // If it is conflicting with any other SPI pin, keep it LOW
-                // Avoids CC1101 Jamming and nRF24 radio to keep enabled
-                digitalWrite(bruceConfigPins.gps_bus.rx, LOW);
-            }
+// One line per network once its position settled, again whenever a stronger signal moves it
+void Wardriving::write_networks(bool all) {
+    if (!networks || !open_file()) return;
+    uint32_t now = millis();
+    for (size_t i = 0; i < networkCapacity; i++) {
+        WardrivingNetwork &net = networks[i];
+        if (!net.used || !net.dirty || (!all && now - net.improvedMs < WARDRIVING_SETTLE_MS)) continue;
+
+        // WiGLE CSV quotes the SSID, escape its quotes
+        char ssid[66];
+        size_t n = 0;
+        for (const char *c = net.ssid; *c && n < sizeof(ssid) - 2; c++) {
+            if (*c == '"') ssid[n++] = '"';
+            ssid[n++] = *c;
         }
-        rxPinReleased = false;
+        ssid[n] = '\0';
+        tmElements_t tm;
+        breakTime(net.firstSeen, tm);
+        int frequency = net.channel > 14    ? 5000 + net.channel * 5
+                        : net.channel == 14 ? 2484
+                                            : 2407 + net.channel * 5;
+
+        char line[200];
+        int length = snprintf(
+            line,
+            sizeof(line),
+            "%02X:%02X:%02X:%02X:%02X:%02X,\"%s\",[%s],%04d-%02d-%02d %02d:%02d:%02d,"
+            "%d,%d,%d,%.7f,%.7f,%d,%.2f,,,WIFI\n",
+            net.bssid[0],
+            net.bssid[1],
+            net.bssid[2],
+            net.bssid[3],
+            net.bssid[4],
+            net.bssid[5],
+            ssid,
+            auth_mode_to_string((wifi_auth_mode_t)net.authMode).c_str(),
+            tmYearToCalendar(tm.Year),
+            tm.Month,
+            tm.Day,
+            tm.Hour,
+            tm.Minute,
+            tm.Second,
+            net.channel,
+            frequency,
+            net.rssi,
+            net.lat / 1e7,
+            net.lng / 1e7,
+            net.altitude,
+            net.hdop / 100.0
+        );
+        write_line(line, min<size_t>(length, sizeof(line) - 1));
+        net.dirty = false;
+        linesWritten++;
     }
 }
@@ -9,10 +9,38 @@
 #ifndef __WAR_DRIVING_H__
 #define __WAR_DRIVING_H__
 
-#include <TinyGPS++.h>
+#include "gps_receiver.h"
 #include <esp_wifi_types.h>
 #include <globals.h>
-#include <set>
+
+// A network heard from a beacon or a probe response
+struct WardrivingObservation {
+    int64_t timeUs; // esp_timer_get_time() when the frame was received
+    uint8_t bssid[6];
+    char ssid[33];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t authMode; // wifi_auth_mode_t
+};
+
+// Strongest observation of a network that had a GPS fix
+struct WardrivingNetwork {
+    uint8_t bssid[6];
+    bool used;
+    bool dirty;   // better position than the last line written
+    bool located; // at least one observation with a fix
+    char ssid[33];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t authMode;
+    int32_t lat; // 1e-7 degrees
+    int32_t lng;
+    int16_t altitude;   // meters
+    uint16_t hdop;      // 1/100
+    uint32_t firstSeen; // unix time from the GPS
+    uint32_t lastSeenMs;
+    uint32_t improvedMs;
+};
 
 class Wardriving {
 public:
@@ -35,20 +63,35 @@ private:
     double cur_lng;
     double distance = 0;
     String filename = "";
-    TinyGPSPlus gps;
-    HardwareSerial GPSserial = HardwareSerial(2); // Uses UART2 for GPS
-    std::set<String> registeredMACs;              // Store and track registered MAC
-    int wifiNetworkCount = 0;                     // Counter fo wifi networks
-    bool rxPinReleased = false;
+    GpsFix fix = {};              // last fix taken from the receiver
+    GpsFix position[2] = {};      // the two latest fixes with a new position, [0] is the newest
+    int wifiNetworkCount = 0;     // Counter fo wifi networks
+    uint32_t *seenBits = nullptr; // BSSIDs already counted, outlives their table entries
+    size_t seenBitCount = 0;
+
+    // Networks by BSSID, open addressing with backward shift deletion
+    WardrivingNetwork *networks = nullptr;
+    size_t networkCapacity = 0;
+    size_t networkCount = 0;
+    uint32_t observationCount = 0;
+    uint32_t linesWritten = 0;
+
+    uint8_t hopIndex = 0;
+    uint32_t hopMs = 0;
+
+    File file;
+    char *writeBuffer = nullptr;
+    size_t writeLength = 0;
+
+    static QueueHandle_t observations; // filled by the promiscuous callback
+    static volatile uint32_t droppedObservations;
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Setup
     /////////////////////////////////////////////////////////////////////////////////////
-    void begin_wifi(void);
+    bool begin_wifi(void);
     bool begin_gps(void);
     void end(void);
-    void releasePins(void);
-    void restorePins(void);
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Display functions
@@ -60,10 +103,21 @@ private:
     // Operations
     /////////////////////////////////////////////////////////////////////////////////////
     void set_position(void);
-    void scan_networks(void);
+    void hop_channel(void);
+    void drain_observations(void);
+    void add_observation(const WardrivingObservation &obs);
+    bool first_sighting(const uint8_t *bssid);
+    WardrivingNetwork *find_network(const uint8_t *bssid, bool create);
+    void erase_network(size_t index);
+    void evict_networks(void);
+    void write_networks(bool all);
     String auth_mode_to_string(wifi_auth_mode_t authMode);
-    void append_to_file(int network_amount);
     void create_filename(void);
+    bool open_file(void);
+    void write_line(const char *line, size_t length);
+    void flush_file(void);
+
+    static void promiscuous_rx(void *buf, wifi_promiscuous_pkt_type_t type);
 };
 
 #endif // WAR_DRIVING_H
@@ -9,9 +9,12 @@
 #include "core/display.h"
 #include "core/mykeyboard.h"
 #include "core/sd_functions.h"
+#include "core/gzip_encoder.h"
 #include "core/wifi/wifi_common.h"
 
-#define CBUFLEN 1024
+#define WIGLE_STATE_FILE "/.wigle_uploads.json"
+#define WIGLE_RETRIES 3
+#define WIGLE_RESPONSE_TIMEOUT 30000 // WiGLE answers once the file is parsed
 
 Wigle::Wigle() {}
 
@@ -36,9 +39,9 @@ bool Wigle::get_user() {
     display_banner();
     padprintln("Connecting to Wigle...");
 
-    WiFiClientSecure client;
-    client.setInsecure();
-    if (!client.connect(host, 443)) return false;
+    std::unique_ptr<WiFiClient> connection = _connect();
+    if (!connection) return false;
+    WiFiClient &client = *connection;
 
     client.println("GET /api/v2/profile/user HTTP/1.0");
     client.print("Host: ");
@@ -82,10 +85,19 @@ void Wigle::dump_wigle_info() {
     padprintln("");
 }
 
-void Wigle::send_upload_headers(WiFiClientSecure &client, String filename, int filesize, String boundary) {
-    // Content-Disposition header size.
-    int cd_header_len = 147 - 45 - 8 + filename.length() + 2 * (boundary.length() + 2);
+std::unique_ptr<WiFiClient> Wigle::_connect() {
+#if WIGLE_TLS
+    WiFiClientSecure *secure = new WiFiClientSecure();
+    secure->setInsecure();
+    std::unique_ptr<WiFiClient> client(secure);
+#else
+    std::unique_ptr<WiFiClient> client(new WiFiClient());
+#endif
+    if (!client->connect(host, WIGLE_PORT)) return nullptr;
+    return client;
+}
 
+void Wigle::send_upload_headers(WiFiClient &client, size_t content_length, String boundary) {
     client.println("POST /api/v2/file/upload HTTP/1.0");
     client.print("Host: ");
     client.println(host);
@@ -96,18 +108,51 @@ void Wigle::send_upload_headers(WiFiClientSecure &client, String filename, int f
     client.print("Content-Type: multipart/form-data; boundary=");
     client.println(boundary);
     client.print("Content-Length: ");
-    client.println(filesize + cd_header_len);
+    client.println(content_length);
     client.println();
+}
 
-    // Start content-disposition file header:
-    client.println("--" + boundary);
-    client.print("Content-Disposition: form-data; name=\"file\"; filename=\"");
-    client.print(filename);
-    client.println("\"");
-    client.println("Content-Type: text/csv");
-    client.println();
+/////////////////////////////////////////////////////////////////////////////////////
+// Upload state, kept next to the files so an interrupted batch resumes where it stopped
+/////////////////////////////////////////////////////////////////////////////////////
+
+void Wigle::_load_state(FS *fs, String folder) {
+    state.clear();
+    state_path = folder + WIGLE_STATE_FILE;
+    File file = fs->open(state_path);
+    if (!file) return;
+    if (deserializeJson(state, file)) state.clear();
+    file.close();
+}
+
+void Wigle::_save_state(FS *fs) {
+    File file = fs->open(state_path, FILE_WRITE);
+    if (!file) return;
+    serializeJson(state, file);
+    file.close();
+}
+
+bool Wigle::_is_uploaded(String filepath, size_t size) {
+    String name = filepath.substring(filepath.lastIndexOf("/") + 1);
+    JsonObject entry = state[name];
+    // A file that grew since then has new networks
+    return !entry.isNull() && entry["done"] == true && entry["size"] == size;
+}
+
+void Wigle::_set_state(FS *fs, String filepath, size_t size, bool done) {
+    String name = filepath.substring(filepath.lastIndexOf("/") + 1);
+    int attempts = state[name]["attempts"] | 0;
+    JsonObject entry = state[name].to<JsonObject>();
+    entry["size"] = size;
+    entry["done"] = done;
+    entry["attempts"] = done ? 0 : attempts + 1;
+    _save_state(fs);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+// Upload
+/////////////////////////////////////////////////////////////////////////////////////
+
 bool Wigle::upload(FS *fs, String filepath, bool auto_delete) {
     display_banner();
 
@@ -115,19 +160,12 @@ bool Wigle::upload(FS *fs, String filepath, bool auto_delete) {
 
     dump_wigle_info();
 
-    File file = fs->open(filepath);
-    if (!file) {
-        displayError("Failed to open Wigle file", true);
-        return false;
-    }
-
-    if (!_upload_file(file, "Uploading...")) {
-        file.close();
+    _load_state(fs, filepath.substring(0, filepath.lastIndexOf("/")));
+    if (!_upload_with_retries(fs, filepath, "Uploading...")) {
         displayError("File upload error", true);
         return false;
     }
 
-    file.close();
     if (auto_delete) fs->remove(filepath);
 
     displaySuccess("File upload success", true);
@@ -139,103 +177,155 @@ bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
 
     display_banner();
 
+    if (!fs) return false;
     File root = fs->open(folder);
     if (!root || !root.isDirectory()) return false;
 
-    if (!fs || !get_user()) return false;
+    if (!get_user()) return false;
 
     dump_wigle_info();
+    _load_state(fs, folder);
     int i = 1;
-    bool success;
+    int skipped = 0;
+    int failed = 0;
 
     while (true) {
         bool isDir;
-
-        success = false;
-
         String fullPath = root.getNextFileName(&isDir);
         String nameOnly = fullPath.substring(fullPath.lastIndexOf("/") + 1);
         if (fullPath == "") { break; }
-        // Serial.printf("Path: %s (isDir: %d)\n", fullPath.c_str(), isDir);
-
-        if (!isDir) {
-
-            int dotIndex = nameOnly.lastIndexOf(".");
-            String ext = dotIndex >= 0 ? nameOnly.substring(dotIndex + 1) : "";
-            ext.toUpperCase();
-            if (ext.equals("CSV")) {
-                File file = fs->open(fullPath);
-
-                if (file) {
-                    if (!_upload_file(file, "Uploading " + String(i) + "...")) {
-                        file.close();
-                        displayError("File upload error", true);
-                        return false;
-                    }
-                    i++;
-                    success = true;
-
-                    file.close();
-                    if (success && auto_delete) fs->remove(fullPath);
-                }
-            }
+        if (isDir) continue;
+
+        String lower = nameOnly;
+        lower.toLowerCase();
+        if (!lower.endsWith(".csv") && !lower.endsWith(".csv.gz")) continue;
+
+        File file = fs->open(fullPath);
+        if (!file) continue;
+        size_t size = file.size();
+        file.close();
+
+        // Sent by an earlier run that did not get to delete it
+        if (_is_uploaded(fullPath, size)) {
+            skipped++;
+            if (auto_delete) fs->remove(fullPath);
+            continue;
+        }
+
+        // A failing file does not hold back the rest of the batch, the next run retries it
+        if (!_upload_with_retries(fs, fullPath, "Uploading " + String(i) + "...")) {
+            failed++;
+            continue;
         }
+        i++;
+        if (auto_delete) fs->remove(fullPath);
     }
     root.close();
 
     String plural = i > 2 ? "s" : "";
-    displaySuccess(String(i - 1) + " file" + plural + " uploaded", true);
+    String result = String(i - 1) + " file" + plural + " uploaded";
+    if (skipped > 0) result += ", " + String(skipped) + " already sent";
+    if (failed > 0) {
+        displayError(result + ", " + String(failed) + " failed", true);
+        return false;
+    }
+    displaySuccess(result, true);
     return true;
 }
 
-bool Wigle::_upload_file(File file, String upload_message) {
-    WiFiClientSecure client;
-    client.setInsecure();
-    if (!client.connect(host, 443)) {
-        displayError("Wigle API connection failed", true);
-        return false;
+bool Wigle::_upload_with_retries(FS *fs, String filepath, String upload_message) {
+    for (int attempt = 1; attempt <= WIGLE_RETRIES; attempt++) {
+        if (attempt > 1) {
+            displayTextLine("Retrying " + String(attempt) + "/" + String(WIGLE_RETRIES));
+            vTaskDelay((2000 << (attempt - 2)) / portTICK_PERIOD_MS);
+            if (WiFi.status() != WL_CONNECTED) wifiConnectMenu();
+        }
+        if (_upload_file(fs, filepath, upload_message)) return true;
+    }
+    return false;
+}
+
+bool Wigle::_upload_file(FS *fs, String filepath, String upload_message) {
+    File file = fs->open(filepath);
+    if (!file) return false;
+    size_t filesize = file.size();
+    String filename = filepath.substring(filepath.lastIndexOf("/") + 1);
+    // WiGLE takes gzipped logs, they are compressed on the fly instead of sent as is
+    bool compress = !filename.endsWith(".gz");
+
+    // The body length must be known up front: a first pass only measures the compressed size
+    size_t bodysize = filesize;
+    if (compress) {
+        GzipCounter counter;
+        bodysize = GzipEncoder::compress(file, counter, [&](size_t done) {
+            progressHandler(done, filesize, "Compressing...");
+        });
+        file.seek(0);
+        filename += ".gz";
     }
 
-    String filename = file.name();
-    int filesize = file.size();
     String boundary = "BRUCE";
     boundary.concat(esp_random());
-
-    send_upload_headers(client, filename, filesize, boundary);
-
-    byte cbuf[CBUFLEN];
-    float percent = 0;
-    while (file.available()) {
-        long bytes_available = file.available();
-        int toread = CBUFLEN;
-        if (bytes_available < CBUFLEN) toread = bytes_available;
-        file.read(cbuf, toread);
-        client.write(cbuf, toread);
-        percent = ((float)file.position() / (float)file.size()) * 100;
-        progressHandler(percent, 100, upload_message);
+    String part_header = "--" + boundary +
+                         "\r\n"
+                         "Content-Disposition: form-data; name=\"file\"; filename=\"" +
+                         filename +
+                         "\"\r\n"
+                         "Content-Type: application/gzip\r\n\r\n";
+    String part_trailer = "\r\n--" + boundary + "--\r\n";
+
+    std::unique_ptr<WiFiClient> connection = _connect();
+    if (!connection) {
+        file.close();
+        Serial.println("Wigle API connection failed");
+        return false;
     }
+    WiFiClient &client = *connection;
+
+    send_upload_headers(client, part_header.length() + bodysize + part_trailer.length(), boundary);
+    client.print(part_header);
+
+    size_t sent = 0;
+    auto progress = [&](size_t done) { progressHandler(done, filesize, upload_message); };
+    if (compress) {
+        sent = GzipEncoder::compress(file, client, progress);
+    } else {
+        uint8_t buffer[1024];
+        int n;
+        while ((n = file.read(buffer, sizeof(buffer))) > 0 && client.write(buffer, n) == (size_t)n) {
+            sent += n;
+            progress(sent);
+        }
+    }
+    file.close();
 
-    client.println();
-    client.print("--");
-    client.print(boundary);
-    client.println("--");
-    client.println();
+    if (sent != bodysize) {
+        Serial.printf("Wigle: %u of %u bytes sent\n", (unsigned)sent, (unsigned)bodysize);
+        client.stop();
+        _set_state(fs, filepath, filesize, false);
+        return false;
+    }
+    client.print(part_trailer);
     client.flush();
 
     Serial.println("File transfer complete");
 
     String serverres = "";
-
-    while (client.connected()) {
+    uint32_t start = millis();
+    while (client.connected() || client.available()) {
         if (client.available()) {
-            char c = client.read();
-            // Serial.write(c);
-            serverres.concat(c);
+            serverres.concat((char)client.read());
+            if (serverres.length() > 1024) break;
+        } else if (millis() - start > WIGLE_RESPONSE_TIMEOUT) {
+            break;
+        } else {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
         }
-        if (serverres.length() > 1024) break;
     }
 
     client.stop();
 
-    return (serverres.indexOf("\"success\":true") > -1);
+    bool success = serverres.indexOf("\"success\":true") > -1;
+    _set_state(fs, filepath, filesize, success);
+    return success;
 }
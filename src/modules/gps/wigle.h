@@ -10,6 +10,18 @@
 
 #include <WiFiClientSecure.h>
 #include <globals.h>
+#include <memory>
+
+// Endpoint, override with build flags to test against a local stand-in server
+#ifndef WIGLE_HOST
+#define WIGLE_HOST "api.wigle.net"
+#endif
+#ifndef WIGLE_PORT
+#define WIGLE_PORT 443
+#endif
+#ifndef WIGLE_TLS
+#define WIGLE_TLS 1
+#endif
 
 class Wigle {
 public:
@@ -25,17 +37,25 @@ public:
     bool get_user(void);
     bool upload(FS *fs, String filepath, bool auto_delete = true);
     bool upload_all(FS *fs, String filepath, bool auto_delete = true);
-    void send_upload_headers(WiFiClientSecure &client, String filename, int filesize, String boundary);
+    void send_upload_headers(WiFiClient &client, size_t content_length, String boundary);
     void display_banner(void);
     void dump_wigle_info(void);
 
 private:
     String wigle_user;
     String auth_header;
-    const char *host = "api.wigle.net";
+    const char *host = WIGLE_HOST;
+    JsonDocument state; // per file upload state of the folder being uploaded
+    String state_path;
 
     bool _check_token(void);
-    bool _upload_file(File file, String upload_message);
+    std::unique_ptr<WiFiClient> _connect(void);
+    bool _upload_file(FS *fs, String filepath, String upload_message);
+    bool _upload_with_retries(FS *fs, String filepath, String upload_message);
+    void _load_state(FS *fs, String folder);
+    void _save_state(FS *fs);
+    bool _is_uploaded(String filepath, size_t size);
+    void _set_state(FS *fs, String filepath, size_t size, bool done);
 };
 
 #endif
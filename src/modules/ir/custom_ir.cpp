@@ -1,6 +1,8 @@
 #include "custom_ir.h"
 #include "TV-B-Gone.h" // for checkIrTxPin()
 #include "core/display.h"
+#include "core/led_control.h"
+#include "core/list_view.h"
 #include "core/mykeyboard.h"
 #include "core/sd_functions.h"
 #include "core/settings.h"
@@ -216,6 +218,14 @@ bool txIrFile(FS *fs, String filepath, bool hideDefaultUI) {
     return true;
 }
 
+// Named codes of the open file, then a "Main Menu" row
+class IrCodeSource : public ListSource {
+public:
+    std::vector<IRCode *> items;
+    size_t size() override { return items.size() + 1; }
+    String label(size_t index) override { return index < items.size() ? items[index]->name : "Main Menu"; }
+};
+
 void otherIRcodes() {
     checkIrTxPin();
     resetCodesArray();
@@ -315,16 +325,10 @@ void otherIRcodes() {
         }
         // if(line.startsWith("duty_cycle:")) codes[total_codes]->duty_cycle = txt.toFloat();
     }
-    options = {};
+    IrCodeSource list;
     for (auto code : codes) {
-        if (code->name != "") {
-            options.push_back({code->name.c_str(), [code]() {
-                                   sendIRCommand(code);
-                                   addToRecentCodes(code);
-                               }});
-        }
+        if (code->name != "") list.items.push_back(code);
     }
-    options.push_back({"Main Menu", [&]() { exit = true; }});
     databaseFile.close();
 
 #ifdef USE_BOOST /// DISABLE 5V OUTPUT
@@ -334,15 +338,17 @@ void otherIRcodes() {
     digitalWrite(bruceConfigPins.irTx, LED_OFF);
     int idx = 0;
     while (1) {
-        idx = loopOptions(options, idx);
-        if (check(EscPress) || exit) break;
+        idx = loopList(list, idx);
+        if (idx < 0 || idx >= (int)list.items.size()) break; // Esc or Main Menu
+        sendIRCommand(list.items[idx]);
+        addToRecentCodes(list.items[idx]);
     }
-    options.clear();
 } // end of otherIRcodes
 
 // IR commands
 
 void sendIRCommand(IRCode *code, bool hideDefaultUI) {
+    LedEffectsPauseScope ledPause; // keep LED frames out of the IR carrier timing
     setup_ir_pin(bruceConfigPins.irTx, OUTPUT);
     // https://developer.flipper.net/flipperzero/doxygen/infrared_file_format.html
     if (code->type.equalsIgnoreCase("raw")) sendRawCommand(code->frequency, code->data, hideDefaultUI);
@@ -0,0 +1,241 @@
+/**
+ * @file ir_capture.cpp
+ * @brief RMT based IR receiver, frames are split by gap and repeated frames merged
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include "ir_capture.h"
+#include <algorithm>
+#include <soc/soc_caps.h>
+
+/*********************************************************************
+**  IrCluster
+*********************************************************************/
+IrCluster::IrCluster(const uint16_t *timings, size_t count) : sums(timings, timings + count), count(1) {}
+
+bool IrCluster::matches(const IrCluster &other) const {
+    if (empty() || size() != other.size()) return false;
+    for (size_t i = 0; i < size(); i++) {
+        int32_t a = at(i);
+        int32_t b = other.at(i);
+        int32_t delta = max(max(a, b) * IR_MATCH_TOLERANCE / 100, (int32_t)IR_MATCH_MIN_DELTA);
+        if (abs(a - b) > delta) return false;
+    }
+    return true;
+}
+
+void IrCluster::merge(const IrCluster &other) {
+    if (empty()) {
+        *this = other;
+        return;
+    }
+    for (size_t i = 0; i < size(); i++) sums[i] += other.sums[i];
+    count += other.count;
+}
+
+String IrCluster::toString() const {
+    String r;
+    r.reserve(size() * 6);
+    char buffer[8];
+    for (size_t i = 0; i < size(); i++) {
+        if (i) r += ' ';
+        utoa(at(i), buffer, 10);
+        r += buffer;
+    }
+    return r;
+}
+
+/*********************************************************************
+**  Receiver
+*********************************************************************/
+bool IRAM_ATTR
+IrCapture::rxDone(rmt_channel_t *channel, const rmt_rx_done_event_data_t *edata, void *user_data) {
+    BaseType_t high_task_wakeup = pdFALSE;
+    IrCapture *cap = (IrCapture *)user_data;
+    RxEvent event = {cap->armed, (uint16_t)edata->num_symbols};
+    // the capture task re-arms the receiver on the other buffer
+    xQueueSendFromISR(cap->events, &event, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
+}
+
+// Converts RMT symbols to alternating mark/space timings starting with a mark. The receiver
+// output is active low, the trailing space is the idle gap that ended the frame.
+void IrCapture::push(const rmt_symbol_word_t *symbols, size_t count) {
+    uint16_t timings[IR_RX_SYMBOLS * 2];
+    size_t n = 0;
+    int lastLevel = -1;
+    for (size_t i = 0; i < count * 2; i++) {
+        const rmt_symbol_word_t &code = symbols[i / 2];
+        uint32_t duration = i & 1 ? code.duration1 : code.duration0;
+        int level = i & 1 ? code.level1 : code.level0;
+        if (duration == 0) break; // end marker
+        if (n == 0 && level != 0) continue;
+        if (level == lastLevel) {
+            // Same level split across symbols, join it
+            timings[n - 1] = min<uint32_t>(timings[n - 1] + duration, UINT16_MAX);
+            continue;
+        }
+        timings[n++] = min<uint32_t>(duration, UINT16_MAX);
+        lastLevel = level;
+    }
+    if (n % 2 == 0 && n > 0) n--; // drop the trailing space
+    if (n < IR_MIN_TIMINGS) return;
+
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    if (IR_RX_RING - (h - t) < n) {
+        droppedFrames++;
+        return;
+    }
+    for (size_t i = 0; i < n; i++) ring[h++ % IR_RX_RING] = timings[i];
+    head.store(h, std::memory_order_release);
+
+    FrameInfo info = {(uint16_t)n, millis()};
+    if (xQueueSend(frames, &info, 0) != pdTRUE) {
+        // poll() would lose track of the ring, take the frame back
+        head.store(h - n, std::memory_order_release);
+        droppedFrames++;
+    }
+}
+
+void IrCapture::captureTask(void *pvParameters) {
+    IrCapture *cap = (IrCapture *)pvParameters;
+    RxEvent event;
+    while (xQueueReceive(cap->events, &event, portMAX_DELAY) == pdTRUE && !cap->stopping) {
+        // Re-arm on the other buffer before converting this one, so back to back frames are kept
+        cap->armed ^= 1;
+        if (!cap->arm()) Serial.println("IR capture: could not re-arm the receiver");
+        cap->push(cap->rxBuffers + event.buffer * IR_RX_SYMBOLS, event.symbols);
+    }
+    xSemaphoreGive(cap->exited);
+    vTaskDelete(NULL);
+}
+
+bool IrCapture::arm() {
+    return rmt_receive(
+               rx_ch, rxBuffers + armed * IR_RX_SYMBOLS, IR_RX_SYMBOLS * sizeof(rmt_symbol_word_t), &config
+           ) == ESP_OK;
+}
+
+bool IrCapture::begin(int pin) {
+    if (rx_ch != NULL) return true;
+
+    rmt_rx_channel_config_t rx_channel_cfg = {};
+    rx_channel_cfg.gpio_num = gpio_num_t(pin);
+    rx_channel_cfg.clk_src = RMT_CLK_SRC_DEFAULT;
+    rx_channel_cfg.resolution_hz = 1 * 1000 * 1000; // 1 tick = 1 us
+#if SOC_RMT_SUPPORT_RX_PINGPONG
+    // The driver moves symbols out of the block while receiving, one block is enough
+    rx_channel_cfg.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+#else
+    // A frame must fit in the channel memory, borrow blocks from the following channels
+    rx_channel_cfg.mem_block_symbols = IR_RX_SYMBOLS;
+#endif
+    if (rmt_new_rx_channel(&rx_channel_cfg, &rx_ch) != ESP_OK) {
+        // Other channels are in use, long AC frames may be truncated
+        rx_channel_cfg.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+        if (rmt_new_rx_channel(&rx_channel_cfg, &rx_ch) != ESP_OK) {
+            rx_ch = NULL;
+            return false;
+        }
+    }
+
+    // The RMT ISR copies into the receive buffers, keep them out of PSRAM
+    rxBuffers = (rmt_symbol_word_t *)heap_caps_malloc(
+        2 * IR_RX_SYMBOLS * sizeof(rmt_symbol_word_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT
+    );
+    ring = (uint16_t *)malloc(IR_RX_RING * sizeof(uint16_t));
+    events = xQueueCreate(2, sizeof(RxEvent));
+    frames = xQueueCreate(32, sizeof(FrameInfo));
+    exited = xSemaphoreCreateBinary();
+    stopping = false;
+    droppedFrames = 0;
+    head = tail = 0;
+    armed = 0;
+    press.clear();
+    // Above the UI, it only re-arms the receiver and copies timings
+    if (!rxBuffers || !ring || !events || !frames || !exited ||
+        xTaskCreate(captureTask, "IrCapture", 4096, this, 5, NULL) != pdPASS) {
+        release();
+        return false;
+    }
+
+    rmt_rx_event_callbacks_t cbs = {
+        .on_recv_done = rxDone,
+    };
+    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rx_ch, &cbs, this));
+    ESP_ERROR_CHECK(rmt_enable(rx_ch));
+    config.signal_range_min_ns = 3000;                     // glitch filter, IR marks are >100us
+    config.signal_range_max_ns = IR_FRAME_GAP_US * 1000UL; // idle threshold
+    if (!arm()) {
+        end();
+        return false;
+    }
+    return true;
+}
+
+void IrCapture::release() {
+    rmt_del_channel(rx_ch);
+    rx_ch = NULL;
+    if (events) vQueueDelete(events);
+    if (frames) vQueueDelete(frames);
+    if (exited) vSemaphoreDelete(exited);
+    events = frames = NULL;
+    exited = NULL;
+    heap_caps_free(rxBuffers);
+    free(ring);
+    rxBuffers = nullptr;
+    ring = nullptr;
+    press.clear();
+}
+
+void IrCapture::end() {
+    if (rx_ch == NULL) return;
+    stopping = true;
+    RxEvent wake = {0, 0};
+    xQueueSend(events, &wake, portMAX_DELAY);
+    xSemaphoreTake(exited, portMAX_DELAY);
+
+    rmt_disable(rx_ch);
+    release();
+}
+
+void IrCapture::clear() {
+    if (rx_ch == NULL) return;
+    FrameInfo info;
+    while (xQueueReceive(frames, &info, 0) == pdTRUE) tail.fetch_add(info.timings, std::memory_order_release);
+    press.clear();
+}
+
+bool IrCapture::poll(IrCluster &out) {
+    if (rx_ch == NULL) return false;
+
+    FrameInfo info;
+    while (xQueueReceive(frames, &info, 0) == pdTRUE) {
+        uint16_t timings[IR_RX_SYMBOLS * 2];
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        for (uint16_t i = 0; i < info.timings; i++) timings[i] = ring[t++ % IR_RX_RING];
+        tail.store(t, std::memory_order_release);
+
+        // Duplicates of a frame already seen in this press are averaged into it
+        IrCluster frame(timings, info.timings);
+        auto it = std::find_if(press.begin(), press.end(), [&](const IrCluster &c) {
+            return c.matches(frame);
+        });
+        if (it != press.end()) it->merge(frame);
+        else press.push_back(frame);
+        lastFrameMs = info.doneMs;
+    }
+
+    if (press.empty() || millis() - lastFrameMs < IR_PRESS_GAP_MS) return false;
+
+    // Repeat codes (NEC) are shorter than the frame they repeat, so prefer the longest frame
+    // and, among frames of that length, the one seen the most
+    auto best = std::max_element(press.begin(), press.end(), [](const IrCluster &a, const IrCluster &b) {
+        return a.size() != b.size() ? a.size() < b.size() : a.weight() < b.weight();
+    });
+    out = *best;
+    press.clear();
+    return true;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file ir_capture.h
+ * @brief RMT based IR receiver, frames are split by gap and repeated frames merged
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * The RMT peripheral timestamps every edge in hardware, so timings don't depend on interrupt
+ * latency and stay accurate while WiFi or the display keep the CPU busy.
+ */
+#ifndef __IR_CAPTURE_H
+#define __IR_CAPTURE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/rmt_rx.h>
+#include <vector>
+
+#define IR_RX_SYMBOLS 256      // per receive buffer, 512 timings like the IRrecv capture buffer
+#define IR_RX_RING 4096        // timings waiting for poll()
+#define IR_FRAME_GAP_US 30000  // RMT idle threshold, a longer space ends the frame
+#define IR_PRESS_GAP_MS 150    // a press ends when no frame arrives for this long
+#define IR_MIN_TIMINGS 3       // NEC repeat codes are the shortest valid frames
+#define IR_MATCH_TOLERANCE 25  // percent, as the IRremoteESP8266 decoders
+#define IR_MATCH_MIN_DELTA 100 // us, absolute tolerance for short marks
+
+// Timings of one IR frame (mark, space, mark, ...), averaged over every duplicate merged into it
+class IrCluster {
+public:
+    IrCluster() {}
+    IrCluster(const uint16_t *timings, size_t count);
+
+    bool matches(const IrCluster &other) const;
+    void merge(const IrCluster &other);
+
+    size_t size() const { return sums.size(); }
+    bool empty() const { return sums.empty(); }
+    uint16_t weight() const { return count; } // frames merged
+    uint16_t at(size_t i) const { return (sums[i] + count / 2) / count; }
+    String toString() const; // space separated timings, as in the .ir "data:" field
+
+private:
+    std::vector<uint32_t> sums;
+    uint16_t count = 0;
+};
+
+class IrCapture {
+public:
+    ~IrCapture() { end(); }
+
+    bool begin(int pin);
+    void end();
+    // Returns true when a press completed, with its most representative frame: the longest
+    // kind of frame seen in the press, averaged over its noisy duplicates
+    bool poll(IrCluster &out);
+    // Drops pending frames and the press in progress
+    void clear();
+    uint32_t dropped() const { return droppedFrames; }
+
+private:
+    struct RxEvent {
+        uint8_t buffer;
+        uint16_t symbols;
+    };
+    struct FrameInfo {
+        uint16_t timings;
+        uint32_t doneMs;
+    };
+
+    rmt_channel_handle_t rx_ch = NULL;
+    rmt_receive_config_t config = {};
+    rmt_symbol_word_t *rxBuffers = nullptr; // two buffers of IR_RX_SYMBOLS, internal RAM
+    uint8_t armed = 0;
+    QueueHandle_t events = NULL;
+    QueueHandle_t frames = NULL;
+    SemaphoreHandle_t exited = NULL;
+    volatile bool stopping = false;
+    volatile uint32_t droppedFrames = 0;
+    // Single producer (capture task), single consumer (poll) ring of timings
+    uint16_t *ring = nullptr;
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+
+    std::vector<IrCluster> press; // distinct frames of the press in progress
+    uint32_t lastFrameMs = 0;
+
+    void push(const rmt_symbol_word_t *symbols, size_t count);
+    bool arm();
+    void release();
+    static bool rxDone(rmt_channel_t *channel, const rmt_rx_done_event_data_t *edata, void *user_data);
+    static void captureTask(void *pvParameters);
+};
+
+#endif
@@ -21,6 +21,7 @@
 // #define MAX_RAWBUF_SIZE 300
 #define IR_FREQUENCY 38000
 #define DUTY_CYCLE 0.330000
+#define IR_LEARN_FILE "/BruceIR/.learning.ir" // renamed when the device is saved
 
 String uint32ToString(uint32_t value) {
     char buffer[12] = {0}; // 8 hex digits + 3 spaces + 1 null terminator
@@ -55,10 +56,13 @@ IrRead::IrRead(bool headless_mode, bool raw_mode) {
     raw = raw_mode;
     setup();
 }
+
+IrRead::~IrRead() { discard_device(); }
+
 bool quickloop = false;
 
 void IrRead::setup() {
-    irrecv.enableIRIn();
+    if (headless) irrecv.enableIRIn();
 
 #ifdef USE_BOOST /// ENABLE 5V OUTPUT
     PPM.enableOTG();
@@ -74,6 +78,11 @@ void IrRead::setup() {
     setup_ir_pin(bruceConfigPins.irRx, INPUT);
     if (headless) return;
     // else
+    // The RMT receiver timestamps edges in hardware, WiFi interrupts don't skew the timings
+    if (!capture.begin(bruceConfigPins.irRx)) {
+        displayError("IR receiver unavailable", true);
+        return;
+    }
     returnToMenu = true; // make sure menu is redrawn when quitting in any point
     std::vector<Option> quickRemoteOptions = {
         {"TV",
@@ -108,6 +117,7 @@ void IrRead::setup() {
         {"Menu",                 yield},
     };
     loopOptions(options);
+    capture.end();
 }
 
 void IrRead::loop() {
@@ -116,6 +126,7 @@ void IrRead::loop() {
             returnToMenu = true;
             button_pos = 0;
             quickloop = false;
+            discard_device();
 #ifdef USE_BOOST /// DISABLE 5V OUTPUT
             PPM.disableOTG();
 #endif
@@ -132,6 +143,8 @@ void IrRead::loop() {
 
 void IrRead::begin() {
     _read_signal = false;
+    signal = IrCluster();
+    capture.clear(); // presses made while a dialog was open
 
     display_banner();
     if (quickloop) {
@@ -175,9 +188,18 @@ void IrRead::display_btn_options() {
 }
 
 void IrRead::read_signal() {
-    if (_read_signal || !irrecv.decode(&results)) return;
-
-    _read_signal = true;
+    IrCluster press;
+    if (!capture.poll(press)) return;
+
+    if (!_read_signal) {
+        signal = press;
+        _read_signal = true;
+    } else if (signal.matches(press)) {
+        // Same button pressed again, averaging both captures evens out their jitter
+        signal.merge(press);
+    } else {
+        return; // another button, the pending one has to be saved or discarded first
+    }
 
     // Always switches to RAW data, regardless of the decoding result
     raw = true;
@@ -186,28 +208,34 @@ void IrRead::read_signal() {
 
     // Dump of signal details
     padprint("RAW Data Captured:");
-    String raw_signal = parse_raw_signal();
+    String raw_signal = signal.toString();
     tft.println(
         raw_signal.substring(0, 45) + (raw_signal.length() > 45 ? "..." : "")
     ); // Shows the RAW signal on the display
+    padprintln("Frames merged: " + String(signal.weight()));
+    for (const auto &entry : learned) {
+        if (!entry.second.matches(signal)) continue;
+        padprintln("Same as: " + entry.first);
+        break;
+    }
 
     display_btn_options();
-    delay(500);
 }
 
 void IrRead::discard_signal() {
     if (!_read_signal) return;
-    irrecv.resume();
     begin();
 }
 
 void IrRead::save_signal() {
     if (!_read_signal) return;
-    if (!quickloop) {
-        String btn_name = keyboard("Btn" + String(signals_read), 30, "Btn name:");
-        append_to_file_str(btn_name);
-    } else {
-        append_to_file_str(quickButtons[button_pos]);
+    String btn_name;
+    if (!quickloop) btn_name = keyboard("Btn" + String(signals_read), 30, "Btn name:");
+    else btn_name = quickButtons[button_pos];
+    if (!append_to_file(btn_name)) {
+        displayError(deviceFs ? "Error writing file." : "No storage available.", true);
+        discard_signal();
+        return;
     }
     signals_read++;
     if (quickloop) button_pos++;
@@ -232,77 +260,112 @@ String IrRead::parse_raw_signal() {
     rawcode = resultToRawArray(&results);
     raw_data_len = getCorrectedRawLength(&results);
 
-    String signal_code = "";
+    String signal_code;
+    signal_code.reserve(raw_data_len * 6);
+    char buffer[8];
 
-    for (uint16_t i = 0; i < raw_data_len; i++) { signal_code += String(rawcode[i]) + " "; }
+    for (uint16_t i = 0; i < raw_data_len; i++) {
+        if (i) signal_code += ' ';
+        utoa(rawcode[i], buffer, 10);
+        signal_code += buffer;
+    }
 
     delete[] rawcode;
     rawcode = nullptr;
-    signal_code.trim();
 
     return signal_code;
 }
 
-void IrRead::append_to_file_str(String btn_name) {
-    strDeviceContent += "name: " + btn_name + "\n";
+// Entries are written as soon as they are confirmed, save_device() only renames the file
+bool IrRead::append_to_file(String btn_name) {
+    if (!deviceFile) {
+        deviceFs = choose_storage();
+        if (deviceFs == nullptr) return false;
+        if (!(*deviceFs).exists("/BruceIR")) (*deviceFs).mkdir("/BruceIR");
+        deviceFile = (*deviceFs).open(IR_LEARN_FILE, FILE_WRITE);
+        if (!deviceFile) return false;
+        deviceFile.println("Filetype: Bruce IR File");
+        deviceFile.println("Version: 1");
+        deviceFile.println("#");
+    }
+
+    String entry = format_signal(btn_name);
+    bool written = deviceFile.print(entry) == entry.length();
+    deviceFile.flush();
+    if (written) learned.emplace_back(btn_name, signal);
+    return written;
+}
+
+void IrRead::discard_device() {
+    if (deviceFile) {
+        deviceFile.close();
+        (*deviceFs).remove(IR_LEARN_FILE);
+    }
+    deviceFs = nullptr;
+    learned.clear();
+    signals_read = 0;
+}
+
+String IrRead::format_signal(String btn_name) {
+    String r = "name: " + btn_name + "\n";
 
     if (raw) {
-        strDeviceContent += "type: raw\n";
-        strDeviceContent += "frequency: " + String(IR_FREQUENCY) + "\n";
-        strDeviceContent += "duty_cycle: " + String(DUTY_CYCLE) + "\n";
-        strDeviceContent += "data: " + parse_raw_signal() + "\n";
+        r += "type: raw\n";
+        r += "frequency: " + String(IR_FREQUENCY) + "\n";
+        r += "duty_cycle: " + String(DUTY_CYCLE) + "\n";
+        r += "data: " + (headless ? parse_raw_signal() : signal.toString()) + "\n";
     } else {
         // parsed signal  https://github.com/jamisonderek/flipper-zero-tutorials/wiki/Infrared
-        strDeviceContent += "type: parsed\n";
+        r += "type: parsed\n";
         switch (results.decode_type) {
             case decode_type_t::RC5: {
-                if (results.command > 0x3F) strDeviceContent += "protocol: RC5X\n";
-                else strDeviceContent += "protocol: RC5\n";
+                if (results.command > 0x3F) r += "protocol: RC5X\n";
+                else r += "protocol: RC5\n";
                 break;
             }
             case decode_type_t::RC6: {
-                strDeviceContent += "protocol: RC6\n";
+                r += "protocol: RC6\n";
                 break;
             }
             case decode_type_t::SAMSUNG: {
-                strDeviceContent += "protocol: Samsung32\n";
+                r += "protocol: Samsung32\n";
                 break;
             }
             case decode_type_t::SONY: {
                 // check address and command ranges to find the exact protocol
-                if (results.address > 0xFF) strDeviceContent += "protocol: SIRC20\n";
-                else if (results.address > 0x1F) strDeviceContent += "protocol: SIRC15\n";
-                else strDeviceContent += "protocol: SIRC\n";
+                if (results.address > 0xFF) r += "protocol: SIRC20\n";
+                else if (results.address > 0x1F) r += "protocol: SIRC15\n";
+                else r += "protocol: SIRC\n";
                 break;
             }
             case decode_type_t::NEC: {
                 // check address and command ranges to find the exact protocol
-                if (results.address > 0xFFFF) strDeviceContent += "protocol: NEC42ext\n";
-                else if (results.address > 0xFF1F) strDeviceContent += "protocol: NECext\n";
-                else if (results.address > 0xFF) strDeviceContent += "protocol: NEC42\n";
-                else strDeviceContent += "protocol: NEC\n";
+                if (results.address > 0xFFFF) r += "protocol: NEC42ext\n";
+                else if (results.address > 0xFF1F) r += "protocol: NECext\n";
+                else if (results.address > 0xFF) r += "protocol: NEC42\n";
+                else r += "protocol: NEC\n";
                 break;
             }
             case decode_type_t::UNKNOWN: {
                 Serial.print("unknown protocol, try raw mode");
-                return;
+                return "";
             }
             default: {
-                strDeviceContent += "protocol: " + typeToString(results.decode_type, results.repeat) + "\n";
+                r += "protocol: " + typeToString(results.decode_type, results.repeat) + "\n";
                 break;
             }
         }
 
-        strDeviceContent += "address: " + uint32ToString(results.address) + "\n";
-        strDeviceContent += "command: " + uint32ToString(results.command) + "\n";
+        r += "address: " + uint32ToString(results.address) + "\n";
+        r += "command: " + uint32ToString(results.command) + "\n";
 
         // extra fields not supported on flipper
-        strDeviceContent += "bits: " + String(results.bits) + "\n";
-        if (hasACState(results.decode_type)) strDeviceContent += "state: " + parse_state_signal() + "\n";
+        r += "bits: " + String(results.bits) + "\n";
+        if (hasACState(results.decode_type)) r += "state: " + parse_state_signal() + "\n";
         else if (results.bits > 32)
-            strDeviceContent += "value: " + uint32ToString(results.value) + " " +
-                                uint32ToString(results.value >> 32) + "\n"; // MEMO: from uint64_t
-        else strDeviceContent += "value: " + uint32ToStringInverted(results.value) + "\n";
+            r += "value: " + uint32ToString(results.value) + " " + uint32ToString(results.value >> 32) +
+                 "\n"; // MEMO: from uint64_t
+        else r += "value: " + uint32ToStringInverted(results.value) + "\n";
 
         /*
         Serial.println(results.bits);
@@ -322,7 +385,8 @@ void IrRead::append_to_file_str(String btn_name) {
         Serial.println(value_int);
         */
     }
-    strDeviceContent += "#\n";
+    r += "#\n";
+    return r;
 }
 
 void IrRead::save_device() {
@@ -332,6 +396,24 @@ void IrRead::save_device() {
 
     display_banner();
 
+    deviceFile.close();
+    if (write_file(filename, deviceFs)) {
+        displaySuccess("File saved to " + String((deviceFs == &SD) ? "SD Card" : "LittleFS") + ".", true);
+        deviceFs = nullptr;
+        learned.clear();
+        signals_read = 0;
+    } else {
+        displayError("Error writing file.", true);
+        // Keep learning into the same file
+        if (deviceFs) deviceFile = (*deviceFs).open(IR_LEARN_FILE, FILE_APPEND);
+    }
+
+    delay(1000);
+
+    begin();
+}
+
+FS *IrRead::choose_storage() {
     FS *fs = nullptr;
 
     bool sdCardAvailable = setupSdCard();
@@ -350,17 +432,7 @@ void IrRead::save_device() {
     } else if (littleFsAvailable) {
         fs = &LittleFS;
     };
-
-    if (fs && write_file(filename, fs)) {
-        displaySuccess("File saved to " + String((fs == &SD) ? "SD Card" : "LittleFS") + ".", true);
-        signals_read = 0;
-        strDeviceContent = "";
-    } else displayError(fs ? "Error writing file." : "No storage available.", true);
-
-    delay(1000);
-
-    irrecv.resume();
-    begin();
+    return fs;
 }
 
 String IrRead::loop_headless(int max_loops) {
@@ -390,9 +462,7 @@ String IrRead::loop_headless(int max_loops) {
     r += "#\n";
     r += "#\n";
 
-    strDeviceContent = "";
-    append_to_file_str("Unknown"); // writes on strDeviceContent
-    r += strDeviceContent;
+    r += format_signal("Unknown");
 
     return r;
 }
@@ -443,17 +513,19 @@ bool IrRead::write_file(String filename, FS *fs) {
     }
     */
 
-    File file = (*fs).open("/BruceIR/" + filename + ".ir", FILE_WRITE);
-
-    if (!file) { return false; }
-
-    file.println("Filetype: Bruce IR File");
-    file.println("Version: 1");
-    file.println("#");
-    file.println("# " + filename);
-    file.print(strDeviceContent);
-
-    file.close();
-    delay(100);
+    // The entries are already on the card, only the learning file has to be renamed.
+    // FAT refuses to rename onto an existing file, so the old one is moved aside until it worked.
+    String path = "/BruceIR/" + filename + ".ir";
+    String backup = path + ".bak";
+    bool replacing = (*fs).exists(path);
+    if (replacing) {
+        if ((*fs).exists(backup)) (*fs).remove(backup);
+        if (!(*fs).rename(path, backup)) return false;
+    }
+    if (!(*fs).rename(IR_LEARN_FILE, path)) {
+        if (replacing) (*fs).rename(backup, path);
+        return false;
+    }
+    if (replacing) (*fs).remove(backup);
     return true;
 }
@@ -6,6 +6,7 @@
  * @date 2024-07-17
  */
 
+#include "ir_capture.h"
 #include <IRrecv.h>
 #include <globals.h>
 
@@ -18,6 +19,7 @@ public:
     // Constructor
     /////////////////////////////////////////////////////////////////////////////////////
     IrRead(bool headless_mode = false, bool raw_mode = false);
+    ~IrRead();
 
     ///////////////////////////////////////////////////////////////////////////////////
     // Arduino Life Cycle
@@ -30,12 +32,16 @@ public:
 
 private:
     bool _read_signal = false;
-    decode_results results;
+    decode_results results; // headless mode, decoded by IRremoteESP8266
     uint16_t *rawcode;
     uint16_t raw_data_len;
+    IrCapture capture; // interactive mode, RMT receiver
+    IrCluster signal;  // pending capture, later presses of the same button are merged into it
+    std::vector<std::pair<String, IrCluster>> learned; // saved in the current device file
+    FS *deviceFs = nullptr;
+    File deviceFile; // entries are appended as they are saved
     int signals_read = 0;
     int button_pos = 0;
-    String strDeviceContent = "";
     bool headless = false;
     bool raw = false;
 
@@ -54,8 +60,11 @@ private:
     void save_device();
     void save_signal();
     void discard_signal();
-    void append_to_file_str(String btn_name);
+    void discard_device();
+    bool append_to_file(String btn_name);
+    String format_signal(String btn_name);
     bool write_file(String filename, FS *fs);
+    FS *choose_storage();
     String parse_raw_signal();
     String parse_state_signal();
     /////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,439 @@
+#if !defined(LITE_VERSION)
+#include "lora_service.h"
+#include "core/configPins.h"
+#include "core/spi_bus.h"
+#include <LittleFS.h>
+#include <RadioLib.h>
+#include <globals.h>
+
+#define LORA_SPREADING_FACTOR 9
+#define LORA_BANDWIDTH_KHZ 31.25
+#define LORA_CODING_RATE 8
+#define LORA_PREAMBLE_LENGTH 8
+#define LORA_INBOX_DEPTH 8
+#define LORA_HISTORY_MAGIC 0x3148524C // "LRH1"
+#define LORA_OLD_CHATS "/chats.txt"
+
+extern BruceConfigPins bruceConfigPins;
+
+LoraService loraService;
+
+struct __attribute__((packed)) LoraHistoryHeader {
+    uint32_t magic;
+    uint16_t slots;
+    uint16_t recordSize;
+    uint32_t total;
+};
+
+static TaskHandle_t rxTaskHandle = NULL;
+static volatile bool irqPending = false;   // a packet waits in the radio
+static volatile bool transmitting = false; // the interrupt only means the transmission ended
+
+static void IRAM_ATTR onLoraPacket() {
+    if (transmitting || rxTaskHandle == NULL) return;
+    irqPending = true;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(rxTaskHandle, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+static int getLoraIrqPin() {
+#ifdef LORA_IRQ
+    return LORA_IRQ;
+#else
+    return bruceConfigPins.LoRa_bus.io2;
+#endif
+}
+
+static int getLoraBusyPin() {
+#ifdef LORA_BUSY
+    return LORA_BUSY;
+#else
+    return GPIO_NUM_NC;
+#endif
+}
+
+static SPIClass *selectLoraSPIBus() {
+    SPIClass *shared = spiArbiter.bus(SpiDevice::LoRa);
+    if (shared) return shared;
+    SPI.begin(
+        bruceConfigPins.LoRa_bus.sck,
+        bruceConfigPins.LoRa_bus.miso,
+        bruceConfigPins.LoRa_bus.mosi,
+        bruceConfigPins.LoRa_bus.cs
+    );
+    Serial.println("Using dedicated SPI for LoRa");
+    return &SPI;
+}
+
+template <typename T> static int configureRadio(T *radio, float bandMHz) {
+    int state = radio->begin(bandMHz);
+    if (state == RADIOLIB_ERR_NONE) state = radio->setSpreadingFactor(LORA_SPREADING_FACTOR);
+    if (state == RADIOLIB_ERR_NONE) state = radio->setBandwidth(LORA_BANDWIDTH_KHZ);
+    if (state == RADIOLIB_ERR_NONE) state = radio->setCodingRate(LORA_CODING_RATE);
+    if (state == RADIOLIB_ERR_NONE) state = radio->setPreambleLength(LORA_PREAMBLE_LENGTH);
+    return state;
+}
+
+static uint32_t messageTime() { return clock_set ? (uint32_t)time(nullptr) : 0; }
+
+void LoraService::loadSettings(JsonDocument &doc) {
+    if (!LittleFS.exists(LORA_SETTINGS_FILE)) {
+        Serial.println("creating lora settings .json file");
+        doc["LoRa_Frequency"] = "434500000.00";
+        doc["LoRa_Name"] = "BruceTest";
+        doc["LoRa_Radio"] = "SX1276";
+        saveSettings(doc);
+        return;
+    }
+    File file = LittleFS.open(LORA_SETTINGS_FILE, "r");
+    deserializeJson(doc, file);
+    file.close();
+}
+
+void LoraService::saveSettings(JsonDocument &doc) {
+    File file = LittleFS.open(LORA_SETTINGS_FILE, "w");
+    serializeJson(doc, file);
+    file.close();
+}
+
+bool LoraService::ensureLocks() {
+    if (!radioLock) radioLock = xSemaphoreCreateMutex();
+    if (!historyLock) historyLock = xSemaphoreCreateMutex();
+    if (!subscriberLock) subscriberLock = xSemaphoreCreateMutex();
+    if (!exited) exited = xSemaphoreCreateCounting(2, 0);
+    if (!inbox) inbox = xQueueCreate(LORA_INBOX_DEPTH, sizeof(LoraMessage));
+    return radioLock && historyLock && subscriberLock && exited && inbox;
+}
+
+bool LoraService::begin() {
+    if (running()) return true;
+    if (!ensureLocks()) {
+        lastError = "Not enough memory";
+        return false;
+    }
+    JsonDocument doc;
+    loadSettings(doc);
+    double band = doc["LoRa_Frequency"].as<String>().toDouble();
+    float bandMHz = (band > 1000) ? band / 1000000.0f : band;
+    String stored = doc["LoRa_Radio"] | "SX1276";
+    variant = stored.equalsIgnoreCase("SX1262") ? Radio::SX1262 : Radio::SX1276;
+    if (bandMHz <= 0) {
+        lastError = "Invalid LoRa frequency";
+        return false;
+    }
+
+    // The tasks first, the radio may interrupt as soon as it listens
+    stopping = false;
+    irqPending = false;
+    transmitting = false;
+    xQueueReset(inbox);
+    if (xTaskCreate(logLoop, "LoRaLog", 4096, this, 1, NULL) == pdPASS) tasks++;
+    if (xTaskCreate(rxLoop, "LoRaRx", 4096, this, 3, &rxTaskHandle) == pdPASS) tasks++;
+    if (tasks < 2) {
+        lastError = "Could not start LoRa tasks";
+        end();
+        return false;
+    }
+
+    xSemaphoreTake(radioLock, portMAX_DELAY);
+    bool started = startRadio(bandMHz);
+    xSemaphoreGive(radioLock);
+    if (!started) {
+        end();
+        return false;
+    }
+    Serial.printf(
+        "LoRa Started: %.3fMHz %s\n", bandMHz, variant == Radio::SX1262 ? "SX1262" : "SX1276"
+    );
+    return true;
+}
+
+void LoraService::end() {
+    stopping = true;
+    if (radioLock) {
+        xSemaphoreTake(radioLock, portMAX_DELAY);
+        stopRadio();
+        xSemaphoreGive(radioLock);
+    }
+    for (; tasks > 0; tasks--) xSemaphoreTake(exited, portMAX_DELAY);
+    rxTaskHandle = NULL;
+    if (historyLock) {
+        xSemaphoreTake(historyLock, portMAX_DELAY);
+        if (history) history.close();
+        xSemaphoreGive(historyLock);
+    }
+}
+
+bool LoraService::startRadio(float bandMHz) {
+    const int irqPin = getLoraIrqPin();
+    if (bruceConfigPins.LoRa_bus.cs == GPIO_NUM_NC || bruceConfigPins.LoRa_bus.mosi == GPIO_NUM_NC ||
+        bruceConfigPins.LoRa_bus.miso == GPIO_NUM_NC || bruceConfigPins.LoRa_bus.sck == GPIO_NUM_NC) {
+        lastError = "LoRa pins not configured!";
+        Serial.println(lastError);
+        return false;
+    }
+    if (irqPin == GPIO_NUM_NC) {
+        lastError = "LoRa IRQ pin not configured!";
+        Serial.println(lastError);
+        return false;
+    }
+
+    SPIClass *spi = selectLoraSPIBus();
+    const int busyPin = (variant == Radio::SX1262) ? getLoraBusyPin() : GPIO_NUM_NC;
+    if (variant == Radio::SX1262 && busyPin == GPIO_NUM_NC) {
+        Serial.println("Warning: SX1262 selected but BUSY pin is not configured");
+    }
+    module = new Module(bruceConfigPins.LoRa_bus.cs, irqPin, bruceConfigPins.LoRa_bus.io0, busyPin, *spi);
+
+    int state;
+    if (variant == Radio::SX1262) {
+        SX1262 *sx = new SX1262(module);
+        radio = sx;
+        state = configureRadio(sx, bandMHz);
+    } else {
+        SX1276 *sx = new SX1276(module);
+        radio = sx;
+        state = configureRadio(sx, bandMHz);
+    }
+    if (state == RADIOLIB_ERR_NONE) {
+        radio->setPacketReceivedAction(onLoraPacket);
+        state = radio->startReceive();
+    }
+    if (state != RADIOLIB_ERR_NONE) {
+        Serial.printf("Starting LoRa failed! Err %d\n", state);
+        lastError = "LoRa Init Failed";
+        stopRadio();
+        return false;
+    }
+    return true;
+}
+
+void LoraService::stopRadio() {
+    if (radio) {
+        radio->clearPacketReceivedAction();
+        radio->standby();
+        if (variant == Radio::SX1262) delete static_cast<SX1262 *>(radio);
+        else delete static_cast<SX1276 *>(radio);
+        radio = nullptr;
+    }
+    if (module) {
+        delete module;
+        module = nullptr;
+    }
+}
+
+// Called with the radio lock held. The bus is held for the whole read, transmissions are not
+// guarded as RadioLib waits for the interrupt pin while the packet goes out.
+void LoraService::readPacket() {
+    SpiGuard bus(SpiDevice::LoRa);
+    irqPending = false;
+    LoraMessage message = {};
+    size_t length = min<size_t>(radio->getPacketLength(), LORA_MAX_TEXT);
+    int state = radio->readData((uint8_t *)message.text, length);
+    if (state == RADIOLIB_ERR_NONE && length > 0) {
+        message.time = messageTime();
+        message.rssi = radio->getRSSI();
+        message.snr = radio->getSNR();
+        message.length = length;
+        message.text[length] = '\0';
+        packets++;
+        post(message);
+    } else {
+        readErrors++;
+        Serial.printf("LoRa read failed: %d\n", state);
+    }
+    radio->startReceive();
+}
+
+void LoraService::post(const LoraMessage &message) {
+    if (xQueueSend(inbox, &message, 0) != pdTRUE) lostPackets++;
+}
+
+bool LoraService::send(const String &text) {
+    if (!running() || text.length() == 0) return false;
+    LoraMessage message = {};
+    message.length = min<size_t>(text.length(), LORA_MAX_TEXT);
+    memcpy(message.text, text.c_str(), message.length);
+
+    xSemaphoreTake(radioLock, portMAX_DELAY);
+    if (!radio) {
+        xSemaphoreGive(radioLock);
+        return false;
+    }
+    // A packet the receive task did not take yet would be overwritten by the transmission
+    if (irqPending) readPacket();
+    transmitting = true;
+    int state = radio->transmit((uint8_t *)message.text, message.length);
+    transmitting = false;
+    radio->startReceive();
+    xSemaphoreGive(radioLock);
+
+    if (state != RADIOLIB_ERR_NONE) {
+        Serial.printf("LoRa transmit failed: %d\n", state);
+        return false;
+    }
+    message.time = messageTime();
+    message.outgoing = 1;
+    post(message);
+    return true;
+}
+
+void LoraService::rxLoop(void *pvParameters) {
+    LoraService *self = (LoraService *)pvParameters;
+    while (!self->stopping) {
+        // Woken by the interrupt, the timeout only notices stopping
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0 && !irqPending) continue;
+        xSemaphoreTake(self->radioLock, portMAX_DELAY);
+        if (irqPending && self->radio) self->readPacket();
+        xSemaphoreGive(self->radioLock);
+    }
+    xSemaphoreGive(self->exited);
+    vTaskDelete(NULL);
+}
+
+void LoraService::logLoop(void *pvParameters) {
+    LoraService *self = (LoraService *)pvParameters;
+    LoraMessage message;
+    while (true) {
+        if (xQueueReceive(self->inbox, &message, pdMS_TO_TICKS(100)) == pdTRUE) self->dispatch(message);
+        else if (self->stopping) break;
+    }
+    xSemaphoreGive(self->exited);
+    vTaskDelete(NULL);
+}
+
+void LoraService::dispatch(const LoraMessage &message) {
+    Serial.printf("LoRa %s: %s\n", message.outgoing ? "sent" : "received", message.text);
+    xSemaphoreTake(historyLock, portMAX_DELAY);
+    appendHistory(message);
+    xSemaphoreGive(historyLock);
+
+    xSemaphoreTake(subscriberLock, portMAX_DELAY);
+    for (QueueHandle_t queue : subscribers) {
+        if (queue && xQueueSend(queue, &message, 0) != pdTRUE) lostPackets++;
+    }
+    xSemaphoreGive(subscriberLock);
+}
+
+QueueHandle_t LoraService::subscribe(UBaseType_t depth) {
+    if (!ensureLocks()) return NULL;
+    QueueHandle_t queue = xQueueCreate(depth, sizeof(LoraMessage));
+    if (!queue) return NULL;
+    xSemaphoreTake(subscriberLock, portMAX_DELAY);
+    for (QueueHandle_t &slot : subscribers) {
+        if (slot == NULL) {
+            slot = queue;
+            xSemaphoreGive(subscriberLock);
+            return queue;
+        }
+    }
+    xSemaphoreGive(subscriberLock);
+    vQueueDelete(queue);
+    return NULL;
+}
+
+void LoraService::unsubscribe(QueueHandle_t queue) {
+    if (!queue || !subscriberLock) return;
+    xSemaphoreTake(subscriberLock, portMAX_DELAY);
+    for (QueueHandle_t &slot : subscribers) {
+        if (slot == queue) slot = NULL;
+    }
+    xSemaphoreGive(subscriberLock);
+    vQueueDelete(queue);
+}
+
+/*********************************************************************
+**  History
+**  A header and LORA_HISTORY_SIZE slots, message n of all the ones ever
+**  written is in slot n % LORA_HISTORY_SIZE. Called with the history lock held.
+*********************************************************************/
+bool LoraService::openHistory() {
+    if (history) return true;
+    if (LittleFS.exists(LORA_HISTORY_FILE)) {
+        history = LittleFS.open(LORA_HISTORY_FILE, "r+");
+        LoraHistoryHeader header;
+        if (history && history.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == LORA_HISTORY_MAGIC && header.slots == LORA_HISTORY_SIZE &&
+            header.recordSize == sizeof(LoraMessage)) {
+            historyTotal = header.total;
+            return true;
+        }
+        // Another layout, start over
+        if (history) history.close();
+        LittleFS.remove(LORA_HISTORY_FILE);
+    }
+
+    history = LittleFS.open(LORA_HISTORY_FILE, "w+");
+    if (!history) return false;
+    LoraHistoryHeader header = {LORA_HISTORY_MAGIC, LORA_HISTORY_SIZE, sizeof(LoraMessage), 0};
+    history.write((const uint8_t *)&header, sizeof(header));
+    historyTotal = 0;
+    importChats();
+    history.flush();
+    return true;
+}
+
+void LoraService::appendHistory(const LoraMessage &message) {
+    if (!openHistory()) return;
+    history.seek(sizeof(LoraHistoryHeader) + (historyTotal % LORA_HISTORY_SIZE) * sizeof(LoraMessage));
+    history.write((const uint8_t *)&message, sizeof(LoraMessage));
+    historyTotal++;
+    history.seek(offsetof(LoraHistoryHeader, total));
+    history.write((const uint8_t *)&historyTotal, sizeof(historyTotal));
+    history.flush();
+}
+
+// The text log of older versions, its last lines become the start of the history
+void LoraService::importChats() {
+    if (!LittleFS.exists(LORA_OLD_CHATS)) return;
+    File file = LittleFS.open(LORA_OLD_CHATS, "r");
+    while (file && file.available()) {
+        String line = file.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0) continue;
+        LoraMessage message = {};
+        message.length = min<size_t>(line.length(), LORA_MAX_TEXT);
+        memcpy(message.text, line.c_str(), message.length);
+        appendHistory(message);
+    }
+    file.close();
+    LittleFS.remove(LORA_OLD_CHATS);
+}
+
+size_t LoraService::historySize() {
+    if (!ensureLocks()) return 0;
+    xSemaphoreTake(historyLock, portMAX_DELAY);
+    size_t size = openHistory() ? min<uint32_t>(historyTotal, LORA_HISTORY_SIZE) : 0;
+    xSemaphoreGive(historyLock);
+    return size;
+}
+
+size_t LoraService::readHistory(size_t first, LoraMessage *out, size_t count) {
+    if (!ensureLocks()) return 0;
+    xSemaphoreTake(historyLock, portMAX_DELAY);
+    size_t size = openHistory() ? min<uint32_t>(historyTotal, LORA_HISTORY_SIZE) : 0;
+    if (first >= size) count = 0;
+    else count = min(count, size - first);
+    uint32_t oldest = historyTotal - size;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t slot = (oldest + first + i) % LORA_HISTORY_SIZE;
+        history.seek(sizeof(LoraHistoryHeader) + slot * sizeof(LoraMessage));
+        if (history.read((uint8_t *)&out[i], sizeof(LoraMessage)) != sizeof(LoraMessage)) {
+            memset(&out[i], 0, sizeof(LoraMessage));
+        }
+        out[i].text[min<size_t>(out[i].length, LORA_MAX_TEXT)] = '\0';
+    }
+    xSemaphoreGive(historyLock);
+    return count;
+}
+
+void LoraService::clearHistory() {
+    if (!ensureLocks()) return;
+    xSemaphoreTake(historyLock, portMAX_DELAY);
+    if (history) history.close();
+    LittleFS.remove(LORA_HISTORY_FILE);
+    historyTotal = 0;
+    xSemaphoreGive(historyLock);
+}
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+#if !defined(LITE_VERSION)
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FS.h>
+
+// LoRa radio shared by the chat and scripts.
+// The packet interrupt wakes a receive task that reads the radio right away and queues the packet,
+// a second task writes it to the history and hands it to the subscribers, so a slow flash write or
+// a busy screen never keeps the radio from taking the next packet.
+// The history is a ring of fixed size records in a file, read a page at a time.
+#define LORA_SETTINGS_FILE "/lora_settings.json"
+#define LORA_HISTORY_FILE "/lora_history.bin"
+#define LORA_HISTORY_SIZE 128
+#define LORA_MAX_TEXT 255
+#define LORA_MAX_SUBSCRIBERS 4
+
+class Module;
+class PhysicalLayer;
+
+struct __attribute__((packed)) LoraMessage {
+    uint32_t time; // unix time, 0 when the clock was not set
+    float rssi;    // dBm, 0 for sent messages
+    float snr;     // dB
+    uint8_t outgoing;
+    uint8_t length;
+    char text[LORA_MAX_TEXT + 1];
+};
+
+class LoraService {
+public:
+    enum class Radio : uint8_t { SX1276, SX1262 };
+
+    // Starts the radio with the saved settings, true if it already runs
+    bool begin();
+    void end();
+    bool running() const { return radio != nullptr; }
+    // Why begin() failed
+    const String &error() const { return lastError; }
+
+    // Blocks while transmitting, the message is added to the history when it went out
+    bool send(const String &text);
+
+    // Each subscriber gets every message, received or sent, on its own queue
+    QueueHandle_t subscribe(UBaseType_t depth = 4);
+    void unsubscribe(QueueHandle_t queue);
+
+    // History, index 0 is the oldest message. Works while the radio is off.
+    size_t historySize();
+    size_t readHistory(size_t first, LoraMessage *out, size_t count);
+    void clearHistory();
+
+    uint32_t received() const { return packets; }
+    uint32_t failed() const { return readErrors; }   // CRC or read errors
+    uint32_t dropped() const { return lostPackets; } // full queues
+
+    // Creates the file with the defaults if there is none
+    static void loadSettings(JsonDocument &doc);
+    static void saveSettings(JsonDocument &doc);
+
+private:
+    PhysicalLayer *radio = nullptr;
+    Module *module = nullptr;
+    Radio variant = Radio::SX1276;
+    String lastError;
+
+    SemaphoreHandle_t exited = NULL; // given by each task as it ends
+    uint8_t tasks = 0;
+    QueueHandle_t inbox = NULL;
+    SemaphoreHandle_t radioLock = NULL;   // receive task vs send()
+    SemaphoreHandle_t historyLock = NULL; // log task vs readers
+    SemaphoreHandle_t subscriberLock = NULL;
+    QueueHandle_t subscribers[LORA_MAX_SUBSCRIBERS] = {};
+    volatile bool stopping = false;
+    volatile uint32_t packets = 0;
+    volatile uint32_t readErrors = 0;
+    volatile uint32_t lostPackets = 0;
+
+    File history;
+    uint32_t historyTotal = 0; // messages ever written, the next one goes to slot total % size
+
+    bool ensureLocks();
+    bool startRadio(float bandMHz);
+    void stopRadio();
+    void readPacket();
+    void post(const LoraMessage &message);
+    void dispatch(const LoraMessage &message);
+    bool openHistory();
+    void appendHistory(const LoraMessage &message);
+    void importChats();
+
+    static void rxLoop(void *pvParameters);
+    static void logLoop(void *pvParameters);
+};
+
+extern LoraService loraService;
+#endif
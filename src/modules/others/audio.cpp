@@ -1,4 +1,6 @@
 #include "audio.h"
+#include "audio_player.h"
+#include "core/display.h"
 #include "core/mykeyboard.h"
 
 #if defined(HAS_NS4168_SPKR)
@@ -14,74 +16,83 @@
 void _setup_codec_speaker(bool enable) __attribute__((weak));
 void _setup_codec_speaker(bool enable) {}
 
-bool playAudioFile(FS *fs, String filepath) {
+bool playAudioFile(FS *fs, String filepath, bool async) {
     if (!bruceConfig.soundEnabled) return false;
 
-    // Enable codec, if exists
-    _setup_codec_speaker(true);
+    if (!audioPlayer.play(fs, filepath)) return false;
+    if (async) return true;
 
-    AudioFileSource *source = new AudioFileSourceFS(*fs, filepath.c_str());
-    if (!source) return false;
+    while (audioPlayer.busy()) {
+        if (check(AnyKeyPress)) audioPlayer.stop();
+        delay(20);
+    }
+    return true;
+}
 
-    AudioOutputI2S *audioout =
-        new AudioOutputI2S(); // https://github.com/earlephilhower/ESP8266Audio/blob/master/src/AudioOutputI2S.cpp#L32
-    audioout->SetPinout(BCLK, WCLK, DOUT, MCLK);
+void audioPlayerScreen(FS *fs, String filepath) {
+    if (!bruceConfig.soundEnabled) {
+        displayWarning("Sound is disabled in Config", true);
+        return;
+    }
+    if (!audioPlayer.play(fs, filepath)) {
+        displayError("Could not play file", true);
+        return;
+    }
 
-    // set volume, derived from
-    // https://github.com/earlephilhower/ESP8266Audio/blob/master/examples/WebRadio/WebRadio.ino
-    audioout->SetGain(((float)bruceConfig.soundVolume) / 100.0);
-
-    AudioGenerator *generator = NULL;
-
-    // switch on extension
-    filepath.toLowerCase(); // case-insensitive match
-    if (filepath.endsWith(".txt") || filepath.endsWith(".rtttl")) generator = new AudioGeneratorRTTTL();
-    if (filepath.endsWith(".wav")) generator = new AudioGeneratorWAV();
-    if (filepath.endsWith(".mod")) generator = new AudioGeneratorMOD();
-    if (filepath.endsWith(".opus")) generator = new AudioGeneratorOpus();
-    if (filepath.endsWith(".aac")) generator = new AudioGeneratorAAC();
-    if (filepath.endsWith(".flac")) generator = new AudioGeneratorFLAC();
-    // OGG Vorbis is not supported https://github.com/earlephilhower/ESP8266Audio/issues/84
-    if (filepath.endsWith(".mp3")) {
-        generator = new AudioGeneratorMP3();
-        source = new AudioFileSourceID3(source);
+    String name = filepath.substring(filepath.lastIndexOf('/') + 1);
+    uint32_t completions = audioPlayer.completions();
+    AudioPlayer::State lastState = AudioPlayer::State::Idle;
+    int lastProgress = -1;
+    drawMainBorderWithTitle("Audio Player");
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.drawCentreString(name, tftWidth / 2, tftHeight / 2 - 30, 1);
+    if (audioPlayer.seekable()) {
+        tft.drawCentreString("Prev/Next: seek", tftWidth / 2, tftHeight - 2 * BORDER_PAD_X - 16, 1);
     }
-    /* 2FIX: compilation issues
-    if(filepath.endsWith(".mid"))  {
-      // need to load a soundfont
-      AudioFileSource* sf2 = NULL;
-      if(setupSdCard()) sf2 = new AudioFileSourceFS(SD, "1mgm.sf2");  // TODO: make configurable
-      if(!sf2) sf2 = new AudioFileSourceLittleFS(LittleFS, "1mgm.sf2");  // TODO: make configurable
-      if(!sf2) return false;  // a soundfount was not found
-      AudioGeneratorMIDI* midi = new AudioGeneratorMIDI();
-      midi->SetSoundfont(sf2);
-      generator = midi;
-    } */
-    if (generator && source && audioout) {
-        Serial.println("Start audio");
-        generator->begin(source, audioout);
-        while (generator->isRunning()) {
-            if (!generator->loop() || check(AnyKeyPress)) generator->stop();
+    tft.drawCentreString("Sel: pause  Esc: stop", tftWidth / 2, tftHeight - 2 * BORDER_PAD_X - 8, 1);
+
+    int barX = 2 * BORDER_PAD_X;
+    int barW = tftWidth - 2 * barX;
+    int barY = tftHeight / 2;
+    tft.drawRect(barX, barY, barW, 10, bruceConfig.priColor);
+    while (audioPlayer.busy()) {
+        if (check(EscPress)) {
+            audioPlayer.stop();
+            break;
+        }
+        if (check(SelPress)) {
+            if (audioPlayer.state() == AudioPlayer::State::Paused) audioPlayer.resume();
+            else audioPlayer.pause();
+        }
+        if (audioPlayer.seekable()) {
+            if (check(NextPress)) audioPlayer.seek(min(audioPlayer.progress() + 5, 100));
+            if (check(PrevPress)) audioPlayer.seek(max(audioPlayer.progress() - 5, 0));
         }
-        audioout->stop();
-        source->close();
-        Serial.println("Stop audio");
 
-        delete generator;
-        delete source;
-        delete audioout;
-        // Disable codec, if exists
-        _setup_codec_speaker(false);
-        return true;
+        int progress = audioPlayer.progress();
+        if (progress != lastProgress) {
+            int fill = (barW - 2) * progress / 100;
+            tft.fillRect(barX + 1, barY + 1, fill, 8, bruceConfig.priColor);
+            tft.fillRect(barX + 1 + fill, barY + 1, barW - 2 - fill, 8, bruceConfig.bgColor);
+            lastProgress = progress;
+        }
+        AudioPlayer::State state = audioPlayer.state();
+        if (state != lastState) {
+            tft.drawCentreString(
+                state == AudioPlayer::State::Paused ? " Paused  " : " Playing ", tftWidth / 2, barY + 16, 1
+            );
+            lastState = state;
+        }
+        wakeUpScreen();
+        delay(50);
     }
-    // else
-    // Disable codec, if exists
-    _setup_codec_speaker(false);
-    return false; // init error
+    if (audioPlayer.completions() != completions) displaySuccess("Finished", true);
 }
 
 bool playAudioRTTTLString(String song) {
     if (!bruceConfig.soundEnabled) return false;
+    audioPlayer.stop(); // the I2S port is needed here
     // Enable codec, if exists
     _setup_codec_speaker(true);
 
@@ -123,6 +134,7 @@ bool playAudioRTTTLString(String song) {
 
 bool tts(String text) {
     if (!bruceConfig.soundEnabled) return false;
+    audioPlayer.stop(); // the I2S port is needed here
 
     // Enable codec, if exists
     _setup_codec_speaker(true);
@@ -152,6 +164,7 @@ bool isAudioFile(String filepath) {
 
 void playTone(unsigned int frequency, unsigned long duration, short waveType) {
     if (!bruceConfig.soundEnabled) return;
+    audioPlayer.stop(); // the I2S port is needed here
 
     // Enable codec, if exists
     _setup_codec_speaker(true);
@@ -2,7 +2,11 @@
 #include <SPIFFS.h>
 // Keep SPIFFS first
 
-bool playAudioFile(FS *fs, String filepath); // TODO: bool async arg -> play in a task?
+// Plays through audioPlayer, async returns once playback started, otherwise a key press stops it
+bool playAudioFile(FS *fs, String filepath, bool async = false);
+
+// Progress and pause/seek controls while the file plays
+void audioPlayerScreen(FS *fs, String filepath);
 
 bool playAudioRTTTLString(String song);
 
@@ -0,0 +1,332 @@
+#include "audio.h"
+#include "audio_player.h"
+#include <globals.h>
+
+#if defined(HAS_NS4168_SPKR)
+#include "AudioGeneratorAAC.h"
+#include "AudioGeneratorFLAC.h"
+#include "AudioGeneratorWAV.h"
+#include <ESP8266Audio.h>
+#include <atomic>
+
+#define AUDIO_CHUNK 4096
+#define AUDIO_READ_TIMEOUT 500 // ms a read waits for the card before the decoder sees an underrun
+
+void _setup_codec_speaker(bool enable);
+
+AudioPlayer audioPlayer;
+
+namespace {
+// File source backed by a ring that a filler task keeps ahead of the decoder. The decoder side
+// (read, seek) runs on the player task, the filler only appends, the lock covers the file itself.
+class AudioFileSourceReadAhead : public AudioFileSource {
+public:
+    AudioFileSourceReadAhead(FS &fs, const char *path) {
+        file = fs.open(path, FILE_READ);
+        if (!file) return;
+        fileSize = file.size();
+        ringSize = psramFound() ? 64 * 1024 : 16 * 1024;
+        ring = (uint8_t *)(psramFound() ? ps_malloc(ringSize) : malloc(ringSize));
+        lock = xSemaphoreCreateMutex();
+        exited = xSemaphoreCreateBinary();
+        if (!ring || !lock || !exited ||
+            xTaskCreate(fillTask, "AudioFill", 3072, this, 4, &filler) != pdPASS) {
+            filler = NULL;
+            file.close();
+        }
+    }
+    ~AudioFileSourceReadAhead() override {
+        close();
+        free(ring);
+        if (lock) vSemaphoreDelete(lock);
+        if (exited) vSemaphoreDelete(exited);
+    }
+
+    uint32_t read(void *data, uint32_t len) override { return take((uint8_t *)data, len, true); }
+    uint32_t readNonBlock(void *data, uint32_t len) override { return take((uint8_t *)data, len, false); }
+
+    bool seek(int32_t pos, int dir) override {
+        if (!isOpen()) return false;
+        uint32_t target = dir == SEEK_SET ? pos : dir == SEEK_CUR ? getPos() + pos : fileSize + pos;
+        if (target > fileSize) return false;
+        uint32_t buffered = head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+        // Forward jumps inside the buffer keep what was read ahead
+        if (target >= getPos() && target - getPos() <= buffered) {
+            tail.fetch_add(target - getPos(), std::memory_order_release);
+            return true;
+        }
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool ok = file.seek(target);
+        base = target;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        eof = false;
+        xSemaphoreGive(lock);
+        xTaskNotifyGive(filler);
+        return ok;
+    }
+
+    bool close() override {
+        if (!filler) return false;
+        stopping = true;
+        xTaskNotifyGive(filler);
+        xSemaphoreTake(exited, portMAX_DELAY);
+        filler = NULL;
+        file.close();
+        return true;
+    }
+    bool isOpen() override { return filler != NULL; }
+    uint32_t getSize() override { return fileSize; }
+    uint32_t getPos() override { return base + tail.load(std::memory_order_relaxed); }
+
+private:
+    File file;
+    uint32_t fileSize = 0;
+    uint8_t *ring = nullptr;
+    size_t ringSize = 0;
+    uint32_t base = 0;             // file offset of ring byte 0
+    std::atomic<uint32_t> head{0}; // bytes filled since base
+    std::atomic<uint32_t> tail{0}; // bytes consumed since base
+    volatile bool eof = false;
+    volatile bool stopping = false;
+    SemaphoreHandle_t lock = NULL;
+    SemaphoreHandle_t exited = NULL;
+    TaskHandle_t filler = NULL;
+
+    uint32_t take(uint8_t *data, uint32_t len, bool block) {
+        if (!isOpen()) return 0;
+        uint32_t copied = 0;
+        uint32_t waitedMs = 0;
+        while (copied < len) {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            uint32_t available = head.load(std::memory_order_acquire) - t;
+            if (available == 0) {
+                if (eof || !block || waitedMs >= AUDIO_READ_TIMEOUT) break;
+                xTaskNotifyGive(filler);
+                vTaskDelay(1);
+                waitedMs += portTICK_PERIOD_MS;
+                continue;
+            }
+            size_t offset = t % ringSize;
+            uint32_t n = min<uint32_t>(min<uint32_t>(available, len - copied), ringSize - offset);
+            memcpy(data + copied, ring + offset, n);
+            tail.store(t + n, std::memory_order_release);
+            copied += n;
+        }
+        // Room for another chunk, no need to wait for the filler to wake up by itself
+        if (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed) <=
+            ringSize - AUDIO_CHUNK)
+            xTaskNotifyGive(filler);
+        return copied;
+    }
+
+    static void fillTask(void *pvParameters) {
+        AudioFileSourceReadAhead *self = (AudioFileSourceReadAhead *)pvParameters;
+        while (!self->stopping) {
+            bool filled = false;
+            xSemaphoreTake(self->lock, portMAX_DELAY);
+            uint32_t h = self->head.load(std::memory_order_relaxed);
+            uint32_t space = self->ringSize - (h - self->tail.load(std::memory_order_acquire));
+            if (!self->eof && space >= AUDIO_CHUNK) {
+                size_t offset = h % self->ringSize;
+                size_t n = min<size_t>(AUDIO_CHUNK, self->ringSize - offset);
+                int got = self->file.read(self->ring + offset, n);
+                if (got > 0) self->head.store(h + got, std::memory_order_release);
+                else self->eof = true;
+                filled = got > 0;
+            }
+            xSemaphoreGive(self->lock);
+            if (!filled) ulTaskNotifyTake(pdTRUE, 50 / portTICK_PERIOD_MS);
+        }
+        xSemaphoreGive(self->exited);
+        vTaskDelete(NULL);
+    }
+};
+
+struct Playback {
+    AudioFileSource *file = nullptr;   // what the generator reads, may wrap source
+    AudioFileSource *source = nullptr; // read-ahead file
+    AudioGenerator *generator = nullptr;
+    AudioOutputI2S *output = nullptr;
+    uint32_t dataStart = 0; // file offset of the audio after the headers
+    bool seekable = false;
+};
+} // namespace
+
+uint8_t AudioPlayer::progress() const {
+    uint32_t total = currentSize;
+    return total ? (uint64_t)currentPosition * 100 / total : 0;
+}
+
+bool AudioPlayer::ensureTask() {
+    if (requests) return true;
+    requests = xQueueCreate(8, sizeof(Request));
+    done = xSemaphoreCreateBinary();
+    caller = xSemaphoreCreateMutex();
+    // Decoders keep large frames on the stack
+    if (!requests || !done || !caller ||
+        xTaskCreate(playerTask, "AudioPlayer", 8192, this, 3, NULL) != pdPASS) {
+        if (requests) vQueueDelete(requests);
+        if (done) vSemaphoreDelete(done);
+        if (caller) vSemaphoreDelete(caller);
+        requests = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool AudioPlayer::send(const Request &request, bool wait) {
+    if (!ensureTask()) return false;
+    if (!wait) return xQueueSend(requests, &request, 100 / portTICK_PERIOD_MS) == pdTRUE;
+    // One waiting caller at a time, so the acknowledge belongs to this request
+    xSemaphoreTake(caller, portMAX_DELAY);
+    xSemaphoreTake(done, 0);
+    bool ok = xQueueSend(requests, &request, portMAX_DELAY) == pdTRUE &&
+              xSemaphoreTake(done, 5000 / portTICK_PERIOD_MS) == pdTRUE;
+    xSemaphoreGive(caller);
+    return ok;
+}
+
+bool AudioPlayer::play(FS *fs, const String &path) {
+    Request request = {Command::Play, 0, fs, {0}};
+    strlcpy(request.path, path.c_str(), sizeof(request.path));
+    return send(request, true) && started;
+}
+
+void AudioPlayer::pause() { send({Command::Pause, 0, nullptr, {0}}, false); }
+
+void AudioPlayer::resume() { send({Command::Resume, 0, nullptr, {0}}, false); }
+
+void AudioPlayer::stop() {
+    if (!requests) return;
+    send({Command::Stop, 0, nullptr, {0}}, true);
+}
+
+void AudioPlayer::seek(uint8_t percent) {
+    send({Command::Seek, min<uint8_t>(percent, 100), nullptr, {0}}, false);
+}
+
+void AudioPlayer::setVolume(uint8_t volume) {
+    send({Command::Volume, min<uint8_t>(volume, 100), nullptr, {0}}, false);
+}
+
+static void finishPlayback(Playback &p) {
+    if (!p.generator) return;
+    if (p.generator->isRunning()) p.generator->stop();
+    p.output->stop();
+    p.file->close();
+    delete p.generator;
+    if (p.file != p.source) delete p.file;
+    delete p.source;
+    delete p.output;
+    p = Playback();
+    // Disable codec, if exists
+    _setup_codec_speaker(false);
+    Serial.println("Stop audio");
+}
+
+static bool startPlayback(Playback &p, FS *fs, String path) {
+    // Enable codec, if exists
+    _setup_codec_speaker(true);
+
+    p.source = new AudioFileSourceReadAhead(*fs, path.c_str());
+    p.file = p.source;
+    // https://github.com/earlephilhower/ESP8266Audio/blob/master/src/AudioOutputI2S.cpp#L32
+    p.output = new AudioOutputI2S();
+    p.output->SetPinout(BCLK, WCLK, DOUT, MCLK);
+    // set volume, derived from
+    // https://github.com/earlephilhower/ESP8266Audio/blob/master/examples/WebRadio/WebRadio.ino
+    p.output->SetGain(((float)bruceConfig.soundVolume) / 100.0);
+
+    // switch on extension
+    path.toLowerCase(); // case-insensitive match
+    if (path.endsWith(".txt") || path.endsWith(".rtttl")) p.generator = new AudioGeneratorRTTTL();
+    if (path.endsWith(".wav")) p.generator = new AudioGeneratorWAV();
+    if (path.endsWith(".mod")) p.generator = new AudioGeneratorMOD();
+    if (path.endsWith(".opus")) p.generator = new AudioGeneratorOpus();
+    if (path.endsWith(".aac")) p.generator = new AudioGeneratorAAC();
+    if (path.endsWith(".flac")) p.generator = new AudioGeneratorFLAC();
+    // OGG Vorbis is not supported https://github.com/earlephilhower/ESP8266Audio/issues/84
+    if (path.endsWith(".mp3")) {
+        p.generator = new AudioGeneratorMP3();
+        p.file = new AudioFileSourceID3(p.source);
+    }
+    // Frame based formats find their sync again after a jump, the others would decode garbage
+    p.seekable = path.endsWith(".wav") || path.endsWith(".mp3") || path.endsWith(".aac") ||
+                 path.endsWith(".flac");
+
+    if (!p.generator || !p.source->isOpen() || !p.generator->begin(p.file, p.output)) {
+        delete p.generator;
+        if (p.file != p.source) delete p.file;
+        delete p.source;
+        delete p.output;
+        p = Playback();
+        _setup_codec_speaker(false);
+        return false;
+    }
+    p.dataStart = p.source->getPos();
+    Serial.println("Start audio");
+    return true;
+}
+
+void AudioPlayer::playerTask(void *pvParameters) {
+    AudioPlayer *self = (AudioPlayer *)pvParameters;
+    Playback p;
+    while (true) {
+        Request request;
+        // Block for requests only while there is nothing to decode
+        TickType_t wait = self->currentState == State::Playing ? 0 : portMAX_DELAY;
+        while (xQueueReceive(self->requests, &request, wait) == pdTRUE) {
+            wait = 0;
+            switch (request.command) {
+                case Command::Play:
+                    finishPlayback(p);
+                    self->currentState = State::Idle;
+                    self->started = startPlayback(p, request.fs, request.path);
+                    if (self->started) {
+                        self->currentSize = p.source->getSize();
+                        self->currentPosition = p.source->getPos();
+                        self->currentSeekable = p.seekable;
+                        self->currentState = State::Playing;
+                    }
+                    xSemaphoreGive(self->done);
+                    break;
+                case Command::Pause:
+                    if (self->currentState == State::Playing) self->currentState = State::Paused;
+                    break;
+                case Command::Resume:
+                    if (self->currentState == State::Paused) self->currentState = State::Playing;
+                    break;
+                case Command::Stop:
+                    finishPlayback(p);
+                    self->currentState = State::Idle;
+                    xSemaphoreGive(self->done);
+                    break;
+                case Command::Seek:
+                    if (p.generator && p.seekable) {
+                        uint32_t length = p.source->getSize() - p.dataStart;
+                        // Whole 32 bit frames so that wav channels stay in place
+                        uint32_t offset = ((uint64_t)length * request.value / 100) & ~3u;
+                        p.source->seek(p.dataStart + min(offset, length), SEEK_SET);
+                    }
+                    break;
+                case Command::Volume:
+                    if (p.output) p.output->SetGain(request.value / 100.0);
+                    break;
+            }
+        }
+
+        if (self->currentState != State::Playing) continue;
+        if (!p.generator->loop()) {
+            finishPlayback(p);
+            self->currentState = State::Idle;
+            self->completed++;
+            continue;
+        }
+        self->currentPosition = p.source->getPos();
+        // The generator returns as soon as the I2S DMA is full, leave the CPU to everyone else
+        vTaskDelay(1);
+    }
+}
+
+#endif
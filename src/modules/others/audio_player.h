@@ -0,0 +1,74 @@
+#ifndef __AUDIO_PLAYER_H__
+#define __AUDIO_PLAYER_H__
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Plays audio files from a task of its own, so the caller keeps running. File data comes through a
+// read-ahead buffer filled by a second task, an SD card that stalls for a moment does not starve
+// the decoder. Requests are queued to the player task, state is published for the UI to poll.
+class AudioPlayer {
+public:
+    enum class State : uint8_t {
+        Idle,
+        Playing,
+        Paused,
+    };
+
+    // Starts path, stopping whatever was playing. Waits until the file is open and the decoder
+    // started, false if that failed or the extension is not supported.
+    bool play(FS *fs, const String &path);
+    void pause();
+    void resume();
+    // Waits until the output is released, so the I2S port can be used by someone else
+    void stop();
+    // Jumps to a percentage of the audio data, only for wav, mp3, aac and flac
+    void seek(uint8_t percent);
+    // Gain of the current track 0..100, the next one starts from bruceConfig.soundVolume
+    void setVolume(uint8_t volume);
+
+    State state() const { return currentState; }
+    bool busy() const { return currentState != State::Idle; }
+    // Bytes of the file handed to the decoder, and the file size
+    uint32_t position() const { return currentPosition; }
+    uint32_t size() const { return currentSize; }
+    uint8_t progress() const;
+    bool seekable() const { return currentSeekable; }
+    // Tracks that played to their end, a change tells the UI that one completed
+    uint32_t completions() const { return completed; }
+
+private:
+    enum class Command : uint8_t {
+        Play,
+        Pause,
+        Resume,
+        Stop,
+        Seek,
+        Volume,
+    };
+    struct Request {
+        Command command;
+        uint8_t value;
+        FS *fs;
+        char path[128];
+    };
+
+    QueueHandle_t requests = NULL;
+    SemaphoreHandle_t done = NULL; // given when Play or Stop was handled
+    SemaphoreHandle_t caller = NULL;
+    volatile bool started = false;
+
+    volatile State currentState = State::Idle;
+    volatile uint32_t currentPosition = 0;
+    volatile uint32_t currentSize = 0;
+    volatile bool currentSeekable = false;
+    volatile uint32_t completed = 0;
+
+    bool ensureTask();
+    bool send(const Request &request, bool wait);
+    static void playerTask(void *pvParameters);
+};
+
+extern AudioPlayer audioPlayer;
+
+#endif
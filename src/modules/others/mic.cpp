@@ -3,8 +3,10 @@
 #include "core/mykeyboard.h"
 #include "core/powerSave.h"
 #include "driver/gpio.h"
+#include "spectrum_analyzer.h"
 #include "soc/gpio_struct.h"
 #include "soc/io_mux_reg.h"
+#include <atomic>
 #include <esp_heap_caps.h>
 
 #include "driver/i2s_pdm.h"
@@ -18,11 +20,11 @@ static i2s_chan_handle_t i2s_chan = nullptr;
 #define FFT_SIZE 1024
 #define SPECTRUM_WIDTH 200
 #define SPECTRUM_HEIGHT 124
-#define HISTORY_LEN (SPECTRUM_WIDTH + 1)
+#define SPECTRUM_DB_MIN -90.0f // bottom and top of the palette
+#define SPECTRUM_DB_MAX -20.0f
+#define MIC_SAMPLE_RATE 48000
 
 static int16_t *i2s_buffer = nullptr;
-static uint8_t *fftHistory = nullptr; // Linear buffer [WIDTH + 1][HEIGHT]
-static uint16_t posData = 0;
 
 #ifndef PIN_CLK
 #define PIN_CLK I2S_PIN_NO_CHANGE
@@ -107,19 +109,28 @@ bool deinitMicroPhone() {
     return err;
 }
 
-bool InitI2SMicroPhone() {
+// Format the channel was actually opened with, some setups only run at 48kHz/16 bits
+static uint32_t mic_sample_rate = 48000;
+static uint8_t mic_bits = 16;
+
+bool InitI2SMicroPhone(uint32_t sampleRate = 48000, uint8_t bits = 16) {
     // Enable codec, if exists
     _setup_codec_mic(true);
+    mic_sample_rate = sampleRate;
+    mic_bits = 16;
     i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
     chan_cfg.dma_desc_num = 8;
     chan_cfg.dma_frame_num = SPECTRUM_HEIGHT;
     esp_err_t err = i2s_new_channel(&chan_cfg, NULL, &i2s_chan);
 #if defined(MIC_INMP441) // #ifdef PIN_WS // INMP441
-    i2s_std_slot_config_t slot_cfg =
-        I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO);
-    slot_cfg.slot_bit_width = I2S_SLOT_BIT_WIDTH_16BIT;
+    // 24 bit samples come left aligned in 32 bit slots
+    mic_bits = bits == 24 ? 24 : 16;
+    i2s_std_slot_config_t slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(
+        mic_bits == 24 ? I2S_DATA_BIT_WIDTH_32BIT : I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO
+    );
+    slot_cfg.slot_bit_width = mic_bits == 24 ? I2S_SLOT_BIT_WIDTH_32BIT : I2S_SLOT_BIT_WIDTH_16BIT;
     const i2s_std_config_t std_cfg = {
-        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(48000),
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sampleRate),
         .slot_cfg = slot_cfg,
         .gpio_cfg = {
                      .mclk = I2S_GPIO_UNUSED,
@@ -135,6 +146,7 @@ bool InitI2SMicroPhone() {
 
     if (mic_bclk_pin != I2S_PIN_NO_CHANGE) {
         gpio_num_t mic_ws_pin = (gpio_num_t)PIN_CLK;
+        mic_sample_rate = 48000;
         i2s_std_config_t i2s_config;
         memset(&i2s_config, 0, sizeof(i2s_std_config_t));
 #if defined(CONFIG_IDF_TARGET_ESP32P4)
@@ -165,7 +177,7 @@ bool InitI2SMicroPhone() {
         err = i2s_channel_init_std_mode(i2s_chan, &i2s_config);
     } else {
 
-        i2s_pdm_rx_clk_config_t clk_cfg = I2S_PDM_RX_CLK_DEFAULT_CONFIG(48000);
+        i2s_pdm_rx_clk_config_t clk_cfg = I2S_PDM_RX_CLK_DEFAULT_CONFIG(sampleRate);
         i2s_pdm_rx_slot_config_t slot_cfg =
             I2S_PDM_RX_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO);
         slot_cfg.slot_bit_width = I2S_SLOT_BIT_WIDTH_16BIT;
@@ -185,76 +197,135 @@ bool InitI2SMicroPhone() {
     return (err == ESP_OK);
 }
 
+/*********************************************************************
+**  Spectrum
+*********************************************************************/
+// Two FFT_SIZE buffers go around: the capture task fills one while the UI transforms the other
+static QueueHandle_t micFree = NULL;
+static QueueHandle_t micReady = NULL;
+static SemaphoreHandle_t micCaptureExited = NULL;
+
+static void mic_capture_task(void *pvParameters) {
+    int16_t *buffer;
+    // nullptr asks the task to stop
+    while (xQueueReceive(micFree, &buffer, portMAX_DELAY) == pdTRUE && buffer) {
+        size_t bytesread = 0;
+        i2s_channel_read(i2s_chan, buffer, FFT_SIZE * sizeof(int16_t), &bytesread, portMAX_DELAY);
+        xQueueSend(micReady, &buffer, portMAX_DELAY);
+    }
+    xSemaphoreGive(micCaptureExited);
+    vTaskDelete(NULL);
+}
+
+static void mic_draw_mode(const SpectrumAnalyzer &analyzer, int y) {
+    static const char *modes[] = {"Instant", "Average", "Peak hold"};
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, TFT_BLACK);
+    tft.setCursor(tftWidth / 2 - SPECTRUM_WIDTH / 2, y);
+    tft.printf(
+        "%s %s  %5.0f Hz ",
+        analyzer.scale() == SpectrumAnalyzer::Scale::Log ? "Log" : "Lin",
+        modes[(int)analyzer.mode()],
+        analyzer.peakFrequency()
+    );
+}
+
+static void mic_set_scale(SpectrumAnalyzer &analyzer, SpectrumAnalyzer::Scale scale) {
+    // Linear keeps the FFT resolution over the voice range, log spreads the audible range
+    float binWidth = analyzer.binWidth();
+    if (scale == SpectrumAnalyzer::Scale::Log) analyzer.setBins(SPECTRUM_HEIGHT, scale, 40, 20000);
+    else analyzer.setBins(SPECTRUM_HEIGHT, scale, binWidth / 2, binWidth * (SPECTRUM_HEIGHT + 0.5f));
+}
+
 void mic_test_one_task() {
     tft.fillScreen(TFT_BLACK);
 
-    // Alloc framebuffer
+    // Alloc framebuffer, it also holds the waterfall history
     uint16_t *frameBuffer;
-    if (psramFound())
-        frameBuffer = (uint16_t *)ps_malloc(SPECTRUM_WIDTH * SPECTRUM_HEIGHT * sizeof(uint16_t));
+    size_t frameSize = SPECTRUM_WIDTH * SPECTRUM_HEIGHT * sizeof(uint16_t);
+    if (psramFound()) frameBuffer = (uint16_t *)ps_malloc(frameSize);
     else {
         closeSdCard(); // Close SDCard to release RAM, as it won't be used
-        frameBuffer = (uint16_t *)malloc(SPECTRUM_WIDTH * SPECTRUM_HEIGHT * sizeof(uint16_t));
+        frameBuffer = (uint16_t *)malloc(frameSize);
     }
 
-    if (!frameBuffer) {
-        Serial.println("Error alloc drawing frameBuffer, exiting");
+    SpectrumAnalyzer analyzer(FFT_SIZE, MIC_SAMPLE_RATE);
+    micFree = xQueueCreate(3, sizeof(int16_t *));
+    micReady = xQueueCreate(2, sizeof(int16_t *));
+    micCaptureExited = xSemaphoreCreateBinary();
+    bool started = frameBuffer && analyzer.ok() && micFree && micReady && micCaptureExited;
+    if (started) {
+        for (int i = 0; i < 2; i++) {
+            int16_t *buffer = i2s_buffer + i * FFT_SIZE;
+            xQueueSend(micFree, &buffer, 0);
+        }
+        // Above the UI so reads keep up while a frame is pushed to the screen
+        started = xTaskCreate(mic_capture_task, "MicCapture", 3072, NULL, 5, NULL) == pdPASS;
+    }
+    if (!started) {
+        Serial.println("Error alloc spectrum buffers, exiting");
         displayError("Not Enough RAM", true);
+        if (micFree) vQueueDelete(micFree);
+        if (micReady) vQueueDelete(micReady);
+        if (micCaptureExited) vSemaphoreDelete(micCaptureExited);
+        free(frameBuffer);
         return;
     }
-    tft.drawRect(
-        tftWidth / 2 - SPECTRUM_WIDTH / 2 - 2,
-        tftHeight / 2 - SPECTRUM_HEIGHT / 2 - 2,
-        SPECTRUM_WIDTH + 4,
-        SPECTRUM_HEIGHT + 4,
-        bruceConfig.priColor
-    );
-
-    while (1) {
-        fft_config_t *plan = fft_init(FFT_SIZE, FFT_REAL, FFT_FORWARD, NULL, NULL);
-        size_t bytesread;
-        i2s_channel_read(i2s_chan, (char *)i2s_buffer, FFT_SIZE * sizeof(int16_t), &bytesread, portMAX_DELAY);
 
-        int16_t *samples = (int16_t *)i2s_buffer;
+    memset(frameBuffer, 0, frameSize);
+    mic_set_scale(analyzer, SpectrumAnalyzer::Scale::Linear);
+    int left = tftWidth / 2 - SPECTRUM_WIDTH / 2;
+    int top = tftHeight / 2 - SPECTRUM_HEIGHT / 2;
+    tft.drawRect(left - 2, top - 2, SPECTRUM_WIDTH + 4, SPECTRUM_HEIGHT + 4, bruceConfig.priColor);
+    uint32_t lastLabel = 0;
 
-        for (int i = 0; i < FFT_SIZE; i++) { plan->input[i] = (float)samples[i] / 32768.0f; }
-
-        fft_execute(plan);
-
-        for (int i = 1; i < FFT_SIZE / 4 && i < SPECTRUM_HEIGHT; i++) {
-            float re = plan->output[2 * i];
-            float im = plan->output[2 * i + 1];
-            float mag = re * re + im * im;
-            if (mag > 1.0f) mag = 1.0f;
-            uint8_t value = map(mag * 2000, 0, 2000, 0, 255);
-            fftHistory[posData * SPECTRUM_HEIGHT + (SPECTRUM_HEIGHT - i)] = value;
-        }
-
-        posData = (posData + 1) % HISTORY_LEN;
-
-        fft_destroy(plan);
-
-        // Render
-        for (int y = 0; y < SPECTRUM_HEIGHT; y++) {
-            for (int x = 0; x < SPECTRUM_WIDTH; x++) {
-                int index = (x + posData) % HISTORY_LEN;
-                uint8_t val = fftHistory[index * SPECTRUM_HEIGHT + y];
-                uint16_t color =
+    while (1) {
+        int16_t *buffer;
+        if (xQueueReceive(micReady, &buffer, 50 / portTICK_PERIOD_MS) == pdTRUE) {
+            analyzer.process(buffer);
+            xQueueSend(micFree, &buffer, 0);
+
+            // Scroll the waterfall one pixel and draw only the new column, low frequencies at the bottom
+            const float *bins = analyzer.bins();
+            for (int y = 0; y < SPECTRUM_HEIGHT; y++) {
+                uint16_t *row = frameBuffer + y * SPECTRUM_WIDTH;
+                memmove(row, row + 1, (SPECTRUM_WIDTH - 1) * sizeof(uint16_t));
+                float level = bins[SPECTRUM_HEIGHT - 1 - y] - SPECTRUM_DB_MIN;
+                uint8_t val = constrain(level * 255 / (SPECTRUM_DB_MAX - SPECTRUM_DB_MIN), 0, 255);
+                row[SPECTRUM_WIDTH - 1] =
                     rgb565(ImageData[val * 3 + 0], ImageData[val * 3 + 1], ImageData[val * 3 + 2]);
-                frameBuffer[y * SPECTRUM_WIDTH + x] = color;
             }
-        }
 
-        tft.pushImage(
-            tftWidth / 2 - SPECTRUM_WIDTH / 2,
-            tftHeight / 2 - SPECTRUM_HEIGHT / 2,
-            SPECTRUM_WIDTH,
-            SPECTRUM_HEIGHT,
-            frameBuffer
-        );
+            tft.pushImage(left, top, SPECTRUM_WIDTH, SPECTRUM_HEIGHT, frameBuffer);
+            if (millis() - lastLabel > 250) {
+                mic_draw_mode(analyzer, top + SPECTRUM_HEIGHT + 6);
+                lastLabel = millis();
+            }
+        }
         wakeUpScreen();
         if (check(SelPress) || check(EscPress)) break;
+        if (check(NextPress)) {
+            mic_set_scale(
+                analyzer,
+                analyzer.scale() == SpectrumAnalyzer::Scale::Log ? SpectrumAnalyzer::Scale::Linear
+                                                                 : SpectrumAnalyzer::Scale::Log
+            );
+            lastLabel = 0;
+        }
+        if (check(PrevPress)) {
+            analyzer.setMode(SpectrumAnalyzer::Mode(((int)analyzer.mode() + 1) % 3));
+            lastLabel = 0;
+        }
     }
+
+    int16_t *stop = nullptr;
+    xQueueSend(micFree, &stop, portMAX_DELAY);
+    xSemaphoreTake(micCaptureExited, portMAX_DELAY);
+    vQueueDelete(micFree);
+    vQueueDelete(micReady);
+    vSemaphoreDelete(micCaptureExited);
+    micFree = micReady = NULL;
+    micCaptureExited = NULL;
     i2s_channel_disable(i2s_chan);
 
     free(frameBuffer);
@@ -282,25 +353,17 @@ void mic_test() {
     }
     Serial.println("Mic Spectrum start");
     InitI2SMicroPhone();
-    // Alloc buffers in PSRAM if available
-    if (psramFound()) {
-        i2s_buffer = (int16_t *)ps_malloc(FFT_SIZE * sizeof(int16_t));
-        fftHistory = (uint8_t *)ps_malloc(HISTORY_LEN * SPECTRUM_HEIGHT);
-    } else {
-        i2s_buffer = (int16_t *)malloc(FFT_SIZE * sizeof(int16_t));
-        fftHistory = (uint8_t *)malloc(HISTORY_LEN * SPECTRUM_HEIGHT);
-    }
-    if (!i2s_buffer || !fftHistory) {
+    // Alloc buffers in PSRAM if available, two of them for the capture task
+    if (psramFound()) i2s_buffer = (int16_t *)ps_malloc(2 * FFT_SIZE * sizeof(int16_t));
+    else i2s_buffer = (int16_t *)malloc(2 * FFT_SIZE * sizeof(int16_t));
+    if (!i2s_buffer) {
         displayError("Fail to alloc buffers, exiting", true);
         return;
     }
 
-    memset(fftHistory, 0, HISTORY_LEN * SPECTRUM_HEIGHT);
-
     mic_test_one_task();
 
     free(i2s_buffer);
-    free(fftHistory);
 
     delay(10);
     if (deinitMicroPhone()) Serial.println("Fail disabling I2S Driver");
@@ -315,57 +378,214 @@ void mic_test() {
     ioExpander.turnPinOnOff(IO_EXP_MIC, LOW);
 }
 
+/*********************************************************************
+**  Recorder
+*********************************************************************/
 // https://github.com/MhageGH/esp32_SoundRecorder/tree/master
 
-void CreateWavHeader(byte *header, int waveDataSize) {
-    header[0] = 'R';
-    header[1] = 'I';
-    header[2] = 'F';
-    header[3] = 'F';
-    unsigned int fileSizeMinus8 = waveDataSize + 44 - 8;
-    header[4] = (byte)(fileSizeMinus8 & 0xFF);
-    header[5] = (byte)((fileSizeMinus8 >> 8) & 0xFF);
-    header[6] = (byte)((fileSizeMinus8 >> 16) & 0xFF);
-    header[7] = (byte)((fileSizeMinus8 >> 24) & 0xFF);
-    header[8] = 'W';
-    header[9] = 'A';
-    header[10] = 'V';
-    header[11] = 'E';
-    header[12] = 'f';
-    header[13] = 'm';
-    header[14] = 't';
-    header[15] = ' ';
-    header[16] = 0x10; // linear PCM
-    header[17] = 0x00;
-    header[18] = 0x00;
-    header[19] = 0x00;
-    header[20] = 0x01; // linear PCM
-    header[21] = 0x00;
-    header[22] = 0x01; // monoral
-    header[23] = 0x00;
-    header[24] = 0x80; // sampling rate 48000
-    header[25] = 0xBB;
-    header[26] = 0x00;
-    header[27] = 0x00;
-    header[28] = 0x00; // Byte/sec = 48000x2x1 = 96000
-    header[29] = 0x77;
-    header[30] = 0x01;
-    header[31] = 0x00;
-    header[32] = 0x02; // 16bit monoral
-    header[33] = 0x00;
-    header[34] = 0x10; // 16bit
-    header[35] = 0x00;
-    header[36] = 'd';
-    header[37] = 'a';
-    header[38] = 't';
-    header[39] = 'a';
-    header[40] = (byte)(waveDataSize & 0xFF);
-    header[41] = (byte)((waveDataSize >> 8) & 0xFF);
-    header[42] = (byte)((waveDataSize >> 16) & 0xFF);
-    header[43] = (byte)((waveDataSize >> 24) & 0xFF);
+// The header is padded with a JUNK chunk to one sector, so audio blocks land on sector boundaries
+#define WAV_HEADER_SIZE 512
+#define REC_READ_SAMPLES 1024
+#define REC_HEADER_INTERVAL 2000 // ms between header updates, what a power loss can cost
+
+static void put16(byte *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(byte *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+void CreateWavHeader(byte *header, uint32_t waveDataSize, uint32_t sampleRate, uint8_t bits) {
+    uint16_t blockAlign = bits / 8; // mono
+    memset(header, 0, WAV_HEADER_SIZE);
+    memcpy(header, "RIFF", 4);
+    put32(header + 4, WAV_HEADER_SIZE - 8 + waveDataSize);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    put32(header + 16, 16);
+    put16(header + 20, 1); // linear PCM
+    put16(header + 22, 1); // monoral
+    put32(header + 24, sampleRate);
+    put32(header + 28, sampleRate * blockAlign);
+    put16(header + 32, blockAlign);
+    put16(header + 34, bits);
+    memcpy(header + 36, "JUNK", 4);
+    put32(header + 40, WAV_HEADER_SIZE - 44 - 8);
+    memcpy(header + WAV_HEADER_SIZE - 8, "data", 4);
+    put32(header + WAV_HEADER_SIZE - 4, waveDataSize);
+}
+
+// The reader task moves I2S DMA data into a ring, the writer task empties it in large blocks,
+// so the SD card can stall for as long as the ring lasts without losing audio
+struct MicRecorder {
+    File file;
+    uint8_t *ring = nullptr;
+    size_t ringSize = 0;
+    size_t blockSize = 0;
+    std::atomic<uint32_t> head{0}; // bytes produced
+    std::atomic<uint32_t> tail{0}; // bytes written
+    uint32_t sampleRate = 48000;
+    uint8_t bits = 16;
+    volatile bool stopping = false;
+    volatile bool writeError = false;
+    volatile uint32_t overruns = 0;
+    volatile uint32_t lostBytes = 0;
+    volatile uint16_t peak = 0; // since the UI last read it, 0..32767
+    volatile uint32_t dataSize = 0;
+    SemaphoreHandle_t readerExited = NULL;
+    SemaphoreHandle_t writerExited = NULL;
+};
+
+static void mic_reader_task(void *pvParameters) {
+    MicRecorder *rec = (MicRecorder *)pvParameters;
+    size_t sampleBytes = rec->bits / 8;
+    size_t slotBytes = rec->bits == 24 ? 4 : 2;
+    uint8_t *raw = (uint8_t *)i2s_buffer;
+    while (!rec->stopping) {
+        size_t bytesRead = 0;
+        i2s_channel_read(i2s_chan, raw, REC_READ_SAMPLES * slotBytes, &bytesRead, 100);
+        size_t samples = bytesRead / slotBytes;
+        if (samples == 0) continue;
+
+        // Level meter and 32 bit slots packed down to 24 bit samples, in place
+        uint16_t peak = rec->peak;
+        for (size_t i = 0; i < samples; i++) {
+            int32_t v;
+            if (slotBytes == 4) {
+                v = ((int32_t *)raw)[i];
+                memcpy(raw + i * 3, (uint8_t *)&v + 1, 3);
+                v >>= 16;
+            } else {
+                v = ((int16_t *)raw)[i];
+            }
+            peak = max<uint16_t>(peak, min(abs(v), 32767));
+        }
+        rec->peak = peak;
+
+        size_t n = samples * sampleBytes;
+        uint32_t h = rec->head.load(std::memory_order_relaxed);
+        uint32_t t = rec->tail.load(std::memory_order_acquire);
+        if (rec->ringSize - (h - t) < n) {
+            // The writer is behind by a whole ring, this block is lost
+            rec->overruns++;
+            rec->lostBytes += n;
+            continue;
+        }
+        size_t offset = h % rec->ringSize;
+        size_t first = min(n, rec->ringSize - offset);
+        memcpy(rec->ring + offset, raw, first);
+        memcpy(rec->ring, raw + first, n - first);
+        rec->head.store(h + n, std::memory_order_release);
+    }
+    xSemaphoreGive(rec->readerExited);
+    vTaskDelete(NULL);
+}
+
+static void mic_writer_task(void *pvParameters) {
+    MicRecorder *rec = (MicRecorder *)pvParameters;
+    byte header[WAV_HEADER_SIZE];
+    uint32_t lastHeader = millis();
+    bool draining = false;
+    while (true) {
+        uint32_t t = rec->tail.load(std::memory_order_relaxed);
+        uint32_t available = rec->head.load(std::memory_order_acquire) - t;
+        // Whole blocks while recording, the ring size is a multiple of them so they never wrap
+        if (available >= rec->blockSize || (draining && available > 0)) {
+            size_t offset = t % rec->ringSize;
+            size_t n = min<size_t>(min<size_t>(available, rec->blockSize), rec->ringSize - offset);
+            if (!rec->writeError && rec->file.write(rec->ring + offset, n) != n) rec->writeError = true;
+            rec->dataSize += n;
+            rec->tail.store(t + n, std::memory_order_release);
+            continue;
+        }
+        if (draining) break;
+        if (rec->stopping && xSemaphoreTake(rec->readerExited, 0) == pdTRUE) {
+            draining = true; // nothing else will be produced
+            continue;
+        }
+
+        // Keep a playable file on the card in case power goes away
+        if (millis() - lastHeader > REC_HEADER_INTERVAL && !rec->writeError) {
+            CreateWavHeader(header, rec->dataSize, rec->sampleRate, rec->bits);
+            rec->file.seek(0);
+            rec->file.write(header, WAV_HEADER_SIZE);
+            rec->file.seek(WAV_HEADER_SIZE + rec->dataSize);
+            rec->file.flush();
+            lastHeader = millis();
+        }
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+    CreateWavHeader(header, rec->dataSize, rec->sampleRate, rec->bits);
+    rec->file.seek(0);
+    rec->file.write(header, WAV_HEADER_SIZE);
+    rec->file.close();
+    xSemaphoreGive(rec->writerExited);
+    vTaskDelete(NULL);
+}
+
+static void mic_draw_recording(MicRecorder &rec, uint32_t elapsedMs, int record_time) {
+    int x = BORDER_PAD_X + 4;
+    int y = tftHeight / 2 + 10;
+    int width = tftWidth - 2 * x;
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.setCursor(x, y);
+    if (record_time) tft.printf("%lus / %ds  ", (unsigned long)(elapsedMs / 1000), record_time);
+    else tft.printf("%lus  ", (unsigned long)(elapsedMs / 1000));
+    tft.printf("%.1f MB  ", rec.dataSize / 1048576.0);
+    if (rec.overruns) tft.printf("%lu overruns", (unsigned long)rec.overruns);
+    if (rec.writeError) tft.print("write error");
+
+    // Level meter, dBFS over a 60 dB span
+    uint16_t peak = rec.peak;
+    rec.peak = 0;
+    float db = peak > 0 ? 20 * log10f(peak / 32767.0f) : -60;
+    int level = constrain((db + 60) * width / 60, 0, width);
+    uint16_t color = db > -3 ? TFT_RED : db > -12 ? TFT_YELLOW : TFT_GREEN;
+    tft.fillRect(x, y + 12, level, 8, color);
+    tft.fillRect(x + level, y + 12, width - level, 8, bruceConfig.bgColor);
 }
 
 void mic_record() {
+    // Format first, the channel is opened with it
+    static uint32_t sampleRate = 48000;
+    static uint8_t bits = 16;
+    bool start = false;
+    int idx = 0;
+    while (!start) {
+        int option = -1;
+        std::vector<Option> options = {
+            {"Record",                                         [&]() { option = 0; }},
+            {"Rate: " + String(sampleRate / 1000.0, 1) + " kHz", [&]() { option = 1; }},
+#if defined(MIC_INMP441)
+            {"Bits: " + String(bits),                          [&]() { option = 2; }},
+#endif
+        };
+        idx = loopOptions(options, idx);
+        if (option == -1 || returnToMenu) return;
+        if (option == 0) start = true;
+        if (option == 1) {
+            options = {
+                {"8 kHz",    [&]() { sampleRate = 8000; } },
+                {"16 kHz",   [&]() { sampleRate = 16000; }},
+                {"22.05 kHz", [&]() { sampleRate = 22050; }},
+                {"44.1 kHz", [&]() { sampleRate = 44100; }},
+                {"48 kHz",   [&]() { sampleRate = 48000; }},
+            };
+            loopOptions(options);
+        }
+        if (option == 2) {
+            options = {
+                {"16 bits", [&]() { bits = 16; }},
+                {"24 bits", [&]() { bits = 24; }},
+            };
+            loopOptions(options);
+        }
+    }
+
     ioExpander.turnPinOnOff(IO_EXP_MIC, HIGH);
 
     bool gpioInput = false;
@@ -373,18 +593,46 @@ void mic_record() {
         gpioInput = true;
         gpio_hold_en(GPIO_NUM_0);
     }
-    InitI2SMicroPhone();
+    InitI2SMicroPhone(sampleRate, bits);
+
+    // A large ring in PSRAM rides out long SD stalls, without it a few blocks have to do
+    MicRecorder rec;
+    rec.sampleRate = mic_sample_rate;
+    rec.bits = mic_bits;
+    rec.blockSize = psramFound() ? 32 * 1024 : 8 * 1024;
+    rec.ringSize = psramFound() ? 16 * rec.blockSize : 4 * rec.blockSize;
+    rec.ring = (uint8_t *)(psramFound() ? ps_malloc(rec.ringSize) : malloc(rec.ringSize));
+    i2s_buffer = (int16_t *)malloc(REC_READ_SAMPLES * sizeof(int32_t));
+    rec.readerExited = xSemaphoreCreateBinary();
+    rec.writerExited = xSemaphoreCreateBinary();
+
+    auto cleanup = [&]() {
+        free(rec.ring);
+        free(i2s_buffer);
+        i2s_buffer = nullptr;
+        if (rec.readerExited) vSemaphoreDelete(rec.readerExited);
+        if (rec.writerExited) vSemaphoreDelete(rec.writerExited);
+        delay(10);
+        if (deinitMicroPhone()) Serial.println("Fail disabling I2S Driver");
+        if (gpioInput) {
+            gpio_hold_dis(GPIO_NUM_0);
+            pinMode(GPIO_NUM_0, INPUT);
+        } else {
+            pinMode(GPIO_NUM_0, OUTPUT);
+            digitalWrite(GPIO_NUM_0, LOW);
+        }
+        ioExpander.turnPinOnOff(IO_EXP_MIC, LOW);
+    };
 
-    // Alloc buffers in PSRAM if available
-    if (psramFound()) i2s_buffer = (int16_t *)ps_malloc(FFT_SIZE * sizeof(int16_t));
-    else i2s_buffer = (int16_t *)malloc(FFT_SIZE * sizeof(int16_t));
-    if (!i2s_buffer) {
+    if (!rec.ring || !i2s_buffer || !rec.readerExited || !rec.writerExited) {
+        cleanup();
         displayError("Fail to alloc buffers, exiting", true);
         return;
     }
 
     FS *fs = nullptr;
     if (!getFsStorage(fs) || fs == nullptr) {
+        cleanup();
         displayError("No space left on device", true);
         return;
     }
@@ -394,6 +642,7 @@ void mic_record() {
 
     if (!fs->exists("/BruceMIC")) {
         if (!fs->mkdir("/BruceMIC")) {
+            cleanup();
             displayError("Error creating directory", true);
             return;
         }
@@ -402,8 +651,9 @@ void mic_record() {
     do {
         snprintf(filename, sizeof(filename), "/BruceMIC/recording_%d.wav", index++);
     } while (fs->exists(filename));
-    File audioFile = fs->open(filename, FILE_WRITE, true);
-    if (!audioFile) {
+    rec.file = fs->open(filename, FILE_WRITE, true);
+    if (!rec.file) {
+        cleanup();
         displayError("Error creating file", true);
         return;
     }
@@ -435,55 +685,56 @@ void mic_record() {
         }
     }
 
-    const int headerSize = 44;
-    byte header[headerSize] = {0};
+    byte header[WAV_HEADER_SIZE];
+    CreateWavHeader(header, 0, rec.sampleRate, rec.bits);
+    rec.file.write(header, WAV_HEADER_SIZE);
 
-    audioFile.write(header, headerSize);
-
-    unsigned long dataSize = 0;
+    // DMA keeps filling while the tasks start, drop what was captured during the menu
+    i2s_channel_disable(i2s_chan);
+    i2s_channel_enable(i2s_chan);
+    // The reader must never wait on the writer or the UI
+    if (xTaskCreate(mic_reader_task, "MicReader", 3072, &rec, 6, NULL) != pdPASS) {
+        rec.file.close();
+        cleanup();
+        displayError("Fail to start recording", true);
+        return;
+    }
+    if (xTaskCreate(mic_writer_task, "MicWriter", 4096, &rec, 4, NULL) != pdPASS) {
+        rec.stopping = true;
+        xSemaphoreTake(rec.readerExited, portMAX_DELAY);
+        rec.file.close();
+        cleanup();
+        displayError("Fail to start recording", true);
+        return;
+    }
 
-    int bytesPerRead = FFT_SIZE * sizeof(int16_t);
+    if (record_time != 0) displayRedStripe("Recording...", 0xffff, 0x5db9);
+    else displayRedStripe("Rec... Press Sel to stop", 0xffff, 0x5db9);
     unsigned long startMillis = millis();
-    if (record_time != 0) {
-        displayRedStripe("Recording...", 0xffff, 0x5db9);
-        while (millis() - startMillis < (unsigned long)record_time * 1000) {
-            size_t bytesRead = 0;
-            i2s_channel_read(i2s_chan, i2s_buffer, bytesPerRead, &bytesRead, 1000);
-            if (bytesRead > 0) {
-                audioFile.write((const uint8_t *)i2s_buffer, bytesRead);
-                dataSize += bytesRead;
-            }
-        }
-    } else {
-        displayRedStripe("Rec... Press Sel to stop", 0xffff, 0x5db9);
-        while (!check(SelPress)) {
-            size_t bytesRead = 0;
-            i2s_channel_read(i2s_chan, (char *)i2s_buffer, bytesPerRead, &bytesRead, 1000);
-
-            if (bytesRead > 0) {
-                audioFile.write((const uint8_t *)i2s_buffer, bytesRead);
-                dataSize += bytesRead;
-            }
-        }
+    while (true) {
+        uint32_t elapsed = millis() - startMillis;
+        if (record_time != 0 && elapsed >= (unsigned long)record_time * 1000) break;
+        if (check(SelPress) || check(EscPress)) break;
+        mic_draw_recording(rec, elapsed, record_time);
+        wakeUpScreen();
+        vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 
-    audioFile.seek(0);
-    CreateWavHeader(header, dataSize);
-    audioFile.write(header, headerSize);
-    audioFile.close();
+    rec.stopping = true;
+    xSemaphoreTake(rec.writerExited, portMAX_DELAY);
+    Serial.printf(
+        "Recording finished: %lu bytes, %lu overruns (%lu bytes lost)\n",
+        (unsigned long)rec.dataSize,
+        (unsigned long)rec.overruns,
+        (unsigned long)rec.lostBytes
+    );
 
-    delay(10);
-    if (deinitMicroPhone()) Serial.println("Fail disabling I2S Driver");
-    if (gpioInput) {
-        gpio_hold_dis(GPIO_NUM_0);
-        pinMode(GPIO_NUM_0, INPUT);
-    } else {
-        pinMode(GPIO_NUM_0, OUTPUT);
-        digitalWrite(GPIO_NUM_0, LOW);
-    }
-    Serial.println("Recording finished");
-    displaySuccess("Recording Finished", true);
-    ioExpander.turnPinOnOff(IO_EXP_MIC, LOW);
+    bool failed = rec.writeError;
+    uint32_t overruns = rec.overruns;
+    cleanup();
+    if (failed) displayError("SD write error", true);
+    else if (overruns) displayWarning(String(overruns) + " overruns, audio lost", true);
+    else displaySuccess("Recording Finished", true);
 }
 
 #else
@@ -0,0 +1,169 @@
+#include "spectrum_analyzer.h"
+#include <algorithm>
+#include <cmath>
+
+#define SPECTRUM_FLOOR_DB -200.0f
+
+SpectrumAnalyzer::SpectrumAnalyzer(size_t fftSize, float sampleRate) : n(fftSize), rate(sampleRate) {
+    if (n < 8 || (n & (n - 1)) != 0 || n / 2 > UINT16_MAX) return;
+    size_t half = n / 2;
+    window.resize(n);
+    twiddleRe.resize(half);
+    twiddleIm.resize(half);
+    reversed.resize(half);
+    re.resize(half);
+    im.resize(half);
+    power.assign(half + 1, SPECTRUM_FLOOR_DB);
+
+    // Hann window, its sum normalizes a full scale sine to 0 dBFS
+    float sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / n);
+        sum += window[i];
+    }
+    powerScale = 4.0f / (sum * sum * 32768.0f * 32768.0f);
+
+    for (size_t k = 0; k < half; k++) {
+        twiddleRe[k] = cosf(2.0f * (float)M_PI * k / n);
+        twiddleIm[k] = -sinf(2.0f * (float)M_PI * k / n);
+    }
+    int bits = 0;
+    while ((1u << bits) < half) bits++;
+    for (size_t i = 0; i < half; i++) {
+        uint16_t r = 0;
+        for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+        reversed[i] = r;
+    }
+    setBins(half, Scale::Linear, 0, rate / 2);
+}
+
+void SpectrumAnalyzer::setBins(size_t count, Scale scale, float minHz, float maxHz) {
+    if (!ok() || count == 0) return;
+    currentScale = scale;
+    float hzPerBin = binWidth();
+    size_t maxBin = n / 2;
+    minHz = std::max(minHz, scale == Scale::Log ? hzPerBin : 0.0f);
+    maxHz = std::min(std::max(maxHz, minHz + hzPerBin), rate / 2);
+
+    spans.resize(count);
+    centers.resize(count);
+    output.assign(count, SPECTRUM_FLOOR_DB);
+    primed = false;
+    for (size_t i = 0; i < count; i++) {
+        float lo, hi;
+        if (scale == Scale::Log) {
+            float ratio = maxHz / minHz;
+            lo = minHz * powf(ratio, (float)i / count);
+            hi = minHz * powf(ratio, (float)(i + 1) / count);
+            centers[i] = sqrtf(lo * hi);
+        } else {
+            lo = minHz + (maxHz - minHz) * i / count;
+            hi = minHz + (maxHz - minHz) * (i + 1) / count;
+            centers[i] = (lo + hi) / 2;
+        }
+        // FFT bins whose center falls in [lo, hi)
+        size_t first = (size_t)ceilf(lo / hzPerBin);
+        size_t last = (size_t)ceilf(hi / hzPerBin);
+        Span &span = spans[i];
+        if (last > first) {
+            span.first = std::min(first, maxBin);
+            span.last = std::min(last - 1, maxBin);
+            span.fraction = -1;
+        } else {
+            float position = centers[i] / hzPerBin;
+            span.first = std::min((size_t)position, maxBin - 1);
+            span.last = span.first;
+            span.fraction = position - span.first;
+        }
+    }
+}
+
+void SpectrumAnalyzer::setMode(Mode mode) {
+    currentMode = mode;
+    primed = false;
+}
+
+// Radix-2 FFT of the n/2 complex points in re/im, in place
+void SpectrumAnalyzer::transform() {
+    size_t half = n / 2;
+    for (size_t i = 0; i < half; i++) {
+        size_t j = reversed[i];
+        if (j > i) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    for (size_t length = 2; length <= half; length <<= 1) {
+        size_t step = n / length; // twiddles of the n points table, every other one for n/2 points
+        size_t middle = length / 2;
+        for (size_t start = 0; start < half; start += length) {
+            for (size_t k = 0; k < middle; k++) {
+                float wr = twiddleRe[k * step];
+                float wi = twiddleIm[k * step];
+                size_t a = start + k;
+                size_t b = a + middle;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+void SpectrumAnalyzer::process(const int16_t *samples) {
+    if (!ok()) return;
+    size_t half = n / 2;
+
+    // A real signal of n samples is packed as n/2 complex ones, even samples in re, odd in im
+    for (size_t i = 0; i < half; i++) {
+        re[i] = samples[2 * i] * window[2 * i];
+        im[i] = samples[2 * i + 1] * window[2 * i + 1];
+    }
+    transform();
+
+    // Split the packed result into the spectrum of the real signal
+    for (size_t k = 0; k <= half; k++) {
+        size_t a = k % half;
+        size_t b = (half - k) % half;
+        float evenRe = (re[a] + re[b]) / 2;
+        float evenIm = (im[a] - im[b]) / 2;
+        float oddRe = (im[a] + im[b]) / 2;
+        float oddIm = (re[b] - re[a]) / 2;
+        float wr = k < half ? twiddleRe[k] : -1.0f;
+        float wi = k < half ? twiddleIm[k] : 0.0f;
+        float xr = evenRe + oddRe * wr - oddIm * wi;
+        float xi = evenIm + oddRe * wi + oddIm * wr;
+        float p = (xr * xr + xi * xi) * powerScale;
+        power[k] = p > 1e-20f ? 10.0f * log10f(p) : SPECTRUM_FLOOR_DB;
+    }
+
+    // Loudest bin, refined with a parabola through its neighbours
+    size_t top = 1;
+    for (size_t k = 2; k < half; k++) {
+        if (power[k] > power[top]) top = k;
+    }
+    float l = power[top - 1], c = power[top], r = power[top + 1];
+    float denominator = l - 2 * c + r;
+    float offset = denominator < 0 ? 0.5f * (l - r) / denominator : 0;
+    peakHz = (top + offset) * binWidth();
+    peakDb = c;
+
+    for (size_t i = 0; i < spans.size(); i++) {
+        const Span &span = spans[i];
+        float level;
+        if (span.fraction >= 0) {
+            level = power[span.first] + (power[span.first + 1] - power[span.first]) * span.fraction;
+        } else {
+            level = power[span.first];
+            for (size_t k = span.first + 1; k <= span.last; k++) level = std::max(level, power[k]);
+        }
+        float &out = output[i];
+        if (!primed || currentMode == Mode::Instant) out = level;
+        else if (currentMode == Mode::Average) out += (level - out) * averaging;
+        else out = std::max(level, out - peakDecay);
+    }
+    primed = true;
+}
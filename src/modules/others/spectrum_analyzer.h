@@ -0,0 +1,78 @@
+#ifndef __SPECTRUM_ANALYZER_H__
+#define __SPECTRUM_ANALYZER_H__
+
+// Audio spectrum pipeline: window, real FFT and display bins. Plain C++ with no Arduino or IDF
+// dependency, so it builds and runs the same on a host.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SpectrumAnalyzer {
+public:
+    enum class Scale : uint8_t {
+        Linear,
+        Log,
+    };
+    enum class Mode : uint8_t {
+        Instant,
+        Average,  // exponential average per bin
+        PeakHold, // the highest level falls back slowly
+    };
+
+    // fftSize must be a power of two, window, twiddle and bit reversal tables are built once here
+    SpectrumAnalyzer(size_t fftSize, float sampleRate);
+
+    bool ok() const { return !window.empty(); }
+    size_t size() const { return n; }
+    float binWidth() const { return rate / n; }
+
+    // Output bins between minHz and maxHz, spaced evenly or logarithmically
+    void setBins(size_t count, Scale scale, float minHz, float maxHz);
+    void setMode(Mode mode);
+    Mode mode() const { return currentMode; }
+    Scale scale() const { return currentScale; }
+
+    // Transforms fftSize samples and updates the output bins
+    void process(const int16_t *samples);
+
+    // Level of each output bin in dBFS, after the mode is applied
+    const float *bins() const { return output.data(); }
+    size_t binCount() const { return output.size(); }
+    float binFrequency(size_t bin) const { return centers[bin]; }
+    // Loudest frequency of the last frame, interpolated between FFT bins
+    float peakFrequency() const { return peakHz; }
+    float peakLevel() const { return peakDb; }
+
+    float averaging = 0.25f; // weight of a new frame in Average mode
+    float peakDecay = 1.5f;  // dB per frame in PeakHold mode
+
+private:
+    size_t n;
+    float rate;
+    std::vector<float> window;
+    std::vector<float> twiddleRe; // e^-2*pi*i*k/n, k < n/2
+    std::vector<float> twiddleIm;
+    std::vector<uint16_t> reversed; // bit reversal of the n/2 points complex FFT
+    std::vector<float> re;
+    std::vector<float> im;
+    std::vector<float> power; // dBFS per FFT bin, n/2 + 1
+    float powerScale = 1;
+
+    Scale currentScale = Scale::Linear;
+    Mode currentMode = Mode::Instant;
+    struct Span {
+        uint16_t first; // FFT bins [first, last] are reduced to their max
+        uint16_t last;
+        float fraction; // narrower than an FFT bin: interpolate from first to first + 1
+    };
+    std::vector<Span> spans;
+    std::vector<float> centers;
+    std::vector<float> output;
+    bool primed = false;
+    float peakHz = 0;
+    float peakDb = -200;
+
+    void transform();
+};
+
+#endif
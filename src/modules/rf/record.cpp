@@ -1,22 +1,65 @@
 #include "record.h"
+#include "core/spi_bus.h"
+#include "rf_decoder.h"
+#include "rf_send.h"
 #include "rf_utils.h"
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
-static bool
+#include <atomic>
+#include <esp_timer.h>
+
+#define RF_RAW_CAPTURE_DIR "/BruceRF"
+#define RF_RAW_CAPTURE_FILE "/BruceRF/.capture.sub" // renamed to raw_N.sub when saved
+#define RF_RAW_RX_SYMBOLS 64                        // one RMT memory block per receive buffer
+#define RF_RAW_MIN_SYMBOLS 5                        // ignore codes shorter than 5 items
+#define RF_RAW_SYNC_MS 1000                         // commit the file to the card this often
+
+struct RawRxEvent {
+    uint8_t buffer;    // which ping-pong buffer was filled
+    size_t symbols;
+    int64_t timestamp; // esp_timer time of the receive done event
+};
+
+// Capture pipeline: RMT ISR -> capture task (re-arms, converts) -> symbol ring -> writer task -> file
+struct RawCapture {
+    rmt_channel_handle_t rx_ch = NULL;
+    rmt_receive_config_t config = {};
+    rmt_symbol_word_t rxBuffers[2][RF_RAW_RX_SYMBOLS];
+    uint8_t armed = 0; // buffer currently owned by the driver
+    QueueHandle_t events = NULL;
+    SemaphoreHandle_t exited = NULL;  // given by each task when it returns
+    SemaphoreHandle_t labelLock = NULL; // guards decoded
+    TaskHandle_t writerTask = NULL;
+    // Single producer (capture task), single consumer (writer task) ring of signed durations in us
+    int32_t *ring = nullptr;
+    uint32_t ringMask = 0;
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    int64_t lastDone = 0;
+    volatile bool stopping = false;
+    volatile bool captureDone = false;
+    volatile uint32_t bursts = 0;
+    volatile uint32_t dropped = 0;
+    RawDataWriter writer;
+    RfDecoder decoder; // labels frames as they are written, only used by the writer task
+    String decoded;    // last label
+};
+
+static bool IRAM_ATTR
 record_rmt_rx_done_callback(rmt_channel_t *channel, const rmt_rx_done_event_data_t *edata, void *user_data) {
     BaseType_t high_task_wakeup = pdFALSE;
-    QueueHandle_t receive_queue = (QueueHandle_t)user_data;
-    // send the received RMT symbols to the parser task
-    xQueueSendFromISR(receive_queue, edata, &high_task_wakeup);
+    RawCapture *cap = (RawCapture *)user_data;
+    RawRxEvent event = {cap->armed, edata->num_symbols, esp_timer_get_time()};
+    // send the buffer index to the capture task, it re-arms the receiver on the other one
+    xQueueSendFromISR(cap->events, &event, &high_task_wakeup);
     return high_task_wakeup == pdTRUE;
 }
+
 float phase = 0.0;
 float lastPhase = 2 * PI;
 unsigned long lastAnimationUpdate = 0;
 void sinewave_animation() {
     if (millis() - lastAnimationUpdate < 10) return;
 
-    tft.drawPixel(0, 0, 0);
-
     int centerY = (tftHeight / 2) + 20;
     int amplitude = (tftHeight / 2) - 40;
     int sinewaveWidth = 5;
@@ -34,7 +77,7 @@ void sinewave_animation() {
     lastAnimationUpdate = millis();
 }
 
-void rf_raw_record_draw(RawRecordingStatus status) {
+void rf_raw_record_draw(RawRecordingStatus &status) {
     tft.setCursor(20, 38);
     tft.setTextSize(FP);
     if (status.frequency <= 0) {
@@ -71,12 +114,29 @@ void rf_raw_record_draw(RawRecordingStatus status) {
         // Normalize RSSI to bar height (RSSI values are typically negative)
         int barHeight = map(rssi, -90, -45, 1, maxBarHeight);
 
-        // Calculate bar position
+        // Calculate bar position, start over from the left once the screen is full
         int x = 20 + (int)(status.rssiCount * 1.35);
+        if (x >= tftWidth - 20) {
+            status.rssiCount = 0;
+            x = 20;
+            tft.fillRect(20, centerY - maxBarHeight, tftWidth - 40, maxBarHeight * 2, bruceConfig.bgColor);
+        }
         int yTop = centerY - barHeight;
 
         // Draw the bar
         tft.drawFastVLine(x, yTop, barHeight * 2, bruceConfig.priColor);
+
+        if (status.decoded != "") {
+            tft.setCursor(20, 48);
+            tft.print(status.decoded + "   ");
+        }
+        tft.setCursor(20, tftHeight - 20);
+        tft.printf(
+            "Bursts: %lu  %lu KB  Lost: %lu  ",
+            (unsigned long)status.bursts,
+            (unsigned long)(status.bytesWritten / 1024),
+            (unsigned long)status.dropped
+        );
     }
 }
 
@@ -104,9 +164,8 @@ float rf_freq_scan() {
             }
             float checkFrequency = subghz_frequency_list[idx];
             setMHZ(checkFrequency);
-            tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
             vTaskDelay(5 / portTICK_PERIOD_MS);
-            rssi = ELECHOUSE_cc1101.getRssi();
+            rssi = getCC1101Rssi();
             if (rssi > rssiThreshold) {
                 best_frequencies[attempt].freq = checkFrequency;
                 best_frequencies[attempt].rssi = rssi;
@@ -134,7 +193,179 @@ float rf_freq_scan() {
     return frequency;
 }
 
-void rf_raw_record_create(RawRecording &recorded, bool &returnToMenu) {
+/*********************************************************************
+**  Capture pipeline
+*********************************************************************/
+// Converts one burst to signed durations, preceded by the gap since the previous burst.
+// The burst is dropped as a whole if the ring has no room for it.
+static void raw_capture_push(RawCapture *cap, const rmt_symbol_word_t *symbols, size_t count, int64_t done) {
+    uint32_t head = cap->head.load(std::memory_order_relaxed);
+    uint32_t tail = cap->tail.load(std::memory_order_acquire);
+    uint32_t needed = 1 + count * 2;
+    if (cap->ringMask + 1 - (head - tail) < needed) {
+        cap->dropped++;
+        return;
+    }
+
+    int64_t duration = 0;
+    for (size_t i = 0; i < count; i++) duration += symbols[i].duration0 + symbols[i].duration1;
+    if (cap->lastDone != 0) {
+        // Both done events fire after the same idle threshold, so it cancels out of the gap
+        int64_t gap = done - duration - cap->lastDone;
+        if (gap < 1) gap = 1;
+        if (gap > INT32_MAX) gap = INT32_MAX;
+        cap->ring[head++ & cap->ringMask] = -(int32_t)gap;
+    }
+    cap->lastDone = done;
+
+    for (size_t i = 0; i < count; i++) {
+        const rmt_symbol_word_t &code = symbols[i];
+        if (code.duration0 > 0)
+            cap->ring[head++ & cap->ringMask] = code.level0 == 1 ? code.duration0 : -(int32_t)code.duration0;
+        if (code.duration1 > 0)
+            cap->ring[head++ & cap->ringMask] = code.level1 == 1 ? code.duration1 : -(int32_t)code.duration1;
+    }
+    cap->head.store(head, std::memory_order_release);
+    cap->bursts++;
+}
+
+static void raw_capture_task(void *pvParameters) {
+    RawCapture *cap = (RawCapture *)pvParameters;
+    RawRxEvent event;
+    while (xQueueReceive(cap->events, &event, portMAX_DELAY) == pdTRUE && !cap->stopping) {
+        // Re-arm on the other buffer before touching this one, so nothing is lost between bursts
+        cap->armed ^= 1;
+        if (rmt_receive(cap->rx_ch, cap->rxBuffers[cap->armed], sizeof(cap->rxBuffers[0]), &cap->config) !=
+            ESP_OK) {
+            Serial.println("RAW capture: could not re-arm the receiver");
+        }
+        if (event.symbols < RF_RAW_MIN_SYMBOLS) continue;
+        raw_capture_push(cap, cap->rxBuffers[event.buffer], event.symbols, event.timestamp);
+        xTaskNotifyGive(cap->writerTask);
+    }
+    cap->captureDone = true;
+    xTaskNotifyGive(cap->writerTask);
+    xSemaphoreGive(cap->exited);
+    vTaskDelete(NULL);
+}
+
+static void raw_writer_task(void *pvParameters) {
+    RawCapture *cap = (RawCapture *)pvParameters;
+    uint32_t lastSync = millis();
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
+        bool finished = cap->captureDone;
+
+        uint32_t tail = cap->tail.load(std::memory_order_relaxed);
+        uint32_t head = cap->head.load(std::memory_order_acquire);
+        if (head != tail || millis() - lastSync >= RF_RAW_SYNC_MS || finished) {
+            SpiGuard bus(SpiDevice::SDCard);
+            while (tail != head) {
+                int32_t value = cap->ring[tail++ & cap->ringMask];
+                cap->writer.add(value);
+                if (cap->decoder.feed(value)) {
+                    const RfDecoded &frame = cap->decoder.result();
+                    char label[48];
+                    snprintf(
+                        label,
+                        sizeof(label),
+                        "%s %llX (%d bit) x%d",
+                        frame.protocol,
+                        (unsigned long long)frame.key,
+                        frame.bits,
+                        frame.repeats + 1
+                    );
+                    xSemaphoreTake(cap->labelLock, portMAX_DELAY);
+                    cap->decoded = label;
+                    xSemaphoreGive(cap->labelLock);
+                }
+            }
+            cap->tail.store(tail, std::memory_order_release);
+            bool sync = millis() - lastSync >= RF_RAW_SYNC_MS;
+            cap->writer.flush(sync);
+            if (sync) lastSync = millis();
+        }
+        if (finished || cap->writer.failed()) break;
+    }
+    xSemaphoreGive(cap->exited);
+    vTaskDelete(NULL);
+}
+
+static RawCapture *raw_capture_start(FS *fs, float frequency) {
+    RawCapture *cap = new RawCapture();
+    // Bigger ring with PSRAM, it only has to absorb SD write latency
+    uint32_t ringSize = psramFound() ? 65536 : 4096;
+    cap->ring = (int32_t *)(psramFound() ? ps_malloc(ringSize * sizeof(int32_t))
+                                         : malloc(ringSize * sizeof(int32_t)));
+    cap->ringMask = ringSize - 1;
+    cap->events = xQueueCreate(2, sizeof(RawRxEvent));
+    cap->exited = xSemaphoreCreateCounting(2, 0);
+    cap->labelLock = xSemaphoreCreateMutex();
+    if (!cap->ring || !cap->events || !cap->exited || !cap->labelLock) goto fail;
+
+    if (!cap->writer.begin(fs, RF_RAW_CAPTURE_FILE, frequency)) goto fail;
+
+    cap->rx_ch = setup_rf_rx();
+    if (cap->rx_ch == NULL) goto fail;
+
+    if (xTaskCreate(raw_writer_task, "RawWriter", 4096, cap, 2, &cap->writerTask) != pdPASS) goto fail;
+    // Above the writer and the UI, it only re-arms the receiver and copies symbols
+    if (xTaskCreate(raw_capture_task, "RawCapture", 3072, cap, 5, NULL) != pdPASS) {
+        cap->captureDone = true;
+        xTaskNotifyGive(cap->writerTask);
+        xSemaphoreTake(cap->exited, portMAX_DELAY);
+        goto fail;
+    }
+
+    {
+        rmt_rx_event_callbacks_t cbs = {
+            .on_recv_done = record_rmt_rx_done_callback,
+        };
+        ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(cap->rx_ch, &cbs, cap));
+        ESP_ERROR_CHECK(rmt_enable(cap->rx_ch));
+        cap->config.signal_range_min_ns = 3000;     // 10us minimum signal duration
+        cap->config.signal_range_max_ns = 12000000; // 24ms maximum signal duration
+        ESP_ERROR_CHECK(
+            rmt_receive(cap->rx_ch, cap->rxBuffers[cap->armed], sizeof(cap->rxBuffers[0]), &cap->config)
+        );
+    }
+    return cap;
+
+fail:
+    if (cap->rx_ch) rmt_del_channel(cap->rx_ch);
+    cap->writer.end();
+    if (cap->events) vQueueDelete(cap->events);
+    if (cap->exited) vSemaphoreDelete(cap->exited);
+    if (cap->labelLock) vSemaphoreDelete(cap->labelLock);
+    free(cap->ring);
+    delete cap;
+    return nullptr;
+}
+
+// Stops the receiver, waits for the writer to drain the ring and closes the file
+static void raw_capture_stop(RawCapture *cap) {
+    cap->stopping = true;
+    RawRxEvent wake = {0, 0, 0};
+    xQueueSend(cap->events, &wake, portMAX_DELAY);
+    xSemaphoreTake(cap->exited, portMAX_DELAY);
+    xSemaphoreTake(cap->exited, portMAX_DELAY);
+
+    rmt_disable(cap->rx_ch);
+    rmt_del_channel(cap->rx_ch);
+    {
+        SpiGuard bus(SpiDevice::SDCard);
+        cap->writer.end();
+    }
+    vQueueDelete(cap->events);
+    vSemaphoreDelete(cap->exited);
+    vSemaphoreDelete(cap->labelLock);
+    free(cap->ring);
+    delete cap;
+}
+
+// Records into RF_RAW_CAPTURE_FILE until [OK], [ESC] or the storage is full.
+// Returns true when at least one burst was written.
+bool rf_raw_record_create(FS *fs, bool &returnToMenu) {
     RawRecordingStatus status;
 
     bool fakeRssiPresent = false;
@@ -163,79 +394,44 @@ void rf_raw_record_create(RawRecording &recorded, bool &returnToMenu) {
     } else status.frequency = bruceConfigPins.rfFreq;
 
     // Something went wrong with scan, probably it was cancelled
-    if (status.frequency < 300) return;
-    recorded.frequency = status.frequency;
+    if (status.frequency < 300) return false;
     setMHZ(status.frequency);
 
     // Erase sinewave animation
-    tft.drawPixel(0, 0, 0);
     tft.fillRect(10, 30, tftWidth - 20, tftHeight - 40, bruceConfig.bgColor);
     rf_raw_record_draw(status);
 
     // Start recording
     delay(200);
-    rmt_channel_handle_t rx_ch = NULL;
-    rx_ch = setup_rf_rx();
-    if (rx_ch == NULL) return;
-    ESP_LOGI("RMT_SPECTRUM", "register RX done callback");
-    QueueHandle_t receive_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
-    assert(receive_queue);
-    rmt_rx_event_callbacks_t cbs = {
-        .on_recv_done = record_rmt_rx_done_callback,
-    };
-    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rx_ch, &cbs, receive_queue));
-    ESP_ERROR_CHECK(rmt_enable(rx_ch));
-    rmt_receive_config_t receive_config = {
-        .signal_range_min_ns = 3000,     // 10us minimum signal duration
-        .signal_range_max_ns = 12000000, // 24ms maximum signal duration
-    };
-    rmt_symbol_word_t item[64];
-    rmt_rx_done_event_data_t rx_data;
-    ESP_ERROR_CHECK(rmt_receive(rx_ch, item, sizeof(item), &receive_config));
+    RawCapture *cap = raw_capture_start(fs, status.frequency);
+    if (cap == nullptr) {
+        deinitRfModule();
+        displayError("Error starting capture", true);
+        return false;
+    }
     Serial.println("RMT Initialized");
 
+    uint32_t seenBursts = 0;
     while (!status.recordingFinished) {
         previousMillis = millis();
-        size_t rx_size = 0;
-        rmt_symbol_word_t *rx_items = NULL;
-        if (xQueueReceive(receive_queue, &rx_data, 0) == pdPASS) {
-            rx_size = rx_data.num_symbols;
-            rx_items = rx_data.received_symbols;
-        }
-        if (rx_size != 0) {
-            bool valid_signal = false;
-            if (rx_size >= 5) valid_signal = true;
-            if (valid_signal) {         // ignore codes shorter than 5 items
-                fakeRssiPresent = true; // For rssi display on single-pinned RF Modules
-                rmt_symbol_word_t *code = (rmt_symbol_word_t *)malloc(rx_size * sizeof(rmt_symbol_word_t));
-
-                // Gap calculation
-                unsigned long receivedTime = millis();
-                unsigned long long signalDuration = 0;
-                for (size_t i = 0; i < rx_size; i++) {
-                    code[i] = rx_items[i];
-                    signalDuration += rx_items[i].duration0 + rx_items[i].duration1;
-                }
-                recorded.codes.push_back(code);
-                recorded.codeLengths.push_back(rx_size);
-
-                if (status.lastSignalTime != 0) {
-                    unsigned long signalDurationMs = signalDuration / RMT_1MS_TICKS;
-                    uint16_t gap = (uint16_t)(receivedTime - status.lastSignalTime - signalDurationMs - 5);
-                    recorded.gaps.push_back(gap);
-                } else {
-                    status.firstSignalTime = receivedTime;
-                    status.recordingStarted = true;
-                    // Erase sinewave animation
-                    tft.drawPixel(0, 0, 0);
-                    tft.fillRect(10, 30, tftWidth - 20, tftHeight - 40, bruceConfig.bgColor);
-                }
-                status.lastSignalTime = receivedTime;
+        if (cap->bursts != seenBursts) {
+            seenBursts = cap->bursts;
+            fakeRssiPresent = true; // For rssi display on single-pinned RF Modules
+            if (!status.recordingStarted) {
+                status.firstSignalTime = millis();
+                status.recordingStarted = true;
+                // Erase sinewave animation
+                tft.fillRect(10, 30, tftWidth - 20, tftHeight - 40, bruceConfig.bgColor);
             }
-            ESP_ERROR_CHECK(rmt_receive(rx_ch, item, sizeof(item), &receive_config));
-            rx_size = 0;
+            status.lastSignalTime = millis();
         }
+        status.bursts = cap->bursts;
+        status.dropped = cap->dropped;
+        status.bytesWritten = cap->writer.bytesWritten();
 
+        xSemaphoreTake(cap->labelLock, portMAX_DELAY);
+        status.decoded = cap->decoded;
+        xSemaphoreGive(cap->labelLock);
         // Periodically update RSSI
         if (status.recordingStarted &&
             (status.lastRssiUpdate == 0 || millis() - status.lastRssiUpdate >= 100)) {
@@ -243,27 +439,35 @@ void rf_raw_record_create(RawRecording &recorded, bool &returnToMenu) {
             else status.latestRssi = -90;
             fakeRssiPresent = false;
 
-            if (rssiFeature) status.latestRssi = ELECHOUSE_cc1101.getRssi();
+            if (rssiFeature) status.latestRssi = getCC1101Rssi();
 
             status.rssiCount++;
             status.lastRssiUpdate = millis();
         }
+        rf_raw_record_draw(status);
 
-        // Stop recording after 20 seconds
-        if (status.firstSignalTime > 0 && millis() - status.firstSignalTime >= 20000)
+        // Only the storage limits the length of a capture
+        if (cap->writer.failed()) {
+            Serial.println("RAW capture: storage write failed");
             status.recordingFinished = true;
+        }
         if (check(SelPress) && status.recordingStarted) status.recordingFinished = true;
         if (check(EscPress)) {
             status.recordingFinished = true;
             returnToMenu = true;
         }
-        rf_raw_record_draw(status);
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
-    Serial.println("Recording stopped.");
-    rmt_disable(rx_ch);
-    rmt_del_channel(rx_ch);
-    vQueueDelete(receive_queue);
+    bool failed = cap->writer.failed();
+    raw_capture_stop(cap);
+    Serial.printf(
+        "Recording stopped: %lu bursts, %lu lost\n",
+        (unsigned long)status.bursts,
+        (unsigned long)status.dropped
+    );
     deinitRfModule();
+    if (failed) displayError("Storage full, capture stopped", true);
+    return status.bursts > 0;
 }
 
 int rf_raw_record_options(bool saved) {
@@ -285,34 +489,43 @@ int rf_raw_record_options(bool saved) {
 }
 
 void rf_raw_record() {
-    bool replaying = false;
     bool returnToMenu = false;
     bool saved = false;
+    bool captured = false;
     int option = 3;
-    RawRecording recorded;
+    String filepath = RF_RAW_CAPTURE_FILE;
+    FS *fs = nullptr;
+    if (!getFsStorage(fs) || fs == nullptr) {
+        displayError("No space left on device", true);
+        return;
+    }
+    if (!fs->exists(RF_RAW_CAPTURE_DIR) && !fs->mkdir(RF_RAW_CAPTURE_DIR)) {
+        displayError("Error creating directory", true);
+        return;
+    }
+
     while (option != 4) {
         if (option == 1) { // Replay
-            rf_raw_emit(recorded, returnToMenu);
+            txSubFile(fs, filepath);
         } else if (option == 2) { // Save
-            saved = true;
-            rf_raw_save(recorded);
+            String target = rf_raw_next_filename(fs);
+            if (fs->rename(RF_RAW_CAPTURE_FILE, target)) {
+                saved = true;
+                filepath = target;
+                displaySuccess(target, true);
+            } else {
+                displayError("Error saving file", true);
+            }
         } else if (option == 3) { // Discard
             saved = false;
-            for (auto &code : recorded.codes) free(code);
-            recorded.codes.clear();
-            recorded.codeLengths.clear();
-            recorded.gaps.clear();
-            recorded.frequency = 0;
-            rf_raw_record_create(recorded, returnToMenu);
+            filepath = RF_RAW_CAPTURE_FILE;
+            captured = rf_raw_record_create(fs, returnToMenu);
         }
 
-        if (returnToMenu || check(EscPress)) return;
+        if (returnToMenu || !captured || check(EscPress)) break;
         option = rf_raw_record_options(saved);
     }
-    for (auto &code : recorded.codes) free(code);
-    recorded.codes.clear();
-    recorded.codeLengths.clear();
-    recorded.gaps.clear();
-    recorded.frequency = 0;
+    // Unsaved captures are not kept
+    if (!saved && fs->exists(RF_RAW_CAPTURE_FILE)) fs->remove(RF_RAW_CAPTURE_FILE);
     return;
 }
@@ -2,7 +2,6 @@
 #define RF_RECORD_H
 
 #include "core/display.h"
-#include "emit.h"
 #include "save.h"
 #include "structs.h"
 
@@ -0,0 +1,352 @@
+#include "rf_decoder.h"
+#include "protocols/Ansonic.h"
+#include "protocols/Came.h"
+#include "protocols/Chamberlain.h"
+#include "protocols/Holtek.h"
+#include "protocols/Linear.h"
+#include "protocols/NiceFlo.h"
+#include <math.h>
+
+#define RF_DECODER_TE_TOLERANCE 0.4f     // first TE estimate, relative to the nominal one
+#define RF_DECODER_TRACK_TOLERANCE 0.3f  // following bits, relative to the running estimate
+#define RF_DECODER_RATIO_TOLERANCE 0.6f  // |ln(observed ratio / expected ratio)|
+#define RF_DECODER_MANCHESTER_GAP 3000   // a low this long ends a Manchester frame
+#define RF_DECODER_MANCHESTER_MAX 256    // pulses kept per Manchester frame
+#define RF_DECODER_MANCHESTER_MIN_TE 100 // shorter pulses are noise
+
+static protocol_came came;
+static protocol_nice_flo nice_flo;
+static protocol_ansonic ansonic;
+static protocol_holtek holtek;
+static protocol_linear linear;
+static protocol_chamberlain chamberlain;
+
+// Order matters when two protocols decode the same frame with the same TE error: first wins
+static const std::vector<RfDecoderProtocol> protocols = {
+    {"CAME",        RF_ENCODING_PWM,        12, &came       },
+    {"Nice FLO",    RF_ENCODING_PWM,        12, &nice_flo   },
+    {"Ansonic",     RF_ENCODING_PWM,        12, &ansonic    },
+    {"Holtek",      RF_ENCODING_PWM,        12, &holtek     },
+    {"Linear",      RF_ENCODING_PWM,        12, &linear     },
+    {"Chamberlain", RF_ENCODING_PWM,        12, &chamberlain},
+    {"Manchester",  RF_ENCODING_MANCHESTER, 16, nullptr     },
+};
+
+const std::vector<RfDecoderProtocol> &rf_decoder_protocols() { return protocols; }
+
+const RfDecoderProtocol *rf_decoder_find(const String &name) {
+    for (const auto &p : protocols) {
+        if (name.equalsIgnoreCase(p.name)) return &p;
+    }
+    return nullptr;
+}
+
+// Shortest pulse of the bit encodings, the other timings are multiples of it
+static float nominal_te(const c_rf_protocol *timing) {
+    int te = 0;
+    for (const auto &entry : timing->transposition_table) {
+        for (int d : entry.second) {
+            if (abs(d) > 1 && (te == 0 || abs(d) < te)) te = abs(d);
+        }
+    }
+    return te;
+}
+
+static const std::vector<int> &bit_timing(const c_rf_protocol *timing, char bit) {
+    static const std::vector<int> none;
+    auto it = timing->transposition_table.find(bit);
+    return it == timing->transposition_table.end() ? none : it->second;
+}
+
+static bool same_sign(int32_t a, int b) { return (a < 0) == (b < 0); }
+
+static bool within(float observed, float expected, float tolerance) {
+    return observed >= expected * (1 - tolerance) && observed <= expected * (1 + tolerance);
+}
+
+RfDecoder::RfDecoder() { reset(); }
+
+void RfDecoder::reset() {
+    pwm.assign(protocols.size(), PwmState());
+    nominal.assign(protocols.size(), 0);
+    sync.assign(protocols.size(), {});
+    for (size_t i = 0; i < protocols.size(); i++) {
+        if (protocols[i].encoding != RF_ENCODING_PWM) continue;
+        const c_rf_protocol *t = protocols[i].timing;
+        nominal[i] = nominal_te(t);
+        // Without a pilot, the stop bit of the previous frame announces the next one
+        sync[i] = t->pilot_period;
+        if (sync[i].empty()) {
+            for (int d : t->stop_bit) {
+                if (abs(d) > 1) sync[i].push_back(d);
+            }
+        }
+    }
+    frame.clear();
+    pwmMatched = false;
+    last = RfDecoded();
+}
+
+bool RfDecoder::emit(const char *protocol, uint64_t key, uint8_t bits, float te) {
+    if (last.protocol == protocol && last.key == key && last.bits == bits) {
+        if (last.repeats < 255) last.repeats++;
+    } else {
+        last.protocol = protocol;
+        last.key = key;
+        last.bits = bits;
+        last.repeats = 0;
+    }
+    last.te = (uint16_t)lroundf(te);
+    return true;
+}
+
+/*********************************************************************
+**  PWM: pilot (or the previous stop bit), then `bits` pulse pairs
+*********************************************************************/
+bool RfDecoder::feedPwm(size_t index, int32_t d) {
+    const RfDecoderProtocol &p = protocols[index];
+    const c_rf_protocol *t = p.timing;
+    PwmState &s = pwm[index];
+    float nominal = this->nominal[index];
+    float magnitude = abs(d);
+
+    if (s.step == 0) {
+        const std::vector<int> &pilot = sync[index];
+        bool matched;
+        if (pilot.empty()) {
+            // Nothing to sync on, the frame starts after the silence of the previous one
+            matched = d < 0 && magnitude >= nominal * 8 * (1 - RF_DECODER_TE_TOLERANCE);
+            s.pos = matched ? 1 : 0;
+            s.te = nominal;
+            s.teSamples = 0;
+        } else {
+            int expected = pilot[s.pos];
+            if (s.pos == 0) {
+                s.te = nominal;
+                s.teSamples = 0;
+                // A leading low merges with whatever silence came before it
+                matched = same_sign(d, expected) &&
+                          (expected < 0 ? magnitude >= abs(expected) * (1 - RF_DECODER_TE_TOLERANCE)
+                                        : within(magnitude, abs(expected), RF_DECODER_TE_TOLERANCE));
+            } else {
+                matched = same_sign(d, expected) &&
+                          within(magnitude, abs(expected) * s.te / nominal, RF_DECODER_TE_TOLERANCE);
+                // Short pilot pulses give the first TE estimate
+                if (matched && abs(expected) <= 2 * nominal) {
+                    s.te = magnitude * nominal / abs(expected);
+                    s.teSamples = 1;
+                }
+            }
+            if (!matched) {
+                // This pulse may be the start of a new pilot
+                bool restart = s.pos != 0;
+                s.pos = 0;
+                if (restart) return feedPwm(index, d);
+                return false;
+            }
+            s.pos++;
+        }
+        if (matched && s.pos >= pilot.size()) {
+            s.step = 1;
+            s.pos = 0;
+            s.bits = 0;
+            s.key = 0;
+            s.haveFirst = false;
+        }
+        return false;
+    }
+
+    if (!s.haveFirst) {
+        s.first = d;
+        s.haveFirst = true;
+        return false;
+    }
+    s.haveFirst = false;
+
+    const std::vector<int> &zero = bit_timing(t, '0');
+    const std::vector<int> &one = bit_timing(t, '1');
+    int32_t a = s.first;
+    bool ok = zero.size() == 2 && one.size() == 2 && same_sign(a, zero[0]) && same_sign(d, zero[1]);
+
+    int bit = -1;
+    float te = 0;
+    bool merged = false;
+    if (ok) {
+        float ka[2] = {abs(zero[0]) / nominal, abs(one[0]) / nominal};
+        float kb[2] = {abs(zero[1]) / nominal, abs(one[1]) / nominal};
+        bool lastBit = s.bits + 1 == p.bits;
+        float longest = max(kb[0], kb[1]) * s.te;
+        merged = lastBit && magnitude > longest * (1 + RF_DECODER_TRACK_TOLERANCE);
+        if (merged) {
+            // The last pulse merged with the gap after the frame, only the first one counts
+            float units = fabsf(a) / s.te;
+            bit = fabsf(units - ka[1]) < fabsf(units - ka[0]) ? 1 : 0;
+            te = fabsf(a) / ka[bit];
+        } else {
+            float ratio = logf(fabsf(a) / magnitude);
+            float err0 = fabsf(ratio - logf(ka[0] / kb[0]));
+            float err1 = fabsf(ratio - logf(ka[1] / kb[1]));
+            bit = err1 < err0 ? 1 : 0;
+            if (min(err0, err1) > RF_DECODER_RATIO_TOLERANCE) ok = false;
+            te = (fabsf(a) + magnitude) / (ka[bit] + kb[bit]);
+        }
+        // Adaptive TE: loose window around the nominal value first, then track the estimate
+        if (s.teSamples == 0) ok = ok && within(te, nominal, RF_DECODER_TE_TOLERANCE);
+        else ok = ok && within(te, s.te, RF_DECODER_TRACK_TOLERANCE);
+    }
+
+    if (!ok) {
+        s.step = 0;
+        s.pos = 0;
+        return feedPwm(index, d);
+    }
+
+    uint16_t n = min<uint16_t>(s.teSamples, 15);
+    s.te = (s.te * n + te) / (n + 1);
+    s.teSamples++;
+    s.key = (s.key << 1) | bit;
+    s.bits++;
+    if (s.bits < p.bits) return false;
+
+    s.frameKey = s.key;
+    s.frameBits = s.bits;
+    s.frameTe = s.te;
+    s.step = 0;
+    s.pos = 0;
+    // That gap may also open the next frame
+    if (merged) feedPwm(index, d);
+    return true;
+}
+
+/*********************************************************************
+**  Manchester: collects a frame between gaps, TE from the shortest pulses
+*********************************************************************/
+bool RfDecoder::endManchesterFrame() {
+    const RfDecoderProtocol *p = rf_decoder_find("Manchester");
+    if (p == nullptr || frame.size() < p->bits) return false;
+
+    int32_t shortest = INT32_MAX;
+    for (int32_t d : frame) shortest = min<int32_t>(shortest, abs(d));
+    if (shortest < RF_DECODER_MANCHESTER_MIN_TE) return false;
+
+    float sum = 0;
+    int count = 0;
+    for (int32_t d : frame) {
+        if (abs(d) <= shortest * 1.5f) {
+            sum += abs(d);
+            count++;
+        }
+    }
+    float te = sum / count;
+
+    // Every pulse must be one or two half bits
+    std::vector<uint8_t> halves;
+    halves.reserve(frame.size() * 2);
+    for (int32_t d : frame) {
+        float units = abs(d) / te;
+        int n = lroundf(units);
+        if (n < 1 || n > 2 || fabsf(units - n) > 0.35f) return false;
+        for (int i = 0; i < n; i++) halves.push_back(d > 0);
+    }
+
+    // A frame starting with a 0 lost its first low half in the gap before it, and one ending with a 1
+    // its last low half in the gap after it. Every pair must hold a transition.
+    for (int lead = 0; lead < 2; lead++) {
+        std::vector<uint8_t> seq;
+        seq.reserve(halves.size() + 2);
+        if (lead) seq.push_back(0);
+        seq.insert(seq.end(), halves.begin(), halves.end());
+        if (seq.size() % 2) seq.push_back(0);
+        uint64_t key = 0;
+        uint8_t bits = 0;
+        bool valid = true;
+        for (size_t i = 0; i + 1 < seq.size(); i += 2) {
+            if (seq[i] == seq[i + 1]) {
+                valid = false;
+                break;
+            }
+            if (bits < 64) {
+                key = (key << 1) | seq[i]; // high then low is a 1
+                bits++;
+            }
+        }
+        if (valid && bits >= p->bits) return emit(p->name, key, bits, te);
+    }
+    return false;
+}
+
+bool RfDecoder::feed(int32_t duration) {
+    if (duration == 0) return false;
+    bool done = false;
+
+    // PWM decoders, if several finish on the same pulse keep the most plausible TE
+    int best = -1;
+    float bestError = 0;
+    for (size_t i = 0; i < protocols.size(); i++) {
+        if (protocols[i].encoding != RF_ENCODING_PWM) continue;
+        if (!feedPwm(i, duration)) continue;
+        float error = fabsf(pwm[i].frameTe / nominal[i] - 1);
+        if (best < 0 || error < bestError) {
+            best = i;
+            bestError = error;
+        }
+    }
+    if (best >= 0) {
+        pwmMatched = true;
+        const PwmState &s = pwm[best];
+        done = emit(protocols[best].name, s.frameKey, s.frameBits, s.frameTe);
+    }
+
+    if (duration < 0 && -duration >= RF_DECODER_MANCHESTER_GAP) {
+        if (!pwmMatched && !frame.empty()) done = endManchesterFrame() || done;
+        frame.clear();
+        pwmMatched = false;
+    } else if (frame.size() < RF_DECODER_MANCHESTER_MAX) {
+        frame.push_back(duration);
+    }
+    return done;
+}
+
+bool RfDecoder::decode(const int32_t *durations, size_t count, RfDecoded &out) {
+    reset();
+    bool found = false;
+    RfDecoded best;
+    for (size_t i = 0; i <= count; i++) {
+        // A trailing gap closes the last frame
+        if (!feed(i < count ? durations[i] : -RF_DECODER_MANCHESTER_GAP * 10)) continue;
+        if (!found || last.repeats > best.repeats) best = last;
+        found = true;
+    }
+    if (found) out = best;
+    return found;
+}
+
+bool rf_decoder_encode(
+    const RfDecoderProtocol &protocol, uint64_t key, int bits, int te, std::vector<int> &out
+) {
+    if (bits <= 0 || bits > 64) return false;
+
+    if (protocol.encoding == RF_ENCODING_MANCHESTER) {
+        if (te <= 0) return false;
+        for (int i = bits - 1; i >= 0; --i) {
+            bool bit = (key >> i) & 1;
+            out.push_back(bit ? te : -te);
+            out.push_back(bit ? -te : te);
+        }
+        out.push_back(-RF_DECODER_MANCHESTER_GAP * 2);
+        return true;
+    }
+
+    const c_rf_protocol *t = protocol.timing;
+    float nominal = nominal_te(t);
+    float scale = te > 0 ? te / nominal : 1;
+    // Markers of 1us only shape the level, they are not scaled
+    auto push = [&](int d) { out.push_back(abs(d) <= 1 ? d : lroundf(d * scale)); };
+
+    for (int d : t->pilot_period) push(d);
+    for (int i = bits - 1; i >= 0; --i) {
+        for (int d : bit_timing(t, (key >> i) & 1 ? '1' : '0')) push(d);
+    }
+    for (int d : t->stop_bit) push(d);
+    return true;
+}
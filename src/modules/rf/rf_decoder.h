@@ -0,0 +1,77 @@
+#ifndef __RF_DECODER_H__
+#define __RF_DECODER_H__
+
+#include "protocols/protocol.h"
+#include <Arduino.h>
+#include <vector>
+
+enum RfEncoding {
+    RF_ENCODING_PWM,        // each bit is a pair of pulses, the ratio between them tells the value
+    RF_ENCODING_MANCHESTER, // each bit is a transition in the middle of a 2*TE period
+};
+
+// Decoding description of a protocol. PWM protocols reuse the c_rf_protocol timings of the
+// bruteforce encoders: pilot, '0' and '1' transpositions and stop bit.
+struct RfDecoderProtocol {
+    const char *name;
+    RfEncoding encoding;
+    uint8_t bits;          // PWM: frame length, Manchester: minimum frame length
+    c_rf_protocol *timing; // PWM only
+};
+
+struct RfDecoded {
+    const char *protocol = nullptr;
+    uint64_t key = 0;
+    uint8_t bits = 0;
+    uint16_t te = 0;      // estimated from the received pulses
+    uint8_t repeats = 0;  // identical frames received in a row, minus one
+};
+
+// Streaming decoder, every protocol of the table runs as its own state machine over the pulses.
+// Pulses are signed durations in microseconds, positive for high and negative for low, as in
+// RAW_Data, RCSwitch raw captures or converted RMT symbols.
+class RfDecoder {
+public:
+    RfDecoder();
+    void reset();
+    // Returns true when a frame was completed, read it with result()
+    bool feed(int32_t duration);
+    const RfDecoded &result() const { return last; }
+    // Runs a whole capture, keeps the frame that repeated the most
+    bool decode(const int32_t *durations, size_t count, RfDecoded &out);
+
+private:
+    struct PwmState {
+        uint8_t step = 0; // 0 = waiting for the sync pulses, 1 = bits
+        uint8_t pos = 0;  // position in the sync pulses
+        bool haveFirst = false;
+        int32_t first = 0;
+        uint8_t bits = 0;
+        uint64_t key = 0;
+        float te = 0;
+        uint16_t teSamples = 0;
+        // Last complete frame, the state above may already be syncing on the next one
+        uint64_t frameKey = 0;
+        uint8_t frameBits = 0;
+        float frameTe = 0;
+    };
+    std::vector<PwmState> pwm;
+    std::vector<float> nominal;          // TE of each PWM protocol as described by its timing table
+    std::vector<std::vector<int>> sync; // pulses that precede a PWM frame
+    std::vector<int32_t> frame; // Manchester frame being collected, cleared at every gap
+    bool pwmMatched = false;    // a PWM protocol already claimed the current frame
+    RfDecoded last;
+
+    bool feedPwm(size_t index, int32_t duration);
+    bool endManchesterFrame();
+    bool emit(const char *protocol, uint64_t key, uint8_t bits, float te);
+};
+
+const std::vector<RfDecoderProtocol> &rf_decoder_protocols();
+const RfDecoderProtocol *rf_decoder_find(const String &name);
+// Builds one frame of `protocol` for `key`, scaled to `te` (0 = nominal), for RCSwitch_RAW_send
+bool rf_decoder_encode(
+    const RfDecoderProtocol &protocol, uint64_t key, int bits, int te, std::vector<int> &out
+);
+
+#endif
@@ -1,6 +1,7 @@
 #include "rf_listen.h"
 
 #include "../others/audio.h"
+#include "core/spi_bus.h"
 
 volatile unsigned long lastMicros = 0;
 volatile unsigned long pulseMicros = 0;
@@ -57,9 +58,12 @@ void rf_listen() {
         return;
     }
 
-    ELECHOUSE_cc1101.setRxBW(58);
-    ELECHOUSE_cc1101.setModulation(2);
-    ELECHOUSE_cc1101.setDcFilterOff(true);
+    {
+        SpiGuard bus(SpiDevice::CC1101);
+        ELECHOUSE_cc1101.setRxBW(58);
+        ELECHOUSE_cc1101.setModulation(2);
+        ELECHOUSE_cc1101.setDcFilterOff(true);
+    }
     attachInterrupt(digitalPinToInterrupt(bruceConfigPins.CC1101_bus.io0), onPulse, CHANGE);
     displayRedStripe("Listening...", getComplementaryColor2(bruceConfig.priColor), bruceConfig.priColor);
 
@@ -1,7 +1,9 @@
 #include "rf_scan.h"
 #include "core/led_control.h"
 #include "core/sd_functions.h"
+#include "core/spi_bus.h"
 #include "core/type_convertion.h"
+#include "rf_decoder.h"
 #include "rf_send.h"
 #include <globals.h>
 #include <sstream>
@@ -91,9 +93,8 @@ bool RFScan::fast_scan() {
     }
     float checkFrequency = subghz_frequency_list[idx];
     setMHZ(checkFrequency);
-    tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
     vTaskDelay(5 / portTICK_PERIOD_MS);
-    rssi = ELECHOUSE_cc1101.getRssi();
+    rssi = getCC1101Rssi();
     if (rssi > rssiThreshold) {
         _freqs[_try].freq = checkFrequency;
         _freqs[_try].rssi = rssi;
@@ -155,6 +156,7 @@ void RFScan::read_raw() {
     String _data = "";
     std::vector<int> durations;
     std::vector<int> indexed_durations;
+    std::vector<int32_t> pulses;
     uint64_t result = 0;
     uint8_t repetition = 0;
 
@@ -167,6 +169,7 @@ void RFScan::read_raw() {
         int duration = sign * (int)raw[transitions];
         if (duration < -5000 && repetition < 2) { repetition += 1; }
         _data += String(duration);
+        pulses.push_back(duration);
         if (received.te == 0 && duration > 0) received.te = duration;
 
         if (!decoded && repetition == 1 && duration >= -5000) {
@@ -183,6 +186,14 @@ void RFScan::read_raw() {
     received.filepath = "signal_" + String(signals);
     received.frequency = long(frequency * 1000000);
 
+    // RCSwitch didn't recognize it, try the protocol decoders
+    RfDecoded frame;
+    bool protocolDecoded = false;
+    if (!decoded) {
+        RfDecoder decoder;
+        protocolDecoded = decoder.decode(pulses.data(), pulses.size(), frame);
+    }
+
     // if there is a value decoded by RCSwitch, show it
     if (decoded) {
         Serial.println("RcSwitch signal captured");
@@ -197,6 +208,20 @@ void RFScan::read_raw() {
         frequency = 0;
         display_info(received, signals, ReadRAW, codesOnly, autoSave, title);
     }
+    // if one of the protocol decoders recognized it, show the decoded key
+    else if (protocolDecoded) {
+        Serial.printf("%s signal decoded, %d bits, TE %d\n", frame.protocol, frame.bits, frame.te);
+        blinkLed();
+        ++signals;
+        received.key = frame.key;
+        received.preset = "0";
+        received.protocol = frame.protocol;
+        received.indexed_durations = {};
+        received.te = frame.te;
+        received.Bit = frame.bits;
+        frequency = 0;
+        display_info(received, signals, ReadRAW, codesOnly, autoSave, title);
+    }
     // if there is no value decoded by RCSwitch, but we calculated a CRC, show it
     else if (repetition >= 2 && !durations.empty()) {
         Serial.println("Raw signal captured");
@@ -479,7 +504,7 @@ bool RCSwitch_SaveSignal(float frequency, RfCodes codes, bool raw, char *key, bo
     subfile_out += "Frequency: " + String(int(frequency * 1000000)) + "\n";
     if (!raw) {
         subfile_out += "Preset: " + String(codes.preset) + "\n";
-        subfile_out += "Protocol: RcSwitch\n";
+        subfile_out += "Protocol: " + codes.protocol + "\n";
         subfile_out += "Bit: " + String(codes.Bit) + "\n";
         subfile_out += "Key: " + String(key) + "\n";
         subfile_out += "TE: " + String(codes.te) + "\n";
@@ -501,16 +526,20 @@ bool RCSwitch_SaveSignal(float frequency, RfCodes codes, bool raw, char *key, bo
 
     String filepath = "/BruceRF";
     if (autoSave) filepath += "/autoSaved";
-    File file = createNewFile(fs, filepath, filename);
-
-    if (file) {
-        file.println(subfile_out);
-        if (!autoSave) displaySuccess(file.path());
-    } else {
-        displayError("Error saving file", true);
+    String path;
+    {
+        // The receiver keeps running while the capture is written
+        SpiGuard bus(SpiDevice::SDCard);
+        File file = createNewFile(fs, filepath, filename);
+        if (file) {
+            file.println(subfile_out);
+            path = file.path();
+        }
+        file.close();
     }
 
-    file.close();
+    if (path == "") displayError("Error saving file", true);
+    else if (!autoSave) displaySuccess(path);
     return true;
 }
 
@@ -522,8 +551,10 @@ String rf_scan(float start_freq, float stop_freq, int max_loops) {
         return ""; // only CC1101 is supported for this
     }
     if (!initRfModule("rx", start_freq)) return "";
-
-    ELECHOUSE_cc1101.setRxBW(256);
+    {
+        SpiGuard bus(SpiDevice::CC1101);
+        ELECHOUSE_cc1101.setRxBW(256);
+    }
 
     float settingf1 = start_freq;
     float settingf2 = stop_freq;
@@ -540,7 +571,7 @@ String rf_scan(float start_freq, float stop_freq, int max_loops) {
 
         setMHZ(freq);
 
-        rssi = ELECHOUSE_cc1101.getRssi();
+        rssi = getCC1101Rssi();
         if (rssi > -75) {
             if (rssi > mark_rssi) {
                 mark_rssi = rssi;
@@ -677,7 +708,7 @@ RestartRec:
             subfile_out += "Frequency: " + String(int(frequency * 1000000)) + "\n";
             if (!raw) {
                 subfile_out += "Preset: " + String(received.preset) + "\n";
-                subfile_out += "Protocol: RcSwitch\n";
+                subfile_out += "Protocol: " + received.protocol + "\n";
                 subfile_out += "Bit: " + String(received.Bit) + "\n";
                 subfile_out += "Key: " + String(hexString) + "\n";
                 subfile_out += "TE: " + String(received.te) + "\n";
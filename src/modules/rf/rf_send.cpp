@@ -1,5 +1,8 @@
 #include "rf_send.h"
+#include "core/led_control.h"
+#include "core/spi_bus.h"
 #include "core/type_convertion.h"
+#include "rf_decoder.h"
 #include "rf_utils.h"
 #include <RCSwitch.h>
 
@@ -44,12 +47,15 @@ bool txSubFile(FS *fs, String filepath, bool hideDefaultUI) {
 
     if (!fs) return false;
 
+    // Held until the file is closed, the CC1101 may sit on the same pins as the card
+    spiArbiter.acquire(SpiDevice::SDCard);
     databaseFile = fs->open(filepath, FILE_READ);
 
     if (!hideDefaultUI) { drawMainBorder(); }
 
     if (!databaseFile) {
         Serial.println("Failed to open database file.");
+        spiArbiter.release(SpiDevice::SDCard);
         displayError("Fail to open file", true);
         return false;
     }
@@ -86,6 +92,7 @@ bool txSubFile(FS *fs, String filepath, bool hideDefaultUI) {
     int total = bitList.size() + bitRawList.size() + keyList.size() + rawDataList.size() > 0 ? 1 : 0;
     Serial.printf("Total signals found: %d\n", total);
     databaseFile.close();
+    spiArbiter.release(SpiDevice::SDCard);
 
     // If the signal is complete, send all of the code(s) that were found in it.
     // TODO: try to minimize the overhead between codes.
@@ -149,6 +156,7 @@ bool txSubFile(FS *fs, String filepath, bool hideDefaultUI) {
 }
 
 void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
+    LedEffectsPauseScope ledPause; // LED frames share the RMT peripheral and add jitter
     uint32_t frequency = rfcode.frequency;
     String protocol = rfcode.protocol;
     String preset = rfcode.preset;
@@ -224,6 +232,7 @@ void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
     // init transmitter
     if (!initRfModule("", frequency / 1000000.0)) return;
     if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) { // CC1101 in use
+        SpiGuard bus(SpiDevice::CC1101);
         // derived from
         // https://github.com/LSatan/SmartRC-CC1101-Driver-Lib/blob/master/examples/Rc-Switch%20examples%20cc1101/SendDemo_cc1101/SendDemo_cc1101.ino
         ELECHOUSE_cc1101.setModulation(modulation);
@@ -308,6 +317,20 @@ void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
         RCSwitch_send(data_val, bits, pulse, rcswitch_protocol_no, repeat);
     } else if (protocol.startsWith("Princeton")) {
         RCSwitch_send(rfcode.key, rfcode.Bit, 350, 1, 10);
+    } else if (const RfDecoderProtocol *decoder = rf_decoder_find(protocol)) {
+        // Protocols known to the decoder are rebuilt from their timing table, with the received TE
+        std::vector<int> transmittimings;
+        for (int r = 0; r < 10; r++) {
+            if (!rf_decoder_encode(*decoder, key, rfcode.Bit, rfcode.te, transmittimings)) break;
+        }
+        if (transmittimings.empty()) {
+            Serial.println("Invalid bit length for " + protocol);
+            deinitRfModule();
+            return;
+        }
+        transmittimings.push_back(0); // termination
+        if (!hideDefaultUI) { displayTextLine("Sending.."); }
+        RCSwitch_RAW_send(transmittimings.data());
     } else {
         Serial.print("unsupported protocol: ");
         Serial.println(protocol);
@@ -98,7 +98,6 @@ void rf_SquareWave() {
     int line_h = 15;
     unsigned int *raw;
 PRINT:
-    tft.drawPixel(0, 0, 0);
     tft.fillScreen(bruceConfig.bgColor);
     tft.setTextSize(1);
     tft.setCursor(3, 2);
@@ -161,7 +160,6 @@ void rf_CC1101_rssi() {
     while (1) {
         if (redraw) {
             redraw = false;
-            tft.drawPixel(0, 0, 0);
             tft.fillScreen(bruceConfig.bgColor);
             tft.setTextSize(1);
             tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
@@ -205,8 +203,7 @@ void rf_CC1101_rssi() {
 
         // draw dot graph for fixed frequency
         if (bruceConfigPins.rfFxdFreq) {
-            int rssi = ELECHOUSE_cc1101.getRssi();
-            tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
+            int rssi = getCC1101Rssi();
             const int base_y = tftHeight - 120;
             int prev = signal[0];
             for (int i = 1; i < graph_size; i++) {
@@ -238,8 +235,7 @@ void rf_CC1101_rssi() {
                 if (EscPress || SelPress) break;
                 setMHZ(subghz_frequency_list[range_limits[bruceConfigPins.rfScanRange][0] + i]);
                 vTaskDelay(pdMS_TO_TICKS(5));
-                int rssi = ELECHOUSE_cc1101.getRssi();
-                tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
+                int rssi = getCC1101Rssi();
                 int size = map(rssi, -95, -20, 0, max_bar_size);
                 if (size > bar_size[i]) bar_size[i] = size;
                 else bar_size[i] = bar_size[i] - (bar_size[i] - size) / 2; // slow down decrease
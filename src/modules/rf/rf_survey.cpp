@@ -0,0 +1,507 @@
+#include "rf_survey.h"
+#include "core/display.h"
+#include "core/mykeyboard.h"
+#include "core/sd_functions.h"
+#include "core/spi_bus.h"
+#include <globals.h>
+#include <time.h>
+
+#define RF_SURVEY_DIR "/BruceRF"
+#define RF_SURVEY_CHUNK 32          // bins measured per bus lock, bounds how long the UI waits
+#define RF_SURVEY_MAX_BINS 2048     // without PSRAM, the step is widened to stay under it
+#define RF_SURVEY_MAX_BINS_PSRAM 8192
+#define RF_SURVEY_DEPTH 4           // epochs kept in memory without PSRAM
+#define RF_SURVEY_DEPTH_PSRAM 60
+#define RF_SURVEY_MARCSTATE_IDLE 0x01
+#define RF_SURVEY_CAL_TIMEOUT_US 2000
+
+// Bands the CC1101 can tune, same split as subghz_frequency_ranges
+static const RfSurveyRange survey_bands[] = {
+    {300, 348},
+    {387, 464},
+    {779, 928},
+};
+
+RfSurvey::RfSurvey(const RfSurveyConfig &config) : config(config) {
+    size_t maxBins = psramFound() ? RF_SURVEY_MAX_BINS_PSRAM : RF_SURVEY_MAX_BINS;
+    float step = max(config.stepMHz, 0.01f);
+    while (true) {
+        binFreqs.clear();
+        for (const RfSurveyRange &range : config.ranges) {
+            for (float f = range.start; f <= range.stop + step / 2 && binFreqs.size() <= maxBins; f += step) {
+                binFreqs.push_back(f);
+            }
+        }
+        if (binFreqs.size() <= maxBins) break;
+        step *= 2; // not enough memory for that resolution
+    }
+    this->config.stepMHz = step;
+}
+
+RfSurvey::~RfSurvey() { end(); }
+
+/*********************************************************************
+**  Radio
+*********************************************************************/
+// Runs the synthesizer calibration once per bin and keeps the result, the sweep then
+// programs FREQ and FSCAL together and goes straight to RX
+void RfSurvey::calibrate() {
+    SpiGuard bus(SpiDevice::CC1101);
+    for (size_t i = 0; i < bins(); i++) {
+        ELECHOUSE_cc1101.setSidle();
+        ELECHOUSE_cc1101.setMHZ(binFreqs[i]); // also sets the band dependent TEST0
+        ELECHOUSE_cc1101.SpiStrobe(CC1101_SCAL);
+        uint32_t start = micros();
+        while ((ELECHOUSE_cc1101.SpiReadStatus(CC1101_MARCSTATE) & 0x1F) != RF_SURVEY_MARCSTATE_IDLE &&
+               micros() - start < RF_SURVEY_CAL_TIMEOUT_US) {}
+
+        Calibration &c = cal[i];
+        for (int r = 0; r < 3; r++) {
+            c.freq[r] = ELECHOUSE_cc1101.SpiReadReg(CC1101_FREQ2 + r);
+            c.fscal[r] = ELECHOUSE_cc1101.SpiReadReg(CC1101_FSCAL3 + r);
+        }
+        c.test0 = ELECHOUSE_cc1101.SpiReadReg(CC1101_TEST0);
+    }
+    // Going to RX must not start a new calibration, it would undo the stored one
+    savedMcsm0 = ELECHOUSE_cc1101.SpiReadReg(CC1101_MCSM0);
+    ELECHOUSE_cc1101.SpiWriteReg(CC1101_MCSM0, savedMcsm0 & ~0x30);
+}
+
+int8_t RfSurvey::measure(size_t bin, uint8_t &lastTest0) {
+    const Calibration &c = cal[bin];
+    byte regs[3];
+
+    ELECHOUSE_cc1101.SpiStrobe(CC1101_SIDLE); // frequency registers may only change in IDLE
+    memcpy(regs, c.freq, 3);
+    ELECHOUSE_cc1101.SpiWriteBurstReg(CC1101_FREQ2, regs, 3);
+    memcpy(regs, c.fscal, 3);
+    ELECHOUSE_cc1101.SpiWriteBurstReg(CC1101_FSCAL3, regs, 3);
+    if (c.test0 != lastTest0) {
+        ELECHOUSE_cc1101.SpiWriteReg(CC1101_TEST0, c.test0);
+        lastTest0 = c.test0;
+    }
+    ELECHOUSE_cc1101.SpiStrobe(CC1101_SRX);
+    delayMicroseconds(settleUs); // PLL lock and a valid RSSI for the filter bandwidth
+
+    int rssi = ELECHOUSE_cc1101.getRssi(); // the sweep already holds the bus
+    return constrain(rssi, -128, 0);
+}
+
+void RfSurvey::rollEpoch() {
+    uint32_t index = epochHead.load(std::memory_order_relaxed);
+    RfSurveyBinStats *slot = ring + (index % depth) * bins();
+    for (size_t i = 0; i < bins(); i++) {
+        const Accumulator &a = acc[i];
+        slot[i].min = a.min;
+        slot[i].max = a.max;
+        slot[i].avg = a.sum / epochSweeps;
+        slot[i].duty = min<uint32_t>(100, a.busy * 100UL / epochSweeps);
+    }
+    for (size_t i = 0; i < bins(); i++) acc[i] = {INT8_MAX, INT8_MIN, 0, 0};
+    epochs[index % depth] = {clock_set ? (uint32_t)time(nullptr) : (uint32_t)(millis() / 1000), epochSweeps};
+    epochSweeps = 0;
+    epochStart = millis();
+    epochHead.store(index + 1, std::memory_order_release);
+}
+
+void RfSurvey::sweepTask(void *pvParameters) {
+    RfSurvey *s = (RfSurvey *)pvParameters;
+    uint8_t lastTest0 = 0xFF;
+    while (!s->stopping) {
+        size_t bin = 0;
+        while (bin < s->bins() && !s->stopping) {
+            size_t last = min(bin + RF_SURVEY_CHUNK, s->bins());
+            {
+                SpiGuard bus(SpiDevice::CC1101);
+                for (; bin < last; bin++) {
+                    int8_t rssi = s->measure(bin, lastTest0);
+                    Accumulator &a = s->acc[bin];
+                    if (rssi < a.min) a.min = rssi;
+                    if (rssi > a.max) a.max = rssi;
+                    a.sum += rssi;
+                    if (rssi >= s->config.busyThreshold) {
+                        a.busy++;
+                        s->totalBusy[bin]++;
+                    }
+                }
+            }
+            vTaskDelay(1); // lets the UI take the bus and keeps the idle task fed
+        }
+        if (bin < s->bins()) break; // stopped halfway, drop the partial sweep from the counts
+        s->epochSweeps++;
+        s->totalSweeps++;
+        if (millis() - s->epochStart >= s->config.epochSeconds * 1000UL || s->epochSweeps == UINT16_MAX) {
+            s->rollEpoch();
+        }
+    }
+    xSemaphoreGive(s->exited);
+    vTaskDelete(NULL);
+}
+
+/*********************************************************************
+**  Life cycle
+*********************************************************************/
+bool RfSurvey::begin(FS *fs) {
+    if (bins() == 0 || task != NULL) return false;
+
+    // Stats of finished epochs are read by the UI, the rest only by the sweep task
+    size_t budget = psramFound() ? RF_SURVEY_DEPTH_PSRAM : RF_SURVEY_DEPTH;
+    depth = budget;
+    cal = (Calibration *)malloc(bins() * sizeof(Calibration));
+    acc = (Accumulator *)malloc(bins() * sizeof(Accumulator));
+    totalBusy = (uint32_t *)calloc(bins(), sizeof(uint32_t));
+    size_t ringSize = depth * bins() * sizeof(RfSurveyBinStats);
+    ring = (RfSurveyBinStats *)(psramFound() ? ps_malloc(ringSize) : malloc(ringSize));
+    epochs = (EpochInfo *)calloc(depth, sizeof(EpochInfo));
+    exited = xSemaphoreCreateBinary();
+    if (!cal || !acc || !totalBusy || !ring || !epochs || !exited) {
+        end();
+        return false;
+    }
+    for (size_t i = 0; i < bins(); i++) acc[i] = {INT8_MAX, INT8_MIN, 0, 0};
+
+    // Before the radio is touched, a failure here has nothing to undo on the CC1101
+    this->fs = fs;
+    if (fs && (config.logCsv || config.logBinary) && !openLogs()) {
+        end();
+        return false;
+    }
+
+    if (!initRfModule("rx", binFreqs[0])) {
+        end();
+        return false;
+    }
+    // Filter about as wide as a bin, the RSSI settles slower on narrow filters
+    float bwKHz = constrain(config.stepMHz * 1000, 58, 812);
+    ELECHOUSE_cc1101.setRxBW(bwKHz);
+    settleUs = 90 + 60000 / bwKHz;
+    calibrate();
+    radioReady = true;
+
+    stopping = false;
+    epochHead = 0;
+    epochWritten = lost = 0;
+    epochSweeps = 0;
+    totalSweeps = 0;
+    epochStart = startMs = millis();
+    // Same priority as the UI, it yields after every chunk of bins
+    if (xTaskCreate(sweepTask, "RfSurvey", 3072, this, 1, &task) != pdPASS) {
+        task = NULL;
+        end();
+        return false;
+    }
+    return true;
+}
+
+void RfSurvey::end() {
+    if (task != NULL) {
+        stopping = true;
+        xSemaphoreTake(exited, portMAX_DELAY);
+        task = NULL;
+        if (epochSweeps > 0) rollEpoch(); // the last, shorter epoch
+        flushLogs();
+    }
+    // Also when the sweep task never started
+    if (radioReady) {
+        SpiGuard bus(SpiDevice::CC1101);
+        ELECHOUSE_cc1101.SpiWriteReg(CC1101_MCSM0, savedMcsm0);
+        deinitRfModule();
+        radioReady = false;
+    }
+    if (csv) csv.close();
+    if (bin) bin.close();
+    if (exited) vSemaphoreDelete(exited);
+    exited = NULL;
+    free(cal);
+    free(acc);
+    free(totalBusy);
+    free(ring);
+    free(epochs);
+    cal = nullptr;
+    acc = nullptr;
+    totalBusy = nullptr;
+    ring = nullptr;
+    epochs = nullptr;
+    depth = 0;
+}
+
+float RfSurvey::sweepRate() const {
+    uint32_t elapsed = millis() - startMs;
+    return elapsed ? totalSweeps * 1000.0f / elapsed : 0;
+}
+
+const RfSurveyBinStats *RfSurvey::epoch(size_t age) const {
+    uint32_t head = epochHead.load(std::memory_order_acquire);
+    if (age >= head || age >= depth) return nullptr;
+    return ring + ((head - 1 - age) % depth) * bins();
+}
+
+/*********************************************************************
+**  Logs
+*********************************************************************/
+// CSV: one row per bin that went above the threshold during the epoch
+// Binary: header, bin frequencies, then per epoch {u32 time, u16 sweeps, u16 flags, bins * 4 bytes}
+bool RfSurvey::openLogs() {
+    SpiGuard bus(SpiDevice::SDCard);
+    if (!fs->exists(RF_SURVEY_DIR)) fs->mkdir(RF_SURVEY_DIR);
+    int i = 0;
+    do {
+        logBase = String(RF_SURVEY_DIR) + "/survey_" + String(i++);
+    } while (fs->exists(logBase + ".csv") || fs->exists(logBase + ".bin"));
+
+    if (config.logCsv) {
+        csv = fs->open(logBase + ".csv", FILE_WRITE);
+        if (!csv) return false;
+        csv.printf(
+            "# Bruce sub-GHz survey, step %.3f MHz, threshold %d dBm, epoch %u s, time %s\n",
+            config.stepMHz,
+            config.busyThreshold,
+            config.epochSeconds,
+            clock_set ? "unix" : "uptime"
+        );
+        csv.println("time,freq_mhz,min_dbm,avg_dbm,max_dbm,duty_pct");
+    }
+    if (config.logBinary) {
+        bin = fs->open(logBase + ".bin", FILE_WRITE);
+        if (!bin) return false;
+        uint32_t count = bins();
+        bin.write((const uint8_t *)"BRSV", 4);
+        const uint8_t version[2] = {1, (uint8_t)config.busyThreshold};
+        bin.write(version, sizeof(version));
+        bin.write((const uint8_t *)&config.epochSeconds, sizeof(config.epochSeconds));
+        bin.write((const uint8_t *)&count, sizeof(count));
+        bin.write((const uint8_t *)&config.stepMHz, sizeof(float));
+        bin.write((const uint8_t *)binFreqs.data(), count * sizeof(float));
+    }
+    return true;
+}
+
+void RfSurvey::writeEpoch(uint32_t index) {
+    const RfSurveyBinStats *slot = ring + (index % depth) * bins();
+    const EpochInfo &info = epochs[index % depth];
+
+    if (csv) {
+        char line[64];
+        for (size_t i = 0; i < bins(); i++) {
+            if (slot[i].max < config.busyThreshold) continue;
+            int len = snprintf(
+                line,
+                sizeof(line),
+                "%lu,%.3f,%d,%d,%d,%u\n",
+                (unsigned long)info.timestamp,
+                binFreqs[i],
+                slot[i].min,
+                slot[i].avg,
+                slot[i].max,
+                slot[i].duty
+            );
+            csv.write((const uint8_t *)line, len);
+        }
+    }
+    if (bin) {
+        uint16_t flags = clock_set ? 1 : 0;
+        bin.write((const uint8_t *)&info.timestamp, sizeof(info.timestamp));
+        bin.write((const uint8_t *)&info.sweeps, sizeof(info.sweeps));
+        bin.write((const uint8_t *)&flags, sizeof(flags));
+        bin.write((const uint8_t *)slot, bins() * sizeof(RfSurveyBinStats));
+    }
+}
+
+size_t RfSurvey::flushLogs() {
+    uint32_t head = epochHead.load(std::memory_order_acquire);
+    if (head - epochWritten > depth) {
+        // The UI was away longer than the ring holds
+        lost += head - epochWritten - depth;
+        epochWritten = head - depth;
+    }
+    if (!csv && !bin) {
+        epochWritten = head;
+        return 0;
+    }
+
+    size_t written = 0;
+    SpiGuard bus(SpiDevice::SDCard);
+    while (epochWritten < head) {
+        writeEpoch(epochWritten++);
+        written++;
+    }
+    if (written) {
+        if (csv) csv.flush();
+        if (bin) bin.flush();
+    }
+    return written;
+}
+
+/*********************************************************************
+**  Menu
+*********************************************************************/
+static RfSurveyConfig survey_config;
+static int survey_range = 3; // index in subghz_frequency_ranges
+
+static void rf_survey_draw(RfSurvey &survey) {
+    tft.fillRect(BORDER_PAD_X, 28, tftWidth - 2 * BORDER_PAD_X, tftHeight - 34, bruceConfig.bgColor);
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.setCursor(BORDER_PAD_X + 2, 30);
+    tft.printf(
+        "%u bins, %lu sweeps (%.1f/s)",
+        (unsigned)survey.bins(),
+        (unsigned long)survey.sweeps(),
+        survey.sweepRate()
+    );
+    if (survey.lostEpochs()) tft.printf(", %lu lost", (unsigned long)survey.lostEpochs());
+
+    // Max RSSI of the last epoch, one column per group of bins
+    int top = 42;
+    int height = tftHeight / 3;
+    int width = tftWidth - 2 * BORDER_PAD_X - 4;
+    const RfSurveyBinStats *last = survey.epoch(0);
+    tft.drawRect(BORDER_PAD_X + 1, top - 1, width + 2, height + 2, bruceConfig.priColor);
+    if (last) {
+        for (int x = 0; x < width; x++) {
+            size_t from = (size_t)x * survey.bins() / width;
+            size_t to = max(from + 1, (size_t)(x + 1) * survey.bins() / width);
+            int peak = -128, duty = 0;
+            for (size_t i = from; i < to && i < survey.bins(); i++) {
+                peak = max(peak, (int)last[i].max);
+                duty = max(duty, (int)last[i].duty);
+            }
+            int h = constrain(map(peak, -110, -30, 0, height), 0, height);
+            uint16_t color = duty > 50 ? TFT_RED : duty > 5 ? TFT_YELLOW : bruceConfig.priColor;
+            tft.drawFastVLine(BORDER_PAD_X + 2 + x, top + height - h, h, color);
+        }
+    }
+
+    // Busiest frequencies since start
+    int y = top + height + 6;
+    const int lines = max(1, (tftHeight - y - 12) / 10);
+    std::vector<size_t> busiest;
+    for (size_t i = 0; i < survey.bins(); i++) {
+        if (survey.busySweeps(i) == 0) continue;
+        busiest.push_back(i);
+        std::sort(busiest.begin(), busiest.end(), [&](size_t a, size_t b) {
+            return survey.busySweeps(a) > survey.busySweeps(b);
+        });
+        if (busiest.size() > (size_t)lines) busiest.pop_back();
+    }
+    for (size_t i : busiest) {
+        tft.setCursor(BORDER_PAD_X + 2, y);
+        float duty = survey.sweeps() ? survey.busySweeps(i) * 100.0f / survey.sweeps() : 0;
+        tft.printf("%.3f MHz  %.1f%% busy", survey.binFrequency(i), duty);
+        y += 10;
+    }
+
+    tft.setCursor(BORDER_PAD_X + 2, tftHeight - 14);
+    if (survey.logName() != "") tft.print(survey.logName() + " [ESC] stop");
+    else tft.print("Not logging, [ESC] stop");
+}
+
+static void rf_survey_run() {
+    RfSurveyConfig config = survey_config;
+    if (survey_range < 3) config.ranges = {survey_bands[survey_range]};
+    else config.ranges = {survey_bands[0], survey_bands[1], survey_bands[2]};
+
+    FS *fs = nullptr;
+    if (config.logCsv || config.logBinary) {
+        if (setupSdCard()) fs = &SD;
+        else if (checkLittleFsSize()) fs = &LittleFS;
+        else displayWarning("No storage, not logging", true);
+    }
+
+    RfSurvey survey(config);
+    drawMainBorderWithTitle("RF Survey");
+    padprintln("Calibrating " + String(survey.bins()) + " bins...");
+    if (!survey.begin(fs)) {
+        displayError("Survey failed to start", true);
+        return;
+    }
+
+    uint32_t lastDraw = 0;
+    while (!check(EscPress)) {
+        if (millis() - lastDraw >= 1000) {
+            survey.flushLogs();
+            rf_survey_draw(survey);
+            lastDraw = millis();
+        }
+        delay(50);
+    }
+    survey.end();
+    if (survey.logName() != "") displaySuccess("Saved " + survey.logName(), true);
+}
+
+void rf_survey() {
+    if (bruceConfigPins.rfModule != CC1101_SPI_MODULE) {
+        displayError("Survey needs a CC1101!", true);
+        return;
+    }
+
+    int option = 0, idx = 0;
+    while (true) {
+        option = 0;
+        String log = survey_config.logCsv && survey_config.logBinary ? "CSV+Bin"
+                     : survey_config.logCsv                          ? "CSV"
+                     : survey_config.logBinary                       ? "Binary"
+                                                                     : "Off";
+        options = {
+            {"Start Survey",                                                  [&]() { option = 1; }},
+            {"Range: " + String(subghz_frequency_ranges[survey_range]),       [&]() { option = 2; }},
+            {"Step: " + String(survey_config.stepMHz * 1000, 0) + " kHz",     [&]() { option = 3; }},
+            {"Threshold: " + String(survey_config.busyThreshold) + " dBm",    [&]() { option = 4; }},
+            {"Epoch: " + String(survey_config.epochSeconds) + " s",           [&]() { option = 5; }},
+            {"Log: " + log,                                                   [&]() { option = 6; }},
+            {"Main Menu",                                                     [&]() { option = 0; }},
+        };
+        idx = loopOptions(options, idx);
+        options.clear();
+
+        switch (option) {
+            case 0: return;
+            case 1: rf_survey_run(); break;
+            case 2:
+                options = {
+                    {subghz_frequency_ranges[0], [&]() { survey_range = 0; }},
+                    {subghz_frequency_ranges[1], [&]() { survey_range = 1; }},
+                    {subghz_frequency_ranges[2], [&]() { survey_range = 2; }},
+                    {subghz_frequency_ranges[3], [&]() { survey_range = 3; }},
+                };
+                loopOptions(options);
+                break;
+            case 3:
+                options = {
+                    {"25 kHz",  [&]() { survey_config.stepMHz = 0.025; }},
+                    {"50 kHz",  [&]() { survey_config.stepMHz = 0.05; } },
+                    {"100 kHz", [&]() { survey_config.stepMHz = 0.1; }  },
+                    {"200 kHz", [&]() { survey_config.stepMHz = 0.2; }  },
+                    {"500 kHz", [&]() { survey_config.stepMHz = 0.5; }  },
+                };
+                loopOptions(options);
+                break;
+            case 4:
+                options = {};
+                for (int thr = -100; thr <= -50; thr += 5) {
+                    options.push_back({String(thr) + " dBm", [thr]() { survey_config.busyThreshold = thr; }});
+                }
+                loopOptions(options, (survey_config.busyThreshold + 100) / 5);
+                break;
+            case 5:
+                options = {
+                    {"10 s",  [&]() { survey_config.epochSeconds = 10; }  },
+                    {"1 min", [&]() { survey_config.epochSeconds = 60; }  },
+                    {"5 min", [&]() { survey_config.epochSeconds = 300; } },
+                    {"15 min", [&]() { survey_config.epochSeconds = 900; }},
+                };
+                loopOptions(options);
+                break;
+            case 6:
+                options = {
+                    {"CSV",     [&]() { survey_config.logCsv = true, survey_config.logBinary = false; }},
+                    {"Binary",  [&]() { survey_config.logCsv = false, survey_config.logBinary = true; }},
+                    {"CSV+Bin", [&]() { survey_config.logCsv = true, survey_config.logBinary = true; } },
+                    {"Off",     [&]() { survey_config.logCsv = false, survey_config.logBinary = false; }},
+                };
+                loopOptions(options);
+                break;
+        }
+        options.clear();
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef __RF_SURVEY_H__
+#define __RF_SURVEY_H__
+
+#include "rf_utils.h"
+#include <FS.h>
+#include <atomic>
+#include <vector>
+
+struct RfSurveyRange {
+    float start; // MHz, inclusive
+    float stop;
+};
+
+struct RfSurveyConfig {
+    std::vector<RfSurveyRange> ranges;
+    float stepMHz = 0.1;
+    int8_t busyThreshold = -85; // dBm, a bin above it counts as occupied for that sweep
+    uint16_t epochSeconds = 60; // statistics window, one log record per window
+    bool logCsv = true;         // bins that went above the threshold, easy to read
+    bool logBinary = false;     // every bin of every epoch, compact
+};
+
+// Statistics of one bin over one epoch
+struct RfSurveyBinStats {
+    int8_t min; // dBm
+    int8_t avg;
+    int8_t max;
+    uint8_t duty; // % of the sweeps above the threshold
+};
+
+// Background sub-GHz occupancy survey. A task hops the CC1101 over every bin using calibration
+// values measured once at start, so each retune skips the ~800us frequency synthesizer
+// calibration. Finished epochs are kept in a ring and appended to the logs from the UI task.
+class RfSurvey {
+public:
+    explicit RfSurvey(const RfSurveyConfig &config);
+    ~RfSurvey();
+
+    bool begin(FS *fs);
+    void end();
+    // Writes the epochs finished since the last call, returns how many were written
+    size_t flushLogs();
+
+    size_t bins() const { return binFreqs.size(); }
+    float binFrequency(size_t bin) const { return binFreqs[bin]; }
+    uint32_t sweeps() const { return totalSweeps; }
+    float sweepRate() const; // sweeps per second since begin
+    size_t epochCount() const { return min<uint32_t>(epochHead.load(), depth); }
+    // Finished epoch, 0 is the newest, nullptr if it fell out of the ring
+    const RfSurveyBinStats *epoch(size_t age) const;
+    // Sweeps above the threshold since begin
+    uint32_t busySweeps(size_t bin) const { return totalBusy[bin]; }
+    uint32_t lostEpochs() const { return lost; }
+    String logName() const { return logBase; }
+
+private:
+    struct Calibration {
+        uint8_t freq[3];  // FREQ2..FREQ0
+        uint8_t fscal[3]; // FSCAL3..FSCAL1
+        uint8_t test0;
+    };
+    struct Accumulator {
+        int8_t min;
+        int8_t max;
+        uint16_t busy;
+        int32_t sum;
+    };
+    struct EpochInfo {
+        uint32_t timestamp; // unix time if the clock is set, else seconds since boot
+        uint16_t sweeps;
+    };
+
+    RfSurveyConfig config;
+    std::vector<float> binFreqs;
+    Calibration *cal = nullptr;
+    Accumulator *acc = nullptr;
+    uint32_t *totalBusy = nullptr;
+    RfSurveyBinStats *ring = nullptr; // depth epochs of bins() stats
+    EpochInfo *epochs = nullptr;
+    uint32_t depth = 0;
+    std::atomic<uint32_t> epochHead{0}; // epochs finished
+    uint32_t epochWritten = 0;
+    uint32_t lost = 0;
+    uint16_t epochSweeps = 0;
+    uint32_t epochStart = 0;
+    volatile uint32_t totalSweeps = 0;
+    uint32_t startMs = 0;
+    uint16_t settleUs = 0;
+    uint8_t savedMcsm0 = 0;
+    bool radioReady = false; // calibrated, end() restores MCSM0 and releases the module
+
+    TaskHandle_t task = NULL;
+    SemaphoreHandle_t exited = NULL;
+    volatile bool stopping = false;
+
+    FS *fs = nullptr;
+    File csv;
+    File bin;
+    String logBase;
+
+    void calibrate();
+    int8_t measure(size_t bin, uint8_t &lastTest0);
+    void rollEpoch();
+    bool openLogs();
+    void writeEpoch(uint32_t index);
+    static void sweepTask(void *pvParameters);
+};
+
+void rf_survey();
+
+#endif
@@ -1,5 +1,6 @@
 #include "rf_utils.h"
 #include "core/settings.h"
+#include "core/spi_bus.h"
 
 // CRC-64-ECMA constants
 const uint64_t CRC64_ECMA_POLY = 0x42F0E1EBA9EA3693; // Polynomial for CRC-64-ECMA
@@ -88,28 +89,19 @@ bool initRfModule(String mode, float frequency) {
     if (!frequency) frequency = bruceConfigPins.rfFreq;
 
     if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) { // CC1101 in use
-        if (bruceConfigPins.CC1101_bus.mosi == (gpio_num_t)TFT_MOSI &&
-            bruceConfigPins.CC1101_bus.mosi != GPIO_NUM_NC) { // (T_EMBED), CORE2 and others
-#if TFT_MOSI > 0
-            initCC1101once(&tft.getSPIinstance());
-#else
-            yield();
-#endif
-        } else if (bruceConfigPins.CC1101_bus.mosi ==
-                   bruceConfigPins.SDCARD_bus.mosi) { // (CARDPUTER) and (ESP32S3DEVKITC1) and devices that
-                                                      // share CC1101 pin with only SDCard
-            initCC1101once(&sdcardSPI);
-        } else if (bruceConfigPins.NRF24_bus.mosi == bruceConfigPins.CC1101_bus.mosi &&
-                   bruceConfigPins.CC1101_bus.mosi !=
-                       bruceConfigPins.SDCARD_bus
-                           .mosi) { // This board uses the same Bus for NRF and CC1101, but with
-                                    // different CS pins, different from Stick_Cs down below..
-            CC_NRF_SPI.begin(
-                bruceConfigPins.CC1101_bus.sck,
-                bruceConfigPins.CC1101_bus.miso,
-                bruceConfigPins.CC1101_bus.mosi
-            );
-            initCC1101once(&CC_NRF_SPI);
+        if (!((frequency >= 280 && frequency <= 350) || (frequency >= 387 && frequency <= 468) ||
+              (frequency >= 779 && frequency <= 928))) {
+            Serial.println("Invalid Frequency, setting default");
+            frequency = 433.92;
+            displayWarning("Wrong freq, set to 433.92", true);
+        }
+
+        // Shares the TFT, SD or NRF24 bus when wired to it
+        SPIClass *shared = spiArbiter.bus(SpiDevice::CC1101);
+        // Setup and the switch to TX/RX in one go, the warning above waits for a key outside of it
+        SpiGuard bus(SpiDevice::CC1101);
+        if (shared) {
+            initCC1101once(shared);
         } else {
             // (STICK_C_PLUS) || (STICK_C_PLUS2) and others that doesn´t share SPI with other devices (need to
             // change it when Bruce board comes to shore)
@@ -133,12 +125,6 @@ bool initRfModule(String mode, float frequency) {
         // ELECHOUSE_cc1101.setSidle();
         // Serial.println("cc1101 setSidle();");
 
-        if (!((frequency >= 280 && frequency <= 350) || (frequency >= 387 && frequency <= 468) ||
-              (frequency >= 779 && frequency <= 928))) {
-            Serial.println("Invalid Frequency, setting default");
-            frequency = 433.92;
-            displayWarning("Wrong freq, set to 433.92", true);
-        }
         // else
         // ELECHOUSE_cc1101.setRxBW(812.50);  // reset to default
         ELECHOUSE_cc1101.setRxBW(256);      // narrow band for better accuracy
@@ -204,6 +190,7 @@ bool initRfModule(String mode, float frequency) {
 
 void deinitRfModule() {
     if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) {
+        SpiGuard bus(SpiDevice::CC1101);
         if (cc1101_spi_ready) {
             ELECHOUSE_cc1101.setSidle();
             cc1101_spi_ready = false;
@@ -271,10 +258,16 @@ void setMHZ(float frequency) {
             vTaskDelay(10 / portTICK_PERIOD_MS); // time to settle the antenna signal
         }
 #endif
+        SpiGuard bus(SpiDevice::CC1101);
         ELECHOUSE_cc1101.setMHZ(frequency);
     }
 }
 
+int getCC1101Rssi() {
+    SpiGuard bus(SpiDevice::CC1101);
+    return ELECHOUSE_cc1101.getRssi();
+}
+
 int find_pulse_index(const std::vector<int> &indexed_durations, int duration) {
     int abs_duration = abs(duration);
     int closest_index = -1;
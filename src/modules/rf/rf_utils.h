@@ -23,6 +23,8 @@ void deinitRfModule();
 void initCC1101once(SPIClass *SSPI);
 
 void setMHZ(float frequency);
+// CC1101 RSSI in dBm, read with its SPI bus held
+int getCC1101Rssi();
 int find_pulse_index(const std::vector<int> &indexed_durations, int duration);
 uint64_t crc64_ecma(const std::vector<int> &data);
 
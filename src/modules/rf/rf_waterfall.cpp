@@ -1,4 +1,5 @@
 #include "rf_waterfall.h"
+#include "core/spi_bus.h"
 #ifndef TFT_MOSI
 #define TFT_MOSI -1
 #endif
@@ -15,7 +16,10 @@ void rf_waterfall() {
         return;
     }
 
-    ELECHOUSE_cc1101.setRxBW(200);
+    {
+        SpiGuard bus(SpiDevice::CC1101);
+        ELECHOUSE_cc1101.setRxBW(200);
+    }
     int option, idx = 0;
 select:
 
@@ -118,15 +122,11 @@ void rf_waterfall_run() {
         for (int i = 0; i < screen_width; ++i) {
             float f_freq = f_start + i * f_freq_step;
             setMHZ(f_freq);
-            // To make sure CC1101 shared with TFT works properly on T-Embed
-            if (bruceConfigPins.CC1101_bus.mosi == TFT_MOSI) {
-                tft.drawPixel(0, 0, 0);
-                delayMicroseconds(150); // T-Embed case, need more time to process
-            } else delayMicroseconds(100);
-
-            int i_rssi = ELECHOUSE_cc1101.getRssi();
-            // To make sure CC1101 shared with TFT works properly on T-Embed
-            if (bruceConfigPins.CC1101_bus.mosi == TFT_MOSI) tft.drawPixel(0, 0, 0);
+            // T-Embed case, the CC1101 shares the TFT bus and needs more time to settle
+            if (bruceConfigPins.CC1101_bus.mosi == TFT_MOSI) delayMicroseconds(150);
+            else delayMicroseconds(100);
+
+            int i_rssi = getCC1101Rssi();
             if (i_rssi > temp_max_rssi) {
                 temp_max_rssi = i_rssi;
                 temp_max_freq = f_freq;
@@ -173,7 +173,6 @@ void rf_waterfall_run() {
                 delay(100);
             }
         }
-        tft.drawPixel(0, 0, 0); // Cardputer Case, need to call something to the tft.
         tft.pushImage(0, current_line, screen_width, 1, frameBuffer);
         tft.drawFastHLine(0, current_line + 1, screen_width, TFT_DARKGREY);
 
@@ -1,75 +1,60 @@
 #include "save.h"
-bool rf_raw_save(RawRecording recorded) {
-    FS *fs = nullptr;
-    if (!getFsStorage(fs) || fs == nullptr) {
-        displayError("No space left on device", true);
+
+bool RawDataWriter::begin(FS *fs, const String &path, float frequency) {
+    len = 0;
+    values = 0;
+    written = 0;
+    error = false;
+    file = fs->open(path, FILE_WRITE, true);
+    if (!file) {
+        error = true;
         return false;
     }
+    len = snprintf(
+        buf,
+        sizeof(buf),
+        "Filetype: Bruce SubGhz File\nVersion 1\nFrequency: %d\nPreset: 0\nProtocol: RAW\nRAW_Data: ",
+        (int)(frequency * 1000000)
+    );
+    return true;
+}
 
-    char filename[32];
-    int index = 0;
-
-    if (!fs->exists("/BruceRF")) {
-        if (!fs->mkdir("/BruceRF")) {
-            displayError("Error creating directory", true);
-            return false;
-        }
+void RawDataWriter::add(int32_t duration) {
+    if (duration == 0 || error) return; // nothing is written after a failure
+    // Room for a value and a line break
+    if (len + 24 > sizeof(buf)) flush();
+    len += snprintf(buf + len, sizeof(buf) - len, "%ld ", (long)duration);
+    values++;
+    if (values % 512 == 0) {
+        memcpy(buf + len, "\nRAW_Data: ", 11);
+        len += 11;
     }
+}
 
-    do { snprintf(filename, sizeof(filename), "/BruceRF/raw_%d.sub", index++); } while (fs->exists(filename));
-
-    File file = fs->open(filename, FILE_WRITE, true);
-    if (!file) {
-        displayError("Error creating file", true);
+bool RawDataWriter::flush(bool sync) {
+    if (!file || error) {
+        len = 0; // the buffer can not be written, keep it from filling up
         return false;
     }
-
-    file.write((const uint8_t *)"Filetype: Bruce SubGhz File\n", 28);
-    file.write((const uint8_t *)"Version 1\n", 10);
-
-    char line[64];
-    int len = snprintf(line, sizeof(line), "Frequency: %d\n", (int)(recorded.frequency * 1000000));
-    file.write((const uint8_t *)line, len);
-
-    file.write((const uint8_t *)"Preset: 0\n", 10);
-    file.write((const uint8_t *)"Protocol: RAW\n", 14);
-    file.write((const uint8_t *)"RAW_Data: ", 10);
-
-    uint16_t values = 0;
-    for (size_t i = 0; i < recorded.codes.size(); ++i) {
-        size_t count = recorded.codeLengths[i];
-        for (size_t j = 0; j < count; ++j) {
-            // RAW_Data must keep maximun 512 values per line
-            // https://github.com/flipperdevices/flipperzero-firmware/blob/dev/documentation/file_formats/SubGhzFileFormats.md#raw-files
-            // check after each addition
-            auto &code = recorded.codes[i][j];
-            if (code.duration0 > 0) {
-                if (code.level0 != 1) file.write((const uint8_t *)"-", 1);
-                len = snprintf(line, sizeof(line), "%d ", code.duration0);
-                file.write((const uint8_t *)line, len);
-                values++;
-                if (values % 512 == 0) file.write((const uint8_t *)"\nRAW_Data: ", 11);
-            }
-            if (code.duration1 > 0) {
-                if (code.level1 != 1) file.write((const uint8_t *)"-", 1);
-                len = snprintf(line, sizeof(line), "%d ", code.duration1);
-                file.write((const uint8_t *)line, len);
-                values++;
-                if (values % 512 == 0) file.write((const uint8_t *)"\nRAW_Data: ", 11);
-            }
-        }
-
-        if (i < recorded.codes.size() - 1) {
-            len = snprintf(line, sizeof(line), "%d ", (int)(recorded.gaps[i] * -1000));
-            file.write((const uint8_t *)line, len);
-            values++;
-            if (values % 512 == 0) file.write((const uint8_t *)"\nRAW_Data: ", 11);
-        }
-
-        file.flush();
+    if (len > 0) {
+        if (file.write((const uint8_t *)buf, len) != len) error = true;
+        written += len;
+        len = 0;
     }
+    if (sync) file.flush();
+    return !error;
+}
 
+void RawDataWriter::end() {
+    if (!file) return;
+    if (len < sizeof(buf)) buf[len++] = '\n';
+    flush();
     file.close();
-    displaySuccess(filename, true);
-    return true;
+}
+
+String rf_raw_next_filename(FS *fs) {
+    char filename[32];
+    int index = 0;
+    do { snprintf(filename, sizeof(filename), "/BruceRF/raw_%d.sub", index++); } while (fs->exists(filename));
+    return String(filename);
 }
@@ -1,6 +1,29 @@
 #ifndef RF_SAVE_H
 #define RF_SAVE_H
 #include "structs.h"
+#include <FS.h>
 
-bool rf_raw_save(RawRecording recorded);
+// Writes a RAW .sub file incrementally, RAW_Data lines keep at most 512 values
+// https://github.com/flipperdevices/flipperzero-firmware/blob/dev/documentation/file_formats/SubGhzFileFormats.md#raw-files
+class RawDataWriter {
+public:
+    bool begin(FS *fs, const String &path, float frequency);
+    // Positive values are high levels, negative values are low levels or gaps, in microseconds
+    void add(int32_t duration);
+    // Writes the buffered text, sync also commits it to the card
+    bool flush(bool sync = false);
+    void end();
+    uint32_t bytesWritten() { return written; }
+    bool failed() { return error; }
+
+private:
+    File file;
+    char buf[2048];
+    size_t len = 0;
+    uint32_t values = 0;
+    uint32_t written = 0;
+    bool error = false;
+};
+
+String rf_raw_next_filename(FS *fs);
 #endif
@@ -5,13 +5,6 @@
 #include <driver/rmt_rx.h>
 #include <driver/rmt_tx.h>
 
-struct RawRecording {
-    float frequency;
-    std::vector<rmt_symbol_word_t *> codes;
-    std::vector<uint16_t> codeLengths;
-    std::vector<uint16_t> gaps;
-};
-
 struct RawRecordingStatus {
     float frequency = 0.f;
     int rssiCount = 0;  // Counter for the number of RSSI readings
@@ -21,6 +14,10 @@ struct RawRecordingStatus {
     unsigned long firstSignalTime = 0; // Store the time of the latest signal
     unsigned long lastSignalTime = 0;  // Store the time of the latest signal
     unsigned long lastRssiUpdate = 0;
+    uint32_t bursts = 0;       // bursts written to the capture file
+    uint32_t dropped = 0;      // bursts lost because the writer fell behind
+    uint32_t bytesWritten = 0; // size of the capture file
+    String decoded = "";        // last frame recognized by the protocol decoders
 };
 struct RfCodes {
     uint32_t frequency = 0;
@@ -108,19 +108,19 @@ void PN532KillerTools::playDeviceDetectedSound() {
 #elif defined(HAS_NS4168_SPKR)
     // Try to play a detection sound file, fallback to startup sound if not available
     if (SD.exists("/device_detected.wav")) {
-        playAudioFile(&SD, "/device_detected.wav");
+        playAudioFile(&SD, "/device_detected.wav", true);
     } else if (LittleFS.exists("/device_detected.wav")) {
-        playAudioFile(&LittleFS, "/device_detected.wav");
+        playAudioFile(&LittleFS, "/device_detected.wav", true);
     } else {
         // Fallback to startup sound logic
         if (bruceConfig.theme.boot_sound) {
             playAudioFile(
-                bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.boot_sound)
+                bruceConfig.themeFS(), bruceConfig.getThemeItemImg(bruceConfig.theme.paths.boot_sound), true
             );
         } else if (SD.exists("/boot.wav")) {
-            playAudioFile(&SD, "/boot.wav");
+            playAudioFile(&SD, "/boot.wav", true);
         } else if (LittleFS.exists("/boot.wav")) {
-            playAudioFile(&LittleFS, "/boot.wav");
+            playAudioFile(&LittleFS, "/boot.wav", true);
         }
     }
 #endif
@@ -139,9 +139,9 @@ void PN532KillerTools::playUidFoundSound() {
 #elif defined(HAS_NS4168_SPKR)
     // Try to play a UID found sound file, fallback to tone simulation
     if (SD.exists("/uid_found.wav")) {
-        playAudioFile(&SD, "/uid_found.wav");
+        playAudioFile(&SD, "/uid_found.wav", true);
     } else if (LittleFS.exists("/uid_found.wav")) {
-        playAudioFile(&LittleFS, "/uid_found.wav");
+        playAudioFile(&LittleFS, "/uid_found.wav", true);
     } else {
         // No specific sound file, play a simple tone pattern
         playTone(800, 100);
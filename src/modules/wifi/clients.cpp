@@ -1,8 +1,6 @@
 #ifndef LITE_VERSION
 // SSH borrowed from https://github.com/m5stack/M5Cardputer :)
 
-// TODO: Display is kinda glitchy :P figure out some way to show better outputs also
-
 // SSH libs
 #include "libssh_esp32.h"
 #include <libssh/libssh.h>
@@ -11,6 +9,7 @@
 #include "clients.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include "core/terminal_view.h"
 #include "core/wifi/wifi_common.h"
 #include <Arduino.h>
 #include <esp_event.h>
@@ -29,12 +28,6 @@ String ssh_port = "";
 String ssh_password = "";
 char *ssh_port_char;
 
-String commandBuffer = "> ";
-int cursorY = 0;
-const int lineHeight = 32; // 32
-unsigned long lastKeyPressMillis = 0;
-const unsigned long debounceDelay = 200; // Adjust debounce delay as needed
-
 // ssh_bind sshbind = (ssh_bind)state->input;
 
 // ssh_init sshbind;
@@ -51,8 +44,6 @@ char *stringTochar(String s) {
     return arr;
 }
 
-bool filterAnsiSequences = true; // Set to false to disable ANSI sequence filtering
-
 void ssh_setup(String host) {
     if (!wifiConnected) wifiConnectMenu();
 
@@ -102,11 +93,9 @@ void ssh_setup(String host) {
 }
 
 void ssh_loop(void *pvParameters) {
-    String message = "";
     tft.setTextSize(FP);
     tft.fillScreen(bruceConfig.bgColor);
     tft.setCursor(0, 0);
-    cursorY = tft.getCursorY();
     log_d("BEFORE SSH");
     my_ssh_session = ssh_new();
     log_d("AFTER SSH");
@@ -166,7 +155,10 @@ void ssh_loop(void *pvParameters) {
         return;
     }
 
-    if (ssh_channel_request_pty(channel_ssh) != SSH_OK) {
+    // The server formats for our grid
+    if (ssh_channel_request_pty_size(
+            channel_ssh, "xterm", TerminalView::fitColumns(), TerminalView::fitRows()
+        ) != SSH_OK) {
         tft.setTextColor(TFT_RED, bruceConfig.bgColor);
         displayError("SSH PTY request error.", true);
         log_d("SSH PTY request error.");
@@ -193,112 +185,14 @@ void ssh_loop(void *pvParameters) {
     }
 
     log_d("SSH setup completed.");
-    tft.fillScreen(bruceConfig.bgColor);
-    tft.setTextColor(TFT_WHITE, bruceConfig.bgColor);
-    tft.setTextSize(FP);
-    char buffer[1024];
-    int nbytes;
-    keyStroke key;
-    while (1) {
-#ifdef HAS_KEYBOARD
-        key = _getKeyPress();
-        if (key.pressed) {
-            unsigned long currentMillis = millis();
-            if (currentMillis - lastKeyPressMillis >= debounceDelay) {
-                lastKeyPressMillis = currentMillis;
-                for (auto i : key.word) {
-                    commandBuffer += i;
-                    tft.print(i);
-                    cursorY = tft.getCursorY();
-                }
-                if (key.del && commandBuffer.length() > 2) {
-                    commandBuffer.remove(commandBuffer.length() - 1);
-                    tft.setCursor(tft.getCursorX() - 6, tft.getCursorY());
-                    tft.setTextColor(TFT_GREEN, bruceConfig.bgColor);
-                    tft.print(" ");
-                    tft.setCursor(tft.getCursorX() - 6, tft.getCursorY());
-                    cursorY = tft.getCursorY();
-                } else if (key.enter) {
-                    tft.setTextColor(TFT_GREEN);
-                    commandBuffer.trim();
-                    if (commandBuffer.substring(2) == "cls") {
-                        tft.fillScreen(bruceConfig.bgColor);
-                        tft.setCursor(0, 0);
-                        tft.print("> ");
-                        commandBuffer = "> ";
-                    } else {
-                        String message =
-                            commandBuffer.substring(2) + "\r"; // Get the command part, exclude the "> "
-                        ssh_channel_write(channel_ssh, message.c_str(), message.length()); // Send the command
-                    }
-                    cursorY = tft.getCursorY(); // Update cursor position
-                    if (cursorY > tftHeight) {
-                        tft.setCursor(0, tftHeight - 10);
-                        tft.fillRect(0, tftHeight - 11, tftWidth, 11, bruceConfig.bgColor);
-                    }
-                }
-            }
-        }
-
-#else
-        if (check(SelPress)) {
-
-            while (check(SelPress)) { yield(); } // timerless debounce
-            message = keyboard("cls", 76, "SSH Command: ");
-            while (check(SelPress)) { yield(); } // timerless debounce
-            if (message == "cls") {
-                tft.fillScreen(bruceConfig.bgColor);
-                tft.setCursor(0, 0);
-                tft.print("> ");
-            } else {
-                message += "\r";
-                ssh_channel_write(channel_ssh, message.c_str(), message.length()); // Send the command
-                log_d("%s", message);
-            }
-
-            commandBuffer = "> " + message;
-            tft.setCursor(0, 0);
-            tft.setTextSize(FP);
-        }
-
-#endif
-
-        // Read data from SSH server and display it, handling ANSI sequences
-        nbytes = ssh_channel_read_nonblocking(channel_ssh, buffer, sizeof(buffer), 0);
-
-        if (nbytes > 0) {
-            String msg = "";
-            tft.setTextColor(TFT_WHITE);
-            for (int i = 0; i < nbytes; ++i) {
-                msg += char(buffer[i]);
-                if (buffer[i] == '\r') continue; // Ignore carriage return
-                tft.write(buffer[i]);
-                if (tft.getCursorY() > tftHeight) {
-                    tft.fillScreen(bruceConfig.bgColor);
-                    tft.setCursor(0, 0);
-                    tft.setTextColor(TFT_GREEN);
-                    tft.print(commandBuffer); // Move to the next line on display
-                    tft.setTextColor(TFT_WHITE);
-                }
-                cursorY = tft.getCursorY();
-            }
-            log_d("%s", msg);
-
-            cursorY = tft.getCursorY(); // Update cursor position
-            if (cursorY > tftHeight) {
-                tft.setCursor(0, tftHeight - 10);
-                tft.fillRect(0, tftHeight - 11, tftWidth, 11, bruceConfig.bgColor);
-            }
-            commandBuffer = "> "; // Reset command buffer
-            tft.setTextColor(TFT_GREEN);
-        }
+    TerminalSession session;
+    session.receive = [](uint8_t *buffer, size_t size) -> int {
+        if (ssh_channel_is_closed(channel_ssh) || ssh_channel_is_eof(channel_ssh)) return -1;
+        return ssh_channel_read_nonblocking(channel_ssh, buffer, size, 0);
+    };
+    session.send = [](const uint8_t *data, size_t length) { ssh_channel_write(channel_ssh, data, length); };
+    session.run();
 
-        // Handle channel closure and other conditions
-        if (nbytes < 0 || ssh_channel_is_closed(channel_ssh)) {
-            log_d("Encerrando");
-            break;
-        }
-    }
     // Clean Up
     ssh_channel_close(channel_ssh);
     ssh_channel_free(channel_ssh);
@@ -326,6 +220,110 @@ int telnet_server_port;
 
 static int sock;
 
+#define TELNET_IAC 255
+#define TELNET_DONT 254
+#define TELNET_DO 253
+#define TELNET_WONT 252
+#define TELNET_WILL 251
+#define TELNET_SB 250
+#define TELNET_SE 240
+#define TELNET_OPT_ECHO 1
+#define TELNET_OPT_SGA 3
+#define TELNET_OPT_TTYPE 24
+#define TELNET_OPT_NAWS 31
+
+// Telnet option negotiation (RFC 854/855), answered inline so only data reaches the terminal.
+// Echo and suppress go ahead are accepted, window size and terminal type are offered.
+struct TelnetFilter {
+    enum State : uint8_t { Data, Iac, Verb, Sub, SubIac } state = Data;
+    uint8_t verb = 0;
+    std::vector<uint8_t> sub;
+    std::vector<uint8_t> reply;
+    bool remoteEcho = false;
+
+    void answer(uint8_t v, uint8_t option) {
+        reply.insert(reply.end(), {TELNET_IAC, v, option});
+        if (v == TELNET_WILL && option == TELNET_OPT_NAWS) {
+            uint16_t cols = TerminalView::fitColumns(), rows = TerminalView::fitRows();
+            reply.insert(
+                reply.end(),
+                {TELNET_IAC,
+                 TELNET_SB,
+                 TELNET_OPT_NAWS,
+                 (uint8_t)(cols >> 8),
+                 (uint8_t)cols,
+                 (uint8_t)(rows >> 8),
+                 (uint8_t)rows,
+                 TELNET_IAC,
+                 TELNET_SE}
+            );
+        }
+    }
+
+    void negotiate(uint8_t option) {
+        if (verb == TELNET_WILL) {
+            bool accept = option == TELNET_OPT_ECHO || option == TELNET_OPT_SGA;
+            if (option == TELNET_OPT_ECHO) remoteEcho = true;
+            answer(accept ? TELNET_DO : TELNET_DONT, option);
+        } else if (verb == TELNET_WONT) {
+            if (option == TELNET_OPT_ECHO) remoteEcho = false;
+        } else if (verb == TELNET_DO) {
+            bool accept = option == TELNET_OPT_SGA || option == TELNET_OPT_NAWS || option == TELNET_OPT_TTYPE;
+            answer(accept ? TELNET_WILL : TELNET_WONT, option);
+        }
+    }
+
+    void subnegotiation() {
+        // TTYPE SEND -> TTYPE IS "XTERM"
+        if (sub.size() >= 2 && sub[0] == TELNET_OPT_TTYPE && sub[1] == 1) {
+            reply.insert(reply.end(), {TELNET_IAC, TELNET_SB, TELNET_OPT_TTYPE, 0, 'X', 'T', 'E', 'R', 'M'});
+            reply.insert(reply.end(), {TELNET_IAC, TELNET_SE});
+        }
+        sub.clear();
+    }
+
+    // Strips the commands from buffer in place, returns the data left
+    int filter(uint8_t *buffer, int length) {
+        int out = 0;
+        for (int i = 0; i < length; i++) {
+            uint8_t c = buffer[i];
+            switch (state) {
+                case Data:
+                    if (c == TELNET_IAC) state = Iac;
+                    else buffer[out++] = c;
+                    break;
+                case Iac:
+                    state = Data;
+                    if (c == TELNET_IAC) buffer[out++] = c; // escaped 255
+                    else if (c == TELNET_SB) state = Sub;
+                    else if (c >= TELNET_WILL && c <= TELNET_DONT) {
+                        verb = c;
+                        state = Verb;
+                    }
+                    break;
+                case Verb:
+                    negotiate(c);
+                    state = Data;
+                    break;
+                case Sub:
+                    if (c == TELNET_IAC) state = SubIac;
+                    else if (sub.size() < 64) sub.push_back(c);
+                    break;
+                case SubIac:
+                    if (c == TELNET_SE) {
+                        subnegotiation();
+                        state = Data;
+                    } else {
+                        if (sub.size() < 64) sub.push_back(c);
+                        state = Sub;
+                    }
+                    break;
+            }
+        }
+        return out;
+    }
+};
+
 void telnet_loop() {
     struct sockaddr_in dest_addr;
     dest_addr.sin_addr.s_addr = inet_addr(telnet_server_ip);
@@ -351,44 +349,38 @@ void telnet_loop() {
     }
 
     Serial.println("Connected to TELNET server");
-    tft.setTextColor(TFT_GREEN, bruceConfig.bgColor);
-    displayTextLine("Connected to TELNET server");
-    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
-    tft.fillScreen(bruceConfig.bgColor);
-    tft.setCursor(0, 0);
 
-    String commandInput;
-
-    while (1) {
-        tft.print("> ");
-        // waitForInput(commandInput);
-        commandInput = keyboard("", 76, "COMMAND");
-        const char *command = commandInput.c_str();
-        send(sock, command, strlen(command), 0);
-
-        // You can also receive data from the server
-        char buffer[128];
-        int len = recv(sock, buffer, sizeof(buffer) - 1, 0);
-        if (len > 0) {
-            buffer[len] = '\0';
-            // Check for Telnet negotiation commands (IAC)
-            /*
-if (buffer[0] == 0xFF) {
-    // Skip Telnet negotiation command
-    continue;
-}
-*/
-            tft.setTextColor(TFT_WHITE, bruceConfig.bgColor);
-            Serial.printf("Received from server %s\n", buffer);
-            // tft.printf("Received from server %s\n", buffer);
-            for (int i = 0; i < len; i++) { Serial.printf("%02X ", buffer[i]); }
-            tft.printf("%s\n", buffer);
-
-            tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    TelnetFilter telnet;
+    TerminalSession session;
+    session.enter = "\r\n";
+    session.localEcho = true; // until the server offers to echo
+    session.receive = [&](uint8_t *buffer, size_t size) -> int {
+        int len = recv(sock, buffer, size, MSG_DONTWAIT);
+        if (len == 0) return -1;
+        if (len < 0) return errno == EWOULDBLOCK || errno == EAGAIN ? 0 : -1;
+        len = telnet.filter(buffer, len);
+        if (!telnet.reply.empty()) {
+            send(sock, telnet.reply.data(), telnet.reply.size(), 0);
+            telnet.reply.clear();
+        }
+        session.localEcho = !telnet.remoteEcho;
+        return len;
+    };
+    session.send = [](const uint8_t *data, size_t length) {
+        // A data byte 255 has to be doubled
+        std::vector<uint8_t> out;
+        for (size_t i = 0; i < length; i++) {
+            out.push_back(data[i]);
+            if (data[i] == TELNET_IAC) out.push_back(TELNET_IAC);
         }
+        send(sock, out.data(), out.size(), 0);
+    };
+    session.run();
 
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-    }
+    close(sock);
+    Serial.println("TELNET session closed");
+    displayWarning("TELNET session closed.", true);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
 }
 
 void telnet_setup() {
@@ -404,8 +396,6 @@ void telnet_setup() {
     tft.setRotation(bruceConfigPins.rotation);
     tft.setTextSize(1); // Set text size
 
-    cursorY = tft.getCursorY();
-
     tft.setCursor(0, 0);
     // tft.print("TELNET Host: \n");
 
@@ -40,6 +40,7 @@
 #include <SPI.h>
 #include <SdFat.h>
 #endif
+#include "modules/wifi/sniffer_stats.h"
 #include "modules/wifi/wifi_atks.h" // to use deauth frames and cmds
 
 //===== SETTINGS =====//
@@ -49,6 +50,7 @@
 #define HOP_INTERVAL 214            // in ms (only necessary if channelHopping is true)
 #define DEAUTH_INTERVAL (15 * 1000) // Send deauth packets every ms
 #define EAPOL_ONLY true
+#define STATS_INTERVAL (10 * 1000) // append the statistics to the log every ms
 
 //===== Run-Time variables =====//
 unsigned long lastTime = 0;
@@ -803,6 +805,7 @@ void sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
     FrameInfo frameInfo = analyzeFrame(pkt);
     if (!frameInfo.valid) { return; }
     if (frameInfo.isEapol) { num_EAPOL++; }
+    snifferStats.record(pkt, frameInfo.isEapol ? classifyEapolMessage(pkt) : -1, frameInfo.ssid);
 
     bool saveRaw = rawCaptureEnabled();
     bool saveHandshake =
@@ -951,6 +954,7 @@ void sniffer_setup() {
     String FileSys = "LittleFS";
     bool deauth = false;
     unsigned long lastLittleFsCheck = 0;
+    unsigned long lastStatsFlush = 0;
     start_time = millis();
     drawMainBorderWithTitle("pcap sniffer");
     lastRedraw = millis();
@@ -972,6 +976,8 @@ void sniffer_setup() {
         return;
     }
 
+    if (!snifferStats.begin(Fs)) Serial.println("Sniffer stats: could not open the database");
+
     SnifferMode startMode = sniffer_full_mode_available() ? SnifferMode::Full : SnifferMode::HandshakesOnly;
     sniffer_set_mode(startMode);
 
@@ -1156,6 +1162,11 @@ void sniffer_setup() {
             clearScreen = true;
         }
 
+        if ((currentTime - lastStatsFlush) > STATS_INTERVAL) {
+            snifferStats.flush();
+            lastStatsFlush = currentTime;
+        }
+
         // perform stale-beacon cleanup every 5s
         if ((currentTime - lastBeaconCleanup) > 5000) {
             cleanupStaleBeacons();
@@ -1296,6 +1307,7 @@ Exit:
     esp_wifi_set_promiscuous_rx_cb(NULL);
     esp_wifi_deinit();
     sniffer_wait_for_flush(1000);
+    snifferStats.end();
     closeRawFile();
     closeDeauthFile();
     wifiDisconnect();
@@ -0,0 +1,530 @@
+#include "sniffer_stats.h"
+#include "core/sd_functions.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+#include <SD.h>
+#include <globals.h>
+#include <time.h>
+
+#define SNIFFER_STATS_TMP SNIFFER_STATS_DIR "/stats.tmp"
+#define SNIFFER_STATS_VERSION 1
+#define SNIFFER_STATS_CAPACITY 256 // slots, 3/4 usable, ~24kB
+#define SNIFFER_STATS_CAPACITY_PSRAM 4096
+#define SNIFFER_STATS_COUNTED_BITS 32768 // 4kB, under 1% false positives for 2000 MACs
+
+struct __attribute__((packed)) SnifferStatsHeader {
+    char magic[4]; // "BSSI" index, "BSSL" log
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t generation; // a log only belongs to the index of the same generation
+};
+
+SnifferStats snifferStats;
+
+/*********************************************************************
+**  Helpers
+*********************************************************************/
+int sniffer_stats_channel_bit(uint8_t channel) {
+    if (channel >= 1 && channel <= 14) return channel - 1;
+    if (channel >= 36 && channel <= 64) return 14 + (channel - 36) / 4;
+    if (channel >= 100 && channel <= 144) return 22 + (channel - 100) / 4;
+    if (channel >= 149 && channel <= 177) return 34 + (channel - 149) / 4;
+    return -1;
+}
+
+uint8_t sniffer_stats_bit_channel(int bit) {
+    if (bit < 14) return bit + 1;
+    if (bit < 22) return 36 + (bit - 14) * 4;
+    if (bit < 34) return 100 + (bit - 22) * 4;
+    return 149 + (bit - 34) * 4;
+}
+
+String sniffer_stats_channels(uint64_t channels) {
+    String list;
+    for (int bit = 0; bit < 64; bit++) {
+        if (!(channels & (1ULL << bit))) continue;
+        if (list.length()) list += ',';
+        list += String(sniffer_stats_bit_channel(bit));
+    }
+    return list;
+}
+
+FS *sniffer_stats_fs() {
+    if (snifferStats.active()) return snifferStats.storage();
+    if (setupSdCard()) return &SD;
+    return &LittleFS;
+}
+
+static uint64_t statsKey(const uint8_t *mac) {
+    uint64_t key = 0;
+    for (int i = 0; i < 6; ++i) key = (key << 8) | mac[i];
+    return key;
+}
+
+static void resetCounters(SnifferStatsRecord &r) {
+    r.eapol = 0;
+    r.sessions = 0;
+    r.frames = 0;
+    r.eapolFrames = 0;
+    r.rssiSum = 0;
+    r.rssiMin = INT8_MAX;
+    r.rssiMax = INT8_MIN;
+    r.channels = 0;
+    r.firstSeen = 0;
+    r.lastSeen = 0;
+}
+
+static void merge(SnifferStatsRecord &into, const SnifferStatsRecord &from) {
+    if (from.kind == (uint8_t)SnifferStatsKind::AP) into.kind = from.kind; // a MAC that beacons is an AP
+    if (statsKey(from.bssid) != 0) memcpy(into.bssid, from.bssid, 6);
+    if (from.ssid[0] != '\0') memcpy(into.ssid, from.ssid, sizeof(into.ssid));
+    into.eapol |= from.eapol;
+    into.sessions += from.sessions;
+    into.frames += from.frames;
+    into.eapolFrames += from.eapolFrames;
+    into.rssiSum += from.rssiSum;
+    into.rssiMin = min(into.rssiMin, from.rssiMin);
+    into.rssiMax = max(into.rssiMax, from.rssiMax);
+    into.channels |= from.channels;
+    if (from.firstSeen && (!into.firstSeen || from.firstSeen < into.firstSeen)) {
+        into.firstSeen = from.firstSeen;
+    }
+    into.lastSeen = max(into.lastSeen, from.lastSeen);
+}
+
+static bool readHeader(File &file, const char *magic, uint32_t &generation) {
+    SnifferStatsHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header)) return false;
+    if (memcmp(header.magic, magic, 4) != 0 || header.version != SNIFFER_STATS_VERSION ||
+        header.recordSize != sizeof(SnifferStatsRecord)) {
+        return false;
+    }
+    generation = header.generation;
+    return true;
+}
+
+static bool writeHeader(File &file, const char *magic, uint32_t generation) {
+    SnifferStatsHeader header;
+    memcpy(header.magic, magic, 4);
+    header.version = SNIFFER_STATS_VERSION;
+    header.recordSize = sizeof(SnifferStatsRecord);
+    header.generation = generation;
+    return file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+}
+
+// Generation of the index, finishes a compaction interrupted between remove and rename
+static uint32_t indexGeneration(FS &fs) {
+    if (fs.exists(SNIFFER_STATS_TMP)) {
+        if (fs.exists(SNIFFER_STATS_INDEX)) fs.remove(SNIFFER_STATS_TMP); // incomplete
+        else fs.rename(SNIFFER_STATS_TMP, SNIFFER_STATS_INDEX);
+    }
+    uint32_t generation = 0;
+    File index = fs.open(SNIFFER_STATS_INDEX, FILE_READ);
+    if (index && !readHeader(index, "BSSI", generation)) generation = 0;
+    if (index) index.close();
+    return generation;
+}
+
+static bool createLog(FS &fs, uint32_t generation) {
+    if (!fs.exists(SNIFFER_STATS_DIR)) fs.mkdir(SNIFFER_STATS_DIR);
+    File log = fs.open(SNIFFER_STATS_LOG, FILE_WRITE);
+    if (!log) return false;
+    bool ok = writeHeader(log, "BSSL", generation);
+    log.close();
+    return ok;
+}
+
+/*********************************************************************
+**  Table
+*********************************************************************/
+bool SnifferStats::Table::alloc() {
+    capacity = psramFound() ? SNIFFER_STATS_CAPACITY_PSRAM : SNIFFER_STATS_CAPACITY;
+    entries = (Entry *)heap_caps_calloc(capacity, sizeof(Entry), MALLOC_CAP_SPIRAM);
+    if (!entries) entries = (Entry *)calloc(capacity, sizeof(Entry));
+    used = 0;
+    return entries != nullptr;
+}
+
+void SnifferStats::Table::release() {
+    free(entries);
+    entries = nullptr;
+    capacity = used = 0;
+}
+
+void SnifferStats::Table::clear() {
+    memset(entries, 0, capacity * sizeof(Entry));
+    used = 0;
+}
+
+// The low bytes of a MAC are the ones that differ between devices of a vendor
+static size_t homeSlot(uint64_t key, size_t mask) { return (key * 2654435761u) & mask; }
+
+SnifferStats::Entry *SnifferStats::Table::find(const uint8_t *mac, bool create) {
+    uint64_t key = statsKey(mac);
+    size_t mask = capacity - 1;
+    for (size_t i = homeSlot(key, mask);; i = (i + 1) & mask) {
+        Entry &e = entries[i];
+        if (e.key == key) return &e;
+        if (e.key != 0) continue;
+        if (!create || (used + 1) * 4 > capacity * 3) return nullptr;
+        e.key = key;
+        e.flag = false;
+        memset(&e.rec, 0, sizeof(e.rec));
+        memcpy(e.rec.mac, mac, 6);
+        resetCounters(e.rec);
+        used++;
+        return &e;
+    }
+}
+
+void SnifferStats::Table::erase(size_t slot) {
+    size_t mask = capacity - 1;
+    // Moves back the following entries that may live in the freed slot
+    for (size_t j = (slot + 1) & mask; entries[j].key != 0; j = (j + 1) & mask) {
+        size_t home = homeSlot(entries[j].key, mask);
+        if (((j - home) & mask) >= ((j - slot) & mask)) {
+            entries[slot] = entries[j];
+            slot = j;
+        }
+    }
+    entries[slot].key = 0;
+    used--;
+}
+
+/*********************************************************************
+**  Session
+*********************************************************************/
+bool SnifferStats::ensureLocks() {
+    // Kept for the whole run, a query may race with the end of a session
+    if (!tableLock) tableLock = xSemaphoreCreateMutex();
+    if (!fileLock) fileLock = xSemaphoreCreateMutex();
+    return tableLock && fileLock;
+}
+
+// True the first time a MAC is written to the log in this session
+bool SnifferStats::countSession(uint64_t key) {
+    uint32_t a = (key * 2654435761u) % SNIFFER_STATS_COUNTED_BITS;
+    uint32_t b = ((key >> 16) * 40503u + key) % SNIFFER_STATS_COUNTED_BITS;
+    bool seen = (counted[a / 32] >> (a % 32) & 1) && (counted[b / 32] >> (b % 32) & 1);
+    counted[a / 32] |= 1u << (a % 32);
+    counted[b / 32] |= 1u << (b % 32);
+    return !seen;
+}
+
+bool SnifferStats::begin(FS *fs) {
+    if (active()) return true;
+    if (!fs || !ensureLocks()) return false;
+    counted = (uint32_t *)calloc(SNIFFER_STATS_COUNTED_BITS / 32, sizeof(uint32_t));
+    if (!counted) return false;
+    if (!table.alloc()) {
+        free(counted);
+        counted = nullptr;
+        return false;
+    }
+
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    // A session that did not end cleanly is still in the log
+    compact(*fs, table);
+    table.clear();
+    bool ok = createLog(*fs, indexGeneration(*fs));
+    xSemaphoreGive(fileLock);
+    if (!ok) {
+        table.release();
+        free(counted);
+        counted = nullptr;
+        return false;
+    }
+    this->fs = fs;
+    droppedFrames = 0;
+    return true;
+}
+
+void SnifferStats::end() {
+    if (!active()) return;
+    flush();
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    xSemaphoreTake(tableLock, portMAX_DELAY);
+    table.clear();
+    compact(*fs, table);
+    table.release();
+    free(counted);
+    counted = nullptr;
+    xSemaphoreGive(tableLock);
+    xSemaphoreGive(fileLock);
+    fs = nullptr;
+}
+
+static void account(SnifferStatsRecord &r, int8_t rssi, uint8_t channel, uint32_t now) {
+    r.frames++;
+    r.rssiSum += rssi;
+    r.rssiMin = min(r.rssiMin, rssi);
+    r.rssiMax = max(r.rssiMax, rssi);
+    int bit = sniffer_stats_channel_bit(channel);
+    if (bit >= 0) r.channels |= 1ULL << bit;
+    if (now) {
+        if (!r.firstSeen) r.firstSeen = now;
+        r.lastSeen = now;
+    }
+}
+
+void SnifferStats::record(const wifi_promiscuous_pkt_t *pkt, int eapolMsg, const String &ssid) {
+    if (!active() || pkt->rx_ctrl.sig_len < 24) return;
+
+    const uint8_t *frame = pkt->payload;
+    const uint8_t type = (frame[0] & 0x0C) >> 2;
+    if (type == 1) return; // control frames, no reliable transmitter address
+    const uint8_t *addr1 = frame + 4;
+    const uint8_t *addr2 = frame + 10; // transmitter, the RSSI is its own
+    const uint8_t *addr3 = frame + 16;
+    if (addr2[0] & 0x01) return; // group address, corrupted frame
+
+    const uint8_t *bssid = addr3;
+    if (type == 2) {
+        switch (frame[1] & 0x03) { // ToDS/FromDS
+            case 0: bssid = addr3; break;
+            case 1: bssid = addr1; break;
+            case 2: bssid = addr2; break;
+            default: return; // WDS
+        }
+    }
+    const bool isAp = memcmp(addr2, bssid, 6) == 0;
+    const bool bssidKnown = !(bssid[0] & 0x01); // probe requests are sent to the broadcast BSSID
+    const uint32_t now = clock_set ? (uint32_t)time(nullptr) : 0;
+
+    if (xSemaphoreTake(tableLock, 0) != pdTRUE) { // flush() is copying the table
+        droppedFrames++;
+        return;
+    }
+    if (!active()) { // ended while we waited
+        xSemaphoreGive(tableLock);
+        return;
+    }
+    Entry *tx = table.find(addr2, true);
+    if (tx) {
+        SnifferStatsRecord &r = tx->rec;
+        r.kind = (uint8_t)(isAp ? SnifferStatsKind::AP : SnifferStatsKind::Client);
+        if (bssidKnown) memcpy(r.bssid, bssid, 6);
+        if (isAp && ssid.length() > 0) strlcpy(r.ssid, ssid.c_str(), sizeof(r.ssid));
+        account(r, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel, now);
+        if (eapolMsg >= 1 && eapolMsg <= 4) {
+            r.eapol |= 1 << (eapolMsg - 1);
+            r.eapolFrames++;
+        }
+    } else {
+        droppedFrames++;
+    }
+    // Handshake coverage is reported per network, messages 2 and 4 come from the client
+    if (eapolMsg >= 1 && eapolMsg <= 4 && !isAp && bssidKnown) {
+        Entry *ap = table.find(bssid, true);
+        if (ap) {
+            ap->rec.kind = (uint8_t)SnifferStatsKind::AP;
+            memcpy(ap->rec.bssid, bssid, 6);
+            ap->rec.eapol |= 1 << (eapolMsg - 1);
+            ap->rec.eapolFrames++;
+        }
+    }
+    xSemaphoreGive(tableLock);
+}
+
+bool SnifferStats::flush() {
+    if (!active()) return false;
+    std::vector<SnifferStatsRecord> dirty;
+    dirty.reserve(table.used + 16); // no allocation while the sniffer callback waits
+
+    xSemaphoreTake(tableLock, portMAX_DELAY);
+    for (size_t i = 0; i < table.capacity && dirty.size() < dirty.capacity(); i++) {
+        Entry &e = table.entries[i];
+        if (e.key == 0 || (e.rec.frames == 0 && e.rec.eapolFrames == 0)) continue;
+        dirty.push_back(e.rec);
+        // The filter remembers the MACs that were evicted since
+        dirty.back().sessions = e.flag || !countSession(e.key) ? 0 : 1;
+        e.flag = true;
+        resetCounters(e.rec);
+    }
+    // What was flushed is in the log now, free the slots for the devices still to come
+    for (size_t i = 0; i < table.capacity; i++) {
+        while (table.entries[i].key != 0 && table.entries[i].flag && table.entries[i].rec.frames == 0 &&
+               table.entries[i].rec.eapolFrames == 0) {
+            table.erase(i);
+        }
+    }
+    xSemaphoreGive(tableLock);
+    if (dirty.empty()) return true;
+
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    File log = fs->open(SNIFFER_STATS_LOG, FILE_APPEND);
+    size_t bytes = dirty.size() * sizeof(SnifferStatsRecord);
+    bool ok = log && log.write((const uint8_t *)dirty.data(), bytes) == bytes;
+    if (log) log.close();
+    xSemaphoreGive(fileLock);
+    if (!ok) Serial.println("Sniffer stats: could not append to " SNIFFER_STATS_LOG);
+    return ok;
+}
+
+/*********************************************************************
+**  Storage
+*********************************************************************/
+// Sums the log records from byte pos on into a table, false if the log does not belong to that
+// index. When the table fills up, more is set and pos is left on the first record not summed.
+bool SnifferStats::replayLog(FS &fs, uint32_t generation, Table &into, size_t &pos, bool &more) {
+    more = false;
+    File log = fs.open(SNIFFER_STATS_LOG, FILE_READ);
+    if (!log) return false;
+    uint32_t logGeneration;
+    if (!readHeader(log, "BSSL", logGeneration) || logGeneration != generation) {
+        log.close();
+        return false;
+    }
+    if (pos < sizeof(SnifferStatsHeader)) pos = sizeof(SnifferStatsHeader);
+    log.seek(pos);
+    SnifferStatsRecord r;
+    while (log.read((uint8_t *)&r, sizeof(r)) == sizeof(r)) {
+        Entry *e = into.find(r.mac, true);
+        if (!e) {
+            more = true;
+            break;
+        }
+        merge(e->rec, r);
+        pos += sizeof(r);
+    }
+    log.close();
+    return true;
+}
+
+// Rewrites the log in as many passes over the index as the table needs, then drops it. A pass
+// moves the index to the next generation, the rest of the log goes stale if it is interrupted.
+bool SnifferStats::compact(FS &fs, Table &scratch) {
+    uint32_t generation = indexGeneration(fs);
+    size_t pos = 0;
+    bool more = true;
+    while (more) {
+        scratch.clear();
+        if (!replayLog(fs, generation, scratch, pos, more)) break; // stale or missing
+        if (scratch.used == 0) break;
+        if (!rewriteIndex(fs, scratch)) return false; // keep the log, the next session retries
+    }
+    if (fs.exists(SNIFFER_STATS_LOG)) fs.remove(SNIFFER_STATS_LOG);
+    return true;
+}
+
+// Writes the index again with the records of a table merged in
+bool SnifferStats::rewriteIndex(FS &fs, Table &scratch) {
+    uint32_t generation = indexGeneration(fs);
+    if (!fs.exists(SNIFFER_STATS_DIR)) fs.mkdir(SNIFFER_STATS_DIR);
+    File tmp = fs.open(SNIFFER_STATS_TMP, FILE_WRITE);
+    if (!tmp || !writeHeader(tmp, "BSSI", generation + 1)) {
+        if (tmp) tmp.close();
+        return false;
+    }
+    bool ok = true;
+    SnifferStatsRecord r;
+    File index = fs.open(SNIFFER_STATS_INDEX, FILE_READ);
+    uint32_t unused;
+    if (index && readHeader(index, "BSSI", unused)) {
+        while (ok && index.read((uint8_t *)&r, sizeof(r)) == sizeof(r)) {
+            Entry *e = scratch.find(r.mac, false);
+            if (e) {
+                merge(r, e->rec);
+                e->flag = true;
+            }
+            ok = tmp.write((const uint8_t *)&r, sizeof(r)) == sizeof(r);
+        }
+    }
+    if (index) index.close();
+    for (size_t i = 0; ok && i < scratch.capacity; i++) {
+        const Entry &e = scratch.entries[i];
+        if (e.key == 0 || e.flag) continue;
+        ok = tmp.write((const uint8_t *)&e.rec, sizeof(e.rec)) == sizeof(e.rec);
+    }
+    tmp.close();
+    if (!ok) {
+        fs.remove(SNIFFER_STATS_TMP);
+        return false;
+    }
+    fs.remove(SNIFFER_STATS_INDEX);
+    fs.rename(SNIFFER_STATS_TMP, SNIFFER_STATS_INDEX);
+    return true;
+}
+
+static bool ranksBefore(const SnifferStatsRecord &a, const SnifferStatsRecord &b, SnifferStatsSort sort) {
+    switch (sort) {
+        case SnifferStatsSort::Rssi: return a.rssiMax > b.rssiMax;
+        case SnifferStatsSort::LastSeen: return a.lastSeen > b.lastSeen;
+        default: return a.frames > b.frames;
+    }
+}
+
+static void offer(
+    std::vector<SnifferStatsRecord> &best, const SnifferStatsRecord &r, SnifferStatsSort sort, size_t n
+) {
+    if (best.size() == n && !ranksBefore(r, best.back(), sort)) return;
+    auto it = std::upper_bound(best.begin(), best.end(), r, [&](const auto &a, const auto &b) {
+        return ranksBefore(a, b, sort);
+    });
+    best.insert(it, r);
+    if (best.size() > n) best.pop_back();
+}
+
+std::vector<SnifferStatsRecord>
+SnifferStats::top(FS &fs, SnifferStatsKind kind, SnifferStatsSort sort, size_t n) {
+    std::vector<SnifferStatsRecord> best;
+    if (n == 0 || !ensureLocks()) return best;
+    if (active() && &fs == this->fs) flush();
+
+    // The index is streamed, only the log is held in memory
+    Table scratch;
+    if (!scratch.alloc()) return best;
+    best.reserve(n + 1);
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    size_t pos = 0;
+    bool more = false;
+    replayLog(fs, indexGeneration(fs), scratch, pos, more);
+    if (more) {
+        // The log holds more devices than the table, fold it into the index and query that alone
+        compact(fs, scratch);
+        scratch.clear();
+        if (active() && &fs == this->fs && !fs.exists(SNIFFER_STATS_LOG)) createLog(fs, indexGeneration(fs));
+    }
+
+    SnifferStatsRecord r;
+    File index = fs.open(SNIFFER_STATS_INDEX, FILE_READ);
+    uint32_t unused;
+    if (index && readHeader(index, "BSSI", unused)) {
+        while (index.read((uint8_t *)&r, sizeof(r)) == sizeof(r)) {
+            Entry *e = scratch.find(r.mac, false);
+            if (e) {
+                merge(r, e->rec);
+                e->flag = true;
+            }
+            if (r.kind == (uint8_t)kind) offer(best, r, sort, n);
+        }
+    }
+    if (index) index.close();
+    xSemaphoreGive(fileLock);
+
+    for (size_t i = 0; i < scratch.capacity; i++) {
+        const Entry &e = scratch.entries[i];
+        if (e.key != 0 && !e.flag && e.rec.kind == (uint8_t)kind) offer(best, e.rec, sort, n);
+    }
+    scratch.release();
+    return best;
+}
+
+bool SnifferStats::clear(FS &fs) {
+    if (!ensureLocks()) return false;
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    fs.remove(SNIFFER_STATS_TMP);
+    fs.remove(SNIFFER_STATS_INDEX);
+    fs.remove(SNIFFER_STATS_LOG);
+    bool ok = true;
+    if (active() && &fs == this->fs) {
+        // The session goes on in an empty database
+        xSemaphoreTake(tableLock, portMAX_DELAY);
+        for (size_t i = 0; i < table.capacity; i++) table.entries[i].flag = false;
+        memset(counted, 0, SNIFFER_STATS_COUNTED_BITS / 8);
+        xSemaphoreGive(tableLock);
+        ok = createLog(fs, 0);
+    }
+    xSemaphoreGive(fileLock);
+    return ok;
+}
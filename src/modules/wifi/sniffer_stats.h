@@ -0,0 +1,109 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_wifi_types.h>
+#include <vector>
+
+// Aggregated sniffer statistics, kept across sessions.
+// The current session is counted in RAM and appended as delta records to a log every few seconds,
+// when the session ends the log is merged into the index, which holds one record per MAC. The RAM
+// table only keeps the MACs heard since the last flush, so a session has no limit on devices.
+#define SNIFFER_STATS_DIR "/BrucePCAP"
+#define SNIFFER_STATS_INDEX SNIFFER_STATS_DIR "/stats.idx"
+#define SNIFFER_STATS_LOG SNIFFER_STATS_DIR "/stats.log"
+
+enum class SnifferStatsKind : uint8_t {
+    AP,
+    Client,
+};
+
+enum class SnifferStatsSort : uint8_t {
+    Frames,
+    Rssi,     // strongest first
+    LastSeen, // most recent first
+};
+
+struct __attribute__((packed)) SnifferStatsRecord {
+    uint8_t mac[6];
+    uint8_t bssid[6]; // network of a client, zeros if only seen probing
+    uint8_t kind;     // SnifferStatsKind
+    uint8_t eapol;    // bit n-1 set when EAPOL message n was seen
+    uint16_t sessions;
+    uint32_t frames;
+    uint32_t eapolFrames;
+    int64_t rssiSum;
+    int8_t rssiMin;
+    int8_t rssiMax;
+    uint64_t channels;  // see sniffer_stats_channel_bit()
+    uint32_t firstSeen; // unix time, 0 when the clock was not set
+    uint32_t lastSeen;
+    char ssid[33];
+
+    int8_t rssiAvg() const { return frames ? rssiSum / (int64_t)frames : 0; }
+};
+
+class SnifferStats {
+public:
+    // Merges what a previous session left in the log and starts counting
+    bool begin(FS *fs);
+    // Writes the session and merges it into the index
+    void end();
+    bool active() const { return table.entries != nullptr; }
+
+    // Called from the promiscuous callback, never blocks
+    void record(const wifi_promiscuous_pkt_t *pkt, int eapolMsg, const String &ssid);
+    // Appends what changed since the last call to the log
+    bool flush();
+
+    size_t size() const { return table.used; }
+    uint32_t dropped() const { return droppedFrames; } // busy table or table full
+    FS *storage() const { return fs; }
+
+    // Top n records of a kind, session in progress included
+    std::vector<SnifferStatsRecord> top(FS &fs, SnifferStatsKind kind, SnifferStatsSort sort, size_t n);
+    bool clear(FS &fs);
+
+private:
+    struct Entry {
+        uint64_t key; // 0 = empty slot
+        // Session table: the session was counted in the log. Scratch table: merged into an index record
+        bool flag;
+        SnifferStatsRecord rec;
+    };
+    // Open addressing on the MAC, never holds more than 3/4 of its capacity
+    struct Table {
+        Entry *entries = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+
+        bool alloc();
+        void release();
+        void clear();
+        Entry *find(const uint8_t *mac, bool create);
+        // Empties a slot without breaking the probe sequences that run through it
+        void erase(size_t slot);
+    };
+
+    Table table;
+    uint32_t *counted = nullptr; // bloom filter of the MACs whose session is in the log
+    volatile uint32_t droppedFrames = 0;
+    SemaphoreHandle_t tableLock = NULL; // record() vs flush()
+    SemaphoreHandle_t fileLock = NULL;  // log and index
+    FS *fs = nullptr;
+
+    bool ensureLocks();
+    bool countSession(uint64_t key);
+    bool replayLog(FS &fs, uint32_t generation, Table &into, size_t &pos, bool &more);
+    bool rewriteIndex(FS &fs, Table &scratch);
+    bool compact(FS &fs, Table &scratch);
+};
+
+extern SnifferStats snifferStats;
+
+// Bit of a channel in SnifferStatsRecord::channels, -1 if unknown
+int sniffer_stats_channel_bit(uint8_t channel);
+uint8_t sniffer_stats_bit_channel(int bit);
+// "1,6,11"
+String sniffer_stats_channels(uint64_t channels);
+// SD if there is a card, LittleFS otherwise, the sniffer storage while it runs
+FS *sniffer_stats_fs();
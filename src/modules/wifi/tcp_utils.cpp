@@ -1,14 +1,124 @@
-// TODO: Be able to read bytes from server in background/task
-//       so there is no loss of data when inputing
 #include "modules/wifi/tcp_utils.h"
+#include "core/display.h"
+#include "core/sd_functions.h"
+#include "core/terminal_view.h"
 #include "core/wifi/wifi_common.h"
+#include "modules/wifi/tcp_worker.h"
+
+struct TcpSessionOptions {
+    bool hex = false;
+    bool log = false;
+};
+
+// Hex dump of a stream that arrives in pieces, 8 bytes per line with their ASCII
+class HexFormatter {
+public:
+    // out needs room for 5 characters per byte, returns the text length
+    size_t format(const uint8_t *data, size_t length, char *out) {
+        static const char digits[] = "0123456789ABCDEF";
+        size_t o = 0;
+        for (size_t i = 0; i < length; i++) {
+            uint8_t b = data[i];
+            out[o++] = digits[b >> 4];
+            out[o++] = digits[b & 0x0F];
+            out[o++] = ' ';
+            ascii[column++] = b >= 0x20 && b < 0x7F ? b : '.';
+            if (column == 8) {
+                memcpy(out + o, ascii, 8);
+                o += 8;
+                out[o++] = '\r';
+                out[o++] = '\n';
+                column = 0;
+            }
+        }
+        return o;
+    }
+
+private:
+    char ascii[8];
+    int column = 0;
+};
+
+static bool tcpSessionOptions(TcpSessionOptions &opts) {
+    int idx = 0;
+    while (true) {
+        int option = -1;
+        std::vector<Option> options = {
+            {"Start",                                          [&]() { option = 0; }},
+            {String("View: ") + (opts.hex ? "Hex" : "Text"), [&]() { option = 1; }},
+            {String("Log: ") + (opts.log ? "On" : "Off"),    [&]() { option = 2; }},
+        };
+        idx = loopOptions(options, idx);
+        if (option == -1 || returnToMenu) return false;
+        if (option == 0) return true;
+        if (option == 1) opts.hex = !opts.hex;
+        if (option == 2) opts.log = !opts.log;
+    }
+}
+
+static File openSessionLog() {
+    FS *fs = nullptr;
+    if (!getFsStorage(fs) || fs == nullptr) return File();
+    if (!fs->exists("/BruceTCP")) fs->mkdir("/BruceTCP");
+    char filename[32];
+    int index = 0;
+    do {
+        snprintf(filename, sizeof(filename), "/BruceTCP/session_%d.bin", index++);
+    } while (fs->exists(filename));
+    return fs->open(filename, FILE_WRITE, true);
+}
 
-bool inputMode;
+// Terminal over a plain TCP connection, raw TCP peers do not echo what is typed
+static bool tcpTerminal(WiFiClient &client, const TcpSessionOptions &opts) {
+    TcpWorker worker;
+    if (!worker.begin(client.fd())) {
+        worker.end();
+        displayError("Fail to start session", true);
+        return true;
+    }
+    File log;
+    if (opts.log) log = openSessionLog();
+
+    TerminalSession session;
+    String peer = "Connected to " + client.remoteIP().toString() + ":" + String(client.remotePort()) + "\r\n";
+    session.term.write(peer.c_str());
+    if (opts.log && !log) session.term.write("Could not open the log file\r\n");
+    session.localEcho = !opts.hex;
+    session.enter = "\n";
+    HexFormatter hex;
+    uint8_t raw[96];
+    session.receive = [&](uint8_t *buffer, size_t size) -> int {
+        // The hex view takes 5 characters per byte at most
+        int n = worker.read(opts.hex ? raw : buffer, opts.hex ? min(sizeof(raw), size / 5) : size);
+        if (n <= 0) return n;
+        const uint8_t *data = opts.hex ? raw : buffer;
+        if (log) log.write(data, n);
+        Serial.write(data, n);
+        return opts.hex ? hex.format(raw, n, (char *)buffer) : n;
+    };
+    session.send = [&](const uint8_t *data, size_t length) {
+        worker.write(data, length);
+        Serial.write(data, length);
+    };
+    bool left = session.run();
+    worker.end();
+    if (log) log.close();
+
+    // Throughput, e.g. against a local echo server
+    uint32_t ms = max<uint32_t>(worker.elapsedMs(), 1);
+    Serial.printf(
+        "TCP session: %lu bytes in (%lu B/s), %lu bytes out, %lu dropped\n",
+        (unsigned long)worker.received(),
+        (unsigned long)((uint64_t)worker.received() * 1000 / ms),
+        (unsigned long)worker.sent(),
+        (unsigned long)worker.dropped()
+    );
+    return left;
+}
 
 void listenTcpPort() {
     if (!wifiConnected) wifiConnectMenu();
 
-    WiFiClient tcpClient;
     tft.fillScreen(TFT_BLACK);
     tft.setTextSize(1);
     tft.setTextColor(TFT_WHITE, TFT_BLACK);
@@ -23,55 +133,45 @@ void listenTcpPort() {
         displayError("Invalid port number, exiting");
         return;
     }
+    TcpSessionOptions opts;
+    if (!tcpSessionOptions(opts)) return;
 
     WiFiServer server(portNumberInt);
     server.begin();
 
-    tft.println("Listening...");
-    tft.print(WiFi.localIP().toString().c_str());
-    tft.println(":" + portNumber);
-
+    bool redraw = true;
     for (;;) {
+        if (redraw) {
+            tft.fillScreen(TFT_BLACK);
+            tft.setCursor(0, 0);
+            tft.setTextColor(TFT_WHITE, TFT_BLACK);
+            tft.println("Listening...");
+            tft.print(WiFi.localIP().toString().c_str());
+            tft.println(":" + portNumber);
+            redraw = false;
+        }
+
         WiFiClient client = server.accept(); // Wait for a client to connect
 
         if (client) {
             Serial.println("Client connected");
-            tft.println("Client connected");
-
-            while (client.connected()) {
-                if (inputMode) {
-                    String keyString = keyboard("", 16, "send input data, q=quit");
-                    if (keyString == "q") {
-                        displayError("Exiting Listener");
-                        client.stop();
-                        server.stop();
-                        return;
-                    }
-                    inputMode = false;
-                    tft.fillScreen(TFT_BLACK);
-                    tft.setCursor(0, 0);
-                    if (keyString.length() > 0) {
-                        client.print(keyString); // Send the entire string to the client
-                        Serial.print(keyString);
-                    }
-                } else {
-                    if (client.available()) {
-                        char incomingChar = client.read(); // Read one byte at time from the client
-                        tft.print(incomingChar);
-                        Serial.print(incomingChar);
-                    }
-                    if (check(SelPress)) { inputMode = true; }
-                }
-            }
+            bool left = tcpTerminal(client, opts);
             client.stop();
+            if (left) {
+                displayError("Exiting Listener");
+                server.stop();
+                return;
+            }
             Serial.println("Client disconnected");
             displayError("Client disconnected");
+            redraw = true;
         }
         if (check(EscPress)) {
             displayError("Exiting Listener");
             server.stop();
             break;
         }
+        delay(10);
     }
 }
 
@@ -86,6 +186,8 @@ void clientTCP() {
         displayError("Invalid IP or Port");
         return;
     }
+    TcpSessionOptions opts;
+    if (!tcpSessionOptions(opts)) return;
 
     WiFiClient client;
     if (!client.connect(serverIP.c_str(), portNumber)) {
@@ -93,39 +195,10 @@ void clientTCP() {
         return;
     }
 
-    tft.fillScreen(TFT_BLACK);
-    tft.setTextSize(1);
-    tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.println("Connected to:");
-    tft.println(serverIP + ":" + portString);
     Serial.println("Connected to server");
+    bool left = tcpTerminal(client, opts);
 
-    while (client.connected()) {
-        if (inputMode) {
-            String keyString = keyboard("", 16, "send input data");
-            inputMode = false;
-            tft.fillScreen(TFT_BLACK);
-            tft.setCursor(0, 0);
-            if (keyString.length() > 0) {
-                client.print(keyString);
-                Serial.print(keyString);
-            }
-        } else {
-            if (client.available()) {
-                char incomingChar = client.read();
-                tft.print(incomingChar);
-                Serial.print(incomingChar);
-            }
-            if (check(SelPress)) { inputMode = true; }
-        }
-        if (check(EscPress)) {
-            displayError("Exiting Client");
-            client.stop();
-            break;
-        }
-    }
-
-    displayError("Connection closed.");
+    displayError(left ? "Exiting Client" : "Connection closed.");
     Serial.println("Connection closed.");
     client.stop();
 }
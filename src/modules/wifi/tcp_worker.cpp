@@ -0,0 +1,172 @@
+#include "tcp_worker.h"
+#include <errno.h>
+#include <string.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <lwip/sockets.h>
+#else
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+using std::min;
+#endif
+
+#define TCP_RX_RING (16 * 1024)
+#define TCP_RX_RING_PSRAM (64 * 1024)
+
+static uint32_t nowMs() {
+#ifdef ARDUINO
+    return millis();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#endif
+}
+
+bool TcpWorker::begin(int socketFd) {
+    fd = socketFd;
+#ifdef ARDUINO
+    rxSize = psramFound() ? TCP_RX_RING_PSRAM : TCP_RX_RING;
+    rx = (uint8_t *)(psramFound() ? ps_malloc(rxSize) : malloc(rxSize));
+    exited = xSemaphoreCreateBinary();
+    if (!exited) return false;
+#else
+    rxSize = TCP_RX_RING_PSRAM;
+    rx = (uint8_t *)malloc(rxSize);
+#endif
+    tx = (uint8_t *)malloc(TCP_TX_RING);
+    startMs = nowMs();
+    if (fd < 0 || !rx || !tx) return false;
+#ifdef ARDUINO
+    if (xTaskCreate(task, "TcpWorker", 4096, this, 2, NULL) != pdPASS) return false;
+#else
+    thread = std::thread(task, this);
+#endif
+    running = true;
+    return true;
+}
+
+void TcpWorker::end() {
+    if (running) {
+        stopping = true;
+#ifdef ARDUINO
+        xSemaphoreTake(exited, portMAX_DELAY);
+#else
+        thread.join();
+#endif
+        running = false;
+    }
+    free(rx);
+    free(tx);
+    rx = tx = nullptr;
+#ifdef ARDUINO
+    if (exited) vSemaphoreDelete(exited);
+    exited = NULL;
+#endif
+}
+
+int TcpWorker::read(uint8_t *buffer, size_t size) {
+    // closed first: the task publishes the last bytes before it sets it, so a close seen here
+    // means the head read below already holds everything
+    bool peerClosed = closed.load(std::memory_order_acquire);
+    uint32_t t = rxTail.load(std::memory_order_relaxed);
+    uint32_t available = rxHead.load(std::memory_order_acquire) - t;
+    if (available == 0) return peerClosed ? -1 : 0;
+    size_t offset = t % rxSize;
+    size_t n = min<size_t>(min<size_t>(available, size), rxSize - offset);
+    memcpy(buffer, rx + offset, n);
+    rxTail.store(t + n, std::memory_order_release);
+    return n;
+}
+
+void TcpWorker::write(const uint8_t *data, size_t length) {
+    uint32_t h = txHead.load(std::memory_order_relaxed);
+    // Nothing queued means the task is not sending: send now rather than after its select() round,
+    // which only ends on incoming data or the timeout. What the socket does not take is queued.
+    if (h == txTail.load(std::memory_order_acquire) && !closed.load(std::memory_order_relaxed)) {
+        int put = send(fd, data, length, MSG_DONTWAIT);
+        if (put > 0) {
+            txBytes += put;
+            data += put;
+            length -= put;
+        }
+    }
+    uint32_t space = TCP_TX_RING - (h - txTail.load(std::memory_order_acquire));
+    if (length > space) {
+        txDropped += length - space;
+        length = space;
+    }
+    for (size_t i = 0; i < length; i++) tx[(h + i) % TCP_TX_RING] = data[i];
+    txHead.store(h + length, std::memory_order_release);
+}
+
+uint32_t TcpWorker::elapsedMs() const { return nowMs() - startMs; }
+
+void TcpWorker::task(void *pvParameters) {
+    TcpWorker *self = (TcpWorker *)pvParameters;
+    self->run();
+#ifdef ARDUINO
+    xSemaphoreGive(self->exited);
+    vTaskDelete(NULL);
+#endif
+}
+
+void TcpWorker::run() {
+    while (!stopping && !closed.load(std::memory_order_relaxed)) {
+        uint32_t rh = rxHead.load(std::memory_order_relaxed);
+        uint32_t rxSpace = rxSize - (rh - rxTail.load(std::memory_order_acquire));
+        uint32_t tt = txTail.load(std::memory_order_relaxed);
+        uint32_t txPending = txHead.load(std::memory_order_acquire) - tt;
+
+        // A full receive ring stops reading, the TCP window then slows the peer down
+        fd_set readSet, writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        if (rxSpace > 0) FD_SET(fd, &readSet);
+        if (txPending > 0) FD_SET(fd, &writeSet);
+        if (rxSpace == 0 && txPending == 0) {
+            // Waits for the reader with the shortest sleep, it empties a full ring much faster than 10 ms
+#ifdef ARDUINO
+            vTaskDelay(1);
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+            continue;
+        }
+        // With a full receive ring the socket is not watched for reading, so come back soon to see
+        // whether the reader made room
+        struct timeval timeout = {0, rxSpace == 0 ? 1000 : 20000};
+        int ready = select(fd + 1, &readSet, &writeSet, NULL, &timeout);
+        if (ready < 0) {
+            closed.store(true, std::memory_order_release);
+            break;
+        }
+
+        if (FD_ISSET(fd, &readSet)) {
+            size_t offset = rh % rxSize;
+            size_t n = min<size_t>(rxSpace, rxSize - offset);
+            int got = recv(fd, rx + offset, n, MSG_DONTWAIT);
+            if (got > 0) {
+                rxHead.store(rh + got, std::memory_order_release);
+                rxBytes += got;
+            } else if (got == 0 || (errno != EWOULDBLOCK && errno != EAGAIN)) {
+                closed.store(true, std::memory_order_release);
+            }
+        }
+        if (FD_ISSET(fd, &writeSet)) {
+            size_t offset = tt % TCP_TX_RING;
+            size_t n = min<size_t>(txPending, TCP_TX_RING - offset);
+            int put = send(fd, tx + offset, n, MSG_DONTWAIT);
+            if (put > 0) {
+                txTail.store(tt + put, std::memory_order_release);
+                txBytes += put;
+            } else if (put < 0 && errno != EWOULDBLOCK && errno != EAGAIN) {
+                closed.store(true, std::memory_order_release);
+            }
+        }
+    }
+}
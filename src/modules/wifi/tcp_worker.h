@@ -0,0 +1,63 @@
+#ifndef __TCP_WORKER_H__
+#define __TCP_WORKER_H__
+
+// Only depends on BSD sockets (lwIP on the device) and a task or a thread, so it also builds on a
+// POSIX host against a local echo server.
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#else
+#include <thread>
+#endif
+
+#define TCP_TX_RING 4096
+
+// Owns the socket of a connected WiFiClient while the session runs. A task moves data between the
+// socket and two rings, so receiving never waits for the screen or the keyboard and sending never
+// waits for the network. Each ring has one producer and one consumer.
+class TcpWorker {
+public:
+    bool begin(int socketFd);
+    // Stops the task, the socket stays open for its owner
+    void end();
+
+    // Received bytes, 0 when there are none, -1 once the peer closed and everything was read
+    int read(uint8_t *buffer, size_t size);
+    // Sends or queues data for the socket without blocking, what does not fit is dropped and counted
+    void write(const uint8_t *data, size_t length);
+
+    uint32_t received() const { return rxBytes; }
+    uint32_t sent() const { return txBytes; }
+    uint32_t dropped() const { return txDropped; }
+    uint32_t elapsedMs() const;
+
+private:
+    int fd = -1;
+    uint8_t *rx = nullptr;
+    size_t rxSize = 0;
+    std::atomic<uint32_t> rxHead{0};
+    std::atomic<uint32_t> rxTail{0};
+    uint8_t *tx = nullptr;
+    std::atomic<uint32_t> txHead{0};
+    std::atomic<uint32_t> txTail{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> closed{false}; // set after the last received bytes were published
+    bool running = false;
+#ifdef ARDUINO
+    SemaphoreHandle_t exited = NULL;
+#else
+    std::thread thread;
+#endif
+    std::atomic<uint32_t> rxBytes{0};
+    std::atomic<uint32_t> txBytes{0};
+    std::atomic<uint32_t> txDropped{0};
+    uint32_t startMs = 0;
+
+    void run();
+    static void task(void *pvParameters);
+};
+
+#endif
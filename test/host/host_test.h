@@ -0,0 +1,77 @@
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+// Minimal test runner for the host tests: every TEST() registers itself, CHECK() records a failure
+// and keeps going, main() runs them all and fails the process if any check failed.
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct HostTest {
+    const char *name;
+    std::function<void()> run;
+};
+
+inline std::vector<HostTest> &hostTests() {
+    static std::vector<HostTest> tests;
+    return tests;
+}
+
+inline int &hostFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct HostTestRegistrar {
+    HostTestRegistrar(const char *name, std::function<void()> run) { hostTests().push_back({name, run}); }
+};
+
+#define TEST(name)                                                                                         \
+    static void test_##name();                                                                             \
+    static HostTestRegistrar registrar_##name(#name, test_##name);                                         \
+    static void test_##name()
+
+#define CHECK(cond)                                                                                        \
+    do {                                                                                                   \
+        if (!(cond)) {                                                                                     \
+            printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);                              \
+            hostFailures()++;                                                                              \
+        }                                                                                                  \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                                     \
+    do {                                                                                                   \
+        auto va = (a);                                                                                     \
+        auto vb = (b);                                                                                     \
+        if (!(va == vb)) {                                                                                 \
+            printf("  %s:%d: CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__, #a, #b);                      \
+            hostFailures()++;                                                                              \
+        }                                                                                                  \
+    } while (0)
+
+// Reads a whole file, empty if it can not be opened
+inline std::string hostReadFile(const std::string &path) {
+    std::string data;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return data;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.append(buf, n);
+    fclose(f);
+    return data;
+}
+
+#ifdef HOST_TEST_MAIN
+int main() {
+    for (const HostTest &test : hostTests()) {
+        int before = hostFailures();
+        test.run();
+        printf("%s %s\n", hostFailures() == before ? "PASS" : "FAIL", test.name);
+    }
+    return hostFailures() ? 1 : 0;
+}
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+// Just enough of the Arduino core to build the portable parts of the firmware on a PC.
+// Only what the host tests use is here, grow it when a new test needs more.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+#include <string>
+#include <thread>
+
+using std::abs;
+using std::max;
+using std::min;
+
+#define DEC 10
+#define HEX 16
+#define PI 3.1415926535897932384626433832795
+
+inline unsigned long millis() {
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t n = 0;
+        while (n < size && write(buffer[n])) n++;
+        return n;
+    }
+};
+
+class String {
+public:
+    String() = default;
+    String(const char *s) : s(s ? s : "") {}
+    String(const std::string &s) : s(s) {}
+    String(char c) : s(1, c) {}
+    String(int n, int base = DEC) : s(format((long long)n, base)) {}
+    String(unsigned int n, int base = DEC) : s(format((unsigned long long)n, base)) {}
+    String(long n, int base = DEC) : s(format((long long)n, base)) {}
+    String(unsigned long n, int base = DEC) : s(format((unsigned long long)n, base)) {}
+    String(float n, int decimals = 2) : s(formatFloat(n, decimals)) {}
+    String(double n, int decimals = 2) : s(formatFloat(n, decimals)) {}
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned int length() const { return s.length(); }
+    bool isEmpty() const { return s.empty(); }
+    void reserve(unsigned int size) { s.reserve(size); }
+    char charAt(unsigned int i) const { return i < s.length() ? s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char &operator[](unsigned int i) { return s[i]; }
+
+    String &operator+=(const String &o) {
+        s += o.s;
+        return *this;
+    }
+    String &operator+=(const char *o) {
+        s += o;
+        return *this;
+    }
+    String &operator+=(char c) {
+        s += c;
+        return *this;
+    }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char *o) const { return s == o; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator!=(const char *o) const { return s != o; }
+    bool operator<(const String &o) const { return s < o.s; }
+
+    bool equalsIgnoreCase(const String &o) const {
+        return s.size() == o.s.size() && strncasecmp(s.c_str(), o.s.c_str(), s.size()) == 0;
+    }
+    bool startsWith(const String &o) const { return s.compare(0, o.s.size(), o.s) == 0; }
+    bool endsWith(const String &o) const {
+        return s.size() >= o.s.size() && s.compare(s.size() - o.s.size(), o.s.size(), o.s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+    int indexOf(const String &o, unsigned int from = 0) const { return pos(s.find(o.s, from)); }
+    int lastIndexOf(char c) const { return pos(s.rfind(c)); }
+    String substring(unsigned int from) const { return from < s.size() ? s.substr(from) : ""; }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from < s.size() ? s.substr(from, to - from) : "";
+    }
+    void remove(unsigned int index) { s.erase(std::min<size_t>(index, s.size())); }
+    void remove(unsigned int index, unsigned int count) {
+        if (index < s.size()) s.erase(index, count);
+    }
+    void replace(const String &from, const String &to) {
+        if (from.s.empty()) return;
+        for (size_t at = s.find(from.s); at != std::string::npos; at = s.find(from.s, at + to.s.size())) {
+            s.replace(at, from.s.size(), to.s);
+        }
+    }
+    void trim() {
+        size_t b = s.find_first_not_of(" \t\r\n");
+        size_t e = s.find_last_not_of(" \t\r\n");
+        s = b == std::string::npos ? "" : s.substr(b, e - b + 1);
+    }
+    void toLowerCase() {
+        for (char &c : s) c = tolower((unsigned char)c);
+    }
+    void toUpperCase() {
+        for (char &c : s) c = toupper((unsigned char)c);
+    }
+    long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s.c_str(), nullptr); }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+    friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+
+private:
+    std::string s;
+
+    static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+    static std::string format(long long n, int base) {
+        if (base == DEC) return std::to_string(n);
+        return (n < 0 ? "-" : "") + format((unsigned long long)(n < 0 ? -n : n), base);
+    }
+    static std::string format(unsigned long long n, int base) {
+        if (base == DEC) return std::to_string(n);
+        std::string out;
+        do {
+            int d = n % base;
+            out.insert(out.begin(), d < 10 ? '0' + d : 'A' + d - 10);
+            n /= base;
+        } while (n);
+        return out;
+    }
+    static std::string formatFloat(double n, int decimals) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, n);
+        return buf;
+    }
+};
+
+#endif
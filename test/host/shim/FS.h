@@ -0,0 +1,37 @@
+#ifndef __HOST_FS_H__
+#define __HOST_FS_H__
+
+// A File over a byte string. chunk limits what one read() returns, like an SD card read ending
+// on a sector or a cluster.
+
+#include <Arduino.h>
+
+class File {
+public:
+    File() = default;
+    File(const std::string &data, size_t chunk = SIZE_MAX) : data(data), chunk(chunk), open(true) {}
+
+    int read(uint8_t *buffer, size_t size) {
+        size_t n = std::min({size, chunk, data.size() - pos});
+        memcpy(buffer, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+    bool seek(size_t to) {
+        if (to > data.size()) return false;
+        pos = to;
+        return true;
+    }
+    size_t size() const { return data.size(); }
+    size_t position() const { return pos; }
+    void close() { open = false; }
+    explicit operator bool() const { return open; }
+
+private:
+    std::string data;
+    size_t chunk = SIZE_MAX;
+    size_t pos = 0;
+    bool open = false;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef __HOST_ESP_ROM_CRC_H__
+#define __HOST_ESP_ROM_CRC_H__
+
+// CRC-32 as in the ESP32 ROM: reflected 0xEDB88320, the running value is kept uninverted so calls
+// chain from 0 like zlib's crc32()
+
+#include <cstddef>
+#include <cstdint>
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int k = 0; k < 8; k++) crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+    }
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,163 @@
+// BMP header limits, pixel formats and conversion throughput of the decoder behind drawBmp() and
+// the theme asset cache, on files built in memory.
+
+#define HOST_TEST_MAIN
+#include "core/bmp_decode.h"
+#include "host_test.h"
+#include <chrono>
+
+static void put16(std::vector<uint8_t> &b, size_t at, uint16_t v) {
+    b[at] = v;
+    b[at + 1] = v >> 8;
+}
+
+static void put32(std::vector<uint8_t> &b, size_t at, uint32_t v) {
+    for (int i = 0; i < 4; i++) b[at + i] = v >> (8 * i);
+}
+
+static uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) { return (r & 0xF8) << 8 | (g & 0xFC) << 3 | b >> 3; }
+
+// Pixel (x, y) of the test pattern, y counted from the top of the image
+static void pattern(int x, int y, uint8_t &r, uint8_t &g, uint8_t &b) {
+    r = x * 7 + y;
+    g = x * 3 + y * 5;
+    b = x ^ y;
+}
+
+// A BMP file of w x h pixels with the test pattern. masks are written for BI_BITFIELDS when given.
+static std::vector<uint8_t> makeBmp(int32_t w, int32_t h, int bits, const uint32_t *masks = nullptr) {
+    int bytes = bits / 8;
+    size_t rowBytes = ((size_t)w * bytes + 3) & ~(size_t)3;
+    int rows = h < 0 ? -h : h;
+    size_t offset = 14 + 40 + (masks ? 12 : 0);
+    std::vector<uint8_t> file(offset + rowBytes * rows, 0);
+    put16(file, 0, 0x4D42);
+    put32(file, 2, file.size());
+    put32(file, 10, offset);
+    put32(file, 14, 40);
+    put32(file, 18, w);
+    put32(file, 22, h);
+    put16(file, 26, 1);
+    put16(file, 28, bits);
+    put32(file, 30, masks ? 3 : 0);
+    if (masks) {
+        for (int i = 0; i < 3; i++) put32(file, 54 + i * 4, masks[i]);
+    }
+
+    for (int fileRow = 0; fileRow < rows; fileRow++) {
+        int y = h > 0 ? rows - 1 - fileRow : fileRow; // bottom up unless the height is negative
+        uint8_t *p = &file[offset + fileRow * rowBytes];
+        for (int x = 0; x < w; x++, p += bytes) {
+            uint8_t r, g, b;
+            pattern(x, y, r, g, b);
+            uint32_t pixel = 0;
+            if (bits == 16 && masks && masks[1] == 0x07E0) pixel = rgb565(r, g, b);
+            else if (bits == 16) pixel = (r >> 3) << 10 | (g >> 3) << 5 | b >> 3;
+            else if (masks) pixel = (uint32_t)r << 24 | (uint32_t)g << 16 | (uint32_t)b << 8; // RGBX
+            else pixel = (uint32_t)r << 16 | (uint32_t)g << 8 | b;                          // BGR(X)
+            for (int i = 0; i < bytes; i++) p[i] = pixel >> (8 * i);
+        }
+    }
+    return file;
+}
+
+// Converts every row like drawBmp() and checks the pattern, 555 loses the low bit of green
+static bool decodesPattern(const std::vector<uint8_t> &file, bool rgb555) {
+    BmpInfo bmp;
+    if (!bmpParseHeader(file.data(), file.size(), bmp)) return false;
+    std::vector<uint16_t> row(bmp.w);
+    for (int fileRow = 0; fileRow < bmp.h; fileRow++) {
+        int y = bmp.bottomUp ? bmp.h - 1 - fileRow : fileRow;
+        bmpConvertRow(bmp.format, &file[bmp.offset + fileRow * bmp.rowBytes], row.data(), bmp.w);
+        for (int x = 0; x < bmp.w; x++) {
+            uint8_t r, g, b;
+            pattern(x, y, r, g, b);
+            if (rgb555) g = (g & 0xF8) | (g >> 5 & 0x04);
+            if (row[x] != rgb565(r, g, b)) return false;
+        }
+    }
+    return true;
+}
+
+static const uint32_t masks565[3] = {0xF800, 0x07E0, 0x001F};
+static const uint32_t masks555[3] = {0x7C00, 0x03E0, 0x001F};
+static const uint32_t masksRgbx[3] = {0xFF000000, 0x00FF0000, 0x0000FF00};
+
+TEST(header_limits) {
+    BmpInfo bmp;
+    // 16-bit sizes are what the capture and the theme cache allocate for
+    std::vector<uint8_t> file = makeBmp(4, 1, 24);
+    CHECK(bmpParseHeader(file.data(), file.size(), bmp));
+    for (int32_t h : {BMP_MAX_HEIGHT, -BMP_MAX_HEIGHT}) {
+        put32(file, 22, h);
+        CHECK(bmpParseHeader(file.data(), file.size(), bmp) && bmp.h == BMP_MAX_HEIGHT);
+    }
+    for (int32_t h : {BMP_MAX_HEIGHT + 1, -BMP_MAX_HEIGHT - 1, INT32_MAX, INT32_MIN, 0}) {
+        put32(file, 22, h);
+        CHECK(!bmpParseHeader(file.data(), file.size(), bmp));
+    }
+    put32(file, 22, 1);
+    for (int32_t w : {BMP_MAX_WIDTH + 1, 0, -4}) {
+        put32(file, 18, w);
+        CHECK(!bmpParseHeader(file.data(), file.size(), bmp));
+    }
+    put32(file, 18, 4);
+    CHECK(!bmpParseHeader(file.data(), 53, bmp)); // truncated
+    put32(file, 30, 1);                            // RLE8
+    CHECK(!bmpParseHeader(file.data(), file.size(), bmp));
+}
+
+TEST(pixel_formats) {
+    // Odd widths exercise the row padding
+    for (int32_t h : {13, -13}) {
+        CHECK(decodesPattern(makeBmp(37, h, 24), false));
+        CHECK(decodesPattern(makeBmp(37, h, 32), false));
+        CHECK(decodesPattern(makeBmp(37, h, 32, masksRgbx), false));
+        CHECK(decodesPattern(makeBmp(37, h, 16, masks565), false));
+        CHECK(decodesPattern(makeBmp(37, h, 16, masks555), true));
+        CHECK(decodesPattern(makeBmp(37, h, 16), true)); // BI_RGB 16-bit is 555
+    }
+    BmpInfo bmp;
+    std::vector<uint8_t> file = makeBmp(8, 2, 24);
+    CHECK(bmpParseHeader(file.data(), file.size(), bmp));
+    CHECK(bmp.bottomUp && bmp.w == 8 && bmp.h == 2 && bmp.rowBytes == 24 && bmp.offset == 54);
+    const uint32_t odd[3] = {0xF000, 0x0FF0, 0x000F};
+    file = makeBmp(8, 2, 16, odd);
+    CHECK(!bmpParseHeader(file.data(), file.size(), bmp));
+}
+
+// Full screen 320x240 images converted row by row, as the decoder does between file reads
+TEST(throughput) {
+    struct Case {
+        const char *name;
+        int bits;
+        const uint32_t *masks;
+    };
+    const Case cases[] = {
+        {"24-bit",     24, nullptr  },
+        {"32-bit",     32, nullptr  },
+        {"16-bit 565", 16, masks565},
+        {"16-bit 555", 16, masks555},
+    };
+    for (const Case &c : cases) {
+        std::vector<uint8_t> file = makeBmp(320, 240, c.bits, c.masks);
+        std::vector<uint16_t> pixels(320 * 240);
+        const int frames = 200;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < frames; n++) {
+            BmpInfo bmp;
+            if (!bmpParseHeader(file.data(), file.size(), bmp)) break;
+            for (int row = 0; row < bmp.h; row++) {
+                const uint8_t *src = &file[bmp.offset + row * bmp.rowBytes];
+                bmpConvertRow(bmp.format, src, &pixels[row * bmp.w], bmp.w);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double mb = (double)(file.size() - 54) * frames / (1 << 20);
+        printf(
+            "  %-10s 320x240: %.0f frames/s, %.0f MB/s of pixel data\n", c.name, frames / seconds, mb / seconds
+        );
+        // The SPI push of a frame takes tens of ms, this only catches a conversion gone badly wrong
+        CHECK(frames / seconds > 100);
+    }
+}
@@ -0,0 +1,193 @@
+// Inflates what GzipEncoder writes with zlib: round trip, gzip trailer and the counting first pass
+// that gives the WiGLE upload its Content-Length, for several inputs and file read sizes.
+
+#define HOST_TEST_MAIN
+#include "core/gzip_encoder.h"
+#include "host_test.h"
+#include <chrono>
+#include <random>
+#include <zlib.h>
+
+// Print into a byte string, fails after limit bytes like a dropped socket
+class StringPrint : public Print {
+public:
+    std::string data;
+    size_t limit = SIZE_MAX;
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        size_t n = std::min(size, limit - data.size());
+        data.append((const char *)buffer, n);
+        return n;
+    }
+};
+
+static std::string inflateGzip(const std::string &gz, bool &ok) {
+    std::string out;
+    z_stream z = {};
+    ok = inflateInit2(&z, 16 + 15) == Z_OK; // gzip wrapper only
+    z.next_in = (Bytef *)gz.data();
+    z.avail_in = gz.size();
+    int rc = Z_OK;
+    char buf[16384];
+    while (ok && rc == Z_OK) {
+        z.next_out = (Bytef *)buf;
+        z.avail_out = sizeof(buf);
+        rc = inflate(&z, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - z.avail_out);
+    }
+    // Z_STREAM_END only once the CRC and the size in the trailer matched, with nothing left over
+    ok = ok && rc == Z_STREAM_END && z.avail_in == 0;
+    inflateEnd(&z);
+    return out;
+}
+
+static uint32_t le32(const std::string &s, size_t at) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = v << 8 | (uint8_t)s[at + i];
+    return v;
+}
+
+static std::string csvLog(size_t lines) {
+    std::mt19937 rng(5);
+    std::string csv = "MAC,SSID,AuthMode,FirstSeen,Channel,Frequency,RSSI,CurrentLatitude,CurrentLongitude,"
+                      "AltitudeMeters,AccuracyMeters,RCOIs,MfgrId,Type\n";
+    char line[200];
+    for (size_t i = 0; i < lines; i++) {
+        int channel = 1 + rng() % 13;
+        snprintf(
+            line,
+            sizeof(line),
+            "%02X:%02X:%02X:%02X:%02X:%02X,\"net-%u\",[WPA2_PSK],2026-10-19 12:%02u:%02u,%d,%d,%d,"
+            "%.7f,%.7f,%d,%.2f,,,WIFI\n",
+            0x3C,
+            0x84,
+            (unsigned)(rng() & 0xFF),
+            (unsigned)(rng() & 0xFF),
+            (unsigned)(rng() & 0xFF),
+            (unsigned)(rng() & 0xFF),
+            (unsigned)(rng() % 500),
+            (unsigned)(i / 60 % 60),
+            (unsigned)(i % 60),
+            channel,
+            2407 + channel * 5,
+            -40 - (int)(rng() % 50),
+            -23.5505 + i * 1e-5,
+            -46.6333 - i * 1e-5,
+            760 + (int)(rng() % 10),
+            1.0 + rng() % 300 / 100.0
+        );
+        csv += line;
+    }
+    return csv;
+}
+
+static std::string randomBytes(size_t size) {
+    std::mt19937 rng(9);
+    std::string data(size, 0);
+    for (char &c : data) c = rng();
+    return data;
+}
+
+struct Input {
+    const char *name;
+    std::string data;
+};
+
+static std::vector<Input> inputs() {
+    return {
+        {"empty",  ""                           },
+        {"1 byte", "x"                          },
+        {"random", randomBytes(100000)          },
+        {"zeros",  std::string(100000, '\0')    },
+        {"csv",    csvLog(2000)                 },
+        {"period", std::string(20000, 'a') + "b"}, // matches of the full 258 bytes
+    };
+}
+
+// Reads of one byte, odd sizes, a card sector and the whole file at once
+static const size_t chunks[] = {1, 7, 512, 4096, SIZE_MAX};
+
+TEST(round_trip) {
+    for (const Input &input : inputs()) {
+        for (size_t chunk : chunks) {
+            if (chunk == 1 && input.data.size() > 20000) continue; // byte reads on the small ones only
+            File counted(input.data, chunk);
+            GzipCounter counter;
+            size_t measured = GzipEncoder::compress(counted, counter);
+
+            File in(input.data, chunk);
+            StringPrint out;
+            size_t last = 0;
+            bool monotonic = true;
+            size_t sent = GzipEncoder::compress(in, out, [&](size_t done) {
+                monotonic = monotonic && done > last;
+                last = done;
+            });
+
+            bool ok;
+            std::string inflated = inflateGzip(out.data, ok);
+            if (!ok || inflated != input.data) {
+                printf("  %s, %zu byte reads: round trip failed\n", input.name, chunk);
+            }
+            CHECK(ok && inflated == input.data);
+            // The first pass gives the Content-Length of the second
+            CHECK_EQ(measured, counter.count);
+            CHECK_EQ(sent, out.data.size());
+            CHECK_EQ(measured, sent);
+            CHECK(monotonic && last == input.data.size());
+
+            CHECK(out.data.size() >= 18);
+            if (out.data.size() < 18) continue;
+            uint32_t crc = crc32(0, (const Bytef *)input.data.data(), input.data.size());
+            CHECK_EQ(le32(out.data, out.data.size() - 8), crc);
+            CHECK_EQ(le32(out.data, out.data.size() - 4), (uint32_t)input.data.size());
+        }
+    }
+}
+
+TEST(compression_ratio) {
+    for (const Input &input : inputs()) {
+        if (input.data.size() < 1000) continue;
+        File in(input.data);
+        GzipCounter counter;
+        size_t size = GzipEncoder::compress(in, counter);
+        printf(
+            "  %-6s %7zu -> %7zu bytes (%.2fx)\n",
+            input.name,
+            input.data.size(),
+            size,
+            (double)input.data.size() / size
+        );
+        // Fixed Huffman codes cost 8 or 9 bits per literal, incompressible data grows at most 1/8
+        CHECK(size <= input.data.size() + input.data.size() / 8 + 32);
+        if (std::string(input.name) == "csv") CHECK(size * 2 < input.data.size());
+        if (std::string(input.name) == "zeros") CHECK(size * 50 < input.data.size());
+    }
+}
+
+TEST(write_failure) {
+    std::string csv = csvLog(500);
+    for (size_t limit : {0, 5, 1024, 3000}) {
+        File in(csv);
+        StringPrint out;
+        out.limit = limit;
+        CHECK_EQ(GzipEncoder::compress(in, out), (size_t)0);
+    }
+}
+
+// One compression pass over a long log, an upload makes two
+TEST(throughput) {
+    std::string csv = csvLog(20000);
+    const int rounds = 5;
+    size_t size = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        File in(csv, 4096);
+        GzipCounter counter;
+        size = GzipEncoder::compress(in, counter);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mbps = csv.size() * rounds / seconds / (1 << 20);
+    printf("  %zu byte CSV -> %zu bytes, %.1f MB/s\n", csv.size(), size, mbps);
+    CHECK(mbps > 1);
+}
@@ -0,0 +1,103 @@
+// Scans every TCP port of localhost with a few listeners open and reports how long the full
+// 1-65535 sweep takes with 64 probes in flight.
+
+#define HOST_TEST_MAIN
+#include "host_test.h"
+#include "modules/ethernet/PortScanner.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Listening socket on an ephemeral localhost port, -1 when sockets are not available
+static int openListener(uint16_t &port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, len) < 0 || listen(fd, 64) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+        close(fd);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static double scan(PortScanner &scanner) {
+    auto start = std::chrono::steady_clock::now();
+    while (scanner.poll(100)) {}
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(finds_listeners_on_localhost) {
+    std::vector<int> fds;
+    std::vector<uint16_t> listening;
+    for (int i = 0; i < 4; i++) {
+        uint16_t port;
+        int fd = openListener(port);
+        if (fd < 0) break;
+        fds.push_back(fd);
+        listening.push_back(port);
+    }
+    if (listening.empty()) {
+        printf("  no loopback sockets here, skipped\n");
+        return;
+    }
+
+    PortScanConfig config;
+    config.maxInFlight = 64;
+    PortScanner scanner(config);
+    scanner.addHost(htonl(INADDR_LOOPBACK));
+    scanner.addPortRange(1, 65535);
+    std::vector<uint16_t> open;
+    scanner.onOpen([&](const PortScanResult &result) {
+        CHECK_EQ(result.ip, htonl(INADDR_LOOPBACK));
+        open.push_back(result.port);
+    });
+
+    double seconds = scan(scanner);
+    printf(
+        "  1-65535 on 127.0.0.1, %u probes in flight: %.2f s (%.0f ports/s), %u open\n",
+        config.maxInFlight,
+        seconds,
+        65535 / seconds,
+        scanner.openCount()
+    );
+
+    CHECK_EQ(scanner.done(), scanner.total());
+    CHECK_EQ(scanner.openCount(), (uint32_t)open.size());
+    for (uint16_t port : listening) CHECK(std::find(open.begin(), open.end(), port) != open.end());
+    // Refused ports answer at once, the adaptive timeout must have settled near the floor
+    CHECK(scanner.timeoutFor(htonl(INADDR_LOOPBACK)) <= config.minTimeoutMs * 2);
+    for (int fd : fds) close(fd);
+}
+
+// A host that never answers ends every probe through the timeout, not by waiting forever
+TEST(unanswered_probes_time_out) {
+    PortScanConfig config;
+    config.maxInFlight = 4;
+    config.initialTimeoutMs = 50;
+    PortScanner scanner(config);
+    scanner.addHost(inet_addr("192.0.2.1")); // TEST-NET-1, never routed
+    const uint16_t ports[] = {22, 80, 443, 8080};
+    scanner.addPorts(ports, 4);
+    double seconds = scan(scanner);
+    CHECK_EQ(scanner.done(), 4u);
+    CHECK_EQ(scanner.openCount(), 0u);
+    CHECK(seconds < 2);
+}
+
+TEST(cancel_stops_the_scan) {
+    PortScanner scanner;
+    scanner.addHost(htonl(INADDR_LOOPBACK));
+    scanner.addPortRange(1, 1000);
+    scanner.poll(0);
+    scanner.cancel();
+    CHECK(!scanner.poll(0));
+    CHECK(scanner.done() < scanner.total());
+}
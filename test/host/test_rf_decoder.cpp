@@ -0,0 +1,166 @@
+// Runs the sub-GHz decoder over the .sub captures in samples/rf and over encoded frames with
+// timing skew and jitter, and measures how many captures it decodes per second.
+
+#define HOST_TEST_MAIN
+#include "host_test.h"
+#include "modules/rf/rf_decoder.h"
+#include <chrono>
+#include <random>
+#include <sstream>
+
+// Pulses of every RAW_Data line of a .sub file
+static std::vector<int32_t> readRawSub(const std::string &path) {
+    std::vector<int32_t> pulses;
+    std::istringstream file(hostReadFile(path));
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.rfind("RAW_Data:", 0) != 0) continue;
+        std::istringstream values(line.substr(9));
+        long value;
+        while (values >> value) pulses.push_back(value);
+    }
+    return pulses;
+}
+
+struct SubSample {
+    const char *file;
+    const char *protocol;
+    uint64_t key;
+    uint8_t bits;
+};
+
+static const SubSample samples[] = {
+    {"came.sub",        "CAME",        0xA5C,    12},
+    {"nice_flo.sub",    "Nice FLO",    0x3B1,    12},
+    {"ansonic.sub",     "Ansonic",     0x6E2,    12},
+    {"holtek.sub",      "Holtek",      0x91D,    12},
+    {"linear.sub",      "Linear",      0x2C7,    12},
+    {"chamberlain.sub", "Chamberlain", 0x5F0,    12},
+    {"manchester.sub",  "Manchester",  0xB38E5A, 24},
+};
+
+TEST(sub_samples) {
+    for (const SubSample &sample : samples) {
+        std::vector<int32_t> pulses = readRawSub(std::string(SAMPLES_DIR "/rf/") + sample.file);
+        CHECK(!pulses.empty());
+        RfDecoder decoder;
+        RfDecoded out;
+        bool found = decoder.decode(pulses.data(), pulses.size(), out);
+        if (!found || String(out.protocol) != sample.protocol || out.key != sample.key ||
+            out.bits != sample.bits) {
+            printf(
+                "  %s: got %s %llX (%d bit)\n",
+                sample.file,
+                found ? out.protocol : "nothing",
+                (unsigned long long)out.key,
+                out.bits
+            );
+        }
+        CHECK(found);
+        CHECK(found && String(out.protocol) == sample.protocol);
+        CHECK_EQ(out.key, sample.key);
+        CHECK_EQ(out.bits, sample.bits);
+        CHECK(out.repeats > 0);
+    }
+}
+
+// Every table protocol decodes what rf_decoder_encode builds, 10% off its TE with jitter. The bit
+// timings of the PWM protocols overlap, their pilot or stop pulses must still tell them apart.
+TEST(round_trip_with_skew) {
+    std::mt19937 rng(1234);
+    int total = 0, correct = 0;
+    std::uniform_int_distribution<int> jitter(-30, 30);
+    for (const RfDecoderProtocol &protocol : rf_decoder_protocols()) {
+        int bits = protocol.bits;
+        for (float skew : {0.9f, 1.0f, 1.1f}) {
+            for (int n = 0; n < 20; n++) {
+                uint64_t key = rng() & ((1ULL << bits) - 1);
+                int te = protocol.encoding == RF_ENCODING_MANCHESTER ? lroundf(350 * skew) : 0;
+                std::vector<int> frame;
+                CHECK(rf_decoder_encode(protocol, key, bits, te, frame));
+                std::vector<int32_t> pulses = {-20000};
+                for (int r = 0; r < 3; r++) {
+                    for (int d : frame) {
+                        if (abs(d) <= 1) continue; // level markers
+                        int32_t scaled = te ? d : lroundf(d * skew);
+                        scaled += scaled > 0 ? jitter(rng) : -jitter(rng);
+                        // Same level twice in a row is one pulse for a receiver
+                        if (!pulses.empty() && (pulses.back() < 0) == (scaled < 0)) pulses.back() += scaled;
+                        else pulses.push_back(scaled);
+                    }
+                }
+                RfDecoder decoder;
+                RfDecoded out;
+                bool found = decoder.decode(pulses.data(), pulses.size(), out);
+                bool named = found && String(out.protocol) == protocol.name;
+                if (found && !named) {
+                    printf("  %s decoded as %s at %.1fx TE\n", protocol.name, out.protocol, skew);
+                }
+                CHECK(found && out.key == key && out.bits == bits);
+                CHECK(named);
+                total++;
+                correct += named && out.key == key && out.bits == bits;
+            }
+        }
+    }
+    printf("  %d of %d frames decoded with the right protocol and key\n", correct, total);
+}
+
+TEST(streaming_counts_repeats) {
+    const RfDecoderProtocol *came = rf_decoder_find("came");
+    CHECK(came != nullptr);
+    if (!came) return;
+    std::vector<int> frame;
+    rf_decoder_encode(*came, 0x123, 12, 0, frame);
+    RfDecoder decoder;
+    int frames = 0;
+    for (int r = 0; r < 4; r++) {
+        for (int d : frame) frames += decoder.feed(d);
+    }
+    frames += decoder.feed(-30000);
+    CHECK_EQ(frames, 4);
+    CHECK_EQ(decoder.result().key, 0x123ULL);
+    CHECK_EQ(decoder.result().repeats, 3);
+}
+
+TEST(noise_is_not_decoded) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> width(50, 3000);
+    std::vector<int32_t> pulses;
+    for (int i = 0; i < 5000; i++) pulses.push_back(i % 2 ? -width(rng) : width(rng));
+    RfDecoder decoder;
+    RfDecoded out;
+    bool found = decoder.decode(pulses.data(), pulses.size(), out);
+    CHECK(!found || out.repeats == 0);
+}
+
+// The whole sample set decoded over and over, like a capture being replayed
+TEST(decode_rate) {
+    std::vector<std::vector<int32_t>> captures;
+    size_t pulseCount = 0;
+    for (const SubSample &sample : samples) {
+        captures.push_back(readRawSub(std::string(SAMPLES_DIR "/rf/") + sample.file));
+        pulseCount += captures.back().size();
+    }
+    const int rounds = 500;
+    int decoded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const std::vector<int32_t> &pulses : captures) {
+            RfDecoder decoder;
+            RfDecoded out;
+            decoded += decoder.decode(pulses.data(), pulses.size(), out);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double captureRate = rounds * captures.size() / seconds;
+    printf(
+        "  %.0f captures/s, %.1f M pulses/s (%zu pulses per round)\n",
+        captureRate,
+        rounds * pulseCount / seconds / 1e6,
+        pulseCount
+    );
+    CHECK_EQ(decoded, rounds * (int)captures.size());
+    // A receiver delivers a few thousand pulses per second, only catches a decoder gone badly slow
+    CHECK(rounds * pulseCount / seconds > 100000);
+}
@@ -0,0 +1,134 @@
+// Feeds synthetic tones through SpectrumAnalyzer with the Mic Spectrum settings (1024 points at
+// 48 kHz): peak frequency and level accuracy, display bin placement and frames per second.
+
+#define HOST_TEST_MAIN
+#include "host_test.h"
+#include "modules/others/spectrum_analyzer.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#define FFT_SIZE 1024
+#define SAMPLE_RATE 48000.0f
+
+// Sum of sines at the given frequencies and amplitudes (1 = full scale), plus optional noise
+static std::vector<int16_t> tones(
+    std::initializer_list<std::pair<float, float>> parts, float noise = 0, size_t count = FFT_SIZE
+) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> gauss(0, 1);
+    std::vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        double value = noise * gauss(rng);
+        for (auto &part : parts) value += part.second * sin(2 * M_PI * part.first * i / SAMPLE_RATE + 0.3);
+        samples[i] = (int16_t)std::max(-32768.0, std::min(32767.0, value * 32767));
+    }
+    return samples;
+}
+
+// Display bin whose range holds the frequency
+static size_t binOf(const SpectrumAnalyzer &analyzer, float hz) {
+    size_t best = 0;
+    for (size_t i = 1; i < analyzer.binCount(); i++) {
+        if (fabsf(analyzer.binFrequency(i) - hz) < fabsf(analyzer.binFrequency(best) - hz)) best = i;
+    }
+    return best;
+}
+
+static size_t loudestBin(const SpectrumAnalyzer &analyzer) {
+    size_t top = 0;
+    for (size_t i = 1; i < analyzer.binCount(); i++) {
+        if (analyzer.bins()[i] > analyzer.bins()[top]) top = i;
+    }
+    return top;
+}
+
+TEST(peak_frequency_and_level) {
+    SpectrumAnalyzer analyzer(FFT_SIZE, SAMPLE_RATE);
+    CHECK(analyzer.ok());
+    float worstHz = 0, worstDb = 0;
+    // Sweeps across whole and half FFT bins, where the Hann scalloping is worst
+    for (float hz = 200; hz < 20000; hz += 173.3f) {
+        analyzer.process(tones({{hz, 1.0f}}).data());
+        worstHz = std::max(worstHz, fabsf(analyzer.peakFrequency() - hz));
+        worstDb = std::max(worstDb, fabsf(analyzer.peakLevel()));
+    }
+    printf(
+        "  peak error up to %.2f Hz (bin %.1f Hz), full scale level within %.2f dB\n",
+        worstHz,
+        analyzer.binWidth(),
+        worstDb
+    );
+    CHECK(worstHz < analyzer.binWidth() * 0.1f);
+    CHECK(worstDb < 1.6f); // Hann scalloping loss is 1.42 dB
+}
+
+TEST(linear_and_log_bins) {
+    SpectrumAnalyzer analyzer(FFT_SIZE, SAMPLE_RATE);
+    for (SpectrumAnalyzer::Scale scale : {SpectrumAnalyzer::Scale::Linear, SpectrumAnalyzer::Scale::Log}) {
+        if (scale == SpectrumAnalyzer::Scale::Log) analyzer.setBins(124, scale, 40, 20000);
+        else analyzer.setBins(124, scale, analyzer.binWidth() / 2, analyzer.binWidth() * 124.5f);
+        CHECK_EQ(analyzer.binCount(), (size_t)124);
+        for (float hz : {440.0f, 1000.0f, 3150.0f, 5000.0f}) {
+            analyzer.process(tones({{hz, 0.5f}}, 0.001f).data());
+            size_t expected = binOf(analyzer, hz);
+            size_t got = loudestBin(analyzer);
+            // Neighbouring display bins can share an FFT bin on the low end of the log scale
+            CHECK(got + 1 >= expected && got <= expected + 1);
+            CHECK(analyzer.bins()[got] > -10.0f);
+        }
+    }
+}
+
+TEST(separates_two_tones) {
+    SpectrumAnalyzer analyzer(FFT_SIZE, SAMPLE_RATE);
+    analyzer.process(tones({{1000, 0.5f}, {4000, 0.05f}}).data());
+    const float *bins = analyzer.bins();
+    size_t loud = (size_t)lroundf(1000 / analyzer.binWidth());
+    size_t quiet = (size_t)lroundf(4000 / analyzer.binWidth());
+    size_t between = (loud + quiet) / 2;
+    CHECK(fabsf(analyzer.peakFrequency() - 1000) < 5);
+    CHECK(fabsf((bins[loud] - bins[quiet]) - 20) < 2); // 10x amplitude is 20 dB
+    CHECK(bins[between] < bins[quiet] - 40);           // Hann side lobes fall off fast
+}
+
+TEST(modes) {
+    SpectrumAnalyzer analyzer(FFT_SIZE, SAMPLE_RATE);
+    std::vector<int16_t> loud = tones({{1000, 0.5f}});
+    std::vector<int16_t> silent(FFT_SIZE, 0);
+    size_t bin = binOf(analyzer, 1000);
+
+    analyzer.setMode(SpectrumAnalyzer::Mode::PeakHold);
+    analyzer.process(loud.data());
+    float held = analyzer.bins()[bin];
+    analyzer.process(silent.data());
+    CHECK(fabsf(analyzer.bins()[bin] - (held - analyzer.peakDecay)) < 0.01f);
+
+    analyzer.setMode(SpectrumAnalyzer::Mode::Average);
+    analyzer.process(silent.data());
+    float quiet = analyzer.bins()[bin];
+    analyzer.process(loud.data());
+    float expected = quiet + (held - quiet) * analyzer.averaging;
+    CHECK(fabsf(analyzer.bins()[bin] - expected) < 0.5f);
+}
+
+// Throughput over a long noisy signal, one frame per FFT_SIZE samples like the capture task
+TEST(frames_per_second) {
+    SpectrumAnalyzer analyzer(FFT_SIZE, SAMPLE_RATE);
+    analyzer.setBins(124, SpectrumAnalyzer::Scale::Log, 40, 20000);
+    analyzer.setMode(SpectrumAnalyzer::Mode::Average);
+    const size_t frames = 64;
+    std::vector<int16_t> signal = tones({{440, 0.3f}, {2500, 0.2f}, {9000, 0.1f}}, 0.01f, frames * FFT_SIZE);
+
+    const int rounds = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t f = 0; f < frames; f++) analyzer.process(signal.data() + f * FFT_SIZE);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double fps = rounds * frames / seconds;
+    printf("  %d-point frames: %.0f frames/s, %.1f us/frame\n", FFT_SIZE, fps, 1e6 / fps);
+    // Far above the 47 frames/s the microphone delivers, only catches a broken build or a lost table
+    CHECK(fps > 2000);
+    CHECK(fabsf(analyzer.peakFrequency() - 440) < 5);
+}
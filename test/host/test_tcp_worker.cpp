@@ -0,0 +1,187 @@
+// Runs TcpWorker against an echo server on localhost: throughput of a long echoed stream, the tail
+// of a stream the peer closes right after sending, and the transmit ring overflow.
+
+#define HOST_TEST_MAIN
+#include "host_test.h"
+#include "modules/wifi/tcp_worker.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// Listening socket on an ephemeral localhost port, -1 when sockets are not available
+static int openListener(uint16_t &port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, len) < 0 || listen(fd, 4) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+        close(fd);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static int connectTo(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static uint8_t pattern(uint32_t i) { return (i * 31 + (i >> 9)) & 0xFF; }
+
+// Echoes everything back until the client closes
+static void echo(int listener) {
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) return;
+    uint8_t buf[16384];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t off = 0; off < n;) {
+            ssize_t put = send(fd, buf + off, n - off, 0);
+            if (put <= 0) break;
+            off += put;
+        }
+    }
+    close(fd);
+}
+
+TEST(echo_throughput) {
+    uint16_t port;
+    int listener = openListener(port);
+    if (listener < 0) {
+        printf("  no loopback sockets here, skipped\n");
+        return;
+    }
+    std::thread server(echo, listener);
+    int fd = connectTo(port);
+    CHECK(fd >= 0);
+    TcpWorker worker;
+    CHECK(fd >= 0 && worker.begin(fd));
+
+    // Written as fast as the transmit ring takes it, like a paste into the terminal
+    const uint32_t total = 64 * 1024 * 1024;
+    uint32_t queued = 0, echoed = 0;
+    bool intact = true;
+    uint8_t out[1024], in[4096];
+    auto start = std::chrono::steady_clock::now();
+    while (echoed < total) {
+        uint32_t room = TCP_TX_RING - (queued - worker.sent());
+        uint32_t n = std::min<uint32_t>({room, sizeof(out), total - queued});
+        if (n > 0) {
+            for (uint32_t i = 0; i < n; i++) out[i] = pattern(queued + i);
+            worker.write(out, n);
+            queued += n;
+        }
+        int got = worker.read(in, sizeof(in));
+        if (got < 0) break;
+        for (int i = 0; i < got; i++) intact = intact && in[i] == pattern(echoed + i);
+        echoed += got;
+        if (n == 0 && got == 0) std::this_thread::yield();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    worker.end();
+    close(fd);
+    server.join();
+    close(listener);
+
+    printf(
+        "  %u MB echoed in %.2f s: %.1f MB/s each way\n", total >> 20, seconds, total / seconds / (1 << 20)
+    );
+    CHECK_EQ(echoed, total);
+    CHECK(intact);
+    CHECK_EQ(worker.dropped(), 0u);
+    CHECK_EQ(worker.received(), total);
+    // Far more than a terminal shows: catches a worker that sits out select() timeouts or sleeps,
+    // which made this 0.2 to 4 MB/s
+    CHECK(total / seconds > 16 * 1024 * 1024);
+}
+
+// The peer sends and closes at once: every byte must be read before read() reports the close
+TEST(tail_before_close) {
+    uint16_t port;
+    int listener = openListener(port);
+    if (listener < 0) return;
+    int lost = 0;
+    for (int round = 0; round < 200; round++) {
+        uint32_t size = 1 + round * 97 % 20000;
+        std::thread server([&] {
+            int fd = accept(listener, NULL, NULL);
+            if (fd < 0) return;
+            std::string data(size, 0);
+            for (uint32_t i = 0; i < size; i++) data[i] = pattern(i);
+            send(fd, data.data(), size, 0);
+            close(fd);
+        });
+        int fd = connectTo(port);
+        TcpWorker worker;
+        worker.begin(fd);
+        uint32_t got = 0;
+        uint8_t buf[512];
+        int n;
+        while ((n = worker.read(buf, sizeof(buf))) >= 0) {
+            for (int i = 0; i < n; i++) CHECK(buf[i] == pattern(got + i));
+            got += n;
+            if (n == 0) std::this_thread::yield();
+        }
+        worker.end();
+        close(fd);
+        server.join();
+        if (got != size) lost++;
+    }
+    close(listener);
+    CHECK_EQ(lost, 0);
+}
+
+// A peer that stops reading fills the socket and then the ring: every byte is either delivered or counted
+TEST(transmit_overflow_is_counted) {
+    uint16_t port;
+    int listener = openListener(port);
+    if (listener < 0) return;
+    std::atomic<bool> reading{false};
+    uint32_t delivered = 0;
+    std::thread server([&] {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) return;
+        while (!reading) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        uint8_t buf[16384];
+        ssize_t n;
+        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) delivered += n;
+        close(fd);
+    });
+    int fd = connectTo(port);
+    TcpWorker worker;
+    CHECK(worker.begin(fd));
+    const uint32_t total = 16 * 1024 * 1024;
+    std::vector<uint8_t> chunk(1024, 'x');
+    for (uint32_t i = 0; i < total; i += chunk.size()) worker.write(chunk.data(), chunk.size());
+    CHECK(worker.dropped() > 0);
+
+    reading = true;
+    auto start = std::chrono::steady_clock::now();
+    while (worker.sent() + worker.dropped() < total &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK_EQ(worker.sent() + worker.dropped(), total);
+    worker.end();
+    shutdown(fd, SHUT_WR);
+    server.join();
+    close(fd);
+    close(listener);
+    CHECK_EQ(delivered, worker.sent());
+}
@@ -0,0 +1,87 @@
+// Replays the recorded sessions in samples/terminal through TerminalEmulator and compares the
+// screen with the expected snapshot next to each one (<name>.in -> <name>.txt).
+
+#define HOST_TEST_MAIN
+#include "core/terminal_emulator.h"
+#include "host_test.h"
+
+struct Session {
+    const char *name;
+    uint16_t cols;
+    uint16_t rows;
+    const char *response; // what the emulator must answer to the host
+};
+
+static const Session sessions[] = {
+    {"shell",    32, 6, ""         }, // colored prompt, \r progress bar, wrapping, readline edits
+    {"top",      24, 8, "\x1b[3;7R"}, // alternate screen, scrolling region, reverse index, DSR
+    {"top_exit", 24, 8, "\x1b[3;7R"}, // same, then back to the primary screen
+    {"graphics", 12, 5, ""         }, // DEC line drawing, UTF-8, an invalid byte, tab
+};
+
+static std::string sample(const Session &session, const char *ext) {
+    return hostReadFile(std::string(SAMPLES_DIR "/terminal/") + session.name + ext);
+}
+
+static void report(const Session &session, const std::string &expected, const std::string &got) {
+    if (expected == got) return;
+    printf("  %s: expected\n%s  got\n%s", session.name, expected.c_str(), got.c_str());
+}
+
+TEST(recorded_sessions) {
+    for (const Session &session : sessions) {
+        std::string input = sample(session, ".in");
+        std::string expected = sample(session, ".txt");
+        CHECK(!input.empty() && !expected.empty());
+
+        TerminalEmulator term(session.cols, session.rows);
+        term.write((const uint8_t *)input.data(), input.size());
+        report(session, expected, term.snapshot());
+        CHECK(term.snapshot() == expected);
+        CHECK(term.takeResponse() == session.response);
+    }
+}
+
+// Serial reads split sequences anywhere, byte by byte must give the same screen
+TEST(byte_by_byte) {
+    for (const Session &session : sessions) {
+        std::string input = sample(session, ".in");
+        TerminalEmulator term(session.cols, session.rows);
+        for (char c : input) term.write((const uint8_t *)&c, 1);
+        CHECK(term.snapshot() == sample(session, ".txt"));
+    }
+}
+
+TEST(shell_attributes_and_scrollback) {
+    const Session &shell = sessions[0];
+    std::string input = sample(shell, ".in");
+    TerminalEmulator term(shell.cols, shell.rows);
+    term.write((const uint8_t *)input.data(), input.size());
+
+    // 9 lines on a 6 row screen, the first prompt is the oldest line kept
+    CHECK_EQ(term.scrollbackLines(), (size_t)3);
+    const TerminalEmulator::Cell *prompt = term.scrollbackLine(2);
+    CHECK(prompt != nullptr);
+    if (!prompt) return;
+    CHECK_EQ(prompt[0].ch, (uint16_t)'u');
+    CHECK_EQ(prompt[0].fg, 2);
+    CHECK(prompt[0].attr & TerminalEmulator::Bold);
+    CHECK_EQ(prompt[10].ch, (uint16_t)':');
+    CHECK(prompt[10].attr & TerminalEmulator::DefaultFg);
+    CHECK_EQ(prompt[11].fg, 4);
+
+    // Cursor right after the inserted 'l'
+    CHECK_EQ(term.cursorX(), 19);
+    CHECK_EQ(term.cursorY(), 5);
+}
+
+TEST(alternate_screen_keeps_history_clean) {
+    const Session &top = sessions[1];
+    std::string input = sample(top, ".in");
+    TerminalEmulator term(top.cols, top.rows);
+    term.write((const uint8_t *)input.data(), input.size());
+    // Lines scrolled inside a region never reach the scrollback
+    CHECK_EQ(term.scrollbackLines(), (size_t)0);
+    CHECK(term.cell(1, 0).attr & TerminalEmulator::Reverse);
+    CHECK(!(term.cell(0, 2).attr & TerminalEmulator::Reverse));
+}
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Stand-in for the WiGLE API to check the gzip uploads of the wardriving logs.
+
+Build the firmware against it with
+    -DWIGLE_HOST='"192.168.1.10"' -DWIGLE_PORT=8080 -DWIGLE_TLS=0
+then run
+    python3 test/host/wigle_receiver.py --port 8080 --save /tmp/wigle
+
+Every upload is checked: Content-Length against the bytes received, the multipart framing, the
+gzip CRC and size (gzip.decompress) and the WiGLE CSV headers. The device is told success only when
+all of them pass, so a failed check also shows up as a retry on the device. --fail N answers the
+first N uploads with an error to exercise the retries and the resume state.
+"""
+
+import argparse
+import email.parser
+import email.policy
+import gzip
+import json
+import os
+import sys
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+CSV_COLUMNS = (
+    "MAC,SSID,AuthMode,FirstSeen,Channel,Frequency,RSSI,CurrentLatitude,CurrentLongitude,"
+    "AltitudeMeters,AccuracyMeters,RCOIs,MfgrId,Type"
+)
+
+
+def check_upload(headers, body):
+    """Returns (filename, csv text), raises ValueError on the first problem found"""
+    declared = int(headers.get("Content-Length", -1))
+    if declared != len(body):
+        raise ValueError(f"Content-Length {declared}, {len(body)} bytes received")
+
+    content_type = headers.get("Content-Type", "")
+    if not content_type.startswith("multipart/form-data; boundary="):
+        raise ValueError(f"unexpected Content-Type {content_type!r}")
+    message = email.parser.BytesParser(policy=email.policy.HTTP).parsebytes(
+        b"Content-Type: " + content_type.encode() + b"\r\n\r\n" + body
+    )
+    if not message.is_multipart():
+        raise ValueError("body is not multipart")
+    parts = [p for p in message.iter_parts() if p.get_param("name", header="content-disposition") == "file"]
+    if len(parts) != 1:
+        raise ValueError(f"{len(parts)} file parts")
+    part = parts[0]
+    filename = part.get_filename() or ""
+    data = part.get_payload(decode=True)
+
+    if filename.endswith(".gz"):
+        if part.get_content_type() != "application/gzip":
+            raise ValueError(f"{filename} sent as {part.get_content_type()}")
+        try:
+            data = gzip.decompress(data)  # checks the CRC-32 and ISIZE of the trailer
+        except (OSError, EOFError) as e:
+            raise ValueError(f"gzip: {e}") from e
+
+    text = data.decode("utf-8", errors="replace")
+    lines = text.splitlines()
+    if len(lines) < 2 or not lines[0].startswith("WigleWifi-1.6,") or lines[1] != CSV_COLUMNS:
+        raise ValueError("not a WiGLE CSV log")
+    columns = CSV_COLUMNS.count(",") + 1
+    for number, line in enumerate(lines[2:], start=3):
+        # Quoted SSIDs may hold commas, count the fields outside the quotes
+        fields, quoted = 1, False
+        for c in line:
+            if c == '"':
+                quoted = not quoted
+            elif c == "," and not quoted:
+                fields += 1
+        if fields != columns:
+            raise ValueError(f"line {number} has {fields} fields: {line!r}")
+    return filename, text
+
+
+class Handler(BaseHTTPRequestHandler):
+    server_version = "WigleStandIn/1.0"
+
+    def reply(self, code, document):
+        # Compact separators, the device looks for "success":true
+        payload = json.dumps(document, separators=(",", ":")).encode()
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(payload)))
+        self.end_headers()
+        self.wfile.write(payload)
+
+    def do_GET(self):
+        if self.path == "/api/v2/profile/user":
+            self.reply(200, {"success": True, "userid": "bruce-test"})
+        else:
+            self.reply(404, {"success": False, "message": "not found"})
+
+    def do_POST(self):
+        if self.path != "/api/v2/file/upload":
+            self.reply(404, {"success": False, "message": "not found"})
+            return
+        length = int(self.headers.get("Content-Length", 0))
+        self.connection.settimeout(30)
+        body = b""
+        try:
+            while len(body) < length:
+                chunk = self.rfile.read(min(65536, length - len(body)))
+                if not chunk:
+                    break
+                body += chunk
+        except TimeoutError:
+            pass
+
+        try:
+            filename, text = check_upload(self.headers, body)
+        except ValueError as e:
+            print(f"REJECTED: {e}", flush=True)
+            self.reply(400, {"success": False, "message": str(e)})
+            return
+
+        rows = len(text.splitlines()) - 2
+        if self.server.fail > 0:
+            self.server.fail -= 1
+            print(f"valid {filename} ({rows} networks), failing it on purpose", flush=True)
+            self.reply(500, {"success": False, "message": "forced failure"})
+            return
+        print(f"OK {filename}: {len(body)} bytes sent, {len(text)} bytes of CSV, {rows} networks", flush=True)
+        if self.server.save:
+            os.makedirs(self.server.save, exist_ok=True)
+            path = os.path.join(self.server.save, os.path.basename(filename).removesuffix(".gz"))
+            with open(path, "w") as f:
+                f.write(text)
+        self.reply(200, {"success": True, "results": {"filename": filename, "networks": rows}})
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--save", help="directory for the decompressed logs")
+    parser.add_argument("--fail", type=int, default=0, help="answer the first N valid uploads with an error")
+    args = parser.parse_args()
+    server = HTTPServer(("0.0.0.0", args.port), Handler)
+    server.save = args.save
+    server.fail = args.fail
+    print(f"Listening on port {args.port}", flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())